@@ -0,0 +1,505 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_ANSI_SCANNER_H
+#define MZ_ANSI_SCANNER_H
+#pragma once
+
+/**
+ * @file AnsiScanner.h
+ * @brief Fast scanning of terminal output for escape sequences
+ *
+ * The functions in namespace mz::ansi split terminal output into text and
+ * escape sequences. ESC characters are located with SSE2 vector compares
+ * where available (with a scalar fallback), and the bodies of CSI, OSC and
+ * string sequences are skipped with a small state machine. On top of that
+ * they strip escapes, list spans, measure visible width and compute the
+ * cells a buffer paints, which is used to check that a box stays inside
+ * its Area.
+ *
+ * Both byte buffers and the wide buffers of the widgets are accepted. A
+ * wide buffer is measured the way mz::Write sends it: every unit carries up
+ * to two bytes of UTF-8, low byte first, and NUL bytes are not shown.
+ *
+ * @author Meysam Zare
+ */
+
+#include "coord.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <bit>
+#include <type_traits>
+#include <algorithm>
+#include <climits>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MZ_ANSI_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mz::ansi {
+
+    /**
+     * @brief Kind of a span of terminal output
+     */
+    enum class span_kind : uint8_t {
+        text,       ///< Characters and C0 controls
+        csi,        ///< Control sequence (ESC [ ... final)
+        osc,        ///< Operating system command (ESC ] ... BEL or ST)
+        string,     ///< DCS, SOS, PM or APC string (ESC P/X/^/_ ... ST)
+        escape      ///< Any other escape sequence
+    };
+
+    /**
+     * @brief A run of terminal output
+     */
+    struct span {
+        size_t Offset{ 0 };                     ///< Start in the scanned buffer
+        size_t Length{ 0 };                     ///< Number of units
+        span_kind Kind{ span_kind::text };      ///< What the run is
+    };
+
+    /**
+     * @brief Cells painted by a buffer
+     */
+    struct paint_extent {
+        coord_box Box;              ///< Bounding box of painted cells
+        bool Empty{ true };         ///< Nothing was painted
+        bool Unbounded{ false };    ///< An erase reached the edge of the screen
+
+        /**
+         * @brief Check whether all painted cells lie inside an area
+         */
+        bool inside(coord_box Area) const noexcept {
+            return Empty || (!Unbounded && Area.contains(Box));
+        }
+    };
+
+    namespace detail {
+
+        /**
+         * @brief Check whether a byte starts a shown character
+         *
+         * Printable ASCII and UTF-8 lead bytes count; C0 controls, DEL,
+         * NUL and UTF-8 continuation bytes do not.
+         */
+        constexpr bool shown_byte(uint8_t b) noexcept {
+            return (b >= 0x20 && b < 0x7F) || b >= 0xC0;
+        }
+
+        /**
+         * @brief Cells shown by one unit of a buffer
+         */
+        template <typename Ch>
+        constexpr int unit_width(Ch c) noexcept {
+            auto u = static_cast<std::make_unsigned_t<Ch>>(c);
+            if constexpr (sizeof(Ch) == 1) {
+                return shown_byte(u);
+            }
+            else {
+                return shown_byte(static_cast<uint8_t>(u & 0xFF))
+                    + shown_byte(static_cast<uint8_t>((u >> 8) & 0xFF));
+            }
+        }
+
+        /**
+         * @brief Get a unit as an unsigned number
+         */
+        template <typename Ch>
+        constexpr uint32_t code(Ch c) noexcept {
+            return static_cast<uint32_t>(static_cast<std::make_unsigned_t<Ch>>(c));
+        }
+
+#if defined(MZ_ANSI_SSE2)
+        /**
+         * @brief Compare 16 bytes with ESC
+         *
+         * @return Byte mask with sizeof(Ch) bits set for each ESC unit
+         */
+        template <typename Ch>
+        inline unsigned esc_mask(Ch const* Ptr) noexcept {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(Ptr));
+            if constexpr (sizeof(Ch) == 1) {
+                return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8(0x1B))));
+            }
+            else if constexpr (sizeof(Ch) == 2) {
+                return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi16(v, _mm_set1_epi16(0x1B))));
+            }
+            else {
+                return static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi32(v, _mm_set1_epi32(0x1B))));
+            }
+        }
+
+        /**
+         * @brief Count shown bytes among 16 bytes
+         *
+         * For 4-byte units only the two low bytes of each unit are looked at.
+         */
+        template <typename Ch>
+        inline int shown_count(Ch const* Ptr) noexcept {
+            __m128i v = _mm_loadu_si128(reinterpret_cast<__m128i const*>(Ptr));
+            if constexpr (sizeof(Ch) == 4) {
+                v = _mm_and_si128(v, _mm_set1_epi32(0xFFFF));
+            }
+            // As signed bytes: printable ASCII is 32..126, UTF-8 lead bytes are -64..-1
+            __m128i Ascii = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(31)), _mm_cmplt_epi8(v, _mm_set1_epi8(127)));
+            __m128i Lead = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(-65)), _mm_cmplt_epi8(v, _mm_setzero_si128()));
+            return std::popcount(static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(Ascii, Lead))));
+        }
+#endif
+
+        /**
+         * @brief Parse the numeric parameters of a CSI sequence
+         *
+         * @param Body Units between "ESC [" and the final character
+         * @param Params Receives up to N parameters (0 where omitted)
+         * @return Number of parameters, or -1 for private sequences
+         */
+        template <typename Ch, size_t N>
+        int csi_params(std::basic_string_view<Ch> Body, int(&Params)[N]) noexcept {
+            std::fill(std::begin(Params), std::end(Params), 0);
+            if (!Body.empty() && code(Body[0]) >= 0x3C && code(Body[0]) <= 0x3F) {
+                return -1;
+            }
+            size_t Count{ 0 };
+            for (Ch c : Body) {
+                uint32_t u = code(c);
+                if (u >= '0' && u <= '9') {
+                    if (Count < N) {
+                        Params[Count] = std::min(Params[Count] * 10 + static_cast<int>(u - '0'), 99999);
+                    }
+                }
+                else if (u == ';') {
+                    ++Count;
+                }
+            }
+            return static_cast<int>(std::min(Count + 1, N));
+        }
+
+    } // namespace detail
+
+    /**
+     * @brief Find the next ESC unit
+     *
+     * @param Text Buffer to search
+     * @param From Position to start at
+     * @return Position of the ESC, or npos if there is none
+     */
+    template <typename Ch>
+    size_t find_escape(std::basic_string_view<Ch> Text, size_t From = 0) noexcept {
+        size_t n = Text.size();
+        size_t i = From;
+#if defined(MZ_ANSI_SSE2)
+        constexpr size_t Step = 16 / sizeof(Ch);
+        for (; i + Step <= n; i += Step) {
+            unsigned m = detail::esc_mask(Text.data() + i);
+            if (m) {
+                return i + static_cast<size_t>(std::countr_zero(m)) / sizeof(Ch);
+            }
+        }
+#endif
+        for (; i < n; i++) {
+            if (detail::code(Text[i]) == 0x1B) {
+                return i;
+            }
+        }
+        return std::basic_string_view<Ch>::npos;
+    }
+
+    /**
+     * @brief Find the end of the escape sequence starting at an ESC
+     *
+     * Unterminated sequences end at the end of the buffer. A CSI sequence
+     * broken by an unexpected unit ends before that unit.
+     *
+     * @param Text Buffer holding the sequence
+     * @param Pos Position of the ESC
+     * @param Kind Receives the kind of the sequence (optional)
+     * @return Position just after the sequence
+     */
+    template <typename Ch>
+    size_t sequence_end(std::basic_string_view<Ch> Text, size_t Pos, span_kind* Kind = nullptr) noexcept {
+        size_t n = Text.size();
+        span_kind k{ span_kind::escape };
+        size_t q = Pos + 1;
+
+        if (q >= n) {
+            q = n;
+        }
+        else {
+            uint32_t c = detail::code(Text[q]);
+            if (c == '[') {
+                // Parameters and intermediates, then one final character
+                k = span_kind::csi;
+                for (++q; q < n && detail::code(Text[q]) >= 0x20 && detail::code(Text[q]) <= 0x3F; ++q) {}
+                if (q < n && detail::code(Text[q]) >= 0x40 && detail::code(Text[q]) <= 0x7E) {
+                    ++q;
+                }
+            }
+            else if (c == ']' || c == 'P' || c == 'X' || c == '^' || c == '_') {
+                // Strings end with BEL or ST (ESC \)
+                k = c == ']' ? span_kind::osc : span_kind::string;
+                for (++q; q < n; ++q) {
+                    uint32_t u = detail::code(Text[q]);
+                    if (u == 0x07) {
+                        ++q;
+                        break;
+                    }
+                    if (u == 0x1B && q + 1 < n && detail::code(Text[q + 1]) == '\\') {
+                        q += 2;
+                        break;
+                    }
+                }
+            }
+            else {
+                // Optional intermediates, then one final character
+                while (q < n && detail::code(Text[q]) >= 0x20 && detail::code(Text[q]) <= 0x2F) {
+                    ++q;
+                }
+                q = std::min(q + 1, n);
+            }
+        }
+
+        if (Kind) *Kind = k;
+        return q;
+    }
+
+    /**
+     * @brief Call a function for each span of a buffer
+     *
+     * @param Text Buffer to scan
+     * @param Fn Called with each span in order
+     */
+    template <typename Ch, typename F>
+    void scan(std::basic_string_view<Ch> Text, F&& Fn) {
+        size_t Pos{ 0 };
+        while (Pos < Text.size()) {
+            size_t Esc = find_escape(Text, Pos);
+            if (Esc == std::basic_string_view<Ch>::npos) {
+                Esc = Text.size();
+            }
+            if (Esc > Pos) {
+                Fn(span{ Pos, Esc - Pos, span_kind::text });
+            }
+            if (Esc == Text.size()) {
+                break;
+            }
+            span_kind Kind;
+            size_t End = sequence_end(Text, Esc, &Kind);
+            Fn(span{ Esc, End - Esc, Kind });
+            Pos = End;
+        }
+    }
+
+    /**
+     * @brief List the spans of a buffer
+     *
+     * @param Text Buffer to scan
+     * @param Spans Receives the spans (cleared first)
+     */
+    template <typename Ch>
+    void spans(std::basic_string_view<Ch> Text, std::vector<span>& Spans) {
+        Spans.clear();
+        scan(Text, [&](span s) { Spans.push_back(s); });
+    }
+
+    /**
+     * @brief Append a buffer with all escape sequences removed
+     *
+     * @param Text Buffer to strip
+     * @param Out Receives the text and control characters
+     */
+    template <typename Ch>
+    void strip(std::basic_string_view<Ch> Text, std::basic_string<Ch>& Out) {
+        scan(Text, [&](span s) {
+            if (s.Kind == span_kind::text) {
+                Out.append(Text.substr(s.Offset, s.Length));
+            }
+            });
+    }
+
+    /**
+     * @brief Get a buffer with all escape sequences removed
+     */
+    template <typename Ch>
+    std::basic_string<Ch> strip(std::basic_string_view<Ch> Text) {
+        std::basic_string<Ch> Out;
+        Out.reserve(Text.size());
+        strip(Text, Out);
+        return Out;
+    }
+
+    /**
+     * @brief Count the cells shown by text without escape sequences
+     *
+     * Each printable ASCII character or UTF-8 lead byte is one cell.
+     */
+    template <typename Ch>
+    size_t text_width(std::basic_string_view<Ch> Text) noexcept {
+        size_t Width{ 0 };
+        size_t i{ 0 };
+#if defined(MZ_ANSI_SSE2)
+        if constexpr (std::endian::native == std::endian::little) {
+            constexpr size_t Step = 16 / sizeof(Ch);
+            for (; i + Step <= Text.size(); i += Step) {
+                Width += static_cast<size_t>(detail::shown_count(Text.data() + i));
+            }
+        }
+#endif
+        for (; i < Text.size(); i++) {
+            Width += static_cast<size_t>(detail::unit_width(Text[i]));
+        }
+        return Width;
+    }
+
+    /**
+     * @brief Count the cells shown by a buffer
+     *
+     * Escape sequences take no cells. Cursor movement is not followed, so
+     * this is the number of characters written, not the width of a line.
+     */
+    template <typename Ch>
+    size_t visible_width(std::basic_string_view<Ch> Text) noexcept {
+        size_t Width{ 0 };
+        scan(Text, [&](span s) {
+            if (s.Kind == span_kind::text) {
+                Width += text_width(Text.substr(s.Offset, s.Length));
+            }
+            });
+        return Width;
+    }
+
+    /**
+     * @brief Compute the cells a buffer paints
+     *
+     * Follows cursor positioning (CUP, HVP, CUU/CUD/CUF/CUB, CNL/CPL, CHA,
+     * VPA, save and restore), CR, LF, BS and TAB, and records every cell
+     * that receives a character or is erased with ECH or EL. Erasing a
+     * whole line or screen marks the extent as unbounded.
+     *
+     * @param Text Buffer to follow
+     * @param Start Cursor position before the buffer is written
+     * @return Bounding box of painted cells
+     */
+    template <typename Ch>
+    paint_extent painted_area(std::basic_string_view<Ch> Text, coord Start = coord{}) noexcept {
+        paint_extent Result;
+        int Row{ Start.Row }, Col{ Start.Col };
+        int SavedRow{ Row }, SavedCol{ Col };
+        int Top{ INT_MAX }, Left{ INT_MAX }, Bottom{ INT_MIN }, Right{ INT_MIN };
+
+        auto paint = [&](int r, int c0, int c1) {
+            Top = std::min(Top, r);
+            Bottom = std::max(Bottom, r);
+            Left = std::min(Left, c0);
+            Right = std::max(Right, c1);
+            Result.Empty = false;
+        };
+
+        scan(Text, [&](span s) {
+            auto Body = Text.substr(s.Offset, s.Length);
+            if (s.Kind == span_kind::text) {
+                for (Ch c : Body) {
+                    uint32_t u = detail::code(c);
+                    if (u == '\r') Col = 0;
+                    else if (u == '\n') ++Row;
+                    else if (u == '\b') Col = std::max(Col - 1, 0);
+                    else if (u == '\t') Col = (Col / 8 + 1) * 8;
+                    else {
+                        int w = detail::unit_width(c);
+                        if (w > 0) {
+                            paint(Row, Col, Col + w - 1);
+                            Col += w;
+                        }
+                    }
+                }
+            }
+            else if (s.Kind == span_kind::csi && s.Length >= 3) {
+                int p[2];
+                int Count = detail::csi_params(Body.substr(2, s.Length - 3), p);
+                if (Count < 0) return;
+                int n = std::max(p[0], 1);
+                switch (detail::code(Body.back())) {
+                case 'H': case 'f': Row = std::max(p[0], 1) - 1; Col = std::max(p[1], 1) - 1; break;
+                case 'A': Row = std::max(Row - n, 0); break;
+                case 'B': Row += n; break;
+                case 'C': Col += n; break;
+                case 'D': Col = std::max(Col - n, 0); break;
+                case 'E': Row += n; Col = 0; break;
+                case 'F': Row = std::max(Row - n, 0); Col = 0; break;
+                case 'G': Col = n - 1; break;
+                case 'd': Row = n - 1; break;
+                case 'X': paint(Row, Col, Col + n - 1); break;
+                case 'K':
+                    paint(Row, p[0] == 0 ? Col : 0, Col);
+                    if (p[0] != 1) Result.Unbounded = true;
+                    break;
+                case 'J': Result.Empty = false; Result.Unbounded = true; break;
+                case 's': SavedRow = Row; SavedCol = Col; break;
+                case 'u': Row = SavedRow; Col = SavedCol; break;
+                default: break;
+                }
+            }
+            else if (s.Kind == span_kind::escape && s.Length == 2) {
+                uint32_t c = detail::code(Body[1]);
+                if (c == '7') { SavedRow = Row; SavedCol = Col; }
+                else if (c == '8') { Row = SavedRow; Col = SavedCol; }
+            }
+            });
+
+        if (!Result.Empty && Top <= Bottom) {
+            Result.Box = coord_box{ coord(Top, Left), coord(Bottom, Right) };
+        }
+        return Result;
+    }
+
+    /**
+     * @brief Check whether a buffer paints any cell outside an area
+     *
+     * @param Text Buffer to follow
+     * @param Area Area the buffer should stay in
+     * @return true if a cell outside Area is painted
+     */
+    template <typename Ch>
+    bool writes_outside(std::basic_string_view<Ch> Text, coord_box Area) noexcept {
+        return !painted_area(Text, Area.Top).inside(Area);
+    }
+
+    // Deduction helpers for strings and literals
+
+    inline size_t find_escape(std::wstring_view Text, size_t From = 0) noexcept { return find_escape<wchar_t>(Text, From); }
+    inline size_t find_escape(std::string_view Text, size_t From = 0) noexcept { return find_escape<char>(Text, From); }
+    inline std::wstring strip(std::wstring_view Text) { return strip<wchar_t>(Text); }
+    inline std::string strip(std::string_view Text) { return strip<char>(Text); }
+    inline size_t visible_width(std::wstring_view Text) noexcept { return visible_width<wchar_t>(Text); }
+    inline size_t visible_width(std::string_view Text) noexcept { return visible_width<char>(Text); }
+    inline paint_extent painted_area(std::wstring_view Text, coord Start = coord{}) noexcept { return painted_area<wchar_t>(Text, Start); }
+    inline bool writes_outside(std::wstring_view Text, coord_box Area) noexcept { return writes_outside<wchar_t>(Text, Area); }
+
+} // namespace mz::ansi
+
+#endif // MZ_ANSI_SCANNER_H
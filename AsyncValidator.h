@@ -0,0 +1,356 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_ASYNC_VALIDATOR_H
+#define MZ_ASYNC_VALIDATOR_H
+#pragma once
+
+/**
+ * @file AsyncValidator.h
+ * @brief Debounced validation of input text on a background thread
+ *
+ * AsyncValidator runs a possibly slow check, such as a stat() on a network
+ * mount, away from the input loop. Each keystroke files a request; the check
+ * starts once the text has been stable for the debounce delay, and only the
+ * result for the latest request is reported. Recent results are cached, so
+ * editing back to a known text answers at once.
+ *
+ * @author Meysam Zare
+ */
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @class AsyncValidator
+     * @brief Validates text on a worker thread, debounced and cancellable
+     *
+     * @code
+     * AsyncValidator Check([](std::wstring_view Path) { return path_error(Path, false); });
+     * Input.OnChange = [&](InputControl& In) { Check.request(In.Text); };
+     * Input.OnIdle = [&](InputControl&) {
+     *     int Error;
+     *     if (Check.poll(Error)) show(Error);
+     * };
+     * @endcode
+     */
+    class AsyncValidator {
+    public:
+        /**
+         * @brief Check that returns 0 for valid text, or error bits
+         */
+        using check_fn = std::function<int(std::wstring_view)>;
+
+        /**
+         * @brief State of the latest request
+         */
+        enum class status {
+            idle,       ///< Nothing requested, or the request was cancelled
+            pending,    ///< Waiting for the debounce delay or the check
+            ready,      ///< Result available
+        };
+
+    private:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Cached result of a check
+         */
+        struct cache_entry {
+            std::wstring Text;
+            int Error{ 0 };
+            clock::time_point When;
+        };
+
+        /**
+         * @brief State shared with the worker
+         *
+         * The worker owns a reference, so a check that never returns does
+         * not hold up the destruction of the validator.
+         */
+        struct shared_state {
+            check_fn Check;
+            std::chrono::milliseconds Debounce;
+            std::chrono::milliseconds CacheLife;
+            size_t CacheSize;
+
+            std::mutex Lock;
+            std::condition_variable Wake;       ///< Signals the worker
+            std::condition_variable Finished;   ///< Signals waiters that a result arrived
+
+            std::wstring Text;                  ///< Text of the latest request
+            uint64_t Requested{ 0 };            ///< Generation of the latest request
+            uint64_t Completed{ 0 };            ///< Generation of the latest result
+            uint64_t Reported{ 0 };             ///< Generation last returned by poll()
+            int Error{ 0 };                     ///< Latest result
+            bool Queued{ false };               ///< Worker has a request to run
+            bool Active{ false };               ///< Latest request was not cancelled
+            bool Stopping{ false };             ///< Validator was destroyed
+            clock::time_point Due;              ///< When the queued request may start
+            clock::time_point Checked;          ///< When the latest result was computed
+            std::vector<cache_entry> Cache;     ///< Recent results, most recent last
+
+            /**
+             * @brief Find a fresh cached result (Lock held)
+             */
+            cache_entry const* find(std::wstring_view Key, clock::time_point Now) const noexcept {
+                for (auto it = Cache.rbegin(); it != Cache.rend(); ++it) {
+                    if (it->Text == Key) {
+                        return Now - it->When <= CacheLife ? &*it : nullptr;
+                    }
+                }
+                return nullptr;
+            }
+
+            /**
+             * @brief Record a result in the cache (Lock held)
+             */
+            void remember(std::wstring_view Key, int Result, clock::time_point Now) {
+                std::erase_if(Cache, [&](cache_entry const& e) { return e.Text == Key; });
+                if (Cache.size() >= CacheSize && !Cache.empty()) {
+                    Cache.erase(Cache.begin());
+                }
+                if (CacheSize) {
+                    Cache.push_back(cache_entry{ std::wstring(Key), Result, Now });
+                }
+            }
+        };
+
+        std::shared_ptr<shared_state> State;
+
+        /**
+         * @brief Worker thread body
+         */
+        static void work(std::shared_ptr<shared_state> S) noexcept {
+            std::unique_lock<std::mutex> Guard(S->Lock);
+            while (true) {
+                S->Wake.wait(Guard, [&] { return S->Stopping || S->Queued; });
+                if (S->Stopping) return;
+
+                // Every new keystroke moves Due, so wait until the text settles
+                if (clock::now() < S->Due) {
+                    S->Wake.wait_until(Guard, S->Due);
+                    continue;
+                }
+
+                uint64_t Generation = S->Requested;
+                std::wstring Text = S->Text;
+                S->Queued = false;
+
+                Guard.unlock();
+                int Error = S->Check(Text);
+                Guard.lock();
+
+                // Stale results still go to the cache
+                S->remember(Text, Error, clock::now());
+                if (Generation == S->Requested) {
+                    S->Error = Error;
+                    S->Checked = clock::now();
+                    S->Completed = Generation;
+                    S->Finished.notify_all();
+                }
+            }
+        }
+
+    public:
+        /**
+         * @brief Start the validator and its worker thread
+         *
+         * @param Check Check to run; called on the worker thread only
+         * @param Debounce Quiet time after the last request before checking
+         * @param CacheSize Number of recent results to remember
+         * @param CacheLife How long a remembered result stays valid
+         */
+        explicit AsyncValidator(check_fn Check,
+            std::chrono::milliseconds Debounce = std::chrono::milliseconds(150),
+            size_t CacheSize = 64,
+            std::chrono::milliseconds CacheLife = std::chrono::milliseconds(5000))
+            : State{ std::make_shared<shared_state>() } {
+            State->Check = std::move(Check);
+            State->Debounce = Debounce;
+            State->CacheSize = CacheSize;
+            State->CacheLife = CacheLife;
+            std::thread(work, State).detach();
+        }
+
+        AsyncValidator(AsyncValidator const&) = delete;
+        AsyncValidator& operator=(AsyncValidator const&) = delete;
+
+        /**
+         * @brief Stop the worker
+         *
+         * Does not wait for a check in progress; the worker exits once the
+         * check returns.
+         */
+        ~AsyncValidator() noexcept {
+            {
+                std::lock_guard<std::mutex> Guard(State->Lock);
+                State->Stopping = true;
+            }
+            State->Wake.notify_all();
+        }
+
+        /**
+         * @brief Request validation of a text
+         *
+         * Supersedes any earlier request. A fresh cached result is available
+         * at once; otherwise the check starts after the debounce delay.
+         * Requesting the text of the latest request again changes nothing
+         * while its result is pending or younger than the cache life.
+         */
+        void request(std::wstring_view Text) {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            auto Now = clock::now();
+            if (State->Active && State->Text == Text
+                && (State->Completed != State->Requested || Now - State->Checked <= State->CacheLife)) {
+                return;
+            }
+            uint64_t Generation = ++State->Requested;
+            State->Text.assign(Text);
+            State->Active = true;
+
+            if (auto Hit = State->find(Text, Now)) {
+                State->Error = Hit->Error;
+                State->Checked = Hit->When;
+                State->Completed = Generation;
+                State->Queued = false;
+                State->Finished.notify_all();
+                return;
+            }
+            State->Due = Now + State->Debounce;
+            State->Queued = true;
+            State->Wake.notify_one();
+        }
+
+        /**
+         * @brief Check a text again at once, ignoring cached results
+         *
+         * For a final decision, such as the user pressing Enter, that must
+         * reflect the current state rather than a recent one.
+         */
+        void check_now(std::wstring_view Text) {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            ++State->Requested;
+            State->Text.assign(Text);
+            State->Active = true;
+            State->Due = clock::now();
+            State->Queued = true;
+            State->Wake.notify_one();
+        }
+
+        /**
+         * @brief Start the pending check without waiting for the debounce delay
+         */
+        void flush() noexcept {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            if (State->Queued) {
+                State->Due = clock::now();
+                State->Wake.notify_one();
+            }
+        }
+
+        /**
+         * @brief Drop the latest request; its result will not be reported
+         */
+        void cancel() noexcept {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            ++State->Requested;
+            State->Queued = false;
+            State->Active = false;
+            State->Text.clear();
+        }
+
+        /**
+         * @brief Get the state of the latest request
+         *
+         * @param Error Receives the result when the state is ready
+         */
+        status get(int& Error) const noexcept {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            if (State->Completed == State->Requested && State->Requested) {
+                Error = State->Error;
+                return status::ready;
+            }
+            return State->Active ? status::pending : status::idle;
+        }
+
+        /**
+         * @brief Report the result of the latest request once
+         *
+         * @param Error Receives the result
+         * @return true if a result arrived since the last call
+         */
+        bool poll(int& Error) noexcept {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            if (State->Completed != State->Requested || State->Reported == State->Completed) {
+                return false;
+            }
+            State->Reported = State->Completed;
+            Error = State->Error;
+            return true;
+        }
+
+        /**
+         * @brief Wait for the result of the latest request
+         *
+         * @param Timeout Longest wait
+         * @param Error Receives the result
+         * @return true if the result arrived in time
+         */
+        bool wait_for(std::chrono::milliseconds Timeout, int& Error) noexcept {
+            std::unique_lock<std::mutex> Guard(State->Lock);
+            bool Ready = State->Finished.wait_for(Guard, Timeout, [&] {
+                return State->Requested && State->Completed == State->Requested;
+                });
+            if (Ready) {
+                Error = State->Error;
+            }
+            return Ready;
+        }
+
+        /**
+         * @brief Forget all cached results
+         *
+         * The next request is checked again even if its text is unchanged.
+         */
+        void clear_cache() noexcept {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            State->Cache.clear();
+            State->Active = false;
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_ASYNC_VALIDATOR_H
@@ -38,8 +38,10 @@
  */
 
 #include "FrameBox.h"
+#include "TemplateBuffer.h"
 #include <string>
 #include <string_view>
+#include <vector>
 #include <algorithm>
 #include <thread>
 
@@ -79,7 +81,8 @@ namespace mz {
         void set_passive(long long Index) noexcept {
             Temp.clear();
             Color.apply(Temp);
-            bf.replace(LineBlockSize * Index, Temp.size(), Temp);
+            Temp.append(Preamble, 23);
+            Line.patch(bf, static_cast<int>(Index), StyleSlot, Temp);
         }
 
         /**
@@ -92,9 +95,36 @@ namespace mz {
         void set_active(long long Index) noexcept {
             Temp.clear();
             FocusColor.apply(Temp);
-            bf.replace(LineBlockSize * Index, Temp.size(), Temp);
+            Temp.append(Preamble, 23);
+            Line.patch(bf, static_cast<int>(Index), StyleSlot, Temp);
         }
 
+        /**
+         * @brief Slot layout of a button line
+         *
+         * Each line is the style (colors and preamble), the button position
+         * and the text. Focus changes patch the style slot, so only the two
+         * affected buttons are written out.
+         */
+        template_buffer Line;
+
+        /**
+         * @brief Style slot index in Line
+         */
+        int StyleSlot{ 0 };
+
+        /**
+         * @brief Text slot index in Line
+         */
+        int TextSlot{ 0 };
+
+        /**
+         * @brief Inputs of each button's text slot
+         *
+         * Lets update_button() skip composing a text that is already in place.
+         */
+        std::vector<render_memo> TextMemos;
+
         /**
          * @brief Offset to coordinate position in buffer
          *
@@ -132,6 +162,12 @@ namespace mz {
             int ButtonWidth = Area.num_cols();
             if (Index < 0 || Index >= NumButtons) { return true; }
 
+            // Skip composing a text that is already in place
+            uint64_t Hash = render_hash{}.add(wv).add(Alignment).add(ButtonWidth).value();
+            if (static_cast<size_t>(Index) < TextMemos.size() && TextMemos[Index].matches(Hash)) {
+                return false;
+            }
+
             // Calculate padding based on alignment
             int ViewLength = static_cast<int>(wv.size());
             int LeftPadding = 0;
@@ -156,22 +192,26 @@ namespace mz {
             }
 
             // Prepare the formatted button text
-            std::wstring Line;
-            Line.reserve(static_cast<size_t>(ButtonWidth));
+            std::wstring Text;
+            Text.reserve(static_cast<size_t>(ButtonWidth));
 
             if (LeftPadding > 0) {
-                Line.append(static_cast<size_t>(LeftPadding), ' ');
+                Text.append(static_cast<size_t>(LeftPadding), ' ');
             }
 
-            Line.append(wv.substr(0, static_cast<size_t>(ViewLength)));
+            Text.append(wv.substr(0, static_cast<size_t>(ViewLength)));
 
             if (RightPadding > 0) {
-                Line.append(static_cast<size_t>(RightPadding), ' ');
+                Text.append(static_cast<size_t>(RightPadding), ' ');
             }
 
             // Update the button text in the buffer
-            bf.replace(Index * LineBlockSize + LineBlockTextOffset, Line.size(), Line);
-
+            if (Line.patch(bf, Index, TextSlot, Text)) {
+                return true;
+            }
+            if (static_cast<size_t>(Index) < TextMemos.size()) {
+                TextMemos[Index].store(Hash);
+            }
             return false;
         }
 
@@ -205,22 +245,26 @@ namespace mz {
             // Clear and prepare the buffer
             bf.clear();
 
-            // Apply base color and save position
+            // Apply base color and formatting control sequences
             Color.apply(bf);
+            bf.append(Preamble, 23);
             LineBlockCoordOffset = static_cast<int>(bf.size());
 
             // Add position placeholder
             Area.Top.apply(bf);
-
-            // Add formatting control sequences
-            bf.append(Preamble, 23);
             LineBlockTextOffset = static_cast<int>(bf.size());
 
             // Calculate the total size of each button block
             LineBlockSize = LineBlockTextOffset + ButtonWidth;
 
+            // Describe the line layout
+            Line.reset(LineBlockSize);
+            StyleSlot = Line.add(L"style", template_buffer::slot_kind::style, 0, LineBlockCoordOffset);
+            TextSlot = Line.add(L"text", template_buffer::slot_kind::text, LineBlockTextOffset, ButtonWidth);
+
             // Reset the buffer to empty
             bf.clear();
+            TextMemos.clear();
         }
 
         /**
@@ -240,15 +284,14 @@ namespace mz {
             // Increase area height for new button
             Area.set_rows(NumButtons);
 
-            // Apply color and position
+            // Apply color, formatting sequences and position
             Color.apply(bf);
-            Area.Top.offset(Index, 0).apply(bf);
-
-            // Add formatting sequences
             bf.append(Preamble, 23);
+            Area.Top.offset(Index, 0).apply(bf);
 
             // Reserve space for button text
             bf.resize(bf.size() + static_cast<size_t>(ButtonWidth));
+            TextMemos.emplace_back();
 
             // Set the button text with specified alignment
             set_button_text(wv, Index, Alignment);
@@ -268,10 +311,7 @@ namespace mz {
                 set_active(FocusIndex + 1);
 
                 // Update display
-                mz::Write(bf.substr(
-                    static_cast<size_t>(LineBlockSize * FocusIndex),
-                    static_cast<size_t>(LineBlockSize * 2)
-                ));
+                flush();
 
                 // Update focus index
                 ++FocusIndex;
@@ -295,10 +335,7 @@ namespace mz {
                 set_active(LastButton);
 
                 // Update display
-                mz::Write(bf.substr(
-                    static_cast<size_t>(LineBlockSize * FocusIndex),
-                    static_cast<size_t>(LineBlockSize * (LastButton - FocusIndex + 1))
-                ));
+                flush();
 
                 // Update focus index
                 FocusIndex = LastButton;
@@ -324,10 +361,7 @@ namespace mz {
                 set_passive(FocusIndex + 1);
 
                 // Update display
-                mz::Write(bf.substr(
-                    static_cast<size_t>(LineBlockSize * FocusIndex),
-                    static_cast<size_t>(LineBlockSize * 2)
-                ));
+                flush();
 
                 return true;
             }
@@ -348,10 +382,7 @@ namespace mz {
                 set_passive(FocusIndex);
 
                 // Update display
-                mz::Write(bf.substr(
-                    0,
-                    static_cast<size_t>(LineBlockSize * (FocusIndex + 1))
-                ));
+                flush();
 
                 // Update focus index
                 FocusIndex = 0;
@@ -382,9 +413,22 @@ namespace mz {
             }
 
             // Render the updated display
+            Line.discard();
             print();
         }
 
+        /**
+         * @brief Write out patched buttons
+         *
+         * Emits only the buttons whose style or text changed since the last
+         * flush, each behind the shortest cursor movement.
+         *
+         * @return Number of slots written
+         */
+        int flush() noexcept {
+            return Line.flush(bf, 0, Area.num_rows(), Area.Top);
+        }
+
         /**
          * @brief Interactive button selection loop
          *
@@ -437,6 +481,7 @@ namespace mz {
             }
 
             // Render the updated display
+            Line.discard();
             mz::Write(bf);
         }
 
@@ -480,7 +525,9 @@ namespace mz {
         /**
          * @brief Set button text for an existing button
          *
-         * Updates the text of a button at the specified index.
+         * Updates the text of a button at the specified index. The change
+         * is shown by the next flush() or full print. Setting the text and
+         * alignment a button already has does nothing.
          *
          * @param index Button index to update
          * @param text New button text
@@ -544,6 +591,7 @@ namespace mz {
             c.append(L"FIVE");
 
             // Display the button box
+            c.Line.discard();
             mz::Write(c.bf);
 
             // Test interaction loop
@@ -41,8 +41,14 @@
 #include "ConsoleCMD.h"
 #include "coord.h"
 #include "cursor.h"
+#include "RenderMemo.h"
+#include "AnsiScanner.h"
+#include "RichText.h"
+#include <iostream>
 #include <string>
 #include <string_view>
+#include <vector>
+#include <span>
 #include <chrono>
 #include <thread>
 #include <algorithm>
@@ -68,6 +74,47 @@ namespace mz {
          */
         std::wstring bf;
 
+        /**
+         * @brief Hash of the content last written by print()
+         */
+        mutable uint64_t PrintedHash{ 0 };
+
+        /**
+         * @brief refresh() has been used, so print() records PrintedHash
+         *
+         * Boxes that are only ever printed unconditionally do not pay for
+         * hashing their buffer.
+         */
+        mutable bool TrackPrints{ false };
+
+        /**
+         * @brief Hash of what print() would write now
+         *
+         * Boxes that print only part of their buffer override this so that
+         * refresh() compares the right bytes.
+         */
+        virtual uint64_t content_hash() const noexcept {
+            return render_hash{}.add(std::wstring_view{ bf }).value();
+        }
+
+        /**
+         * @brief Report output that paints outside Area
+         *
+         * Called by print() in debug builds compiled with MZ_CHECK_AREA.
+         *
+         * @param Out Output about to be written
+         */
+        void check_area(std::wstring_view Out) const noexcept {
+            ansi::paint_extent Painted = ansi::painted_area(Out, Area.Top);
+            if (!Painted.inside(Area)) {
+                std::wcerr << std::format(L"ERROR: Box at ({},{}) size {}x{} paints outside its area{}.\n",
+                    Area.Top.Row, Area.Top.Col, Area.num_rows(), Area.num_cols(),
+                    Painted.Unbounded ? L" (erases to the screen edge)"
+                    : std::format(L" (rows {}-{}, columns {}-{})", Painted.Box.Top.Row, Painted.Box.Bottom.Row,
+                        Painted.Box.Top.Col, Painted.Box.Bottom.Col));
+            }
+        }
+
     public:
         /**
          * @brief Box position and dimensions
@@ -118,10 +165,48 @@ namespace mz {
          * @brief Output the box contents to the terminal
          *
          * Writes the entire buffer to the terminal at once,
-         * minimizing output operations for better performance.
+         * minimizing output operations for better performance. Debug builds
+         * compiled with MZ_CHECK_AREA report output that paints outside Area.
          */
-        void print() const noexcept {
+        virtual void print() const noexcept {
+#if defined(MZ_CHECK_AREA) && !defined(NDEBUG)
+            check_area(bf);
+#endif
             mz::Write(bf);
+            if (TrackPrints) {
+                PrintedHash = content_hash();
+            }
+        }
+
+        /**
+         * @brief Append what print() writes to another buffer
+         *
+         * Lets several boxes be composed into one frame and written at once.
+         *
+         * @param Out Buffer to append to
+         */
+        virtual void render(std::wstring& Out) const {
+            Out.append(bf);
+        }
+
+        /**
+         * @brief Print the box only if its contents changed since the last print
+         *
+         * Suited to periodic redraws where most boxes are unchanged. The
+         * decision is counted in render_counters().
+         *
+         * @return true if the box was printed
+         */
+        bool refresh() const noexcept {
+            uint64_t Hash = content_hash();
+            if (TrackPrints && Hash == PrintedHash) {
+                render_counters().Skipped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            render_counters().Performed.fetch_add(1, std::memory_order_relaxed);
+            TrackPrints = true;
+            print();
+            return true;
         }
 
         /**
@@ -133,6 +218,23 @@ namespace mz {
             return std::wstring_view{ bf };
         }
 
+        /**
+         * @brief Paint the box area in its background color
+         *
+         * Emits one cursor move and one erase-characters command per row,
+         * which makes it a cheap stand-in while the real contents are
+         * still being built.
+         */
+        void print_placeholder() const {
+            std::wstring Temp;
+            Color.apply(Temp);
+            for (int Row = Area.Top.Row; Row <= Area.Bottom.Row; ++Row) {
+                coord{ Row, Area.Top.Col }.apply(Temp);
+                Temp.append(std::format(L"\x1b[{}X", Area.num_cols()));
+            }
+            mz::Write(Temp);
+        }
+
         /**
          * @brief Set box colors
          *
@@ -203,6 +305,130 @@ namespace mz {
      * line and visual effects like blinking.
      */
     class MultilineMessageBox : public BasicBox {
+    private:
+        /**
+         * @brief Colors and area the header and Blank were built for
+         */
+        render_memo HeaderMemo;
+
+        /**
+         * @brief Buffer size of the header
+         */
+        int HeaderSize{ 0 };
+
+        /**
+         * @brief Commands that blank every row, row after row
+         *
+         * print() appends the part for the rows below NextLine, so lines
+         * already in the buffer never need to be padded out again.
+         */
+        std::wstring Blank;
+
+        /**
+         * @brief Offset in Blank where each row starts
+         */
+        std::vector<size_t> BlankOffsets;
+
+        /**
+         * @brief Inputs of each composed line still in the buffer
+         */
+        std::vector<render_memo> LineMemos;
+
+        /**
+         * @brief Buffer size after each composed line
+         */
+        std::vector<int> LineEnds;
+
+        /**
+         * @brief Number of composed lines that can be reused
+         */
+        int ComposedLines{ 0 };
+
+        /**
+         * @brief Composed lines set aside by clear(), for reuse
+         *
+         * Holds the lines from the header on, so the buffer itself only
+         * ever has the lines inserted since the last clear().
+         */
+        std::wstring Stash;
+
+        /**
+         * @brief Size the per-row state for the current area
+         *
+         * Builds the blank rows and forgets every composed line.
+         */
+        void prepare_rows() noexcept {
+            const int NumRows = std::max(Area.num_rows(), 0);
+            const int boxWidth = Area.num_cols();
+            Blank.clear();
+            BlankOffsets.assign(static_cast<size_t>(NumRows), 0);
+            for (int Row = 0; Row < NumRows; Row++) {
+                BlankOffsets[Row] = Blank.size();
+                Area.Top.offset(Row, 0).apply(Blank);
+                Blank.append(boxWidth, ' ');
+            }
+
+            LineMemos.assign(static_cast<size_t>(NumRows), render_memo{});
+            LineEnds.assign(static_cast<size_t>(NumRows), 0);
+            ComposedLines = 0;
+            Stash.clear();
+        }
+
+        /**
+         * @brief Start the line at NextLine
+         *
+         * Copies the composed line back from the stash when its hash
+         * matches; otherwise drops it and everything after it and positions
+         * the cursor for a new line.
+         *
+         * @return true if the line was reused and NextLine advanced
+         */
+        bool reuse_line(uint64_t Hash) noexcept {
+            if (NextLine < ComposedLines && LineMemos[NextLine].matches(Hash)) {
+                const int From = NextLine ? LineEnds[NextLine - 1] : HeaderSize;
+                bf.append(Stash, static_cast<size_t>(From - HeaderSize), static_cast<size_t>(LineEnds[NextLine] - From));
+                NextSize = LineEnds[NextLine];
+                ++NextLine;
+                return true;
+            }
+
+            // Reset the buffer to the position after the previous line
+            bf.resize(NextSize);
+
+            // Position cursor at the current line
+            Area.Top.offset(NextLine, 0).apply(bf);
+            return false;
+        }
+
+        /**
+         * @brief Finish the line composed at NextLine
+         *
+         * @return The line number after insertion
+         */
+        int commit_line(uint64_t Hash) noexcept {
+            // Update the buffer position for the next insertion
+            NextSize = static_cast<int>(bf.size());
+
+            // Lines after this one can no longer be reused
+            LineMemos[NextLine].store(Hash);
+            LineEnds[NextLine] = NextSize;
+            ComposedLines = NextLine + 1;
+
+            // Move to the next line; print() blanks the rows below
+            return ++NextLine;
+        }
+
+    protected:
+        /**
+         * @brief Hash of the lines shown and the number of blank rows
+         */
+        uint64_t content_hash() const noexcept override {
+            return render_hash{}
+                .add(std::wstring_view{ bf }.substr(0, static_cast<size_t>(NextSize)))
+                .add(NextLine)
+                .value();
+        }
+
     public:
         /**
          * @brief Current line index for next insertion
@@ -221,9 +447,27 @@ namespace mz {
         /**
          * @brief Clear the box and reset state
          *
-         * Clears the display area and resets internal tracking.
+         * Clears the display area and resets internal tracking. When colors
+         * and area are unchanged, the composed lines are kept so that
+         * inserting the same lines again does not compose them anew.
          */
         void clear() noexcept override {
+            if (HeaderMemo.matches(render_hash{}.add(Color).add(Area).value())) {
+                // Set the composed lines aside: the lines inserted since the
+                // last clear() replace the start of the stash, unless a new
+                // line made the rest of it unusable
+                const size_t Shown = static_cast<size_t>(NextSize - HeaderSize);
+                Stash.resize(ComposedLines ? static_cast<size_t>(LineEnds[ComposedLines - 1] - HeaderSize) : 0);
+                Stash.replace(0, Shown, bf, static_cast<size_t>(HeaderSize), Shown);
+                bf.resize(static_cast<size_t>(HeaderSize));
+                NextLine = 0;
+                NextSize = HeaderSize;
+                return;
+            }
+
+            // Reset tracking variables
+            NextLine = 0;
+
             // Start with a fresh buffer but maintain capacity
             const size_t currentCapacity = bf.capacity();
             bf.clear();
@@ -237,12 +481,13 @@ namespace mz {
             SetHide(bf);
             ClrUnderline(bf);
 
-            // Reset tracking variables
-            NextLine = 0;
-            NextSize = static_cast<int>(bf.size());
+            HeaderSize = static_cast<int>(bf.size());
+            NextSize = HeaderSize;
 
-            // Clear the entire area with spaces
-            Area.clear(bf);
+            // Prepare the blank rows; no line is composed yet
+            prepare_rows();
+
+            HeaderMemo.store(render_hash{}.add(Color).add(Area).value());
         }
 
         /**
@@ -254,6 +499,34 @@ namespace mz {
             clear();
         }
 
+        /**
+         * @brief Output the lines and blank the rows below them
+         */
+        void print() const noexcept override {
+#if defined(MZ_CHECK_AREA) && !defined(NDEBUG)
+            std::wstring Out;
+            render(Out);
+            check_area(Out);
+#endif
+            mz::Write(std::wstring_view{ bf }.substr(0, static_cast<size_t>(NextSize)));
+            if (NextLine < static_cast<int>(BlankOffsets.size())) {
+                mz::Write(std::wstring_view{ Blank }.substr(BlankOffsets[NextLine]));
+            }
+            if (TrackPrints) {
+                PrintedHash = content_hash();
+            }
+        }
+
+        /**
+         * @brief Append the lines and the blank rows below them to another buffer
+         */
+        void render(std::wstring& Out) const override {
+            Out.append(std::wstring_view{ bf }.substr(0, static_cast<size_t>(NextSize)));
+            if (NextLine < static_cast<int>(BlankOffsets.size())) {
+                Out.append(std::wstring_view{ Blank }.substr(BlankOffsets[NextLine]));
+            }
+        }
+
         /**
          * @brief Insert a line of text
          *
@@ -270,6 +543,8 @@ namespace mz {
          * @brief Insert a line of text with specific color
          *
          * Adds a new line of text to the box with the specified text color.
+         * A line identical to the one inserted at the same row before the
+         * last clear() is reused as it is.
          *
          * @param Msg Text to display
          * @param FrontColor Text color to use
@@ -280,11 +555,15 @@ namespace mz {
             if (NextLine >= Area.num_rows())
                 return NextLine;
 
-            // Reset the buffer to the position after the box setup
-            bf.resize(NextSize);
+            // A box that was never cleared has no per-row state yet
+            if (LineMemos.size() != static_cast<size_t>(Area.num_rows()))
+                prepare_rows();
 
-            // Position cursor at the current line
-            Area.Top.offset(NextLine, 0).apply(bf);
+            // Reuse the line if it is already composed at this row
+            uint64_t Hash = render_hash{}.add(Msg).add(FrontColor).add(Color).add(Area).value();
+            if (reuse_line(Hash)) {
+                return NextLine;
+            }
 
             // Set text color
             FrontColor.setFront(bf);
@@ -314,19 +593,51 @@ namespace mz {
                 }
             }
 
-            // Update the buffer position for the next insertion
-            NextSize = static_cast<int>(bf.size());
+            return commit_line(Hash);
+        }
 
-            // Move to the next line
-            int Row{ ++NextLine };
+        /**
+         * @brief Insert a line of rich text
+         *
+         * Text past the box width is cut off. A line with the same format
+         * and arguments as the one at the same row before the last clear()
+         * is reused as it is.
+         *
+         * @param Format Parsed markup
+         * @param Args Placeholder values by argument index
+         * @return The line number after insertion (or the current line if full)
+         */
+        int insert_line(rich_format const& Format, std::span<std::wstring_view const> Args = {}) noexcept {
+            if (NextLine >= Area.num_rows())
+                return NextLine;
+            if (LineMemos.size() != static_cast<size_t>(Area.num_rows()))
+                prepare_rows();
 
-            // Clear any remaining lines below
-            while (Row < Area.num_rows()) {
-                Area.Top.offset(Row++, 0).apply(bf);
-                bf.append(boxWidth, ' ');
+            uint64_t Hash = render_hash{}.add(Format.hash(Args)).add(Color).add(Area).value();
+            if (reuse_line(Hash)) {
+                return NextLine;
             }
 
-            return NextLine;
+            const size_t boxWidth = static_cast<size_t>(Area.num_cols());
+            size_t Width = Format.render(bf, Color, Args, boxWidth);
+            bf.append(boxWidth - Width, ' ');
+
+            return commit_line(Hash);
+        }
+
+        /**
+         * @brief Insert a line of rich text from markup
+         *
+         * The markup is parsed once and cached; see rich_format::get().
+         *
+         * @param Markup Markup text
+         * @param Args Placeholder values (strings or std::format-able values)
+         * @return The line number after insertion (or the current line if full)
+         */
+        template <typename... A>
+        int insert_rich(std::wstring_view Markup, A const&... Args) {
+            rich_args<A...> Views(Args...);
+            return insert_line(rich_format::get(Markup), Views.views());
         }
 
         /**
@@ -338,6 +649,11 @@ namespace mz {
          * @param Milliseconds Duration of each blink state in milliseconds
          */
         void blink(int NumBlinks = 2, long long Milliseconds = 250) const noexcept {
+            // Animations are suspended while the terminal is unfocused
+            if (!TerminalFocused) {
+                return;
+            }
+
             // Each blink consists of two states: inverted and normal
             NumBlinks *= 2;
 
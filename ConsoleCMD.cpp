@@ -36,9 +36,14 @@
  */
 
 #include "ConsoleCMD.h"
+#include "TokenRules.h"
 #include <format>
 #include <climits>  // For LLONG_MIN, LLONG_MAX
 #include <cstdint>  // For int64_t, uint64_t
+#include <charconv> // For std::from_chars
+#include <cmath>    // For std::isfinite
+#include <deque>
+#include <cerrno>
 
  // Platform-specific includes and defines
 #if defined(MZ_PLATFORM_WINDOWS)
@@ -136,43 +141,106 @@ namespace mz {
         }
     }
 
+    /**
+     * @brief Copies a wide number into a byte buffer for std::from_chars
+     *
+     * @param sv Wide string view containing the number
+     * @param Buf Receives the characters
+     * @return Number of characters, or 0 if the text is empty, too long
+     *         or not ASCII
+     */
+    template <size_t N>
+    static size_t narrow_number(std::wstring_view sv, char(&Buf)[N]) noexcept
+    {
+        if (sv.empty() || sv.size() >= N) { return 0; }
+        for (size_t i = 0; i < sv.size(); i++) {
+            if (sv[i] <= 0 || sv[i] >= 0x80) { return 0; }
+            Buf[i] = static_cast<char>(sv[i]);
+        }
+        return sv.size();
+    }
+
+    /**
+     * @brief Parses a wide string as a signed 64-bit integer
+     *
+     * Accepts an optional leading minus sign followed by digits, over the
+     * full range of long long.
+     *
+     * @param sv Wide string view containing the number to parse
+     * @param Value Receives the parsed value
+     * @return true if the text is not a valid number in range
+     */
+    bool parse_signed(std::wstring_view sv, long long& Value) noexcept
+    {
+        char Buf[32];
+        size_t Len = narrow_number(sv, Buf);
+        if (!Len) { return true; }
+        auto [Ptr, Ec] = std::from_chars(Buf, Buf + Len, Value);
+        return Ec != std::errc{} || Ptr != Buf + Len;
+    }
+
+    /**
+     * @brief Parses a wide string as an unsigned 64-bit integer
+     *
+     * Accepts digits only, over the full range of unsigned long long.
+     *
+     * @param sv Wide string view containing the number to parse
+     * @param Value Receives the parsed value
+     * @return true if the text is not a valid number in range
+     */
+    bool parse_unsigned(std::wstring_view sv, unsigned long long& Value) noexcept
+    {
+        char Buf[32];
+        size_t Len = narrow_number(sv, Buf);
+        if (!Len || Buf[0] == '-') { return true; }
+        auto [Ptr, Ec] = std::from_chars(Buf, Buf + Len, Value);
+        return Ec != std::errc{} || Ptr != Buf + Len;
+    }
+
+    /**
+     * @brief Parses a wide string as a finite floating-point number
+     *
+     * Accepts fixed and scientific notation; infinities and NaN are
+     * rejected.
+     *
+     * @param sv Wide string view containing the number to parse
+     * @param Value Receives the parsed value
+     * @return true if the text is not a valid finite number
+     */
+    bool parse_floating(std::wstring_view sv, double& Value) noexcept
+    {
+        char Buf[128];
+        size_t Len = narrow_number(sv, Buf);
+        if (!Len) { return true; }
+        auto [Ptr, Ec] = std::from_chars(Buf, Buf + Len, Value);
+        return Ec != std::errc{} || Ptr != Buf + Len || !std::isfinite(Value);
+    }
+
     /**
      * @brief Converts a wide string to an unsigned integer
      *
      * Parses a wide string containing only digits to an unsigned long long.
-     * Returns LLONG_MIN if the string is invalid or too large.
+     * Returns LLONG_MIN if the string is invalid or larger than LLONG_MAX;
+     * use parse_unsigned() for the full unsigned range.
      *
      * @param sv Wide string view containing the number to parse
      * @return Parsed unsigned value, or LLONG_MIN if invalid
      */
     long long string_to_unsigned(std::wstring_view sv) noexcept
     {
-        int ndigits{ 0 };
-        long long Res{ 0 };
-
-        // Empty string is invalid
-        if (sv.empty()) { return LLONG_MIN; }
-
-        // Process each character
-        for (auto c : sv) {
-            // Limit digits to 17 (to avoid overflow) and ensure it's a digit
-            if (++ndigits < 18 && c >= '0' && c <= '9') {
-                Res *= 10;  // Shift existing value
-                Res += long long(c - '0');  // Add new digit
-            }
-            else {
-                // Not a valid digit or too many digits
-                return LLONG_MIN;
-            }
+        unsigned long long Res{ 0 };
+        if (parse_unsigned(sv, Res) || Res > static_cast<unsigned long long>(LLONG_MAX)) {
+            return LLONG_MIN;
         }
-        return Res;
+        return static_cast<long long>(Res);
     }
 
     /**
      * @brief Converts a wide string to a signed integer
      *
      * Parses a wide string representing an integer (with optional sign)
-     * to a signed long long. Returns LLONG_MIN if the string is invalid.
+     * to a signed long long. Returns LLONG_MIN if the string is invalid;
+     * use parse_signed() to tell that apart from the value LLONG_MIN.
      *
      * @param sv Wide string view containing the number to parse
      * @return Parsed signed value, or LLONG_MIN if invalid
@@ -180,26 +248,10 @@ namespace mz {
     long long string_to_signed(std::wstring_view sv) noexcept
     {
         long long Res{ 0 };
-        long long Sign{ 1 };
-
-        // Empty string is invalid
-        if (sv.empty()) { return LLONG_MIN; }
-
-        // Check for negative sign
-        if (sv[0] == '-') {
-            Sign = -1;  // Set negative flag
-            Res = string_to_unsigned(sv.substr(1));  // Parse rest without sign
-        }
-        else {
-            // Parse as unsigned
-            Res = string_to_unsigned(sv);
+        if (parse_signed(sv, Res)) {
+            return LLONG_MIN;
         }
-
-        // Return signed result if valid
-        if (Res != LLONG_MIN) {
-            return Res * Sign;
-        }
-        return LLONG_MIN;
+        return Res;
     }
 
     /**
@@ -222,31 +274,10 @@ namespace mz {
      *         bit 3: Missing uppercase letter
      *         bit 4: Contains invalid characters
      */
-    int username_error(std::wstring const& Text, long long MinLen, long long MaxLen) noexcept
+    int username_error(std::wstring_view Text, long long MinLen, long long MaxLen) noexcept
     {
-        int nL = 0;  // Count of lowercase letters
-        int nU = 0;  // Count of uppercase letters
-        int nD = 0;  // Count of digits
-        int Errors = 0;  // Error bitmap
-
-        // Check length constraints
-        if (Text.size() < size_t(MinLen)) Errors |= 1;
-        if (Text.size() > size_t(MaxLen)) Errors |= 1;
-
-        // Check character types
-        for (auto const& w : Text) {
-            if (w >= '0' && w <= '9') ++nD;  // Digit
-            else if (w >= 'a' && w <= 'z') ++nL;  // Lowercase
-            else if (w >= 'A' && w <= 'Z') ++nU;  // Uppercase
-            else Errors |= 16;  // Invalid character
-        }
-
-        // Check required character types
-        if (!nD) Errors |= 2;  // Missing digit
-        if (!nL) Errors |= 4;  // Missing lowercase
-        if (!nU) Errors |= 8;  // Missing uppercase
-
-        return Errors;
+        // The rules of validate_token() for token_type::user; the bits are those of token_error
+        return detail::text_token_error(Text, MinLen, MaxLen, true);
     }
 
     /**
@@ -563,4 +594,359 @@ namespace mz {
         return result;
     }
 
+    //=========================================================================
+    // KEYBOARD INPUT
+    //=========================================================================
+
+    namespace {
+
+        /**
+         * @brief Leading number of each ';'-separated parameter of a CSI sequence
+         *
+         * Sub-parameters after ':' are stored in Sub (only the first one, which
+         * carries the event type in the modifier field).
+         */
+        struct csi_params {
+            int Count{ 0 };
+            int Value[4]{ 0, 0, 0, 0 };
+            int Sub[4]{ 0, 0, 0, 0 };
+        };
+
+        /**
+         * @brief Split the parameter bytes of a CSI sequence
+         * @return true if error (private or malformed parameters)
+         */
+        bool parse_csi_params(std::string_view Text, csi_params& P) noexcept {
+            P = {};
+            if (Text.empty()) return false;
+            int Field = 0;
+            bool InSub = false;
+            bool SubSeen = false;
+            P.Count = 1;
+            for (char c : Text) {
+                if (c >= '0' && c <= '9') {
+                    if (Field >= 4) continue;
+                    int& Target = InSub ? P.Sub[Field] : P.Value[Field];
+                    if (InSub && SubSeen) continue;
+                    if (Target > 100000) return true;
+                    Target = Target * 10 + (c - '0');
+                }
+                else if (c == ':') {
+                    SubSeen = InSub;
+                    InSub = true;
+                }
+                else if (c == ';') {
+                    ++Field;
+                    InSub = SubSeen = false;
+                    if (Field < 4) P.Count = Field + 1;
+                }
+                else {
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        /**
+         * @brief Key for the number of a CSI ~ sequence
+         * @return Key code, or 0 if unknown
+         */
+        int tilde_key(int Number) noexcept {
+            switch (Number) {
+            case 1: case 7: return HOMEKEY;
+            case 2: return INSERTKEY;
+            case 3: return DELETEKEY;
+            case 4: case 8: return ENDKEY;
+            case 5: return PAGEUPKEY;
+            case 6: return PAGEDOWNKEY;
+            case 11: return F1KEY;
+            case 12: return F2KEY;
+            case 13: return F3KEY;
+            case 14: return F4KEY;
+            case 15: return F5KEY;
+            case 17: return F6KEY;
+            case 18: return F7KEY;
+            case 19: return F8KEY;
+            case 20: return F9KEY;
+            case 21: return F10KEY;
+            case 23: return F11KEY;
+            case 24: return F12KEY;
+            default: return 0;
+            }
+        }
+
+        /**
+         * @brief Key for the final byte of a CSI or SS3 cursor/function key
+         *
+         * 'R' is only F3 after SS3; after CSI it ends a cursor position report.
+         * @return Key code, or 0 if unknown
+         */
+        int letter_key(char Final) noexcept {
+            switch (Final) {
+            case 'A': return UPKEY;
+            case 'B': return DOWNKEY;
+            case 'C': return RIGHTKEY;
+            case 'D': return LEFTKEY;
+            case 'H': return HOMEKEY;
+            case 'F': return ENDKEY;
+            case 'P': return F1KEY;
+            case 'Q': return F2KEY;
+            case 'R': return F3KEY;
+            case 'S': return F4KEY;
+            default: return 0;
+            }
+        }
+
+        /**
+         * @brief Key for a CSI u code point
+         *
+         * Keypad keys are reported in the private use area; they are folded
+         * onto their main-keyboard equivalents.
+         */
+        int codepoint_key(int Code) noexcept {
+            switch (Code) {
+            case 57414: return RETURNKEY;
+            case 57417: return LEFTKEY;
+            case 57418: return RIGHTKEY;
+            case 57419: return UPKEY;
+            case 57420: return DOWNKEY;
+            case 57421: return PAGEUPKEY;
+            case 57422: return PAGEDOWNKEY;
+            case 57423: return HOMEKEY;
+            case 57424: return ENDKEY;
+            case 57425: return INSERTKEY;
+            case 57426: return DELETEKEY;
+            default: break;
+            }
+            if (Code >= 57399 && Code <= 57408) return '0' + (Code - 57399);
+            return Code;
+        }
+
+        /**
+         * @brief Input taken from the terminal but not yet returned as keys
+         */
+        struct input_queue {
+            std::deque<key_event> Keys;     ///< Keys put back by unread_key()
+            std::string Bytes;              ///< Bytes read ahead or put back
+            size_t Next{ 0 };               ///< First byte not yet consumed
+        };
+
+        input_queue& pending_input() noexcept {
+            static input_queue Queue;
+            return Queue;
+        }
+
+#if defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+        /**
+         * @brief Read one byte of terminal input
+         *
+         * Reads the descriptor directly, in chunks, so that input_buffered()
+         * knows what has been read ahead without looking into stdio.
+         *
+         * @return The byte, or EOF when the input is closed
+         */
+        int next_byte() noexcept {
+            input_queue& In = pending_input();
+            if (In.Next == In.Bytes.size()) {
+                In.Bytes.clear();
+                In.Next = 0;
+                char Chunk[256];
+                ssize_t n;
+                do {
+                    n = read(STDIN_FILENO, Chunk, sizeof(Chunk));
+                } while (n < 0 && errno == EINTR);
+                if (n <= 0) return EOF;
+                In.Bytes.assign(Chunk, static_cast<size_t>(n));
+            }
+            return static_cast<unsigned char>(In.Bytes[In.Next++]);
+        }
+
+        /**
+         * @brief Skip the rest of an OSC or DCS string, up to BEL or ST
+         */
+        void skip_string() noexcept {
+            int Previous{ 0 };
+            for (int ch; (ch = next_byte()) != EOF; Previous = ch) {
+                if (ch == 0x07 || (Previous == ESCAPEKEY && ch == '\\')) return;
+            }
+        }
+
+        /**
+         * @brief Switches off line buffering and echo for the lifetime of the object
+         */
+        class unbuffered_input {
+        public:
+            unbuffered_input() noexcept {
+                Valid = tcgetattr(STDIN_FILENO, &Saved) == 0;
+                if (Valid) {
+                    struct termios Raw = Saved;
+                    Raw.c_lflag &= ~(ICANON | ECHO);
+                    tcsetattr(STDIN_FILENO, TCSANOW, &Raw);
+                }
+            }
+            ~unbuffered_input() {
+                if (Valid) tcsetattr(STDIN_FILENO, TCSANOW, &Saved);
+            }
+            unbuffered_input(const unbuffered_input&) = delete;
+            unbuffered_input& operator=(const unbuffered_input&) = delete;
+
+        private:
+            struct termios Saved {};
+            bool Valid{ false };
+        };
+#endif
+
+    } // namespace
+
+    bool decode_key_sequence(std::string_view Sequence, key_event& Event) noexcept {
+        Event = {};
+        if (Sequence.size() < 2) return true;
+
+        char Final = Sequence.back();
+        if (Sequence[0] == 'O') {
+            // SS3: keypad cursor keys and F1-F4
+            if (Sequence.size() != 2) return true;
+            Event.Key = letter_key(Final);
+            return Event.Key == 0;
+        }
+        if (Sequence[0] != '[') return true;
+
+        csi_params P;
+        if (parse_csi_params(Sequence.substr(1, Sequence.size() - 2), P)) return true;
+
+        switch (Final) {
+        case 'u':
+            if (P.Value[0] == 0) return true;
+            Event.Key = codepoint_key(P.Value[0]);
+            break;
+        case '~':
+            Event.Key = tilde_key(P.Value[0]);
+            break;
+        case 'Z':
+            Event.Key = TABKEY;
+            Event.Modifiers = KEYMOD_SHIFT;
+            break;
+        case 'I':
+        case 'O':
+            // Focus reports carry no parameters
+            if (P.Count > 0) return true;
+            Event.Key = Final == 'I' ? FOCUSINKEY : FOCUSOUTKEY;
+            return false;
+        default:
+            // Legacy CSI 1;mods X; a first parameter other than 1 is a reply, not a key.
+            // CSI row;col R is a cursor position report even at 1;1 (F3 is CSI 13~ here)
+            if (P.Count > 0 && P.Value[0] > 1) return true;
+            if (Final == 'R') return true;
+            Event.Key = letter_key(Final);
+            break;
+        }
+        if (Event.Key == 0) return true;
+
+        if (P.Count > 1 && P.Value[1] > 0) {
+            Event.Modifiers |= (P.Value[1] - 1) & 0xff;
+        }
+        if (P.Sub[1] >= 1 && P.Sub[1] <= 3) {
+            Event.Action = static_cast<key_action>(P.Sub[1]);
+        }
+        return false;
+    }
+
+    bool input_buffered() noexcept {
+        input_queue& In = pending_input();
+        return !In.Keys.empty() || In.Next < In.Bytes.size();
+    }
+
+    void unread_key(key_event Event) noexcept {
+        pending_input().Keys.push_back(Event);
+    }
+
+    void unread_input(std::string_view Bytes) noexcept {
+        input_queue& In = pending_input();
+        In.Bytes.erase(0, In.Next);
+        In.Bytes.insert(0, Bytes);
+        In.Next = 0;
+    }
+
+    key_event read_key() noexcept {
+        input_queue& In = pending_input();
+        if (!In.Keys.empty()) {
+            key_event Event = In.Keys.front();
+            In.Keys.pop_front();
+            return Event;
+        }
+#ifdef MZ_PLATFORM_WINDOWS
+        // Bytes put back come first; the console is read directly, never
+        // through wgetch(), which defers to this function for buffered input
+        if (In.Next < In.Bytes.size()) {
+            return key_event{ static_cast<unsigned char>(In.Bytes[In.Next++]) };
+        }
+        int w = _getwch();
+        if (!w || w == 224) {
+            w |= int(_getwch()) << 16;
+        }
+        return key_event{ w };
+#else
+        unbuffered_input Guard;
+        for (;;) {
+            int ch = next_byte();
+            if (ch != ESCAPEKEY) {
+                return key_event{ ch };
+            }
+
+            // With the keyboard protocol active the Escape key is itself a
+            // sequence, so a lone ESC byte always has more to come
+            if (!(KittyKeyboardFlags & KITTY_DISAMBIGUATE) && !wait_key(EscapeTimeoutMs)) {
+                return key_event{ ESCAPEKEY };
+            }
+
+            ch = next_byte();
+            if (ch == EOF) {
+                return key_event{ ESCAPEKEY };
+            }
+            if (ch == ']' || ch == 'P') {
+                // A reply string that missed the capability probe starts with
+                // a digit or '>'; Alt+] and Alt+P are followed by silence or a key
+                int Next = wait_key(EscapeTimeoutMs) ? next_byte() : EOF;
+                if ((Next >= '0' && Next <= '9') || Next == '>') {
+                    skip_string();
+                    continue;
+                }
+                if (Next != EOF) {
+                    unread_input(std::string(1, char(Next)));
+                }
+                return key_event{ ch, KEYMOD_ALT };
+            }
+            if (ch != '[' && ch != 'O') {
+                return key_event{ ch, KEYMOD_ALT };
+            }
+
+            char Sequence[32];
+            size_t Length = 0;
+            Sequence[Length++] = char(ch);
+            if (ch == 'O') {
+                ch = next_byte();
+                if (ch == EOF) continue;
+                Sequence[Length++] = char(ch);
+            }
+            else {
+                // Parameter and intermediate bytes up to the final byte
+                while ((ch = next_byte()) != EOF) {
+                    if (Length < sizeof(Sequence)) Sequence[Length++] = char(ch);
+                    if (ch >= 0x40 && ch <= 0x7E) break;
+                }
+                if (ch == EOF || Length == sizeof(Sequence)) continue;
+            }
+
+            key_event Event;
+            if (!decode_key_sequence(std::string_view(Sequence, Length), Event)) {
+                if (Event.Key == FOCUSINKEY || Event.Key == FOCUSOUTKEY) {
+                    TerminalFocused = Event.Key == FOCUSINKEY;
+                }
+                return Event;
+            }
+            // Unknown sequence or a stray terminal reply: skip it
+        }
+#endif
+    }
+
 } // namespace mz
@@ -44,19 +44,24 @@
 #include <string_view>
 #include <format>
 #include <cstdint>
+#include <cstdio>
 
  // Platform detection
 #if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
 #define MZ_PLATFORM_WINDOWS
 #include <conio.h>
+#include <thread>
+#include <chrono>
 #elif defined(__APPLE__) || defined(__MACH__)
 #define MZ_PLATFORM_MACOS
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
 #elif defined(__linux__) || defined(__unix__) || defined(__unix)
 #define MZ_PLATFORM_UNIX
 #include <termios.h>
 #include <unistd.h>
+#include <poll.h>
 #else
 #define MZ_PLATFORM_UNKNOWN
 #endif
@@ -181,6 +186,7 @@ namespace mz {
     static constexpr int ESCAPEKEY{ 27 };                 ///< Escape key
     static constexpr int SPACEKEY{ 32 };                  ///< Space key
     static constexpr int BACKSPACEKEY{ 8 };               ///< Backspace key
+    static constexpr int TABKEY{ 9 };                     ///< Tab key
     static constexpr int UPKEY{ (72 << 16) | 224 };       ///< Up arrow key
     static constexpr int DOWNKEY{ (80 << 16) | 224 };     ///< Down arrow key
     static constexpr int HOMEKEY{ (71 << 16) | 224 };     ///< Home key
@@ -191,8 +197,172 @@ namespace mz {
     static constexpr int DELETEKEY{ (83 << 16) | 224 };   ///< Delete key
     static constexpr int PAGEUPKEY{ (73 << 16) | 224 };   ///< Page Up key
     static constexpr int PAGEDOWNKEY{ (81 << 16) | 224 }; ///< Page Down key
+    static constexpr int F1KEY{ 59 << 16 };               ///< F1 key
+    static constexpr int F2KEY{ 60 << 16 };               ///< F2 key
+    static constexpr int F3KEY{ 61 << 16 };               ///< F3 key
+    static constexpr int F4KEY{ 62 << 16 };               ///< F4 key
+    static constexpr int F5KEY{ 63 << 16 };               ///< F5 key
+    static constexpr int F6KEY{ 64 << 16 };               ///< F6 key
+    static constexpr int F7KEY{ 65 << 16 };               ///< F7 key
+    static constexpr int F8KEY{ 66 << 16 };               ///< F8 key
+    static constexpr int F9KEY{ 67 << 16 };               ///< F9 key
+    static constexpr int F10KEY{ 68 << 16 };              ///< F10 key
+    static constexpr int F11KEY{ (133 << 16) | 224 };     ///< F11 key
+    static constexpr int F12KEY{ (134 << 16) | 224 };     ///< F12 key
+    static constexpr int FOCUSINKEY{ (240 << 16) | 224 };  ///< Terminal gained focus (focus reporting)
+    static constexpr int FOCUSOUTKEY{ (241 << 16) | 224 }; ///< Terminal lost focus (focus reporting)
     ///@}
 
+    /**
+     * @name Key Modifier Bits
+     * @brief Modifiers held during a key_event
+     */
+     ///@{
+    static constexpr int KEYMOD_SHIFT{ 1 };               ///< Shift
+    static constexpr int KEYMOD_ALT{ 2 };                 ///< Alt (Option)
+    static constexpr int KEYMOD_CTRL{ 4 };                ///< Control
+    static constexpr int KEYMOD_SUPER{ 8 };               ///< Super (Windows, Command)
+    static constexpr int KEYMOD_HYPER{ 16 };              ///< Hyper
+    static constexpr int KEYMOD_META{ 32 };               ///< Meta
+    static constexpr int KEYMOD_CAPSLOCK{ 64 };           ///< Caps Lock is on
+    static constexpr int KEYMOD_NUMLOCK{ 128 };           ///< Num Lock is on
+    ///@}
+
+    /**
+     * @name Keyboard Protocol Flags
+     * @brief Progressive enhancement flags of the kitty keyboard protocol
+     *
+     * Pushed with CSI > flags u; see TerminalManager::enable_kitty_keyboard().
+     */
+     ///@{
+    static constexpr int KITTY_DISAMBIGUATE{ 1 };         ///< Escape codes for ambiguous keys, ESC as CSI 27 u
+    static constexpr int KITTY_EVENT_TYPES{ 2 };          ///< Report repeat and release events
+    static constexpr int KITTY_ALTERNATE_KEYS{ 4 };       ///< Report shifted and base layout keys
+    static constexpr int KITTY_ALL_KEYS{ 8 };             ///< Report all keys as escape codes
+    static constexpr int KITTY_TEXT{ 16 };                ///< Report associated text
+    ///@}
+
+    /**
+     * @brief What happened to a key
+     */
+    enum class key_action : uint8_t {
+        press = 1,      ///< Key went down
+        repeat = 2,     ///< Key is held and auto-repeating
+        release = 3     ///< Key went up (only with KITTY_EVENT_TYPES)
+    };
+
+    /**
+     * @struct key_event
+     * @brief One decoded keystroke
+     */
+    struct key_event {
+        int Key{ 0 };                               ///< Key code: a character or one of the *KEY constants
+        int Modifiers{ 0 };                         ///< KEYMOD_* bits
+        key_action Action{ key_action::press };     ///< Press, repeat or release
+
+        /**
+         * @brief Key code in the form wgetch() returns
+         *
+         * Ctrl with a letter or one of @[\]^_ gives the control character,
+         * as legacy terminals send it.
+         */
+        constexpr int legacy_key() const noexcept {
+            if ((Modifiers & KEYMOD_CTRL) && ((Key >= 'a' && Key <= 'z') || (Key >= '@' && Key <= '_'))) {
+                return Key & 0x1f;
+            }
+            return Key;
+        }
+    };
+
+    /**
+     * @brief Keyboard protocol flags currently pushed to the terminal
+     *
+     * Set by TerminalManager::enable_kitty_keyboard(). While
+     * KITTY_DISAMBIGUATE is set, the Escape key arrives as a sequence, so a
+     * lone ESC byte always starts one and is never waited on.
+     */
+    inline int KittyKeyboardFlags{ 0 };
+
+    /**
+     * @brief Wait for the rest of a legacy escape sequence, in milliseconds
+     *
+     * Without the keyboard protocol an Escape keypress is only told apart
+     * from the start of a sequence by the silence after it.
+     */
+    inline int EscapeTimeoutMs{ 25 };
+
+    /**
+     * @brief Whether the terminal window has focus
+     *
+     * Updated by read_key() from focus reports, which are on while an
+     * EventLoop runs (or after TerminalManager::enable_focus_reporting()).
+     * Stays true otherwise and on terminals that never report focus.
+     *
+     * Animations and blinking alerts are skipped while it is false.
+     */
+    inline bool TerminalFocused{ true };
+
+    /**
+     * @brief Number of holders of focus reports (mode 1004)
+     *
+     * EventLoop::run() and TerminalManager::enable_focus_reporting() each
+     * count as one; the mode is switched off when the last one lets go.
+     */
+    inline int FocusReportUsers{ 0 };
+
+    /**
+     * @brief Decode the bytes of a key sequence that follow ESC
+     *
+     * Understands CSI u (kitty keyboard protocol), CSI ~ and the CSI and
+     * SS3 forms of cursor and function keys, with modifiers and event
+     * types where present.
+     *
+     * @param Sequence Bytes after ESC, e.g. "[27u", "[1;5A" or "OP"
+     * @param Event Receives the key
+     * @return true if error (not a key sequence)
+     */
+    [[nodiscard]] bool decode_key_sequence(std::string_view Sequence, key_event& Event) noexcept;
+
+    /**
+     * @brief Read one key event from the console
+     *
+     * Blocks until a key arrives. Unrecognized sequences (such as stray
+     * terminal replies) are skipped. Release events are returned only
+     * when KITTY_EVENT_TYPES is active. Focus reports are returned as
+     * FOCUSINKEY and FOCUSOUTKEY after updating TerminalFocused.
+     *
+     * @return Decoded key
+     */
+    key_event read_key() noexcept;
+
+    /**
+     * @brief Check whether input was taken from the terminal but not yet returned
+     *
+     * Counts bytes that read_key() read ahead and input put back with
+     * unread_key() or unread_input().
+     */
+    [[nodiscard]] bool input_buffered() noexcept;
+
+    /**
+     * @brief Put a key back, to be returned first by read_key() and wgetch()
+     *
+     * Keys put back are returned in the order they were put back, ahead
+     * of anything still unread in the terminal.
+     *
+     * @param Event Key to return again
+     */
+    void unread_key(key_event Event) noexcept;
+
+    /**
+     * @brief Put raw bytes back in front of the terminal input
+     *
+     * For code that read the terminal directly, such as a capability
+     * probe, and found keystrokes among the replies.
+     *
+     * @param Bytes Bytes to be decoded again by read_key()
+     */
+    void unread_input(std::string_view Bytes) noexcept;
+
     //=========================================================================
     // UNICODE SYMBOL CONSTANTS
     //=========================================================================
@@ -360,6 +530,30 @@ namespace mz {
     // STRING CONVERSION FUNCTIONS
     //=========================================================================
 
+    /**
+     * @brief Parse wide string as a signed 64-bit integer
+     * @param Text String to parse (optional '-' and digits)
+     * @param Value Receives the value
+     * @return true if the text is not a valid number in range
+     */
+    [[nodiscard]] bool parse_signed(std::wstring_view Text, long long& Value) noexcept;
+
+    /**
+     * @brief Parse wide string as an unsigned 64-bit integer
+     * @param Text String to parse (digits only)
+     * @param Value Receives the value
+     * @return true if the text is not a valid number in range
+     */
+    [[nodiscard]] bool parse_unsigned(std::wstring_view Text, unsigned long long& Value) noexcept;
+
+    /**
+     * @brief Parse wide string as a finite floating-point number
+     * @param Text String to parse
+     * @param Value Receives the value
+     * @return true if the text is not a valid finite number
+     */
+    [[nodiscard]] bool parse_floating(std::wstring_view Text, double& Value) noexcept;
+
     /**
      * @brief Convert wide string to signed integer
      * @param Text String to convert
@@ -381,64 +575,76 @@ namespace mz {
      * @param MaxLen Maximum allowed length
      * @return Error code (0 if valid, non-zero for specific errors)
      */
-    int username_error(std::wstring const& Text, long long MinLen, long long MaxLen) noexcept;
+    int username_error(std::wstring_view Text, long long MinLen, long long MaxLen) noexcept;
 
     /**
      * @brief Cross-platform wide character input function
      *
      * Reads a wide character from the console, handling extended keys
-     * that produce multiple characters or special key codes.
+     * that produce multiple characters or special key codes. Key releases
+     * reported by the keyboard protocol and focus reports are skipped.
      *
      * @return Key code (possibly with extended key info in high 16 bits)
      */
     inline int wgetch() noexcept {
 #ifdef MZ_PLATFORM_WINDOWS
+        if (input_buffered()) {
+            return read_key().legacy_key();
+        }
         int w = _getwch();
         if (!w || w == 224) {
             w |= int(_getwch()) << 16;
         }
         return w;
 #else
-        // Non-Windows implementation using termios for raw input
-        struct termios oldSettings, newSettings;
-        tcgetattr(STDIN_FILENO, &oldSettings);
-        newSettings = oldSettings;
-        newSettings.c_lflag &= ~(ICANON | ECHO);
-        tcsetattr(STDIN_FILENO, TCSANOW, &newSettings);
-
-        int ch = getchar();
-        if (ch == 27) { // Escape sequence
-            // Handle arrow keys and other escape sequences
-            ch = getchar();
-            if (ch == '[') {
-                ch = getchar();
-                switch (ch) {
-                case 'A': return UPKEY;
-                case 'B': return DOWNKEY;
-                case 'C': return RIGHTKEY;
-                case 'D': return LEFTKEY;
-                case 'H': return HOMEKEY;
-                case 'F': return ENDKEY;
-                    // Extended sequences like page up/down, insert, delete
-                case '2':
-                    ch = getchar(); // Get '~'
-                    return INSERTKEY;
-                case '3':
-                    ch = getchar(); // Get '~'
-                    return DELETEKEY;
-                case '5':
-                    ch = getchar(); // Get '~'
-                    return PAGEUPKEY;
-                case '6':
-                    ch = getchar(); // Get '~'
-                    return PAGEDOWNKEY;
-                }
+        // Key releases and focus reports are only of interest to read_key() callers
+        for (;;) {
+            key_event Event = read_key();
+            if (Event.Action != key_action::release && Event.Key != FOCUSINKEY && Event.Key != FOCUSOUTKEY) {
+                return Event.legacy_key();
             }
-            return ESCAPEKEY;
         }
+#endif
+    }
 
-        tcsetattr(STDIN_FILENO, TCSANOW, &oldSettings);
-        return ch;
+    /**
+     * @brief Check whether a keystroke is waiting to be read
+     *
+     * Does not block and does not consume input.
+     *
+     * @return true if wgetch() would return without waiting
+     */
+    inline bool key_pending() noexcept {
+        if (input_buffered()) return true;
+#ifdef MZ_PLATFORM_WINDOWS
+        return _kbhit() != 0;
+#else
+        struct pollfd pfd { STDIN_FILENO, POLLIN, 0 };
+        return poll(&pfd, 1, 0) > 0 && (pfd.revents & POLLIN);
+#endif
+    }
+
+    /**
+     * @brief Wait up to a timeout for a keystroke
+     *
+     * Does not consume input; call wgetch() when it returns true. Keys
+     * already read ahead by read_key() count as waiting, so keystrokes
+     * that arrive together are not held back until the next timeout.
+     *
+     * @param TimeoutMs Longest wait in milliseconds (negative waits forever)
+     * @return true if wgetch() would return without waiting
+     */
+    inline bool wait_key(int TimeoutMs) noexcept {
+        if (input_buffered()) return true;
+#ifdef MZ_PLATFORM_WINDOWS
+        for (int Waited = 0; !_kbhit(); Waited += 10) {
+            if (TimeoutMs >= 0 && Waited >= TimeoutMs) return false;
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return true;
+#else
+        struct pollfd pfd { STDIN_FILENO, POLLIN, 0 };
+        return poll(&pfd, 1, TimeoutMs) > 0 && (pfd.revents & POLLIN);
 #endif
     }
 
@@ -458,53 +664,83 @@ namespace mz {
      */
     [[nodiscard]] std::wstring FileLengthString(int64_t Length, bool Binary) noexcept;
 
+    /**
+     * @brief Get the terminal window dimensions
+     * @param width Receives the width in characters
+     * @param height Receives the height in characters
+     * @return true if successful, false otherwise
+     */
+    bool GetConsoleSize(int& width, int& height) noexcept;
+
     //=========================================================================
     // CONSOLE OUTPUT FUNCTIONS
     //=========================================================================
 
+    /**
+     * @brief Observer that receives a copy of all console output
+     *
+     * When set, every Write() call also passes the exact bytes it sends to
+     * stdout to this function. Used to mirror the screen elsewhere, e.g. to
+     * remote viewers. Not synchronized: install it before output starts.
+     */
+    inline void (*OutputTap)(std::string_view Bytes) noexcept = nullptr;
+
+    /**
+     * @brief Write raw bytes to stdout and to the output tap
+     * @param Ptr Pointer to the data
+     * @param Size Size of one element in bytes
+     * @param Count Number of elements
+     */
+    inline void WriteBytes(void const* Ptr, size_t Size, size_t Count) noexcept {
+        fwrite(Ptr, Size, Count, stdout);
+        if (OutputTap) {
+            OutputTap(std::string_view(static_cast<char const*>(Ptr), Size * Count));
+        }
+    }
+
     /**
      * @brief Write a single character to stdout
      * @param c Character to write
      */
-    inline void Write(char c) noexcept { fwrite(&c, 1, 1, stdout); }
+    inline void Write(char c) noexcept { WriteBytes(&c, 1, 1); }
 
     /**
      * @brief Write a wide character to stdout
      * @param c Wide character to write
      */
-    inline void Write(wchar_t c) noexcept { fwrite(&c, 2, 1, stdout); }
+    inline void Write(wchar_t c) noexcept { WriteBytes(&c, 2, 1); }
 
     /**
      * @brief Write a string view to stdout
      * @param sv String view to write
      */
-    inline void Write(std::string_view sv) noexcept { fwrite(sv.data(), 1, sv.size(), stdout); }
+    inline void Write(std::string_view sv) noexcept { WriteBytes(sv.data(), 1, sv.size()); }
 
     /**
      * @brief Write a wide string view to stdout
      * @param sv Wide string view to write
      */
-    inline void Write(std::wstring_view sv) noexcept { fwrite(sv.data(), 2, sv.size(), stdout); }
+    inline void Write(std::wstring_view sv) noexcept { WriteBytes(sv.data(), 2, sv.size()); }
 
     /**
      * @brief Write a character buffer to stdout
      * @param Ptr Pointer to the character buffer
      * @param Size Number of characters to write
      */
-    inline void Write(char const* Ptr, size_t Size) noexcept { fwrite(Ptr, 1, Size, stdout); }
+    inline void Write(char const* Ptr, size_t Size) noexcept { WriteBytes(Ptr, 1, Size); }
 
     /**
      * @brief Write a wide character buffer to stdout
      * @param Ptr Pointer to the wide character buffer
      * @param Size Number of wide characters to write
      */
-    inline void Write(wchar_t const* Ptr, size_t Size) noexcept { fwrite(Ptr, 2, Size, stdout); }
+    inline void Write(wchar_t const* Ptr, size_t Size) noexcept { WriteBytes(Ptr, 2, Size); }
 
     /**
      * @brief Write a symbol to stdout
      * @param S Symbol to write
      */
-    inline void Write(sym S) noexcept { fwrite(S.Symbol, 2, 2, stdout); }
+    inline void Write(sym S) noexcept { WriteBytes(S.Symbol, 2, 2); }
 
     //=========================================================================
     // STRING MANIPULATION HELPERS
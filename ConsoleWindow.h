@@ -39,6 +39,7 @@
 
 #include "ConsoleBoxes.h"
 #include "FooterBox.h"
+#include "StartupProfiler.h"
 #include <string>
 #include <string_view>
 #include <stdexcept>
@@ -75,11 +76,49 @@ namespace mz {
          * @throws std::bad_alloc If memory allocation fails during initialization
          */
         void initialize(mz::console_picture const& Pic, mz::coord_box Boundary) {
+            set_layout(Boundary);
+            build_picture(Pic);
+        }
+
+        /**
+         * @brief Initialize the window, building the bitmap when idle
+         *
+         * Lays out the window immediately so the first frame can be painted
+         * (draw() paints a placeholder until the picture exists), then queues
+         * the picture construction and a full redraw on idle_tasks().
+         * The task does nothing if the window is destroyed first.
+         *
+         * @param Pic Console bitmap to display (copied)
+         * @param Boundary Screen area to use for the window
+         */
+        void initialize_lazy(mz::console_picture Pic, mz::coord_box Boundary) {
+            set_layout(Boundary);
+            idle_tasks().defer(L"ConsoleWindow picture", [this, Alive = Guard.watch(), Pic = std::move(Pic)] {
+                if (Alive.expired()) return;
+                build_picture(Pic);
+                draw();
+            });
+        }
+
+        /**
+         * @brief Compute the window, picture and message areas
+         *
+         * @param Boundary Screen area to use for the window
+         */
+        void set_layout(mz::coord_box Boundary) noexcept {
             // Configure message box position at bottom of window
             Window = Boundary;
             MsgBox.Area = Window.bottom_rows(5, 1, 1).shift(-1, 0);
             Area = Window.top_rows(Window.num_rows() - 6);
+        }
 
+        /**
+         * @brief Build the formatted picture for the current layout
+         *
+         * @param Pic Console bitmap to display
+         * @throws std::bad_alloc If memory allocation fails
+         */
+        void build_picture(mz::console_picture const& Pic) {
             // Calculate dimensions for the bitmap
             int LogoWidth = Pic.Width;
             int LogoHeight = Pic.Height;
@@ -170,6 +209,12 @@ namespace mz {
          * Renders the complete window including the bitmap and message area.
          */
         void draw() {
+            // Picture still pending: paint the background only
+            if (Picture.empty()) {
+                print_placeholder();
+                return;
+            }
+
             // Prepare the buffer
             bf.clear();
             mz::SetHide(bf);
@@ -190,6 +235,11 @@ namespace mz {
          * @param Box Region to redraw
          */
         void draw(mz::coord_box Box) {
+            // Nothing to copy from until the picture is built
+            if (Picture.empty()) {
+                return;
+            }
+
             // Ensure the box is within window boundaries
             Box.Top.Row = std::max(Box.Top.Row, Window.Top.Row);
             Box.Top.Col = std::max(Box.Top.Col, Window.Top.Col);
@@ -318,6 +368,11 @@ namespace mz {
          * Used for calculating positions within the picture buffer.
          */
         int PictureLineLength{ 0 };
+
+        /**
+         * @brief Cancels the task queued by initialize_lazy() on destruction
+         */
+        idle_guard Guard;
     };
 
 } // namespace mz
@@ -0,0 +1,395 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "ContentSearch.h"
+#include "TextEncoding.h"
+#include <filesystem>
+#include <fstream>
+#include <algorithm>
+#include <format>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz {
+
+    namespace {
+
+        /**
+         * @brief Bytes searched between checks for cancellation
+         */
+        constexpr size_t ScanChunk = 4 * 1024 * 1024;
+
+        /**
+         * @brief File names taken from the finder at a time
+         */
+        constexpr size_t FileBatch = 16;
+
+        /**
+         * @brief Append a line of a file as a preview
+         *
+         * Decodes UTF-8; tabs become spaces, other controls and broken
+         * sequences become '.'.
+         */
+        void append_preview(std::wstring& Out, std::string_view Line) {
+            for (size_t i = 0; i < Line.size();) {
+                auto c = static_cast<unsigned char>(Line[i]);
+                if (c < 0x80) {
+                    Out.push_back(c == '\t' ? L' ' : (c < 32 || c == 127) ? L'.' : static_cast<wchar_t>(c));
+                    ++i;
+                    continue;
+                }
+                size_t Len = c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 0;
+                if (Len == 0 || i + Len > Line.size()) {
+                    Out.push_back(L'.');
+                    ++i;
+                    continue;
+                }
+                char32_t Code = c & (0x7F >> Len);
+                bool Valid{ true };
+                for (size_t k = 1; k < Len; k++) {
+                    auto d = static_cast<unsigned char>(Line[i + k]);
+                    Valid = Valid && (d & 0xC0) == 0x80;
+                    Code = (Code << 6) | (d & 0x3F);
+                }
+                if (!Valid || (sizeof(wchar_t) == 2 && Code > 0xFFFF)) {
+                    Out.push_back(L'.');
+                    ++i;
+                    continue;
+                }
+                Out.push_back(static_cast<wchar_t>(Code));
+                i += Len;
+            }
+        }
+
+    } // namespace
+
+    ContentSearch::~ContentSearch() noexcept {
+        cancel();
+        wait();
+        close_root();
+    }
+
+    bool ContentSearch::start(std::wstring const& RootPath, grep_options SearchOptions) noexcept {
+        cancel();
+        wait();
+        close_root();
+
+        Options = std::move(SearchOptions);
+        Root = RootPath.empty() ? std::wstring(L".") : RootPath;
+        Needle.clear();
+        encode_utf8(Needle, Options.Text);
+        if (Needle.empty()) {
+            return true;
+        }
+        if (Options.IgnoreCase) {
+            for (char& c : Needle) c = detail::fold_ascii(c);
+        }
+
+#if !defined(MZ_PLATFORM_WINDOWS) && !defined(MZ_PLATFORM_UNKNOWN)
+        // A root that does not encode exactly would name some other directory
+        std::string Native;
+        if (encode_utf8(Native, Root)) {
+            return true;
+        }
+        RootFd = ::open(Native.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (RootFd < 0) {
+            return true;
+        }
+#endif
+        if (Finder.start(Root, Options.Files)) {
+            close_root();
+            return true;
+        }
+
+        Results.clear();
+        NumFiles = 0;
+        NumBinary = 0;
+        NumBytes = 0;
+        NumMatches = 0;
+        Cancelled = false;
+        Clock.start();
+
+        unsigned n = Options.NumThreads ? Options.NumThreads : std::max(1u, std::thread::hardware_concurrency());
+        Running = n;
+        try {
+            for (unsigned i = 0; i < n; i++) {
+                Threads.emplace_back(&ContentSearch::scan, this);
+            }
+        }
+        catch (...) {
+            // Scanners that never started cannot count themselves out
+            cancel();
+            wait();
+            Running = 0;
+            Clock.stop();
+            close_root();
+            return true;
+        }
+        return false;
+    }
+
+    void ContentSearch::cancel() noexcept {
+        Cancelled = true;
+        Finder.cancel();
+    }
+
+    void ContentSearch::wait() noexcept {
+        for (auto& t : Threads) {
+            if (t.joinable()) t.join();
+        }
+        Threads.clear();
+        Finder.wait();
+    }
+
+    void ContentSearch::close_root() noexcept {
+#if !defined(MZ_PLATFORM_WINDOWS) && !defined(MZ_PLATFORM_UNKNOWN)
+        if (RootFd >= 0) ::close(RootFd);
+#endif
+        RootFd = -1;
+    }
+
+    void ContentSearch::scan() noexcept {
+        std::vector<find_match> Files;
+        std::vector<grep_match> Found;
+        std::vector<char> Buffer;
+        while (!Cancelled.load(std::memory_order_relaxed)) {
+            Files.clear();
+            if (!Finder.take(Files, FileBatch)) {
+                // Nothing more arrives once the finder is done
+                if (Finder.done() && !Finder.pending()) break;
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                continue;
+            }
+            for (auto const& File : Files) {
+                if (Cancelled.load(std::memory_order_relaxed)) break;
+                if (File.Directory || File.Size == 0) continue;
+                scan_file(File.Path, Buffer, Found);
+                Results.publish(Found);
+            }
+        }
+
+        if (Running.fetch_sub(1) == 1) {
+            Clock.stop();
+        }
+    }
+
+    void ContentSearch::scan_file(std::string const& Path, std::vector<char>& Buffer, std::vector<grep_match>& Found) noexcept {
+#if defined(MZ_PLATFORM_WINDOWS) || defined(MZ_PLATFORM_UNKNOWN)
+        std::error_code Ec;
+        std::filesystem::path FullPath;
+        try {
+            FullPath = std::filesystem::path(Root) / std::filesystem::path(widen_path(Path));
+        }
+        catch (...) {
+            return;
+        }
+        uint64_t Size = std::filesystem::file_size(FullPath, Ec);
+        if (Ec || Size == 0 || Size > Options.MaxFileSize) return;
+
+        std::ifstream In(FullPath, std::ios::binary);
+        if (!In) return;
+        Buffer.resize(static_cast<size_t>(Size));
+        In.read(Buffer.data(), static_cast<std::streamsize>(Size));
+        size_t Got = static_cast<size_t>(In.gcount());
+        NumFiles.fetch_add(1, std::memory_order_relaxed);
+        NumBytes.fetch_add(Got, std::memory_order_relaxed);
+        scan_text(Path, std::string_view(Buffer.data(), Got), Found);
+#else
+        // Non-blocking, so a FIFO does not hold up the scanner
+        int Fd = ::openat(RootFd, Path.c_str(), O_RDONLY | O_NOFOLLOW | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+        if (Fd < 0) return;
+
+        struct stat St;
+        if (fstat(Fd, &St) != 0 || !S_ISREG(St.st_mode) || St.st_size <= 0
+            || static_cast<uint64_t>(St.st_size) > Options.MaxFileSize) {
+            ::close(Fd);
+            return;
+        }
+        size_t Size = static_cast<size_t>(St.st_size);
+
+        if (Size <= MapThreshold) {
+            // One read is cheaper than setting up a mapping
+            Buffer.resize(Size);
+            size_t Got{ 0 };
+            while (Got < Size) {
+                ssize_t r = pread(Fd, Buffer.data() + Got, Size - Got, static_cast<off_t>(Got));
+                if (r <= 0) break;
+                Got += static_cast<size_t>(r);
+            }
+            ::close(Fd);
+            NumFiles.fetch_add(1, std::memory_order_relaxed);
+            NumBytes.fetch_add(Got, std::memory_order_relaxed);
+            scan_text(Path, std::string_view(Buffer.data(), Got), Found);
+            return;
+        }
+
+        void* Map = mmap(nullptr, Size, PROT_READ, MAP_PRIVATE, Fd, 0);
+        ::close(Fd);
+        if (Map == MAP_FAILED) return;
+        posix_madvise(Map, Size, POSIX_MADV_SEQUENTIAL);
+        NumFiles.fetch_add(1, std::memory_order_relaxed);
+        NumBytes.fetch_add(Size, std::memory_order_relaxed);
+        scan_text(Path, std::string_view(static_cast<char const*>(Map), Size), Found);
+        munmap(Map, Size);
+#endif
+    }
+
+    void ContentSearch::scan_text(std::string const& Path, std::string_view Text, std::vector<grep_match>& Found) noexcept {
+        if (std::memchr(Text.data(), 0, std::min(Text.size(), SniffSize))) {
+            NumBinary.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        size_t n = Text.size();
+        size_t Pos{ 0 };
+        size_t Counted{ 0 };        // Newlines before Counted are in Line
+        uint32_t Line{ 1 };
+        size_t PerFile{ 0 };
+        while (Pos < n && !Cancelled.load(std::memory_order_relaxed)) {
+            // Search a chunk at a time; matches may start anywhere in the chunk
+            size_t Limit = std::min(n, Pos + ScanChunk + Needle.size() - 1);
+            size_t Hit = find_literal(Text.substr(0, Limit), Needle, Options.IgnoreCase, Pos);
+            if (Hit == std::string_view::npos) {
+                if (Limit == n) break;
+                Pos += ScanChunk;
+                continue;
+            }
+
+            Line += static_cast<uint32_t>(std::count(Text.begin() + Counted, Text.begin() + Hit, '\n'));
+            Counted = Hit;
+            size_t Begin = Hit ? Text.rfind('\n', Hit - 1) : std::string_view::npos;
+            Begin = Begin == std::string_view::npos ? 0 : Begin + 1;
+            size_t End = Text.find('\n', Hit);
+            if (End == std::string_view::npos) End = n;
+
+            grep_match& Match = Found.emplace_back();
+            Match.Path = Path;
+            Match.Line = Line;
+            Match.Column = static_cast<uint32_t>(Hit - Begin);
+            std::string_view Shown = Text.substr(Begin, std::min(End - Begin, PreviewSize));
+            if (!Shown.empty() && Shown.back() == '\r') Shown.remove_suffix(1);
+            append_preview(Match.Preview, Shown);
+            NumMatches.fetch_add(1, std::memory_order_relaxed);
+
+            // One report per line
+            if (++PerFile >= Options.MaxMatchesPerFile) break;
+            Pos = End;
+        }
+    }
+
+    grep_stats ContentSearch::stats() const noexcept {
+        grep_stats St;
+        St.Files = NumFiles.load();
+        St.Binary = NumBinary.load();
+        St.Bytes = NumBytes.load();
+        St.Matches = NumMatches.load();
+        St.Done = done();
+        St.Seconds = Clock.seconds(St.Done);
+        return St;
+    }
+
+    size_t ContentSearch::stream_to(DirectoryDisplayBox& Box, size_t Max) {
+        std::vector<grep_match> Batch;
+        size_t n = take(Batch, Max);
+        if (!n) return 0;
+
+        int From = Box.NumIndexes;
+        std::wstring Item;
+        for (auto const& Match : Batch) {
+            if (Box.NumIndexes >= ParallelFind::MaxListed) break;
+            Item = std::format(L"{:>{}}", Match.Line, Box.LeftColumnSize);
+            Item.append(widen_path(Match.Path));
+            Item.append(L": ");
+            Item.append(Match.Preview);
+            Box.append_item(Item);
+        }
+        Box.draw_appended(From);
+        return n;
+    }
+
+    void ContentSearch::report(FooterBox& Footer) {
+        grep_stats St = stats();
+        std::wstring Msg = std::format(L" {} {} files, {} matches, {} binary skipped, {}/s",
+            St.Done ? L"Searched" : L"Searching", St.Files, St.Matches, St.Binary,
+            FileLengthString(static_cast<int64_t>(St.throughput()), false));
+        if (Footer.update_status(Msg)) {
+            Footer.refresh();
+        }
+    }
+
+    void ContentSearch::Test(coord_box Window, std::wstring const& RootPath, std::wstring const& Text) {
+        coord_box Place = Window.center_box(22, 90);
+        DirectoryDisplayBox sb;
+        sb.Area = Place.top_rows(20);
+        sb.initialize();
+        sb.create();
+        sb.draw_all2();
+
+        FooterBox Footer;
+        Footer.create(Place);
+        Footer.print();
+
+        ContentSearch Grep;
+        grep_options Options;
+        Options.Text = Text;
+        if (Grep.start(RootPath, Options)) return;
+
+        while (true) {
+            if (wait_key(30)) {
+                int wc = mz::wgetch();
+                switch (wc) {
+                case UPKEY: sb.move_up(); break;
+                case DOWNKEY: sb.move_down(); break;
+                case PAGEUPKEY: sb.page_up(); break;
+                case PAGEDOWNKEY: sb.page_down(); break;
+                case ESCAPEKEY:
+                    if (Grep.done()) return;
+                    Grep.cancel();
+                    break;
+                default: break;
+                }
+            }
+            Grep.stream_to(sb);
+            Grep.report(Footer);
+        }
+    }
+
+} // namespace mz
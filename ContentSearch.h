@@ -0,0 +1,365 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_CONTENT_SEARCH_H
+#define MZ_CONTENT_SEARCH_H
+#pragma once
+
+/**
+ * @file ContentSearch.h
+ * @brief Parallel search of file contents for a literal string
+ *
+ * ContentSearch lists files with ParallelFind and scans them on a set of
+ * worker threads. Large files are mapped, small ones are read with a single
+ * pread. The literal is found with a SIMD prefilter on its first and last
+ * bytes, and candidates are verified byte by byte. Files whose first block
+ * holds a NUL byte are taken as binary and skipped. Each matching line is
+ * reported once, with its line number and a preview, and can be streamed
+ * into a DirectoryDisplayBox while the footer shows the throughput.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ParallelFind.h"
+#include "FooterBox.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MZ_SEARCH_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace mz {
+
+    namespace detail {
+
+        /**
+         * @brief Compare a candidate with a needle
+         *
+         * @param Folded Needle is lowercase and Hay is compared without ASCII case
+         */
+        inline bool same_bytes(char const* Hay, std::string_view Needle, bool Folded) noexcept {
+            if (!Folded) {
+                return std::memcmp(Hay, Needle.data(), Needle.size()) == 0;
+            }
+            for (size_t i = 0; i < Needle.size(); i++) {
+                if (fold_ascii(Hay[i]) != Needle[i]) {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+#if defined(MZ_SEARCH_SSE2)
+        /**
+         * @brief Compare 16 bytes with a needle byte
+         *
+         * With Folded, letters are compared without case: OR-ing 0x20 turns
+         * upper into lower case. It also merges a few punctuation pairs,
+         * which the verification sorts out.
+         */
+        inline __m128i byte_equal(__m128i v, __m128i Byte, __m128i Fold) noexcept {
+            return _mm_cmpeq_epi8(_mm_or_si128(v, Fold), Byte);
+        }
+#endif
+
+    } // namespace detail
+
+    /**
+     * @brief Find a literal in a buffer
+     *
+     * Loads 16 bytes at each position and 16 bytes at the position of the
+     * needle's last byte; only where both the first and the last byte match
+     * is the rest compared.
+     *
+     * @param Hay Buffer to search
+     * @param Needle Literal to find; lowercase if IgnoreCase
+     * @param IgnoreCase Compare ASCII letters without case
+     * @param From Position to start at
+     * @return Position of the first match, or npos if there is none
+     */
+    inline size_t find_literal(std::string_view Hay, std::string_view Needle, bool IgnoreCase, size_t From = 0) noexcept {
+        size_t m = Needle.size();
+        size_t n = Hay.size();
+        if (m == 0) return From <= n ? From : std::string_view::npos;
+        if (m > n || From > n - m) return std::string_view::npos;
+
+        char const* p = Hay.data();
+        size_t Last = n - m;            // Last possible start
+        size_t i = From;
+#if defined(MZ_SEARCH_SSE2)
+        auto First = static_cast<unsigned char>(Needle[0]);
+        auto Final = static_cast<unsigned char>(Needle[m - 1]);
+        auto fold_of = [IgnoreCase](unsigned char c) {
+            return static_cast<char>(IgnoreCase && c >= 'a' && c <= 'z' ? 0x20 : 0);
+        };
+        __m128i FirstByte = _mm_set1_epi8(static_cast<char>(First));
+        __m128i FinalByte = _mm_set1_epi8(static_cast<char>(Final));
+        __m128i FirstFold = _mm_set1_epi8(fold_of(First));
+        __m128i FinalFold = _mm_set1_epi8(fold_of(Final));
+
+        for (; i + 16 <= Last + 1; i += 16) {
+            __m128i Head = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i));
+            __m128i Tail = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + i + m - 1));
+            unsigned Mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(
+                detail::byte_equal(Head, FirstByte, FirstFold),
+                detail::byte_equal(Tail, FinalByte, FinalFold))));
+            while (Mask) {
+                size_t k = i + static_cast<size_t>(std::countr_zero(Mask));
+                if (detail::same_bytes(p + k, Needle, IgnoreCase)) {
+                    return k;
+                }
+                Mask &= Mask - 1;
+            }
+        }
+#endif
+        for (; i <= Last; i++) {
+            if (detail::same_bytes(p + i, Needle, IgnoreCase)) {
+                return i;
+            }
+        }
+        return std::string_view::npos;
+    }
+
+    /**
+     * @struct grep_options
+     * @brief What ContentSearch looks for and where
+     */
+    struct grep_options {
+        std::wstring Text;                      ///< Literal to find (UTF-8 in the files)
+        bool IgnoreCase{ false };               ///< Compare ASCII letters without case
+        find_options Files;                     ///< Files to scan: name pattern, depth, file systems
+        unsigned NumThreads{ 0 };               ///< Scanner threads (0 for the number of hardware threads)
+        uint64_t MaxFileSize{ 1ull << 32 };     ///< Larger files are skipped
+        size_t MaxMatchesPerFile{ 1000 };       ///< Lines reported per file
+    };
+
+    /**
+     * @struct grep_match
+     * @brief One matching line
+     */
+    struct grep_match {
+        std::string Path;           ///< File path relative to the root
+        uint32_t Line{ 0 };         ///< Line number, from 1
+        uint32_t Column{ 0 };       ///< Byte offset of the match in the line, from 0
+        std::wstring Preview;       ///< Text of the line, shortened and with controls replaced
+    };
+
+    /**
+     * @struct grep_stats
+     * @brief Progress of a content search
+     */
+    struct grep_stats {
+        uint64_t Files{ 0 };        ///< Files scanned
+        uint64_t Binary{ 0 };       ///< Files skipped as binary
+        uint64_t Bytes{ 0 };        ///< Bytes scanned
+        uint64_t Matches{ 0 };      ///< Matching lines
+        double Seconds{ 0 };        ///< Time since start, or duration once done
+        bool Done{ false };         ///< Search finished or was cancelled
+
+        /**
+         * @brief Scanning speed in bytes per second
+         */
+        double throughput() const noexcept {
+            return Seconds > 0 ? static_cast<double>(Bytes) / Seconds : 0.0;
+        }
+    };
+
+    /**
+     * @class ContentSearch
+     * @brief Multi-threaded search of file contents
+     *
+     * @code
+     * ContentSearch Grep;
+     * grep_options Options;
+     * Options.Text = L"TODO";
+     * Options.Files.Pattern = L"*.cpp";
+     * Grep.start(L"src", Options);
+     * while (!Grep.done() || Grep.pending()) {
+     *     if (wait_key(30)) handle_key(wgetch());
+     *     Grep.stream_to(List);
+     *     Grep.report(Footer);
+     * }
+     * @endcode
+     */
+    class ContentSearch {
+    private:
+        ParallelFind Finder;                    ///< Lists the files to scan
+        grep_options Options;
+        std::string Needle;                     ///< Literal as UTF-8, lowercase if IgnoreCase
+        std::wstring Root;
+        int RootFd{ -1 };                       ///< Open root directory (POSIX)
+
+        std::vector<std::thread> Threads;
+        std::atomic<bool> Cancelled{ false };
+        std::atomic<unsigned> Running{ 0 };     ///< Scanners still running
+
+        detail::result_queue<grep_match> Results;   ///< Matches not yet taken
+
+        std::atomic<uint64_t> NumFiles{ 0 };
+        std::atomic<uint64_t> NumBinary{ 0 };
+        std::atomic<uint64_t> NumBytes{ 0 };
+        std::atomic<uint64_t> NumMatches{ 0 };
+        detail::run_clock Clock;                ///< Stopped by the last scanner to finish
+
+        /**
+         * @brief Scanner thread body
+         */
+        void scan() noexcept;
+
+        /**
+         * @brief Scan one file
+         */
+        void scan_file(std::string const& Path, std::vector<char>& Buffer, std::vector<grep_match>& Found) noexcept;
+
+        /**
+         * @brief Find the matching lines of a file's contents
+         */
+        void scan_text(std::string const& Path, std::string_view Text, std::vector<grep_match>& Found) noexcept;
+
+        /**
+         * @brief Release the root directory
+         */
+        void close_root() noexcept;
+
+    public:
+        /**
+         * @brief Files up to this size are read; larger ones are mapped
+         */
+        static constexpr size_t MapThreshold{ 256 * 1024 };
+
+        /**
+         * @brief Bytes looked at for a NUL to tell a binary file
+         */
+        static constexpr size_t SniffSize{ 8 * 1024 };
+
+        /**
+         * @brief Longest preview, in bytes of the line
+         */
+        static constexpr size_t PreviewSize{ 240 };
+
+        ContentSearch() noexcept = default;
+        ContentSearch(ContentSearch const&) = delete;
+        ContentSearch& operator=(ContentSearch const&) = delete;
+
+        /**
+         * @brief Cancel and wait for the scanners
+         */
+        ~ContentSearch() noexcept;
+
+        /**
+         * @brief Start a search, cancelling any search in progress
+         *
+         * @param RootPath Directory to search
+         * @param SearchOptions Literal, files and limits
+         * @return true if the root cannot be opened or the literal is empty
+         */
+        bool start(std::wstring const& RootPath, grep_options SearchOptions) noexcept;
+
+        /**
+         * @brief Stop the search; scanners finish the block they are reading
+         */
+        void cancel() noexcept;
+
+        /**
+         * @brief Wait for the scanners to finish
+         */
+        void wait() noexcept;
+
+        /**
+         * @brief Check whether the search has finished
+         */
+        bool done() const noexcept {
+            return Running.load() == 0;
+        }
+
+        /**
+         * @brief Check whether matches are waiting to be taken
+         */
+        bool pending() noexcept {
+            return Results.pending();
+        }
+
+        /**
+         * @brief Take the matches found since the last call
+         *
+         * Matches of one file arrive together, in line order.
+         *
+         * @param Out Receives up to Max matches
+         * @param Max Largest number of matches to take
+         * @return Number of matches taken
+         */
+        size_t take(std::vector<grep_match>& Out, size_t Max = SIZE_MAX) {
+            return Results.take(Out, Max);
+        }
+
+        /**
+         * @brief Get the progress of the search
+         */
+        grep_stats stats() const noexcept;
+
+        /**
+         * @brief Append new matches to a list box and draw them
+         *
+         * Each item shows the line number in the left column and
+         * "path: preview" after it. Stops listing at ParallelFind::MaxListed.
+         *
+         * @param Box List that is already on screen
+         * @param Max Largest number of matches to append in this call
+         * @return Number of matches taken
+         */
+        size_t stream_to(DirectoryDisplayBox& Box, size_t Max = 1024);
+
+        /**
+         * @brief Show the progress and throughput in a footer
+         *
+         * The footer is only written when the text changes.
+         */
+        void report(FooterBox& Footer);
+
+        /**
+         * @brief Run a test search into a list with a footer
+         *
+         * The arrow and page keys move through the list while it fills.
+         * Escape cancels the search, or leaves once it has stopped.
+         *
+         * @param Window Screen area for the test
+         * @param RootPath Directory to search
+         * @param Text Literal to look for
+         */
+        static void Test(coord_box Window, std::wstring const& RootPath, std::wstring const& Text);
+    };
+
+} // namespace mz
+
+#endif // MZ_CONTENT_SEARCH_H
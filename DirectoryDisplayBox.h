@@ -41,10 +41,15 @@
 #include "coord.h"
 #include "cursor.h"
 #include "WindowBox.h"
+#include "StartupProfiler.h"
+#include "TemplateBuffer.h"
+#include "RenderMemo.h"
 #include <vector>
 #include <string>
 #include <string_view>
 #include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
 
 namespace mz {
 
@@ -83,6 +88,11 @@ namespace mz {
              */
             int EndOffset{ 0 };
 
+            /**
+             * @brief Hash of the item text, used to detect modified items
+             */
+            uint64_t Hash{ 0 };
+
             /**
              * @brief Selection state of this item
              */
@@ -116,6 +126,40 @@ namespace mz {
          */
         std::vector<name_column> NameColumns;
 
+        /**
+         * @brief Identity of each item, matched by update_items()
+         *
+         * The item text unless a separate key (such as an inode number)
+         * was given.
+         */
+        std::vector<std::wstring> ItemKeys;
+
+        /**
+         * @brief Cancels the task queued by load_items_lazy() on destruction
+         */
+        idle_guard Guard;
+
+        /**
+         * @struct list_item
+         * @brief An entry passed to update_items()
+         */
+        struct list_item {
+            std::wstring Key;   ///< Identity that survives renames of the display text
+            std::wstring Text;  ///< Display text
+        };
+
+        /**
+         * @struct list_changes
+         * @brief What update_items() changed
+         */
+        struct list_changes {
+            int Inserted{ 0 };  ///< Items with a new key
+            int Deleted{ 0 };   ///< Keys no longer present
+            int Modified{ 0 };  ///< Kept keys whose text changed
+            int Moved{ 0 };     ///< Kept items that changed order relative to the others
+            int Repainted{ 0 }; ///< Screen rows written
+        };
+
         /**
          * @brief Width of the left column in characters
          */
@@ -223,6 +267,39 @@ namespace mz {
          */
         std::wstring TempBuffer;
 
+        /**
+         * @brief Slot layout of an item line
+         *
+         * Style, left column, left quote, right column and right quote.
+         * Focus, selection and horizontal scrolling patch these slots and
+         * write out only what changed.
+         */
+        template_buffer Line;
+
+        /**
+         * @brief Slot indexes in Line
+         */
+        int StyleSlot{ 0 }, LeftSlot{ 0 }, LeftSignSlot{ 0 }, RightSlot{ 0 }, RightSignSlot{ 0 };
+
+        /**
+         * @brief Restyle an item line for its focus and selection state
+         *
+         * @param Index Item index
+         * @param Focused Whether the item has the focus
+         */
+        void set_line_style(int Index, bool Focused) {
+            bool Selected = NameColumns[Index].Selected;
+            Line.patch(bf, Index, StyleSlot,
+                Focused ? (Selected ? CommBoth : CommFocus) : (Selected ? CommSelect : CommInit));
+        }
+
+        /**
+         * @brief Write out the patched slots of the visible lines
+         */
+        void flush_lines() {
+            Line.flush(bf, TopIndex, Area.num_rows() - 1, Area.Top);
+        }
+
         /**
          * @brief Default constructor
          */
@@ -323,6 +400,18 @@ namespace mz {
             bf.append(CommReturn);
             TextLineLength = static_cast<int>(bf.size());
             bf.clear();
+
+            // Describe the line layout
+            Line.reset(TextLineLength);
+            StyleSlot = Line.add(L"style", template_buffer::slot_kind::style, 0, static_cast<int>(CommInit.size()));
+            LeftSlot = Line.add(L"left", template_buffer::slot_kind::text,
+                static_cast<int>(CommInit.size()), LeftColumnSize, 0);
+            LeftSignSlot = Line.add(L"left sign", template_buffer::slot_kind::indicator,
+                offsetLeftSign, 1, LeftColumnSize);
+            RightSlot = Line.add(L"right", template_buffer::slot_kind::text,
+                offsetColumn2, RightColumnSize, LeftColumnSize + 1);
+            RightSignSlot = Line.add(L"right sign", template_buffer::slot_kind::indicator,
+                offsetRightSign, 1, LeftColumnSize + RightColumnSize + 1);
         }
 
         /**
@@ -354,57 +443,370 @@ namespace mz {
 
             // Highlight first item if any items exist
             if (NumIndexes > 0) {
-                bf.replace(0, CommFocus.size(), CommFocus);
+                set_line_style(0, true);
             }
         }
 
+        /**
+         * @brief Format the display line of an item
+         *
+         * @param Out Receives exactly TextLineLength characters
+         * @param col Item record; its text offsets are set here
+         * @param sv Text for the item
+         */
+        void format_item(std::wstring& Out, name_column& col, std::wstring_view sv) {
+            col.Hash = render_hash().add(sv).value();
+            col.FirstIndex = LeftColumnSize;
+            col.BeginOffset = static_cast<int>(NameContainer.size());
+            col.Selected = false;
+
+            // Format display of the item
+            Out.append(CommInit);
+            Out.append(sv.substr(0, LeftColumnSize));
+            if (sv.size() < static_cast<size_t>(LeftColumnSize)) {
+                Out.append(LeftColumnSize - sv.size(), ' ');
+                sv = {};
+            }
+            else {
+                sv.remove_prefix(LeftColumnSize);
+            }
+            Out.push_back(' ');
+
+            // Handle text that fits entirely in the visible area
+            if (sv.size() <= static_cast<size_t>(RightColumnSize)) {
+                Out.append(sv);
+                Out.append(static_cast<size_t>(RightColumnSize) - sv.size(), ' ');
+                Out.push_back(' ');
+            }
+            // Handle text that requires horizontal scrolling
+            else {
+                Out.append(sv.substr(0, RightColumnSize));
+                NameContainer.append(sv);
+                PushBack(Out, RRQUOTE);
+            }
+
+            // Complete the line
+            Out.append(CommReturn);
+            col.EndOffset = static_cast<int>(NameContainer.size());
+        }
+
         /**
          * @brief Add a new item to the list
          *
          * Adds an item with the specified text and formats it appropriately.
          *
          * @param sv Text for the new item
+         * @param Key Identity for update_items() (empty: the text)
          * @throws std::bad_alloc If memory allocation fails
          */
-        void add_item(std::wstring_view sv) {
+        void add_item(std::wstring_view sv, std::wstring_view Key = {}) {
             // Check for valid state
             if (CommReturn.empty()) {
                 throw std::bad_alloc();
             }
 
-            // Calculate column sizes
-            int ColumnSizes = LeftColumnSize + RightColumnSize;
-
             // Create new item
             ++NumIndexes;
             auto& col = NameColumns.emplace_back(name_column{});
-            col.FirstIndex = LeftColumnSize;
-            col.BeginOffset = static_cast<int>(NameContainer.size());
-            col.Selected = false;
+            format_item(bf, col, sv);
+            ItemKeys.emplace_back(Key.empty() ? sv : Key);
+        }
 
-            // Format display of the item
-            bf.append(CommInit);
-            bf.append(sv.substr(0, LeftColumnSize));
-            bf.push_back(' ');
+        /**
+         * @brief Add an item to a list that is already on screen
+         *
+         * Takes the place of the first blank row left by create(), or is
+         * added at the end. Nothing is written; call draw_appended() after
+         * a batch of items.
+         *
+         * @param sv Text for the new item
+         * @param Key Identity for update_items() (empty: the text)
+         */
+        void append_item(std::wstring_view sv, std::wstring_view Key = {}) {
+            if (NumIndexes >= static_cast<int>(NameColumns.size())) {
+                add_item(sv, Key);
+            }
+            else {
+                std::wstring Text;
+                Text.reserve(TextLineLength);
+                format_item(Text, NameColumns[NumIndexes], sv);
+                bf.replace(static_cast<size_t>(TextLineLength) * NumIndexes, TextLineLength, Text);
+                ItemKeys.resize(NumIndexes);
+                ItemKeys.emplace_back(Key.empty() ? sv : Key);
+                ++NumIndexes;
+            }
+            if (NumIndexes - 1 == FocusIndex) {
+                set_line_style(FocusIndex, true);
+            }
+        }
 
-            // Handle text that fits entirely in the visible area
-            if (sv.size() <= static_cast<size_t>(ColumnSizes)) {
-                bf.append(sv.substr(LeftColumnSize, sv.size() - LeftColumnSize));
-                if (sv.size() < static_cast<size_t>(ColumnSizes)) {
-                    bf.append(static_cast<size_t>(ColumnSizes) - sv.size(), ' ');
+        /**
+         * @brief Write the appended items that are visible, and the scrollbar
+         *
+         * @param From Number of items before the batch was appended
+         */
+        void draw_appended(int From) {
+            TempBuffer.clear();
+            int Rows = Area.num_rows() - 1;
+            int Begin = std::max(From, TopIndex);
+            int End = std::min(NumIndexes, TopIndex + Rows);
+            if (Begin < End) {
+                Area.Top.offset(Begin - TopIndex, 0).apply(TempBuffer);
+                TempBuffer.append(std::wstring_view(bf).substr(
+                    static_cast<size_t>(TextLineLength) * Begin,
+                    static_cast<size_t>(TextLineLength) * (End - Begin)));
+            }
+            if (From < NumIndexes) {
+                vScroll.draw(TempBuffer, FocusIndex, NumIndexes);
+            }
+            mz::Write(TempBuffer);
+        }
+
+        /**
+         * @brief Replace the items, keeping what did not change
+         *
+         * Items are matched to the current ones by key. Kept items keep
+         * their line, selection and horizontal scroll; only inserted and
+         * modified items are formatted. The focus stays on the same key
+         * (or the same position if that key is gone) at the same screen
+         * row where possible, and only the visible rows whose content
+         * changed are written, so a refresh costs output in proportion to
+         * what changed on screen.
+         *
+         * @param Items New entries in display order
+         * @return What changed
+         */
+        list_changes update_items(std::vector<list_item> const& Items) {
+            return reconcile(Items.size(),
+                [&Items](size_t i) { return std::wstring_view(Items[i].Key); },
+                [&Items](size_t i) { return std::wstring_view(Items[i].Text); });
+        }
+
+        /**
+         * @brief Replace the items, each identified by its text
+         *
+         * @param Items New entries in display order
+         * @return What changed
+         */
+        list_changes update_items(std::vector<std::wstring> const& Items) {
+            return reconcile(Items.size(),
+                [&Items](size_t i) { return std::wstring_view(Items[i]); },
+                [&Items](size_t i) { return std::wstring_view(Items[i]); });
+        }
+
+        /**
+         * @brief Reconcile the item store with a new list
+         *
+         * @param Count Number of new items
+         * @param KeyOf Key of new item i
+         * @param TextOf Text of new item i
+         */
+        template <typename KeyFn, typename TextFn>
+        list_changes reconcile(size_t Count, KeyFn KeyOf, TextFn TextOf) {
+            list_changes Changes;
+            if (CommReturn.empty()) {
+                return Changes;
+            }
+
+            // Put pending patches on screen so the comparison below sees the truth
+            flush_lines();
+
+            const int Rows = Area.num_rows() - 1;
+            const int OldCount = NumIndexes;
+            const int NewCount = static_cast<int>(Count);
+            const size_t Stride = static_cast<size_t>(TextLineLength);
+            const int OldTop = TopIndex;
+            const int OldFocus = FocusIndex;
+            ItemKeys.resize(OldCount);
+
+            // Screen contents before the update
+            std::wstring Shown = bf.substr(std::min(Stride * OldTop, bf.size()), Stride * Rows);
+            Shown.resize(Stride * Rows);
+
+            // Match new items to old ones by key; a repeated key counts as new
+            std::vector<int> Match(Count, -1);
+            {
+                std::unordered_map<std::wstring_view, int> OldIndex;
+                OldIndex.reserve(static_cast<size_t>(OldCount));
+                for (int i = 0; i < OldCount; i++) {
+                    OldIndex.try_emplace(ItemKeys[i], i);
+                }
+                std::vector<bool> Used(static_cast<size_t>(OldCount), false);
+                for (size_t n = 0; n < Count; n++) {
+                    auto it = OldIndex.find(KeyOf(n));
+                    if (it != OldIndex.end() && !Used[it->second]) {
+                        Used[it->second] = true;
+                        Match[n] = it->second;
+                    }
                 }
-                bf.push_back(' ');
             }
-            // Handle text that requires horizontal scrolling
+
+            // Kept items outside the longest increasing run of old indexes have moved
+            std::vector<int> Run;
+            int Kept{ 0 };
+            for (int j : Match) {
+                if (j < 0) continue;
+                ++Kept;
+                auto it = std::lower_bound(Run.begin(), Run.end(), j);
+                if (it == Run.end()) Run.push_back(j);
+                else *it = j;
+            }
+            Changes.Moved = Kept - static_cast<int>(Run.size());
+            Changes.Deleted = OldCount - Kept;
+
+            // The focus follows its key
+            int NewFocus{ -1 };
+            for (int n = 0; n < NewCount && OldFocus < OldCount; n++) {
+                if (Match[n] == OldFocus) {
+                    NewFocus = n;
+                    break;
+                }
+            }
+            if (NewFocus < 0) {
+                NewFocus = std::clamp(OldFocus, 0, std::max(NewCount - 1, 0));
+            }
+
+            // Build the new store, copying the lines of unchanged items
+            std::wstring Lines;
+            Lines.reserve(Stride * std::max(NewCount, Rows));
+            std::vector<name_column> Columns;
+            Columns.reserve(std::max(NewCount, Rows));
+            std::vector<std::wstring> Keys;
+            Keys.reserve(Count);
+            for (size_t n = 0; n < Count; n++) {
+                int j = Match[n];
+                std::wstring_view Text = TextOf(n);
+                if (j >= 0 && NameColumns[j].Hash == render_hash().add(Text).value()) {
+                    Columns.push_back(NameColumns[j]);
+                    Lines.append(std::wstring_view(bf).substr(Stride * j, Stride));
+                    Keys.push_back(std::move(ItemKeys[j]));
+                }
+                else {
+                    auto& col = Columns.emplace_back(name_column{});
+                    format_item(Lines, col, Text);
+                    if (j >= 0) {
+                        col.Selected = NameColumns[j].Selected;
+                        Keys.push_back(std::move(ItemKeys[j]));
+                        ++Changes.Modified;
+                    }
+                    else {
+                        Keys.emplace_back(KeyOf(n));
+                        ++Changes.Inserted;
+                    }
+                }
+
+                // Copied lines may carry the old focus style
+                bool Selected = Columns.back().Selected;
+                bool Focused = static_cast<int>(n) == NewFocus;
+                std::wstring const& Style = Focused ? (Selected ? CommBoth : CommFocus) : (Selected ? CommSelect : CommInit);
+                Lines.replace(Stride * n, Style.size(), Style);
+            }
+
+            // Blank rows below a short list
+            for (int i = NewCount; i < Rows; i++) {
+                auto& col = Columns.emplace_back(name_column{});
+                col.FirstIndex = LeftColumnSize;
+                col.BeginOffset = col.EndOffset = static_cast<int>(NameContainer.size());
+                Lines.append(CommInit);
+                Lines.append(LeftColumnSize + RightColumnSize + 2, ' ');
+                Lines.append(CommReturn);
+            }
+
+            bf.swap(Lines);
+            NameColumns.swap(Columns);
+            ItemKeys.swap(Keys);
+            NumIndexes = NewCount;
+            FocusIndex = NewFocus;
+
+            // Keep the focused item on the same screen row if the list allows it
+            TopIndex = std::clamp(NewFocus - (OldFocus - OldTop), 0, std::max(NewCount - Rows, 0));
+            if (FocusIndex < TopIndex) TopIndex = FocusIndex;
+            if (FocusIndex >= TopIndex + Rows) TopIndex = FocusIndex - Rows + 1;
+
+            compact_names();
+            Line.discard();
+
+            // Write only the rows whose content changed
+            TempBuffer.clear();
+            bool Continues{ false };
+            for (int r = 0; r < Rows; r++) {
+                std::wstring_view Now = std::wstring_view(bf).substr(Stride * (TopIndex + r), Stride);
+                if (Now == std::wstring_view(Shown).substr(Stride * r, Stride)) {
+                    Continues = false;
+                    continue;
+                }
+                if (!Continues) {
+                    Area.Top.offset(r, 0).apply(TempBuffer);
+                }
+                TempBuffer.append(Now);
+                Continues = true;
+                ++Changes.Repainted;
+            }
+            if (NumIndexes > 0) {
+                name_column const& Item = NameColumns[FocusIndex];
+                vScroll.draw(TempBuffer, FocusIndex, NumIndexes);
+                hScroll.draw(TempBuffer, Item.FirstIndex - LeftColumnSize, Item.size());
+            }
             else {
-                bf.append(sv.substr(LeftColumnSize, RightColumnSize));
-                NameContainer.append(sv.substr(LeftColumnSize, sv.size() - LeftColumnSize));
-                PushBack(bf, RRQUOTE);
+                vScroll.draw(TempBuffer, 0, 0);
+                hScroll.draw(TempBuffer, 0, 0);
+            }
+            if (!TempBuffer.empty()) {
+                mz::Write(TempBuffer);
             }
+            return Changes;
+        }
 
-            // Complete the line
-            bf.append(CommReturn);
-            col.EndOffset = static_cast<int>(NameContainer.size());
+        /**
+         * @brief Drop the text of replaced items from NameContainer
+         *
+         * update_items() appends the text of new and modified items, so the
+         * container is rebuilt once more than half of it is unused.
+         */
+        void compact_names() {
+            size_t Used{ 0 };
+            for (auto const& col : NameColumns) {
+                Used += static_cast<size_t>(col.size());
+            }
+            if (NameContainer.size() <= 2 * Used + 4096) {
+                return;
+            }
+            std::wstring Names;
+            Names.reserve(Used);
+            for (auto& col : NameColumns) {
+                int Begin = static_cast<int>(Names.size());
+                Names.append(std::wstring_view(NameContainer).substr(col.BeginOffset, col.size()));
+                col.BeginOffset = Begin;
+                col.EndOffset = static_cast<int>(Names.size());
+            }
+            NameContainer.swap(Names);
+        }
+
+        /**
+         * @brief Populate the list when idle, painting a placeholder now
+         *
+         * Paints the list area in its background color immediately, then
+         * queues initialize(), add_item() for every entry, create() and
+         * draw_all2() on idle_tasks(). The task does nothing if the box is
+         * destroyed first.
+         *
+         * @param Items Entries to display (moved into the task)
+         */
+        void load_items_lazy(std::vector<std::wstring> Items) {
+            Color = ListColors;
+            print_placeholder();
+            idle_tasks().defer(L"DirectoryDisplayBox items", [this, Alive = Guard.watch(), Items = std::move(Items)] {
+                if (Alive.expired()) return;
+                NameColumns.clear();
+                ItemKeys.clear();
+                NumIndexes = 0;
+                initialize();
+                for (auto const& Item : Items) {
+                    add_item(Item);
+                }
+                create();
+                draw_all2();
+            });
         }
 
         /**
@@ -414,6 +816,8 @@ namespace mz {
          */
         void draw_all2() noexcept {
             TempBuffer.clear();
+            vScroll.invalidate();
+            hScroll.invalidate();
 
             // Draw scrollbars if items exist
             if (FocusIndex >= 0 && FocusIndex < NumIndexes) {
@@ -433,6 +837,7 @@ namespace mz {
                 TextLineLength * TopIndex,
                 TextLineLength * (Area.num_rows() - 1))
             );
+            Line.discard();
         }
 
         /**
@@ -445,18 +850,10 @@ namespace mz {
             NameColumns[FocusIndex].Selected = !NameColumns[FocusIndex].Selected;
 
             // Update display formatting based on new state
-            if (NameColumns[FocusIndex].Selected) {
-                bf.replace(TextLineLength * FocusIndex, CommBoth.size(), CommBoth);
-            }
-            else {
-                bf.replace(TextLineLength * FocusIndex, CommFocus.size(), CommFocus);
-            }
+            set_line_style(FocusIndex, true);
 
             // Render the updated item
-            TempBuffer.clear();
-            Area.Top.offset(FocusIndex - TopIndex, 0).apply(TempBuffer);
-            mz::Write(TempBuffer);
-            mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength));
+            flush_lines();
 
             return NameColumns[FocusIndex].Selected;
         }
@@ -481,44 +878,24 @@ namespace mz {
                 }
 
                 // Unmark current focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommSelect.size(), CommSelect);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommInit.size(), CommInit);
-                }
+                set_line_style(FocusIndex, false);
 
-                // Render the updated line
-                Area.Top.offset(FocusIndex - TopIndex, 0).apply(TempBuffer);
+                // Render the scrollbar
                 mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength));
 
                 // Move focus to top visible item
                 FocusIndex = TopIndex;
 
                 // Mark new focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommBoth.size(), CommBoth);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommFocus.size(), CommFocus);
-                }
+                set_line_style(FocusIndex, true);
 
-                // Render the updated focus line
-                TempBuffer.clear();
-                Area.Top.apply(TempBuffer);
-                mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength));
+                // Render both updated lines
+                flush_lines();
             }
             // If top item is not the first item, scroll up a page
             else if (TopIndex > 0) {
                 // Unmark current focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommSelect.size(), CommSelect);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommInit.size(), CommInit);
-                }
+                set_line_style(FocusIndex, false);
 
                 // Calculate new top position (scroll up a page)
                 TopIndex -= Area.num_rows() - 1;
@@ -526,12 +903,7 @@ namespace mz {
                 FocusIndex = TopIndex;
 
                 // Mark new focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommBoth.size(), CommBoth);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommFocus.size(), CommFocus);
-                }
+                set_line_style(FocusIndex, true);
 
                 // Update scrollbars and render
                 TempBuffer.clear();
@@ -540,6 +912,7 @@ namespace mz {
                 Area.Top.apply(TempBuffer);
                 mz::Write(TempBuffer);
                 mz::Write(std::wstring_view(bf).substr(TextLineLength * TopIndex, TextLineLength * NumPrintIndex));
+                Line.discard();
             }
             // Already at top, just wait a bit to show feedback
             else {
@@ -571,44 +944,24 @@ namespace mz {
                 }
 
                 // Unmark current focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommSelect.size(), CommSelect);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommInit.size(), CommInit);
-                }
+                set_line_style(FocusIndex, false);
 
-                // Render the updated line
-                Area.Top.offset(FocusIndex - TopIndex, 0).apply(TempBuffer);
+                // Render the scrollbar
                 mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength));
 
                 // Move focus to bottom visible item
                 FocusIndex = BottomIndex;
 
                 // Mark new focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommBoth.size(), CommBoth);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommFocus.size(), CommFocus);
-                }
+                set_line_style(FocusIndex, true);
 
-                // Render the updated focus line
-                TempBuffer.clear();
-                Area.Top.offset(BottomIndex - TopIndex, 0).apply(TempBuffer);
-                mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength));
+                // Render both updated lines
+                flush_lines();
             }
             // If bottom item is not the last item, scroll down a page
             else if (BottomIndex < NumIndexes - 1) {
                 // Unmark current focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommSelect.size(), CommSelect);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommInit.size(), CommInit);
-                }
+                set_line_style(FocusIndex, false);
 
                 // Calculate new bottom position (scroll down a page)
                 BottomIndex += Area.num_rows() - 2;
@@ -616,12 +969,7 @@ namespace mz {
                 FocusIndex = BottomIndex;
 
                 // Mark new focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommBoth.size(), CommBoth);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommFocus.size(), CommFocus);
-                }
+                set_line_style(FocusIndex, true);
 
                 // Calculate new top position
                 TopIndex = BottomIndex - (Area.num_rows() - 2);
@@ -637,6 +985,7 @@ namespace mz {
                 Area.Top.apply(TempBuffer);
                 mz::Write(TempBuffer);
                 mz::Write(std::wstring_view(bf).substr(TextLineLength * TopIndex, TextLineLength * NumPrintIndex));
+                Line.discard();
             }
             // Already at bottom, just wait a bit to show feedback
             else {
@@ -654,38 +1003,25 @@ namespace mz {
         int move_up() noexcept {
             if (!NumIndexes) { return -1; }
 
-            // Default number of lines to render
-            int NumPrintIndex = 2;
-
             // Move up if not at first item
             if (FocusIndex > 0) {
                 // Unmark current focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommSelect.size(), CommSelect);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommInit.size(), CommInit);
-                }
+                set_line_style(FocusIndex, false);
 
                 // Move focus up one item
                 --FocusIndex;
 
                 // Mark new focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommBoth.size(), CommBoth);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommFocus.size(), CommFocus);
-                }
+                set_line_style(FocusIndex, true);
 
                 // Prepare render buffer
                 TempBuffer.clear();
 
                 // If focus moved above visible area, scroll up
-                if (TopIndex > FocusIndex) {
+                bool Scrolled = TopIndex > FocusIndex;
+                if (Scrolled) {
                     TopIndex = FocusIndex;
                     vScroll.draw(TempBuffer, TopIndex, NumIndexes);
-                    NumPrintIndex = Area.num_rows() - 1;
                 }
 
                 // Update horizontal scrollbar if needed
@@ -693,10 +1029,18 @@ namespace mz {
                     hScroll.draw(TempBuffer, NameColumns[FocusIndex].FirstIndex - LeftColumnSize, NameColumns[FocusIndex].size());
                 }
 
-                // Render the updated display
-                Area.Top.offset(FocusIndex - TopIndex, 0).apply(TempBuffer);
-                mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength * NumPrintIndex));
+                // Render the updated display: the whole page after a
+                // scroll, otherwise just the two restyled lines
+                if (Scrolled) {
+                    Area.Top.apply(TempBuffer);
+                    mz::Write(TempBuffer);
+                    mz::Write(std::wstring_view(bf).substr(TextLineLength * TopIndex, TextLineLength * (Area.num_rows() - 1)));
+                    Line.discard();
+                }
+                else {
+                    mz::Write(TempBuffer);
+                    flush_lines();
+                }
             }
             // Already at top, just wait a bit to show feedback
             else {
@@ -712,38 +1056,24 @@ namespace mz {
          * @return New focused item index, or -1 if empty
          */
         int move_down() noexcept {
-            // Default number of lines to render
-            int NumPrintIndex = 2;
-            int TopPrintIndex = FocusIndex;
-
             // Move down if not at last item
             if (FocusIndex + 1 < NumIndexes) {
                 // Unmark current focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommSelect.size(), CommSelect);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommInit.size(), CommInit);
-                }
+                set_line_style(FocusIndex, false);
 
                 // Move focus down one item
                 ++FocusIndex;
 
                 // Mark new focus
-                if (NameColumns[FocusIndex].Selected) {
-                    bf.replace(FocusIndex * TextLineLength, CommBoth.size(), CommBoth);
-                }
-                else {
-                    bf.replace(FocusIndex * TextLineLength, CommFocus.size(), CommFocus);
-                }
+                set_line_style(FocusIndex, true);
 
                 // Prepare render buffer
                 TempBuffer.clear();
 
                 // If focus moved below visible area, scroll down
-                if (FocusIndex - TopIndex >= Area.num_rows() - 1) {
-                    TopPrintIndex = ++TopIndex;
-                    NumPrintIndex = Area.num_rows() - 1;
+                bool Scrolled = FocusIndex - TopIndex >= Area.num_rows() - 1;
+                if (Scrolled) {
+                    ++TopIndex;
                     vScroll.draw(TempBuffer, TopIndex, NumIndexes);
                 }
 
@@ -752,10 +1082,18 @@ namespace mz {
                     hScroll.draw(TempBuffer, NameColumns[FocusIndex].FirstIndex - LeftColumnSize, NameColumns[FocusIndex].size());
                 }
 
-                // Render the updated display
-                Area.Top.offset(TopPrintIndex - TopIndex, 0).apply(TempBuffer);
-                mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * TopPrintIndex, TextLineLength * NumPrintIndex));
+                // Render the updated display: the whole page after a
+                // scroll, otherwise just the two restyled lines
+                if (Scrolled) {
+                    Area.Top.apply(TempBuffer);
+                    mz::Write(TempBuffer);
+                    mz::Write(std::wstring_view(bf).substr(TextLineLength * TopIndex, TextLineLength * (Area.num_rows() - 1)));
+                    Line.discard();
+                }
+                else {
+                    mz::Write(TempBuffer);
+                    flush_lines();
+                }
             }
             // Already at bottom, just wait a bit to show feedback
             else {
@@ -787,24 +1125,21 @@ namespace mz {
 
                 // Update left indicator if needed
                 if (item.FirstIndex == LeftColumnSize) {
-                    bf[TextLineLength * FocusIndex + offsetLeftSign] = ' ';
+                    Line.patch(bf, FocusIndex, LeftSignSlot, L" ");
                 }
 
                 // Update the visible text
                 auto sv = std::wstring_view(NameContainer).substr(item.BeginOffset, item.EndOffset);
-                bf.replace(TextLineLength * FocusIndex + offsetColumn2,
-                    RightColumnSize,
-                    sv.substr(item.FirstIndex - LeftColumnSize, RightColumnSize));
+                Line.patch(bf, FocusIndex, RightSlot, sv.substr(item.FirstIndex - LeftColumnSize, RightColumnSize));
 
                 // Ensure right indicator is visible
-                bf[TextLineLength * FocusIndex + offsetRightSign] = RRQUOTE[0];
+                Line.patch(bf, FocusIndex, RightSignSlot, std::wstring_view(RRQUOTE, 1));
 
                 // Update scrollbar and render
                 TempBuffer.clear();
                 hScroll.draw(TempBuffer, item.FirstIndex - LeftColumnSize, ItemSize - LeftColumnSize);
-                Area.Top.offset(FocusIndex - TopIndex, 0).apply(TempBuffer);
                 mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength));
+                flush_lines();
             }
         }
 
@@ -830,25 +1165,22 @@ namespace mz {
                 ++item.FirstIndex;
 
                 // Ensure left indicator is visible
-                bf[TextLineLength * FocusIndex + offsetLeftSign] = LLQUOTE[0];
+                Line.patch(bf, FocusIndex, LeftSignSlot, std::wstring_view(LLQUOTE, 1));
 
                 // Update the visible text
                 auto sv = std::wstring_view(NameContainer).substr(item.BeginOffset, item.EndOffset);
-                bf.replace(TextLineLength * FocusIndex + offsetColumn2,
-                    RightColumnSize,
-                    sv.substr(item.FirstIndex - LeftColumnSize, RightColumnSize));
+                Line.patch(bf, FocusIndex, RightSlot, sv.substr(item.FirstIndex - LeftColumnSize, RightColumnSize));
 
                 // Update right indicator if needed
                 if (item.FirstIndex == MaxFirstIndex) {
-                    bf[TextLineLength * FocusIndex + offsetRightSign] = ' ';
+                    Line.patch(bf, FocusIndex, RightSignSlot, L" ");
                 }
 
                 // Update scrollbar and render
                 TempBuffer.clear();
                 hScroll.draw(TempBuffer, item.FirstIndex - LeftColumnSize, ItemSize - LeftColumnSize);
-                Area.Top.offset(FocusIndex - TopIndex, 0).apply(TempBuffer);
                 mz::Write(TempBuffer);
-                mz::Write(std::wstring_view(bf).substr(TextLineLength * FocusIndex, TextLineLength));
+                flush_lines();
             }
         }
 
@@ -872,6 +1204,8 @@ namespace mz {
                     if (ReadIndex != WriteIndex) {
                         auto sv = std::wstring_view(bf).substr(TextLineLength * ReadIndex, TextLineLength);
                         bf.replace(TextLineLength * WriteIndex, TextLineLength, sv);
+                        NameColumns[WriteIndex] = NameColumns[ReadIndex];
+                        ItemKeys[WriteIndex] = std::move(ItemKeys[ReadIndex]);
                     }
 
                     ++WriteIndex;
@@ -880,6 +1214,7 @@ namespace mz {
 
             // Update item count
             NumIndexes = WriteIndex;
+            ItemKeys.resize(NumIndexes);
 
             // Resize buffer and fill with empty lines if needed
             bf.resize(TextLineLength * NumIndexes);
@@ -892,6 +1227,7 @@ namespace mz {
             // Reset view position
             TopIndex = 0;
             FocusIndex = 0;
+            Line.discard();
         }
 
         /**
@@ -945,6 +1281,18 @@ namespace mz {
             return std::wstring_view();
         }
 
+        /**
+         * @brief Get the key of the focused item
+         *
+         * @return Key of the focused item or empty view if none
+         */
+        std::wstring_view get_focused_key() const noexcept {
+            if (FocusIndex >= 0 && FocusIndex < NumIndexes && FocusIndex < static_cast<int>(ItemKeys.size())) {
+                return ItemKeys[FocusIndex];
+            }
+            return std::wstring_view();
+        }
+
         /**
          * @brief Get index of focused item
          *
@@ -960,6 +1308,7 @@ namespace mz {
         void clear_items() noexcept {
             NameContainer.clear();
             NameColumns.clear();
+            ItemKeys.clear();
             NumIndexes = 0;
             TopIndex = 0;
             FocusIndex = 0;
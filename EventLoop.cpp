@@ -0,0 +1,103 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "EventLoop.h"
+#include "TerminalManager.h"
+#include "DirectoryDisplayBox.h"
+#include "FooterBox.h"
+#include <algorithm>
+#include <format>
+#include <string>
+#include <vector>
+
+namespace mz {
+
+    void EventLoop::Test(coord_box Window) {
+        FooterBox Footer;
+        Footer.create(Window);
+
+        EventLoop Loop;
+        int Step{ 0 };
+        Loop.OnKey = [&Loop](key_event const& Event) {
+            if (Event.Key == ESCAPEKEY) Loop.quit();
+            else if (Event.Key == SPACEKEY) Loop.invalidate();
+        };
+        Loop.OnFocus = [&Loop](bool) { Loop.invalidate(); };
+        Loop.OnFrame = [&](bool Animate) {
+            static constexpr wchar_t Spinner[4]{ L'|', L'/', L'-', L'\\' };
+            if (Animate) ++Step;
+            Footer.centered_text(std::format(L"{} frames {}  wakeups {}  {}",
+                Spinner[Step % 4], Loop.frames(), Loop.wakeups(),
+                Loop.active() ? L"focused" : L"in background"));
+            Footer.print();
+            return Step < 600;
+        };
+        Loop.run();
+    }
+
+    void EventLoop::TestLazy(int NumRows, int NumCols) noexcept {
+        startup_profile().mark(L"demo start");
+        TerminalManager Terminal;
+        Terminal.setup_lazy(NumRows, NumCols);
+
+        // The placeholder is painted now; the entries are formatted when idle
+        coord_box Window = Terminal.get_window();
+        DirectoryDisplayBox List;
+        List.Area = Window.center_box(std::min(20, Window.num_rows() - 2), std::min(60, Window.num_cols()));
+        std::vector<std::wstring> Items;
+        Items.reserve(100000);
+        for (int i = 0; i < 100000; i++) {
+            Items.push_back(std::format(L"file{:06}.dat  {:>12}", i, i * 37));
+        }
+        List.load_items_lazy(std::move(Items));
+
+        FooterBox Footer;
+        Footer.create(Window);
+
+        EventLoop Loop;
+        Loop.OnKey = [&](key_event const& Event) {
+            switch (Event.legacy_key()) {
+            case ESCAPEKEY: Loop.quit(); break;
+            case UPKEY: List.move_up(); break;
+            case DOWNKEY: List.move_down(); break;
+            case PAGEUPKEY: List.page_up(); break;
+            case PAGEDOWNKEY: List.page_down(); break;
+            default: break;
+            }
+            Loop.invalidate();
+        };
+        Loop.OnFrame = [&](bool) {
+            Footer.centered_text(std::format(L"first frame {:.1f} ms  |  {}  |  ESC to quit",
+                startup_profile().time_to_first_frame(),
+                idle_tasks().empty() ? L"ready" : L"loading..."));
+            Footer.print();
+            return false;
+        };
+
+        // Queued after the setup and the list, so it runs once both are done
+        idle_tasks().defer(L"demo ready", [&Loop] { Loop.invalidate(); });
+        Loop.run();
+    }
+
+} // namespace mz
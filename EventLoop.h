@@ -0,0 +1,401 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_EVENT_LOOP_H
+#define MZ_EVENT_LOOP_H
+#pragma once
+
+/**
+ * @file EventLoop.h
+ * @brief Focus-aware frame scheduling for interactive consoles
+ *
+ * This file provides an event loop that renders only when something changed
+ * and blocks without a timeout when nothing did, so idle consoles cost no
+ * CPU at all. Frames are rate limited, and the limit drops to a background
+ * rate with animations suspended while the terminal is unfocused or its
+ * input is gone. Other threads mark the loop dirty through invalidate(),
+ * which wakes it immediately. A bound reactive graph has its effects
+ * flushed once per frame, just before OnFrame.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleCMD.h"
+#include "StartupProfiler.h"
+#include "coord.h"
+#include "Reactive.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#if defined(MZ_PLATFORM_WINDOWS)
+#include <Windows.h>
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+#include <fcntl.h>
+#endif
+
+namespace mz {
+
+    /**
+     * @class EventLoop
+     * @brief Input dispatch and rate-limited rendering on one thread
+     *
+     * Each pass draws a frame if one is due, otherwise runs an idle task,
+     * otherwise waits for input or a wake-up. The wait has no timeout unless
+     * a frame is pending, so a loop with nothing to draw never wakes.
+     *
+     * OnFrame is told whether animations may advance and returns true while
+     * it wants to keep refreshing (a spinner, a live dashboard). Live frames
+     * run at FocusedFps when focused and at BackgroundFps otherwise.
+     */
+    class EventLoop {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        int FocusedFps{ 60 };       ///< Frame rate limit while the terminal has focus
+        int BackgroundFps{ 1 };     ///< Frame rate limit while unfocused or detached (0 = dirty frames only)
+
+        std::function<void(key_event const&)> OnKey;    ///< Called for every key event
+        std::function<void(bool)> OnFocus;              ///< Called with the new focus state
+        std::function<bool(bool)> OnFrame;              ///< Draws a frame; argument is true if animations may advance
+
+        EventLoop() noexcept {
+#if defined(MZ_PLATFORM_WINDOWS)
+            WakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+            if (pipe(WakePipe) == 0) {
+                for (int fd : WakePipe) {
+                    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+                    fcntl(fd, F_SETFD, FD_CLOEXEC);
+                }
+            }
+            else {
+                WakePipe[0] = WakePipe[1] = -1;
+            }
+#endif
+        }
+
+        ~EventLoop() {
+            unbind();
+#if defined(MZ_PLATFORM_WINDOWS)
+            if (WakeEvent) CloseHandle(WakeEvent);
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+            for (int fd : WakePipe) {
+                if (fd >= 0) close(fd);
+            }
+#endif
+        }
+
+        EventLoop(const EventLoop&) = delete;
+        EventLoop& operator=(const EventLoop&) = delete;
+
+        /**
+         * @brief Request a frame
+         *
+         * Safe to call from any thread; wakes a waiting loop.
+         */
+        void invalidate() noexcept {
+            if (!Dirty.exchange(true)) {
+                wake();
+            }
+        }
+
+        /**
+         * @brief Flush a reactive graph's effects at the start of every frame
+         *
+         * A change to any observable in the graph requests a frame, so
+         * several changes made before the frame cost one update per
+         * affected widget. Replaces the graph's OnSchedule until unbind()
+         * or the destruction of the loop.
+         *
+         * @param Graph Graph to drive; must outlive the binding
+         */
+        void bind(reactive_graph& Graph = reactive()) {
+            unbind();
+            Reactive = &Graph;
+            Graph.OnSchedule = schedule_hook{ this };
+            if (Graph.pending()) invalidate();
+        }
+
+        /**
+         * @brief Stop driving the bound graph
+         *
+         * Clears the graph's OnSchedule unless something else has replaced
+         * it since bind().
+         */
+        void unbind() noexcept {
+            if (!Reactive) return;
+            auto Hook = Reactive->OnSchedule.target<schedule_hook>();
+            if (Hook && Hook->Loop == this) {
+                Reactive->OnSchedule = nullptr;
+            }
+            Reactive = nullptr;
+        }
+
+        /**
+         * @brief Make run() return after the current pass
+         *
+         * Safe to call from any thread.
+         */
+        void quit() noexcept {
+            Quit = true;
+            wake();
+        }
+
+        /**
+         * @brief Check whether frames run at the focused rate with animations
+         */
+        bool active() const noexcept {
+            return TerminalFocused && !Detached;
+        }
+
+        /**
+         * @brief Check whether standard input has closed (terminal gone)
+         */
+        bool detached() const noexcept {
+            return Detached;
+        }
+
+        /**
+         * @brief Number of times the loop waited for an event
+         */
+        uint64_t wakeups() const noexcept {
+            return Wakeups;
+        }
+
+        /**
+         * @brief Number of frames drawn
+         */
+        uint64_t frames() const noexcept {
+            return Frames;
+        }
+
+        /**
+         * @brief Dispatch input and draw frames until quit()
+         *
+         * The first frame is drawn immediately and marked on
+         * startup_profile(). Focus reporting is switched on for the
+         * duration of the call, since only read_key() readers such as this
+         * loop consume the reports; it stays on afterwards if
+         * TerminalManager::enable_focus_reporting() asked for it.
+         *
+         * @return 0 after quit(), 1 if the loop cannot wait for events
+         */
+        int run() noexcept {
+#if defined(MZ_PLATFORM_WINDOWS)
+            if (!WakeEvent) return 1;
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+            if (WakePipe[0] < 0) return 1;
+#else
+            return 1;
+#endif
+            Quit = false;
+            Dirty = true;
+            report_focus(true);
+            bool Live{ false };
+            clock::time_point NextFrame = clock::now();
+
+            while (!Quit) {
+                bool Animate = active();
+                int Fps = Animate ? FocusedFps : BackgroundFps;
+                bool Due = Dirty || (Live && Fps > 0);
+                int TimeoutMs = -1;
+
+                if (Due) {
+                    clock::time_point Now = clock::now();
+                    if (Now >= NextFrame) {
+                        Dirty = false;
+                        if (Reactive) Reactive->flush();
+                        Live = OnFrame ? OnFrame(Animate) : false;
+                        ++Frames;
+                        fflush(stdout);
+                        if (Frames == 1) startup_profile().first_frame();
+                        NextFrame = Now + frame_interval(Fps);
+                        continue;
+                    }
+                    TimeoutMs = int(std::chrono::ceil<std::chrono::milliseconds>(NextFrame - Now).count());
+                }
+                else if (!idle_tasks().empty()) {
+                    // Nothing to draw: deferred setup gets the time, one task per pass
+                    if (Detached || !key_pending()) {
+                        idle_tasks().run_one();
+                        continue;
+                    }
+                    // Input goes first; the task runs on a later pass
+                    TimeoutMs = 0;
+                }
+
+                ++Wakeups;
+                if (wait(TimeoutMs)) {
+                    dispatch_key();
+                }
+            }
+            report_focus(false);
+            return 0;
+        }
+
+        /**
+         * @brief Run a demo: a spinner that stops while the terminal is unfocused
+         *
+         * Press Space to redraw the counters, Escape to quit.
+         *
+         * @param Window Screen area for the test
+         */
+        static void Test(coord_box Window);
+
+        /**
+         * @brief Run a demo of lazy startup
+         *
+         * Paints a list placeholder right after TerminalManager::setup_lazy(),
+         * then finishes the terminal setup and fills a 100,000 entry list
+         * while idle. Keys typed during the capability probe still reach
+         * the list. The footer shows the time to first frame; arrow keys
+         * move the focus and Escape quits.
+         *
+         * @param NumRows Number of rows requested
+         * @param NumCols Number of columns requested
+         */
+        static void TestLazy(int NumRows, int NumCols) noexcept;
+
+    private:
+        /**
+         * @brief OnSchedule handler installed by bind()
+         */
+        struct schedule_hook {
+            EventLoop* Loop;
+            void operator()() const { Loop->invalidate(); }
+        };
+
+        std::atomic<bool> Dirty{ true };
+        std::atomic<bool> Quit{ false };
+        bool Detached{ false };
+        reactive_graph* Reactive{ nullptr };
+        uint64_t Wakeups{ 0 };
+        uint64_t Frames{ 0 };
+
+#if defined(MZ_PLATFORM_WINDOWS)
+        HANDLE WakeEvent{ nullptr };
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+        int WakePipe[2]{ -1, -1 };
+#endif
+
+        /**
+         * @brief Shortest time between two frames at a rate
+         */
+        static clock::duration frame_interval(int Fps) noexcept {
+            if (Fps <= 0) return clock::duration::zero();
+            return std::chrono::duration_cast<clock::duration>(std::chrono::seconds(1)) / Fps;
+        }
+
+        /**
+         * @brief Take or release a hold on the terminal's focus reports (mode 1004)
+         *
+         * The mode stays on while a TerminalManager or another loop still
+         * holds it. Off again means the terminal is assumed focused.
+         */
+        static void report_focus(bool On) noexcept {
+            if (On ? FocusReportUsers++ > 0 : --FocusReportUsers > 0) return;
+#if defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+            mz::Write(std::string_view(On ? "\x1b[?1004h" : "\x1b[?1004l"));
+            fflush(stdout);
+#endif
+            if (!On) TerminalFocused = true;
+        }
+
+        /**
+         * @brief Interrupt wait() from another thread
+         */
+        void wake() noexcept {
+#if defined(MZ_PLATFORM_WINDOWS)
+            if (WakeEvent) SetEvent(WakeEvent);
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+            // A full pipe already guarantees a wake-up
+            char b{ 0 };
+            if (WakePipe[1] >= 0) (void)!write(WakePipe[1], &b, 1);
+#endif
+        }
+
+        /**
+         * @brief Block until input, a wake-up or the timeout
+         *
+         * @param TimeoutMs Longest wait in milliseconds (negative waits forever)
+         * @return true if a key is waiting
+         */
+        bool wait(int TimeoutMs) noexcept {
+            if (!Detached && wait_key(0)) return true;
+#if defined(MZ_PLATFORM_WINDOWS)
+            HANDLE Handles[2]{ WakeEvent, GetStdHandle(STD_INPUT_HANDLE) };
+            DWORD r = WaitForMultipleObjects(Detached ? 1 : 2, Handles, FALSE,
+                TimeoutMs < 0 ? INFINITE : DWORD(TimeoutMs));
+            // The input handle is also signaled by mouse and focus records
+            return r == WAIT_OBJECT_0 + 1 && _kbhit() != 0;
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+            struct pollfd pfd[2]{ { WakePipe[0], POLLIN, 0 }, { STDIN_FILENO, POLLIN, 0 } };
+            if (poll(pfd, Detached ? 1 : 2, TimeoutMs) <= 0) return false;
+            if (pfd[0].revents & POLLIN) {
+                char Drain[64];
+                while (read(WakePipe[0], Drain, sizeof(Drain)) > 0) {}
+            }
+            if (Detached) return false;
+            if ((pfd[1].revents & (POLLHUP | POLLERR | POLLNVAL)) && !(pfd[1].revents & POLLIN)) {
+                lose_input();
+                return false;
+            }
+            return (pfd[1].revents & POLLIN) != 0;
+#else
+            return false;
+#endif
+        }
+
+        /**
+         * @brief Read one key and hand it to OnFocus or OnKey
+         */
+        void dispatch_key() {
+            key_event Event = read_key();
+            if (Event.Key == EOF) {
+                lose_input();
+            }
+            else if (Event.Key == FOCUSINKEY || Event.Key == FOCUSOUTKEY) {
+                // Regaining focus repaints at once with animations resumed
+                if (Event.Key == FOCUSINKEY) Dirty = true;
+                if (OnFocus) OnFocus(Event.Key == FOCUSINKEY);
+            }
+            else if (OnKey) {
+                OnKey(Event);
+            }
+        }
+
+        /**
+         * @brief Stop reading a closed terminal and fall back to the background rate
+         */
+        void lose_input() {
+            Detached = true;
+            if (OnFocus) OnFocus(false);
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_EVENT_LOOP_H
@@ -0,0 +1,390 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "FileDigest.h"
+#include "TextEncoding.h"
+#include <fstream>
+#include <system_error>
+#include <algorithm>
+#include <format>
+#include <cstdlib>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz {
+
+    namespace {
+
+        constexpr int CACHE_VERSION = 1;
+
+        /**
+         * @brief A file being digested
+         */
+        struct source {
+            int Fd{ -1 };                       ///< Open file (POSIX)
+            std::filesystem::path Path;         ///< File name (other systems)
+            digest_key Key;
+            size_t FirstTask{ 0 };              ///< First chunk task of the file
+            size_t NumChunks{ 0 };
+            bool Hashing{ false };              ///< Not failed and not cached
+        };
+
+#if defined(MZ_PLATFORM_WINDOWS) || defined(MZ_PLATFORM_UNKNOWN)
+
+        bool open_source(std::wstring const& Name, source& Src) {
+            std::error_code Ec;
+            uint64_t Size{ 0 };
+            std::filesystem::file_time_type Time;
+            std::u8string Utf8;
+            // Path conversions throw for names without a native form
+            try {
+                Src.Path = std::filesystem::path(Name);
+                if (!std::filesystem::is_regular_file(Src.Path, Ec)) return true;
+                Size = std::filesystem::file_size(Src.Path, Ec);
+                if (Ec) return true;
+                Time = std::filesystem::last_write_time(Src.Path, Ec);
+                if (Ec) return true;
+                // No inode here: the path stands in for it
+                Utf8 = std::filesystem::absolute(Src.Path, Ec).u8string();
+            }
+            catch (...) {
+                return true;
+            }
+            Src.Key = digest_key{ 0, hash64(Utf8.data(), Utf8.size()),
+                static_cast<int64_t>(Time.time_since_epoch().count()), Size };
+            return false;
+        }
+
+        void close_source(source&) noexcept {}
+
+        size_t read_chunk(source const& Src, uint64_t Offset, char* Buffer, size_t Size) {
+            std::ifstream In(Src.Path, std::ios::binary);
+            if (!In.seekg(static_cast<std::streamoff>(Offset))) return 0;
+            In.read(Buffer, static_cast<std::streamsize>(Size));
+            return static_cast<size_t>(In.gcount());
+        }
+
+#else
+
+        bool open_source(std::wstring const& Name, source& Src) {
+            // A name that does not encode exactly would open some other file
+            std::string Native;
+            if (encode_utf8(Native, Name)) return true;
+            // Non-blocking, so a FIFO does not hold up the run
+            Src.Fd = ::open(Native.c_str(), O_RDONLY | O_NONBLOCK | O_NOCTTY | O_CLOEXEC);
+            if (Src.Fd < 0) return true;
+            struct stat St;
+            if (fstat(Src.Fd, &St) != 0 || !S_ISREG(St.st_mode)) return true;
+#if defined(MZ_PLATFORM_MACOS)
+            int64_t Modified = static_cast<int64_t>(St.st_mtimespec.tv_sec) * 1000000000 + St.st_mtimespec.tv_nsec;
+#else
+            int64_t Modified = static_cast<int64_t>(St.st_mtim.tv_sec) * 1000000000 + St.st_mtim.tv_nsec;
+#endif
+            Src.Key = digest_key{ static_cast<uint64_t>(St.st_dev), static_cast<uint64_t>(St.st_ino),
+                Modified, static_cast<uint64_t>(St.st_size) };
+#if defined(POSIX_FADV_SEQUENTIAL)
+            posix_fadvise(Src.Fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+            return false;
+        }
+
+        void close_source(source& Src) noexcept {
+            if (Src.Fd >= 0) ::close(Src.Fd);
+            Src.Fd = -1;
+        }
+
+        size_t read_chunk(source const& Src, uint64_t Offset, char* Buffer, size_t Size) {
+            size_t Got{ 0 };
+            while (Got < Size) {
+                ssize_t r = pread(Src.Fd, Buffer + Got, Size - Got, static_cast<off_t>(Offset + Got));
+                if (r <= 0) break;
+                Got += static_cast<size_t>(r);
+            }
+            return Got;
+        }
+
+#endif
+
+    } // namespace
+
+    std::filesystem::path DigestCache::default_path() {
+        std::filesystem::path Dir;
+        if (const char* Xdg = std::getenv("XDG_CACHE_HOME"); Xdg && *Xdg) {
+            Dir = Xdg;
+        }
+        else if (const char* Home = std::getenv("HOME"); Home && *Home) {
+            Dir = std::filesystem::path(Home) / ".cache";
+        }
+        else {
+            return {};
+        }
+        return Dir / "terminal_utils" / "digests";
+    }
+
+    bool DigestCache::load() noexcept {
+        std::ifstream In(Path);
+        if (!In) return true;
+
+        std::string Magic;
+        int Version{ 0 };
+        In >> Magic >> Version;
+        if (Magic != "digests" || Version != CACHE_VERSION) return true;
+
+        std::unordered_map<digest_key, value, key_hash> Loaded;
+        digest_key Key;
+        value Value;
+        while (In >> std::hex >> Key.Device >> Key.Inode >> std::dec >> Key.ModifiedNs
+            >> Key.Size >> std::hex >> Value.Crc32c >> Value.Hash >> std::dec) {
+            Loaded[Key] = Value;
+        }
+
+        std::lock_guard<std::mutex> Guard(Lock);
+        Entries.swap(Loaded);
+        Dirty = false;
+        return false;
+    }
+
+    bool DigestCache::save() noexcept {
+        std::lock_guard<std::mutex> Guard(Lock);
+        if (!Dirty) return false;
+        if (Path.empty()) return true;
+
+        std::error_code Ec;
+        std::filesystem::create_directories(Path.parent_path(), Ec);
+        if (Ec) return true;
+
+        // Write to a temporary file and rename so readers never see a partial file
+        std::filesystem::path Temp = Path;
+        Temp += ".tmp";
+        {
+            std::ofstream Out(Temp, std::ios::trunc);
+            if (!Out) return true;
+            Out << "digests " << CACHE_VERSION << '\n';
+            for (auto const& [Key, Value] : Entries) {
+                Out << std::format("{:x} {:x} {} {} {:x} {:x}\n",
+                    Key.Device, Key.Inode, Key.ModifiedNs, Key.Size, Value.Crc32c, Value.Hash);
+            }
+            if (!Out) return true;
+        }
+        std::filesystem::rename(Temp, Path, Ec);
+        if (Ec) return true;
+        Dirty = false;
+        return false;
+    }
+
+    void DigestEngine::digest_memory(void const* Data, size_t Size, file_digest& Out) noexcept {
+        auto p = static_cast<unsigned char const*>(Data);
+        std::vector<uint64_t> Hashes;
+        uint32_t Crc{ 0 };
+        for (size_t Offset = 0; Offset < Size; Offset += ChunkSize) {
+            size_t n = std::min(ChunkSize, Size - Offset);
+            Crc = crc32c(p + Offset, n, Crc);
+            Hashes.push_back(hash64(p + Offset, n));
+        }
+        Out.Size = Size;
+        Out.Crc32c = Crc;
+        Out.Hash = hash64(Hashes.data(), Hashes.size() * sizeof(uint64_t), Size);
+    }
+
+    bool DigestEngine::start(std::vector<std::wstring> Paths) {
+        if (Running.load()) return true;
+        wait();
+
+        Results.clear();
+        Results.resize(Paths.size());
+        for (size_t i = 0; i < Paths.size(); i++) {
+            Results[i].Path = std::move(Paths[i]);
+            Results[i].Failed = true;       // Until the file is done
+        }
+        Cancelled = false;
+        BytesDone = 0;
+        BytesTotal = 0;
+        FilesDone = 0;
+        ElapsedNs = 0;
+        Started = std::chrono::steady_clock::now();
+        Running = true;
+        Controller = std::thread(&DigestEngine::run, this);
+        return false;
+    }
+
+    void DigestEngine::run() noexcept {
+        DigestCache& Store = Cache ? *Cache : DigestCache::shared();
+        WorkerPool& Workers = Pool ? *Pool : WorkerPool::shared();
+
+        // Sizes first, so the progress has a fixed total
+        std::error_code Ec;
+        uint64_t Total{ 0 };
+        for (auto const& r : Results) {
+            try {
+                uint64_t Size = std::filesystem::file_size(std::filesystem::path(r.Path), Ec);
+                if (!Ec) Total += Size;
+            }
+            catch (...) {}      // Fails again, and is reported, when opened
+        }
+        BytesTotal = Total;
+
+        std::vector<source> Sources;
+        std::vector<uint32_t> ChunkCrc;
+        std::vector<uint64_t> ChunkHash;
+        std::vector<uint8_t> ChunkFailed;
+        std::vector<size_t> TaskSource;
+
+        for (size_t First = 0; First < Results.size() && !Cancelled.load(); First += MaxOpenFiles) {
+            size_t Last = std::min(Results.size(), First + MaxOpenFiles);
+            Sources.assign(Last - First, source{});
+            TaskSource.clear();
+
+            for (size_t i = First; i < Last; i++) {
+                source& Src = Sources[i - First];
+                file_digest& Out = Results[i];
+                if (open_source(Out.Path, Src)) {
+                    close_source(Src);
+                    FilesDone.fetch_add(1);
+                    continue;
+                }
+                Out.Size = Src.Key.Size;
+
+                DigestCache::value Known;
+                if (Store.find(Src.Key, Known)) {
+                    Out.Crc32c = Known.Crc32c;
+                    Out.Hash = Known.Hash;
+                    Out.Cached = true;
+                    Out.Failed = false;
+                    BytesTotal.fetch_sub(std::min<uint64_t>(Src.Key.Size, BytesTotal.load()));
+                    close_source(Src);
+                    FilesDone.fetch_add(1);
+                    continue;
+                }
+
+                Src.Hashing = true;
+                Src.FirstTask = TaskSource.size();
+                Src.NumChunks = static_cast<size_t>((Src.Key.Size + ChunkSize - 1) / ChunkSize);
+                TaskSource.insert(TaskSource.end(), Src.NumChunks, i - First);
+            }
+
+            size_t NumTasks = TaskSource.size();
+            ChunkCrc.assign(NumTasks, 0);
+            ChunkHash.assign(NumTasks, 0);
+            ChunkFailed.assign(NumTasks, 0);
+
+            // Chunks of all files of the group share one batch
+            Workers.run(NumTasks, [&](size_t t) {
+                source const& Src = Sources[TaskSource[t]];
+                if (Cancelled.load(std::memory_order_relaxed)) {
+                    ChunkFailed[t] = 1;
+                    return;
+                }
+                uint64_t Offset = static_cast<uint64_t>(t - Src.FirstTask) * ChunkSize;
+                size_t Want = static_cast<size_t>(std::min<uint64_t>(ChunkSize, Src.Key.Size - Offset));
+
+                thread_local std::vector<char> Buffer;
+                Buffer.resize(ChunkSize);
+                size_t Got = read_chunk(Src, Offset, Buffer.data(), Want);
+                if (Got != Want) {
+                    ChunkFailed[t] = 1;     // File shrank or could not be read
+                    return;
+                }
+                ChunkCrc[t] = crc32c(Buffer.data(), Got);
+                ChunkHash[t] = hash64(Buffer.data(), Got);
+                BytesDone.fetch_add(Got, std::memory_order_relaxed);
+                });
+
+            for (size_t i = First; i < Last; i++) {
+                source& Src = Sources[i - First];
+                if (!Src.Hashing) continue;
+                file_digest& Out = Results[i];
+
+                uint32_t Crc{ 0 };
+                bool Failed{ false };
+                uint64_t Remaining = Src.Key.Size;
+                for (size_t c = 0; c < Src.NumChunks; c++) {
+                    size_t t = Src.FirstTask + c;
+                    uint64_t Length = std::min<uint64_t>(ChunkSize, Remaining);
+                    Remaining -= Length;
+                    Failed = Failed || ChunkFailed[t];
+                    Crc = crc32c_combine(Crc, ChunkCrc[t], Length);
+                }
+                close_source(Src);
+
+                if (!Failed) {
+                    Out.Failed = false;
+                    Out.Crc32c = Crc;
+                    Out.Hash = hash64(ChunkHash.data() + Src.FirstTask, Src.NumChunks * sizeof(uint64_t), Src.Key.Size);
+                    Store.store(Src.Key, DigestCache::value{ Out.Crc32c, Out.Hash });
+                }
+                FilesDone.fetch_add(1);
+            }
+        }
+
+        Store.save();
+
+        ElapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - Started).count();
+        Running = false;
+    }
+
+    digest_progress DigestEngine::progress() const noexcept {
+        digest_progress p;
+        p.BytesDone = BytesDone.load();
+        p.BytesTotal = BytesTotal.load();
+        p.FilesDone = FilesDone.load();
+        p.FilesTotal = Results.size();
+        p.Done = done();
+        p.Seconds = p.Done
+            ? ElapsedNs.load() / 1e9
+            : std::chrono::duration<double>(std::chrono::steady_clock::now() - Started).count();
+        return p;
+    }
+
+    void DigestEngine::show(ProgressBarControl& Bar, FooterBox* Footer) {
+        digest_progress p = progress();
+        Bar.update_permille(p.permille());
+        if (Footer) {
+            std::wstring Msg = std::format(L" {} of {} files, {} of {}, {}/s",
+                p.FilesDone, p.FilesTotal,
+                FileLengthString(static_cast<int64_t>(p.BytesDone), true),
+                FileLengthString(static_cast<int64_t>(p.BytesTotal), true),
+                FileLengthString(static_cast<int64_t>(p.throughput()), true));
+            if (Footer->update_status(Msg)) {
+                Footer->refresh();
+            }
+        }
+    }
+
+} // namespace mz
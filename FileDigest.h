@@ -0,0 +1,637 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_FILE_DIGEST_H
+#define MZ_FILE_DIGEST_H
+#pragma once
+
+/**
+ * @file FileDigest.h
+ * @brief Parallel file checksums with progress and a digest cache
+ *
+ * Two digests are computed per file: CRC32C and a 64-bit hash. Files are
+ * split into fixed chunks that are hashed in parallel on a WorkerPool.
+ * Chunk CRCs are joined with crc32c_combine(), so the CRC equals that of
+ * the whole file; the hash is a one-level Merkle tree over the chunk hashes.
+ * Because the chunk size is fixed, both digests are independent of the
+ * number of threads. CRC32C uses the SSE4.2 or ARMv8 CRC instructions where
+ * the build enables them, and slice-by-8 tables otherwise.
+ *
+ * Digests are cached by device, inode, modification time and size, so
+ * unchanged files are not read again, also across runs.
+ *
+ * @author Meysam Zare
+ */
+
+#include "WorkerPool.h"
+#include "WindowBox.h"
+#include "FooterBox.h"
+#include "DirectoryDisplayBox.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE4_2__)
+#define MZ_DIGEST_SSE42
+#include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#define MZ_DIGEST_ARM_CRC
+#include <arm_acle.h>
+#endif
+
+namespace mz {
+
+    namespace detail {
+
+        /**
+         * @brief Reflected CRC32C (Castagnoli) polynomial
+         */
+        inline constexpr uint32_t Crc32cPoly = 0x82F63B78u;
+
+        /**
+         * @brief Slice-by-8 tables for CRC32C
+         */
+        struct crc32c_tables {
+            uint32_t T[8][256]{};
+
+            constexpr crc32c_tables() noexcept {
+                for (uint32_t i = 0; i < 256; i++) {
+                    uint32_t c = i;
+                    for (int k = 0; k < 8; k++) {
+                        c = (c & 1) ? (c >> 1) ^ Crc32cPoly : c >> 1;
+                    }
+                    T[0][i] = c;
+                }
+                for (uint32_t i = 0; i < 256; i++) {
+                    for (int k = 1; k < 8; k++) {
+                        T[k][i] = (T[k - 1][i] >> 8) ^ T[0][T[k - 1][i] & 0xFF];
+                    }
+                }
+            }
+        };
+
+        inline constexpr crc32c_tables Crc32cTables{};
+
+        /**
+         * @brief Multiply two polynomials modulo the CRC32C polynomial
+         */
+        constexpr uint32_t crc32c_multiply(uint32_t a, uint32_t b) noexcept {
+            uint32_t m = 1u << 31;
+            uint32_t p = 0;
+            while (true) {
+                if (a & m) {
+                    p ^= b;
+                    if ((a & (m - 1)) == 0) break;
+                }
+                m >>= 1;
+                b = (b & 1) ? (b >> 1) ^ Crc32cPoly : b >> 1;
+            }
+            return p;
+        }
+
+        /**
+         * @brief x^(2^k) modulo the CRC32C polynomial, enough for 64-bit byte counts
+         */
+        struct crc32c_powers {
+            uint32_t P[67]{};
+
+            constexpr crc32c_powers() noexcept {
+                P[0] = 1u << 30;        // x^1
+                for (int k = 1; k < 67; k++) {
+                    P[k] = crc32c_multiply(P[k - 1], P[k - 1]);
+                }
+            }
+        };
+
+        inline constexpr crc32c_powers Crc32cPowers{};
+
+        inline uint64_t load64(unsigned char const* p) noexcept {
+            uint64_t v;
+            std::memcpy(&v, p, 8);
+            if constexpr (std::endian::native == std::endian::big) {
+                v = 0;
+                for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+            }
+            return v;
+        }
+
+        inline uint32_t load32(unsigned char const* p) noexcept {
+            uint32_t v;
+            std::memcpy(&v, p, 4);
+            if constexpr (std::endian::native == std::endian::big) {
+                v = 0;
+                for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+            }
+            return v;
+        }
+
+        inline constexpr uint64_t HashP1 = 0x9E3779B185EBCA87ull;
+        inline constexpr uint64_t HashP2 = 0xC2B2AE3D27D4EB4Full;
+        inline constexpr uint64_t HashP3 = 0x165667B19E3779F9ull;
+        inline constexpr uint64_t HashP4 = 0x85EBCA77C2B2AE63ull;
+        inline constexpr uint64_t HashP5 = 0x27D4EB2F165667C5ull;
+
+        constexpr uint64_t hash_round(uint64_t Acc, uint64_t Input) noexcept {
+            Acc += Input * HashP2;
+            Acc = std::rotl(Acc, 31);
+            return Acc * HashP1;
+        }
+
+        constexpr uint64_t hash_merge(uint64_t Acc, uint64_t Value) noexcept {
+            Acc ^= hash_round(0, Value);
+            return Acc * HashP1 + HashP4;
+        }
+
+    } // namespace detail
+
+    /**
+     * @brief Update a CRC32C with more data
+     *
+     * @code
+     * uint32_t Crc = crc32c(Part1.data(), Part1.size());
+     * Crc = crc32c(Part2.data(), Part2.size(), Crc);
+     * @endcode
+     *
+     * @param Data Bytes to add
+     * @param Size Number of bytes
+     * @param Crc CRC of the preceding data (0 to start)
+     * @return CRC of the preceding data followed by Data
+     */
+    inline uint32_t crc32c(void const* Data, size_t Size, uint32_t Crc = 0) noexcept {
+        auto p = static_cast<unsigned char const*>(Data);
+        uint32_t c = ~Crc;
+#if defined(MZ_DIGEST_SSE42) && (defined(__x86_64__) || defined(_M_X64))
+        uint64_t c64 = c;
+        for (; Size >= 8; Size -= 8, p += 8) {
+            c64 = _mm_crc32_u64(c64, detail::load64(p));
+        }
+        c = static_cast<uint32_t>(c64);
+        for (; Size; --Size, ++p) {
+            c = _mm_crc32_u8(c, *p);
+        }
+#elif defined(MZ_DIGEST_SSE42)
+        for (; Size >= 4; Size -= 4, p += 4) {
+            c = _mm_crc32_u32(c, detail::load32(p));
+        }
+        for (; Size; --Size, ++p) {
+            c = _mm_crc32_u8(c, *p);
+        }
+#elif defined(MZ_DIGEST_ARM_CRC)
+        for (; Size >= 8; Size -= 8, p += 8) {
+            c = __crc32cd(c, detail::load64(p));
+        }
+        for (; Size; --Size, ++p) {
+            c = __crc32cb(c, *p);
+        }
+#else
+        auto const& T = detail::Crc32cTables.T;
+        for (; Size >= 8; Size -= 8, p += 8) {
+            uint64_t x = detail::load64(p) ^ c;
+            c = T[7][x & 0xFF] ^ T[6][(x >> 8) & 0xFF] ^ T[5][(x >> 16) & 0xFF] ^ T[4][(x >> 24) & 0xFF]
+                ^ T[3][(x >> 32) & 0xFF] ^ T[2][(x >> 40) & 0xFF] ^ T[1][(x >> 48) & 0xFF] ^ T[0][x >> 56];
+        }
+        for (; Size; --Size, ++p) {
+            c = T[0][(c ^ *p) & 0xFF] ^ (c >> 8);
+        }
+#endif
+        return ~c;
+    }
+
+    /**
+     * @brief CRC32C of two pieces of data joined together
+     *
+     * Takes time logarithmic in LengthB and does not need the data.
+     *
+     * @param CrcA CRC of the first piece
+     * @param CrcB CRC of the second piece
+     * @param LengthB Length of the second piece in bytes
+     * @return CRC of the first piece followed by the second
+     */
+    constexpr uint32_t crc32c_combine(uint32_t CrcA, uint32_t CrcB, uint64_t LengthB) noexcept {
+        // Shift CrcA over LengthB zero bytes: multiply by x^(8 * LengthB)
+        uint32_t Shift = 1u << 31;      // x^0
+        for (int k = 3; LengthB; LengthB >>= 1, k++) {
+            if (LengthB & 1) {
+                Shift = detail::crc32c_multiply(detail::Crc32cPowers.P[k], Shift);
+            }
+        }
+        return detail::crc32c_multiply(Shift, CrcA) ^ CrcB;
+    }
+
+    /**
+     * @brief 64-bit non-cryptographic hash
+     *
+     * The XXH64 algorithm: four independent lanes of multiply-rotate rounds
+     * over 32-byte stripes, then a final avalanche.
+     *
+     * @param Data Bytes to hash
+     * @param Size Number of bytes
+     * @param Seed Seed value
+     * @return Hash value
+     */
+    inline uint64_t hash64(void const* Data, size_t Size, uint64_t Seed = 0) noexcept {
+        using namespace detail;
+        auto p = static_cast<unsigned char const*>(Data);
+        auto End = p + Size;
+        uint64_t h;
+        if (Size >= 32) {
+            uint64_t v1 = Seed + HashP1 + HashP2;
+            uint64_t v2 = Seed + HashP2;
+            uint64_t v3 = Seed;
+            uint64_t v4 = Seed - HashP1;
+            for (; End - p >= 32; p += 32) {
+                v1 = hash_round(v1, load64(p));
+                v2 = hash_round(v2, load64(p + 8));
+                v3 = hash_round(v3, load64(p + 16));
+                v4 = hash_round(v4, load64(p + 24));
+            }
+            h = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+            h = hash_merge(h, v1);
+            h = hash_merge(h, v2);
+            h = hash_merge(h, v3);
+            h = hash_merge(h, v4);
+        }
+        else {
+            h = Seed + HashP5;
+        }
+        h += static_cast<uint64_t>(Size);
+
+        for (; End - p >= 8; p += 8) {
+            h ^= hash_round(0, load64(p));
+            h = std::rotl(h, 27) * HashP1 + HashP4;
+        }
+        if (End - p >= 4) {
+            h ^= static_cast<uint64_t>(load32(p)) * HashP1;
+            h = std::rotl(h, 23) * HashP2 + HashP3;
+            p += 4;
+        }
+        for (; p < End; ++p) {
+            h ^= *p * HashP5;
+            h = std::rotl(h, 11) * HashP1;
+        }
+
+        h ^= h >> 33;
+        h *= HashP2;
+        h ^= h >> 29;
+        h *= HashP3;
+        h ^= h >> 32;
+        return h;
+    }
+
+    /**
+     * @struct file_digest
+     * @brief Digests of one file
+     */
+    struct file_digest {
+        std::wstring Path;          ///< File as given
+        uint64_t Size{ 0 };         ///< Bytes hashed
+        uint32_t Crc32c{ 0 };       ///< CRC32C of the contents
+        uint64_t Hash{ 0 };         ///< Merkle hash over the chunk hashes, seeded with the size
+        bool Cached{ false };       ///< Taken from the cache without reading the file
+        bool Failed{ false };       ///< File could not be opened or read; digests are not valid
+    };
+
+    /**
+     * @struct digest_key
+     * @brief What identifies an unchanged file
+     */
+    struct digest_key {
+        uint64_t Device{ 0 };
+        uint64_t Inode{ 0 };
+        int64_t ModifiedNs{ 0 };    ///< Modification time in nanoseconds
+        uint64_t Size{ 0 };
+
+        constexpr bool operator==(digest_key const&) const noexcept = default;
+    };
+
+    /**
+     * @class DigestCache
+     * @brief Digests of files by identity, kept across runs
+     */
+    class DigestCache {
+    public:
+        /**
+         * @brief Digests stored for a file
+         */
+        struct value {
+            uint32_t Crc32c{ 0 };
+            uint64_t Hash{ 0 };
+        };
+
+    private:
+        struct key_hash {
+            size_t operator()(digest_key const& k) const noexcept {
+                uint64_t Words[4]{ k.Device, k.Inode, static_cast<uint64_t>(k.ModifiedNs), k.Size };
+                return static_cast<size_t>(hash64(Words, sizeof(Words)));
+            }
+        };
+
+        mutable std::mutex Lock;
+        std::unordered_map<digest_key, value, key_hash> Entries;
+        bool Dirty{ false };        ///< Entries changed since the last save or load
+
+    public:
+        /**
+         * @brief File the cache is saved to (empty to keep it in memory only)
+         */
+        std::filesystem::path Path;
+
+        /**
+         * @brief Look up a file
+         *
+         * @return true if the file is in the cache
+         */
+        bool find(digest_key const& Key, value& Out) const {
+            std::lock_guard<std::mutex> Guard(Lock);
+            auto it = Entries.find(Key);
+            if (it == Entries.end()) return false;
+            Out = it->second;
+            return true;
+        }
+
+        /**
+         * @brief Remember the digests of a file
+         */
+        void store(digest_key const& Key, value const& Digests) {
+            std::lock_guard<std::mutex> Guard(Lock);
+            Entries[Key] = Digests;
+            Dirty = true;
+        }
+
+        /**
+         * @brief Forget all digests
+         */
+        void clear() noexcept {
+            std::lock_guard<std::mutex> Guard(Lock);
+            Entries.clear();
+            Dirty = true;
+        }
+
+        /**
+         * @brief Number of files in the cache
+         */
+        size_t size() const noexcept {
+            std::lock_guard<std::mutex> Guard(Lock);
+            return Entries.size();
+        }
+
+        /**
+         * @brief Read the cache from Path, replacing the entries
+         *
+         * @return true if error
+         */
+        bool load() noexcept;
+
+        /**
+         * @brief Write the cache to Path if it changed
+         *
+         * @return true if error
+         */
+        bool save() noexcept;
+
+        /**
+         * @brief Get the default cache file
+         *
+         * @return $XDG_CACHE_HOME/terminal_utils/digests (or under
+         *         $HOME/.cache), empty if there is no cache directory
+         */
+        static std::filesystem::path default_path();
+
+        /**
+         * @brief Get the process-wide cache, loaded from the default file
+         */
+        static DigestCache& shared() {
+            static DigestCache Cache{ default_path() };
+            return Cache;
+        }
+
+        /**
+         * @brief Create a cache, loading it from a file if one is given
+         *
+         * @param File Cache file (empty to keep the cache in memory only)
+         */
+        explicit DigestCache(std::filesystem::path File = {}) : Path{ std::move(File) } {
+            if (!Path.empty()) load();
+        }
+
+        DigestCache(DigestCache const&) = delete;
+        DigestCache& operator=(DigestCache const&) = delete;
+    };
+
+    /**
+     * @struct digest_progress
+     * @brief Progress of a DigestEngine run
+     */
+    struct digest_progress {
+        uint64_t BytesDone{ 0 };    ///< Bytes hashed so far
+        uint64_t BytesTotal{ 0 };   ///< Bytes to hash (files found in the cache excluded)
+        size_t FilesDone{ 0 };
+        size_t FilesTotal{ 0 };
+        double Seconds{ 0 };        ///< Time since start, or duration once done
+        bool Done{ false };
+
+        /**
+         * @brief Progress from 0 to 100
+         */
+        int percentage() const noexcept {
+            if (BytesTotal == 0) return Done ? 100 : 0;
+            return static_cast<int>(BytesDone * 100 / BytesTotal);
+        }
+
+        /**
+         * @brief Progress from 0 to 1000
+         */
+        int permille() const noexcept {
+            if (BytesTotal == 0) return Done ? 1000 : 0;
+            return static_cast<int>(BytesDone * 1000 / BytesTotal);
+        }
+
+        /**
+         * @brief Hashing speed in bytes per second
+         */
+        double throughput() const noexcept {
+            return Seconds > 0 ? static_cast<double>(BytesDone) / Seconds : 0.0;
+        }
+    };
+
+    /**
+     * @class DigestEngine
+     * @brief Computes file digests in the background
+     *
+     * @code
+     * DigestEngine Engine;
+     * Engine.start(List, Paths);      // Paths[i] is the file of list item i
+     * while (!Engine.done()) {
+     *     Engine.show(Bar, &Footer);
+     *     std::this_thread::sleep_for(std::chrono::milliseconds(50));
+     * }
+     * for (auto const& d : Engine.results()) ...
+     * @endcode
+     */
+    class DigestEngine {
+    public:
+        /**
+         * @brief Bytes per chunk; part of the definition of the hash
+         */
+        static constexpr size_t ChunkSize{ 1 << 20 };
+
+        /**
+         * @brief Files open at the same time
+         */
+        static constexpr size_t MaxOpenFiles{ 128 };
+
+    private:
+        WorkerPool* Pool;
+        DigestCache* Cache;
+
+        std::vector<file_digest> Results;
+        std::thread Controller;
+        std::atomic<bool> Cancelled{ false };
+        std::atomic<bool> Running{ false };
+
+        std::atomic<uint64_t> BytesDone{ 0 };
+        std::atomic<uint64_t> BytesTotal{ 0 };
+        std::atomic<size_t> FilesDone{ 0 };
+        std::chrono::steady_clock::time_point Started;
+        std::atomic<int64_t> ElapsedNs{ 0 };
+
+        /**
+         * @brief Controller thread body
+         */
+        void run() noexcept;
+
+    public:
+        /**
+         * @brief Create an engine
+         *
+         * @param WorkPool Pool for chunks (nullptr for the shared pool)
+         * @param DigestStore Cache to use (nullptr for the shared cache)
+         */
+        explicit DigestEngine(WorkerPool* WorkPool = nullptr, DigestCache* DigestStore = nullptr) noexcept
+            : Pool{ WorkPool }, Cache{ DigestStore } {
+        }
+
+        DigestEngine(DigestEngine const&) = delete;
+        DigestEngine& operator=(DigestEngine const&) = delete;
+
+        /**
+         * @brief Cancel and wait for the run
+         */
+        ~DigestEngine() noexcept {
+            cancel();
+            wait();
+        }
+
+        /**
+         * @brief Start computing the digests of files
+         *
+         * @param Paths Files to digest
+         * @return true if a run is already in progress
+         */
+        bool start(std::vector<std::wstring> Paths);
+
+        /**
+         * @brief Start computing the digests of the selected items of a list
+         *
+         * @param Box List with the selection
+         * @param Paths File of each list item, by item index
+         * @return true if a run is already in progress
+         */
+        bool start(DirectoryDisplayBox const& Box, std::vector<std::wstring> const& Paths) {
+            std::vector<std::wstring> Selected;
+            for (int i : Box.get_selected_indices()) {
+                if (static_cast<size_t>(i) < Paths.size()) {
+                    Selected.push_back(Paths[i]);
+                }
+            }
+            return start(std::move(Selected));
+        }
+
+        /**
+         * @brief Stop the run; files not finished are marked as failed
+         */
+        void cancel() noexcept {
+            Cancelled = true;
+        }
+
+        /**
+         * @brief Wait for the run to finish
+         */
+        void wait() noexcept {
+            if (Controller.joinable()) Controller.join();
+        }
+
+        /**
+         * @brief Check whether the run has finished
+         */
+        bool done() const noexcept {
+            return !Running.load();
+        }
+
+        /**
+         * @brief Get the digests, in the order of the paths
+         *
+         * Only valid once done() returns true.
+         */
+        std::vector<file_digest> const& results() const noexcept {
+            return Results;
+        }
+
+        /**
+         * @brief Get the progress of the run
+         */
+        digest_progress progress() const noexcept;
+
+        /**
+         * @brief Show the progress in a bar and the throughput in a footer
+         *
+         * @param Bar Progress bar to update
+         * @param Footer Footer for counts and throughput (optional)
+         */
+        void show(ProgressBarControl& Bar, FooterBox* Footer = nullptr);
+
+        /**
+         * @brief Compute the digests of one file on the calling thread
+         *
+         * Bypasses the cache; gives the same digests as an engine run.
+         *
+         * @param Data File contents
+         * @param Size Number of bytes
+         * @param Out Receives Size, Crc32c and Hash
+         */
+        static void digest_memory(void const* Data, size_t Size, file_digest& Out) noexcept;
+    };
+
+} // namespace mz
+
+#endif // MZ_FILE_DIGEST_H
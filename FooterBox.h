@@ -32,7 +32,9 @@
  *
  * This file provides a specialized UI component for displaying status messages
  * at the bottom of terminal-based user interfaces. It supports text updates,
- * visual effects like blinking for alerts, and consistent styling.
+ * visual effects like blinking for alerts, and consistent styling. The
+ * footer can also be split into fields (mode, clock, counters, key hints)
+ * that are updated and written independently.
  *
  * @author Meysam Zare
  */
@@ -41,8 +43,12 @@
 #include "coord.h"
 #include "cursor.h"
 #include "ConsoleBoxes.h"
+#include "TemplateBuffer.h"
 #include <string>
 #include <string_view>
+#include <span>
+#include <vector>
+#include <algorithm>
 #include <thread>
 #include <chrono>
 
@@ -81,6 +87,65 @@ namespace mz {
          */
         int EndSize{ 0 };
 
+        /**
+         * @brief Inputs of the last update_status() still shown in the buffer
+         *
+         * Any other change to the contents invalidates it.
+         */
+        render_memo StatusMemo;
+
+    public:
+        /**
+         * @brief Alignment of text within a field
+         */
+        enum class field_align : uint8_t {
+            left,
+            right,
+            center
+        };
+
+        /**
+         * @struct field
+         * @brief One segment of a footer split into fields
+         */
+        struct field {
+            std::wstring Name;                  ///< Lookup name
+            int Width{ 0 };                     ///< Requested columns, 0 or less for a flexible field
+            field_align Align{ field_align::left };
+            color Style;                        ///< Field colors
+            int Cols{ 0 };                      ///< Columns assigned by layout_fields()
+            int StyleSlot{ -1 };                ///< Style slot in Line
+            int TextSlot{ -1 };                 ///< Text slot in Line
+        };
+
+    private:
+        /**
+         * @brief Fields in display order
+         */
+        std::vector<field> Fields;
+
+        /**
+         * @brief Slot layout of the footer when split into fields
+         *
+         * Empty unless layout_fields() built the buffer; clear() and the
+         * messages built on it turn the footer back into a single message.
+         */
+        mutable template_buffer Line;
+
+        /**
+         * @brief Scratch buffer for field text and output
+         */
+        std::wstring FieldTemp;
+
+        /**
+         * @brief Style sequence of a field: its colors with the footer underline
+         */
+        static void field_style(std::wstring& Out, color Style) noexcept {
+            Out.clear();
+            Style.apply(Out);
+            SetUnderline(Out);
+        }
+
         /**
          * @brief Complete the footer with ending elements
          *
@@ -109,6 +174,8 @@ namespace mz {
          * Clears all content while maintaining the footer's visual structure.
          */
         void clear() noexcept override {
+            StatusMemo.invalidate();
+            Line.reset(0);
             Capacity = Area.num_cols() - 2;  // Account for left and right edge chars
 
             // Reset buffer to initial state (keep pre-allocated memory)
@@ -129,6 +196,8 @@ namespace mz {
          * @return true if text was truncated, false if it fit completely
          */
         bool append(std::wstring_view text) noexcept {
+            StatusMemo.invalidate();
+
             // Resize buffer to content position
             bf.resize(EndSize);
 
@@ -162,6 +231,7 @@ namespace mz {
             requires (N > 0 && N < 6)
         bool push_back(const wchar_t(&Symbol)[N]) noexcept {
             if (Capacity > 0) {
+                StatusMemo.invalidate();
                 bf.resize(EndSize);
                 PushBack(bf, Symbol);
                 --Capacity;
@@ -219,13 +289,305 @@ namespace mz {
         /**
          * @brief Replace footer text with new message
          *
-         * Clears current content and displays a new message.
+         * Clears current content and displays a new message. When the
+         * message, colors and area match the previous call and nothing else
+         * changed the footer in between, the buffer is left as it is.
+         * Follow with refresh() to also skip the output; only that decision
+         * is counted in render_counters().
          *
          * @param Msg New message to display
+         * @return true if the buffer was rebuilt
          */
-        void update_status(std::wstring_view Msg) noexcept {
+        bool update_status(std::wstring_view Msg) noexcept {
+            uint64_t Hash = render_hash{}.add(Msg).add(Color).add(Area).value();
+            if (StatusMemo.matches(Hash)) {
+                return false;
+            }
             clear();
             append(Msg);
+            StatusMemo.store(Hash);
+            return true;
+        }
+
+        /**
+         * @brief Replace footer text with rich text
+         *
+         * Like update_status(), but the message comes from parsed markup.
+         * Unstyled text keeps the footer's colors and underline.
+         *
+         * @param Format Parsed markup
+         * @param Args Placeholder values by argument index
+         * @return true if the buffer was rebuilt
+         */
+        bool update_status(rich_format const& Format, std::span<std::wstring_view const> Args = {}) noexcept {
+            uint64_t Hash = render_hash{}.add(Format.hash(Args)).add(Color).add(Area).value();
+            if (StatusMemo.matches(Hash)) {
+                return false;
+            }
+            clear();
+            bf.resize(EndSize);
+            size_t Width = Format.render(bf, Color, Args, static_cast<size_t>(std::max(Capacity, 0)), rich_format::UNDERLINE);
+            Capacity -= static_cast<int>(Width);
+            fill_end();
+            StatusMemo.store(Hash);
+            return true;
+        }
+
+        /**
+         * @brief Replace footer text with rich text from markup
+         *
+         * The markup is parsed once and cached; see rich_format::get().
+         *
+         * @param Markup Markup text
+         * @param Args Placeholder values (strings or std::format-able values)
+         * @return true if the buffer was rebuilt
+         */
+        template <typename... A>
+        bool update_rich(std::wstring_view Markup, A const&... Args) {
+            rich_args<A...> Views(Args...);
+            return update_status(rich_format::get(Markup), Views.views());
+        }
+
+        /**
+         * @brief Add a field to the footer
+         *
+         * Fields are laid out left to right by layout_fields(). A field of
+         * Width 0 or less is flexible: the columns the fixed fields leave
+         * over are shared evenly among the flexible ones.
+         *
+         * @param Name Lookup name
+         * @param Width Columns of the field, 0 or less for flexible
+         * @param Align Alignment of the text within the field
+         * @return Field index
+         */
+        int add_field(std::wstring_view Name, int Width = 0, field_align Align = field_align::left) {
+            return add_field(Name, Width, Align, Color);
+        }
+
+        /**
+         * @brief Add a field with its own colors
+         *
+         * @param Name Lookup name
+         * @param Width Columns of the field, 0 or less for flexible
+         * @param Align Alignment of the text within the field
+         * @param Style Colors of the field
+         * @return Field index
+         */
+        int add_field(std::wstring_view Name, int Width, field_align Align, color Style) {
+            field f;
+            f.Name = Name;
+            f.Width = Width;
+            f.Align = Align;
+            f.Style = Style;
+            Fields.push_back(std::move(f));
+            return static_cast<int>(Fields.size()) - 1;
+        }
+
+        /**
+         * @brief Remove all fields
+         *
+         * The footer keeps showing the last layout until it is cleared.
+         */
+        void clear_fields() noexcept {
+            Fields.clear();
+        }
+
+        /**
+         * @brief Find a field by name
+         *
+         * @return Field index, or -1 if there is no such field
+         */
+        int find_field(std::wstring_view Name) const noexcept {
+            for (size_t i = 0; i < Fields.size(); i++) {
+                if (Fields[i].Name == Name) return static_cast<int>(i);
+            }
+            return -1;
+        }
+
+        /**
+         * @brief Get a field definition
+         */
+        field const& get_field(int Field) const noexcept {
+            return Fields[Field];
+        }
+
+        /**
+         * @brief Build the footer from its fields
+         *
+         * Assigns columns to the fields, separated by one space, and fills
+         * the buffer with empty fields. Fields that do not fit get no
+         * columns. Follow with print(); afterwards set_field() and
+         * flush_fields() write only the fields that changed.
+         */
+        void layout_fields() {
+            clear();
+            bf.resize(EndSize);
+
+            // Columns left for flexible fields after fixed fields and gaps
+            int NumFlex{ 0 };
+            int Free = Capacity - std::max(static_cast<int>(Fields.size()) - 1, 0);
+            for (field const& f : Fields) {
+                if (f.Width > 0) {
+                    Free -= f.Width;
+                }
+                else {
+                    ++NumFlex;
+                }
+            }
+            Free = std::max(Free, 0);
+
+            // Lay the fields out, remembering where their slots go
+            std::wstring Style;
+            std::vector<int> Places;  // Style offset, text offset and column of each field
+            int Col{ 1 };             // Column 0 holds the left edge
+            int Flex{ 0 };
+            for (field& f : Fields) {
+                int Cols = f.Width;
+                if (Cols <= 0) {
+                    // Earlier flexible fields take the remainder
+                    Cols = Free / NumFlex + (Flex < Free % NumFlex ? 1 : 0);
+                    ++Flex;
+                }
+                if (Col > 1 && Capacity > 0) {
+                    Color.apply(bf);
+                    bf.push_back(' ');
+                    --Capacity;
+                    ++Col;
+                }
+                Cols = std::clamp(Cols, 0, std::max(Capacity, 0));
+                f.Cols = Cols;
+
+                field_style(Style, f.Style);
+                Places.push_back(static_cast<int>(bf.size()));
+                bf.append(Style);
+                Places.push_back(static_cast<int>(bf.size()));
+                Places.push_back(Col);
+                bf.append(Cols, ' ');
+                Capacity -= Cols;
+                Col += Cols;
+            }
+
+            // The remainder keeps the footer colors
+            Color.apply(bf);
+            fill_end();
+
+            // The footer is a single line of the template
+            Line.reset(static_cast<int>(bf.size()));
+            for (size_t i = 0; i < Fields.size(); i++) {
+                field& f = Fields[i];
+                f.StyleSlot = Line.add(f.Name, template_buffer::slot_kind::style,
+                    Places[3 * i], Places[3 * i + 1] - Places[3 * i]);
+                f.TextSlot = Line.add(f.Name, template_buffer::slot_kind::text,
+                    Places[3 * i + 1], f.Cols, Places[3 * i + 2]);
+            }
+        }
+
+        /**
+         * @brief Replace the text of a field
+         *
+         * The text is truncated or padded to the field width according to
+         * its alignment. Nothing is marked for output if the field already
+         * shows this text.
+         *
+         * @param Field Field index
+         * @param Text New text, one column per character
+         * @return true if error (no such field or the fields are not laid out)
+         */
+        bool set_field(int Field, std::wstring_view Text) {
+            if (Field < 0 || Field >= static_cast<int>(Fields.size()) || Fields[Field].TextSlot < 0
+                || Fields[Field].TextSlot >= Line.num_slots()) {
+                return true;
+            }
+            field const& f = Fields[Field];
+            StatusMemo.invalidate();
+
+            Text = Text.substr(0, static_cast<size_t>(f.Cols));
+            int Pad = f.Cols - static_cast<int>(Text.size());
+            int Before = f.Align == field_align::right ? Pad : f.Align == field_align::center ? Pad / 2 : 0;
+            FieldTemp.assign(static_cast<size_t>(Before), ' ');
+            FieldTemp.append(Text);
+            return Line.patch(bf, 0, f.TextSlot, FieldTemp);
+        }
+
+        /**
+         * @brief Replace the text of a field found by name
+         *
+         * @return true if error
+         */
+        bool set_field(std::wstring_view Name, std::wstring_view Text) {
+            return set_field(find_field(Name), Text);
+        }
+
+        /**
+         * @brief Change the colors of a field
+         *
+         * @param Field Field index
+         * @param Style New colors
+         * @return true if error
+         */
+        bool set_field_color(int Field, color Style) {
+            if (Field < 0 || Field >= static_cast<int>(Fields.size()) || Fields[Field].StyleSlot < 0
+                || Fields[Field].StyleSlot >= Line.num_slots()) {
+                return true;
+            }
+            Fields[Field].Style = Style;
+            StatusMemo.invalidate();
+            field_style(FieldTemp, Style);
+            return Line.patch(bf, 0, Fields[Field].StyleSlot, FieldTemp);
+        }
+
+        /**
+         * @brief Append the fields changed since the last print or flush
+         *
+         * Each changed field is written as its own span with its style;
+         * the rest of the footer line is left alone.
+         *
+         * @param Out Destination for the escape sequences (appended)
+         * @return Number of fields written
+         */
+        int flush_fields(std::wstring& Out) {
+            if (!Line.pending()) {
+                return 0;
+            }
+            size_t Begin = Out.size();
+            int Written = Line.flush(bf, Out, 0, 1, Area.Top);
+            if (Out.size() > Begin) {
+                ClrUnderline(Out);
+            }
+            if (TrackPrints) {
+                PrintedHash = content_hash();
+            }
+            return Written;
+        }
+
+        /**
+         * @brief Write the fields changed since the last print or flush
+         *
+         * @return Number of fields written
+         */
+        int flush_fields() {
+            FieldTemp.clear();
+            int Written = flush_fields(FieldTemp);
+            if (!FieldTemp.empty()) {
+                mz::Write(FieldTemp);
+            }
+            return Written;
+        }
+
+        /**
+         * @brief Output the footer and drop pending field updates
+         */
+        void print() const noexcept override {
+            BasicBox::print();
+            Line.discard();
+        }
+
+        /**
+         * @brief Append the footer to another buffer and drop pending field updates
+         */
+        void render(std::wstring& Out) const override {
+            BasicBox::render(Out);
+            Line.discard();
         }
 
         /**
@@ -239,6 +601,11 @@ namespace mz {
          */
         void blink(rgb BlinkBack = color::RED, int NumBlinks = 2,
             int NumMilliSeconds = 150) noexcept {
+            // Nobody is watching a background terminal; skip the delay as well
+            if (!TerminalFocused) {
+                return;
+            }
+
             // Prepare temporary buffer and alternative color
             std::wstring Temp;
             color TempColor{ Color };
@@ -33,6 +33,8 @@
  * This file provides the FrameBox class which implements a framed rectangular
  * area with a title bar and optional footer for terminal-based user interfaces.
  * It's designed to create styled, consistent UI components with borders.
+ * Border glyph runs are cached per size and colors and shared by all frames
+ * of equal dimensions; titles and status lines are patched in place.
  *
  * @author Meysam Zare
  */
@@ -42,6 +44,9 @@
 #include <string>
 #include <string_view>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
 
 namespace mz {
 
@@ -54,6 +59,144 @@ namespace mz {
      * and other framed content areas in terminal-based user interfaces.
      */
     class FrameBox : public BasicBox {
+    private:
+        /**
+         * @brief Inputs of the title bar currently in the buffer
+         */
+        render_memo TitleMemo;
+
+        /**
+         * @brief Hash the inputs of the title bar
+         */
+        uint64_t title_hash(std::wstring_view Title) const noexcept {
+            return render_hash{}.add(Title).add(Color).add(Area).value();
+        }
+
+        /**
+         * @brief Hash of the geometry and colors the chrome was built for
+         */
+        uint64_t chrome_hash() const noexcept {
+            return render_hash{}.add(Color).add(Area).value();
+        }
+
+        /**
+         * @brief Border glyph runs below the title bar, shared with equal frames
+         */
+        std::shared_ptr<const std::wstring> Chrome;
+
+        /**
+         * @brief Chrome hash of the frame last written in full, 0 if none
+         */
+        mutable uint64_t ShownChrome{ 0 };
+
+        /**
+         * @brief Buffer offset of the first title bar cell
+         */
+        int TitleOffset{ 0 };
+
+        /**
+         * @brief Footer field holding the status message
+         */
+        int StatusField{ -1 };
+
+        /**
+         * @brief Put a status message in the footer buffer
+         *
+         * @return true if the footer had to be laid out again
+         */
+        bool put_status(std::wstring_view message) noexcept {
+            if (!Footer.set_field(StatusField, message)) {
+                return false;
+            }
+            Footer.clear_fields();
+            StatusField = Footer.add_field(L"status");
+            Footer.layout_fields();
+            Footer.set_field(StatusField, message);
+            return true;
+        }
+
+        /**
+         * @brief Format the title bar cells: a space, the title, padding
+         */
+        static void title_cells(std::wstring& Out, std::wstring_view Title, int Cols) {
+            int TitleLength = static_cast<int>(Title.size());
+            if (TitleLength >= Cols - 1) {
+                TitleLength = Cols - 2;
+            }
+            Out.clear();
+            Out.push_back(L' ');
+            Out.append(Title.data(), static_cast<size_t>(std::max(TitleLength, 0)));
+            if (Cols > TitleLength + 1) {
+                Out.append(static_cast<size_t>(Cols - 1 - std::max(TitleLength, 0)), ' ');
+            }
+        }
+
+        /**
+         * @brief Border glyph runs for a frame of a given size and colors
+         *
+         * Starts right after the title bar and moves only relative to it,
+         * so frames of equal size and colors share one string wherever
+         * they are placed.
+         *
+         * @param Size Rows and columns of the frame
+         * @param FrameColor Colors of the frame
+         * @return Shared chrome
+         */
+        static std::shared_ptr<const std::wstring> chrome(coord Size, color FrameColor) {
+            static std::mutex Lock;
+            static std::unordered_map<uint64_t, std::shared_ptr<const std::wstring>> Cache;
+
+            uint64_t Key = render_hash{}.add(Size.Row).add(Size.Col).add(FrameColor).value();
+            std::lock_guard<std::mutex> Guard(Lock);
+            auto Found = Cache.find(Key);
+            if (Found != Cache.end()) {
+                return Found->second;
+            }
+
+            auto Runs = std::make_shared<std::wstring>();
+            Runs->reserve(static_cast<size_t>(Size.Col + 16) * Size.Row);
+
+            // Move to next line and reset colors
+            MoveLeft(*Runs, Size.Col);
+            MoveDown(*Runs);
+            FrameColor.apply(*Runs);
+
+            // Draw the frame borders
+            for (int i = 2; i <= Size.Row; i++) {
+                // Add underline to the last row
+                if (i == Size.Row) {
+                    SetUnderline(*Runs);
+                }
+
+                // Draw left border, middle spaces and right border
+                PushBack(*Runs, LEFTHALF);
+                Runs->append(static_cast<size_t>(Size.Col - 2), ' ');
+                PushBack(*Runs, RIGHTHALF);
+
+                // Move to next line
+                MoveLeft(*Runs, Size.Col);
+                MoveDown(*Runs);
+            }
+
+            // Reset text formatting
+            ClrUnderline(*Runs);
+
+            // Screens rarely use many sizes; start over rather than grow without bound
+            if (Cache.size() >= 256) {
+                Cache.clear();
+            }
+            Cache.emplace(Key, Runs);
+            return Runs;
+        }
+
+    protected:
+        /**
+         * @brief Hash of the frame together with its footer
+         */
+        uint64_t content_hash() const noexcept override {
+            return render_hash{}.add(std::wstring_view{ bf }).add(Footer.view()).value();
+        }
+
     public:
         /**
          * @brief Buffer position after initial formatting
@@ -88,67 +231,36 @@ namespace mz {
             Footer.Color.F = Color.F;
             Footer.Color.B = Color.B.mix(Color.F, 30);
 
-            // Calculate dimensions and title length
+            // Shared border runs for this size and colors
             coord Size = Area.get_size();
-            int TitleLength = static_cast<int>(Title.size());
-
-            // Ensure title fits within the frame width
-            if (TitleLength >= Size.Col - 1) {
-                TitleLength = Size.Col - 2;
-            }
+            Chrome = chrome(Size, Color);
 
             // Pre-allocate buffer with reasonable capacity
-            const size_t estimatedCapacity = static_cast<size_t>(Size.Col * Size.Row * 3);
             bf.clear();
-            bf.reserve(estimatedCapacity);
+            bf.reserve(Chrome->size() + static_cast<size_t>(Size.Col) + 64);
 
             // Create the title bar with inverted colors
             Color.apply_mirror(bf);
             Area.Top.apply(bf);
-            bf.push_back(L' ');  // Leading space
-
-            // Add the title text (truncated if necessary)
-            bf.append(Title.data(), std::min<size_t>(TitleLength, Title.size()));
+            TitleOffset = static_cast<int>(bf.size());
+            std::wstring Cells;
+            title_cells(Cells, Title, Size.Col);
+            bf.append(Cells);
 
-            // Fill the rest of the title bar with spaces
-            if (Size.Col > TitleLength + 1) {
-                bf.append(static_cast<size_t>(Size.Col - 1 - TitleLength), ' ');
-            }
-
-            // Move to next line and reset colors
-            MoveLeft(bf, Size.Col);
-            MoveDown(bf);
-            Color.apply(bf);
-
-            // Draw the frame borders
-            for (int i = 2; i <= Size.Row; i++) {
-                // Add underline to the last row
-                if (i == Size.Row) {
-                    SetUnderline(bf);
-                }
-
-                // Draw left border character
-                PushBack(bf, LEFTHALF);
-
-                // Draw middle spaces
-                bf.append(static_cast<size_t>(Size.Col - 2), ' ');
-
-                // Draw right border character
-                PushBack(bf, RIGHTHALF);
-
-                // Move to next line
-                MoveLeft(bf, Size.Col);
-                MoveDown(bf);
-            }
-
-            // Reset text formatting
-            ClrUnderline(bf);
+            // Borders below the title bar
+            bf.append(*Chrome);
 
             // Save position for content
             PreMessageSize = static_cast<int>(bf.size());
 
             // Initialize the footer at the bottom of the frame
             Footer.create(Area.bottom_rows(1));
+            Footer.clear_fields();
+            StatusField = Footer.add_field(L"status");
+            Footer.layout_fields();
+
+            TitleMemo.store(title_hash(Title));
+            ShownChrome = 0;
         }
 
         /**
@@ -156,9 +268,40 @@ namespace mz {
          *
          * Renders both the frame and its footer component.
          */
-        void print() const noexcept {
+        void print() const noexcept override {
             BasicBox::print();
             Footer.print();
+            ShownChrome = chrome_hash();
+        }
+
+        /**
+         * @brief Output only what changed since the frame was last printed
+         *
+         * Prints everything if the frame moved, was resized or recolored
+         * since the last print(). Otherwise the borders and title are
+         * already on screen: only the content after PreMessageSize and a
+         * changed footer are written.
+         *
+         * @return true if the whole frame was printed
+         */
+        bool redraw() const noexcept {
+            if (ShownChrome != chrome_hash()) {
+                print();
+                return true;
+            }
+            if (bf.size() > static_cast<size_t>(PreMessageSize)) {
+                mz::Write(std::wstring_view(bf).substr(static_cast<size_t>(PreMessageSize)));
+            }
+            Footer.refresh();
+            return false;
+        }
+
+        /**
+         * @brief Append the frame and footer to another buffer
+         */
+        void render(std::wstring& Out) const override {
+            BasicBox::render(Out);
+            Footer.render(Out);
         }
 
         /**
@@ -178,45 +321,51 @@ namespace mz {
         /**
          * @brief Update the frame's title text
          *
+         * Does nothing if the title, colors and area are unchanged since the
+         * title bar was last drawn. Otherwise only the cells that differ
+         * from the current title bar are written, and the buffer is patched
+         * so a later print() shows the new title.
+         *
          * @param Title New title text
          */
         void set_title(std::wstring_view Title) noexcept {
-            // Calculate dimensions and title length
-            coord Size = Area.get_size();
-            int TitleLength = static_cast<int>(Title.size());
-
-            // Ensure title fits within the frame width
-            if (TitleLength >= Size.Col - 1) {
-                TitleLength = Size.Col - 2;
+            uint64_t Hash = title_hash(Title);
+            if (TitleMemo.skip(Hash)) {
+                return;
             }
 
-            // Create temporary buffer for the new title bar
-            std::wstring titleBar;
-            titleBar.reserve(static_cast<size_t>(Size.Col) + 64);
-
-            // Apply inverted colors and position cursor
-            Color.apply_mirror(titleBar);
-            Area.Top.apply(titleBar);
-
-            // Add title with padding
-            titleBar.push_back(L' ');  // Leading space
-            titleBar.append(Title.data(), std::min<size_t>(TitleLength, Title.size()));
-
-            // Fill the rest of the title bar with spaces
-            if (Size.Col > TitleLength + 1) {
-                titleBar.append(static_cast<size_t>(Size.Col - 1 - TitleLength), ' ');
+            const int Cols = Area.num_cols();
+            std::wstring Cells;
+            title_cells(Cells, Title, Cols);
+            if (bf.size() < static_cast<size_t>(TitleOffset) + Cells.size()) {
+                return;
             }
 
-            // Output the new title bar
-            Write(titleBar);
+            // Changed range of the fixed-length title bar
+            std::wstring_view Old{ bf.data() + TitleOffset, Cells.size() };
+            size_t First = 0;
+            while (First < Cells.size() && Old[First] == Cells[First]) ++First;
+            if (First < Cells.size()) {
+                size_t Last = Cells.size();
+                while (Last > First && Old[Last - 1] == Cells[Last - 1]) --Last;
+
+                std::wstring Patch;
+                Color.apply_mirror(Patch);
+                Area.Top.offset(0, static_cast<int>(First)).apply(Patch);
+                Patch.append(Cells, First, Last - First);
+                Write(Patch);
+                bf.replace(static_cast<size_t>(TitleOffset) + First, Last - First, Cells, First, Last - First);
+            }
+            TitleMemo.store(Hash);
         }
 
         /**
          * @brief Clear the content area of the frame
          *
-         * Fills the inside of the frame with spaces, preserving the borders.
+         * Erases each row inside the borders with one erase-characters
+         * command, written in a single call.
          */
-        void clear_content() noexcept {
+        void clear_content() const noexcept {
             // Get content area dimensions
             coord_box content = content_area();
             int width = content.num_cols();
@@ -224,32 +373,45 @@ namespace mz {
 
             if (width <= 0 || height <= 0) return;
 
-            // Create temporary buffer
+            // Erasing fills with the current background color
             std::wstring clearBuf;
-            clearBuf.reserve(static_cast<size_t>(width + 10));
-
-            // Apply colors and prepare spaces
+            clearBuf.reserve(static_cast<size_t>(height) * 24 + 48);
             Color.apply(clearBuf);
-            std::wstring spaces(static_cast<size_t>(width), ' ');
-
-            // Clear each line in the content area
+            std::wstring Erase{ std::format(L"\x1b[{}X", width) };
             for (int i = 0; i < height; i++) {
                 content.Top.offset(i, 0).apply(clearBuf);
-                clearBuf.append(spaces);
-                Write(clearBuf);
-                clearBuf.clear();
+                clearBuf.append(Erase);
             }
+            Write(clearBuf);
         }
 
         /**
          * @brief Set status message in the footer
          *
-         * Updates the footer with a new message.
+         * Updates the footer buffer only; the message is shown by the next
+         * print(), refresh() or redraw(). If the footer was rebuilt as a
+         * plain message since, the status field is laid out again.
          *
          * @param message Message to display
          */
         void set_status(std::wstring_view message) noexcept {
-            Footer.update_status(message);
+            put_status(message);
+        }
+
+        /**
+         * @brief Set status message in the footer and show it at once
+         *
+         * Writes only the status field, and nothing if it already shows
+         * this message; the whole footer if it had to be laid out again.
+         *
+         * @param message Message to display
+         */
+        void set_status_now(std::wstring_view message) noexcept {
+            if (put_status(message)) {
+                Footer.print();
+                return;
+            }
+            Footer.flush_fields();
         }
 
         /**
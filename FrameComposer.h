@@ -0,0 +1,355 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_FRAME_COMPOSER_H
+#define MZ_FRAME_COMPOSER_H
+#pragma once
+
+/**
+ * @file FrameComposer.h
+ * @brief Parallel composition of many widgets into one frame
+ *
+ * FrameComposer holds the layers of a screen, each with an area, a z-order
+ * and a function that composes its output. Layers whose areas overlap form a
+ * group that is composed on one thread in z-order, since they may share
+ * state; separate groups are composed in parallel on a WorkerPool. The
+ * per-layer outputs are then joined in z-order and written at once, so the
+ * frame is the same whatever the number of threads.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleBoxes.h"
+#include "WorkerPool.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <numeric>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <iostream>
+
+namespace mz {
+
+    /**
+     * @class FrameComposer
+     * @brief Composes independent widgets in parallel and flushes them once
+     *
+     * @code
+     * FrameComposer Frame(&WorkerPool::shared());
+     * Frame.add(Chart, 0, [&] { Chart.append(Load); });
+     * Frame.add(Log, 0, [&] { Log.insert_line(Message); });
+     * Frame.add(Popup, 1);
+     * Frame.present();
+     * @endcode
+     */
+    class FrameComposer {
+    public:
+        /**
+         * @brief Function that appends a layer's output to a buffer
+         */
+        using compose_fn = std::function<void(std::wstring&)>;
+
+    private:
+        /**
+         * @brief One widget of the frame
+         */
+        struct layer {
+            coord_box Area;         ///< Screen area the layer draws into
+            int Z{ 0 };             ///< Layers with higher Z are written later
+            compose_fn Compose;     ///< Appends the layer's output
+            std::wstring Out;       ///< Output of the last build
+        };
+
+        WorkerPool* Pool{ nullptr };            ///< Pool for parallel groups (nullptr for one thread)
+        std::vector<layer> Layers;              ///< Layers in insertion order
+        std::vector<std::vector<size_t>> Groups;    ///< Overlapping layers, each in z-order
+        std::vector<size_t> Order;              ///< All layers in z-order
+        std::wstring Frame;                     ///< Joined output of the last build
+        bool Planned{ false };                  ///< Groups and Order match Layers
+
+        /**
+         * @brief Split layers into groups of overlapping areas
+         */
+        void plan() {
+            size_t n = Layers.size();
+
+            // Union-find over pairs of overlapping areas
+            std::vector<size_t> Parent(n);
+            std::iota(Parent.begin(), Parent.end(), size_t{ 0 });
+            auto root = [&](size_t i) {
+                while (Parent[i] != i) {
+                    Parent[i] = Parent[Parent[i]];
+                    i = Parent[i];
+                }
+                return i;
+            };
+            for (size_t i = 0; i < n; i++) {
+                for (size_t j = i + 1; j < n; j++) {
+                    if (!Layers[i].Area.disjoint(Layers[j].Area)) {
+                        Parent[root(j)] = root(i);
+                    }
+                }
+            }
+
+            // Ties in Z keep insertion order
+            Order.resize(n);
+            std::iota(Order.begin(), Order.end(), size_t{ 0 });
+            std::stable_sort(Order.begin(), Order.end(), [&](size_t a, size_t b) {
+                return Layers[a].Z < Layers[b].Z;
+                });
+
+            // Groups list their layers in z-order, and come in order of first layer
+            Groups.clear();
+            std::vector<size_t> GroupOf(n, SIZE_MAX);
+            for (size_t i : Order) {
+                size_t r = root(i);
+                if (GroupOf[r] == SIZE_MAX) {
+                    GroupOf[r] = Groups.size();
+                    Groups.emplace_back();
+                }
+                Groups[GroupOf[r]].push_back(i);
+            }
+            Planned = true;
+        }
+
+    public:
+        /**
+         * @brief Construct a composer
+         *
+         * @param WorkPool Pool that composes groups in parallel, or nullptr
+         *        to compose everything on the calling thread
+         */
+        explicit FrameComposer(WorkerPool* WorkPool = nullptr) noexcept : Pool{ WorkPool } {}
+
+        /**
+         * @brief Use another pool (nullptr for one thread)
+         */
+        void set_pool(WorkerPool* WorkPool) noexcept {
+            Pool = WorkPool;
+        }
+
+        /**
+         * @brief Add a layer composed by a function
+         *
+         * @param Area Screen area the layer draws into
+         * @param Z Layers with higher Z are written later and end up on top
+         * @param Compose Appends the layer's output to the given buffer; runs on a worker thread and must not print
+         * @return Index of the layer
+         */
+        int add(coord_box Area, int Z, compose_fn Compose) {
+            Layers.push_back(layer{ Area, Z, std::move(Compose), {} });
+            Planned = false;
+            return static_cast<int>(Layers.size() - 1);
+        }
+
+        /**
+         * @brief Add a box as a layer
+         *
+         * Update runs first on the composing thread, then the box renders
+         * itself. Layers compose on worker threads, so Update may only
+         * change the box's buffer: it must not print (use
+         * SparklineBox::append(), not push()). The area is taken when the
+         * layer is added, so call set_area() after moving or resizing the
+         * box.
+         *
+         * @param Box Box to compose
+         * @param Z Layers with higher Z are written later and end up on top
+         * @param Update Optional work that brings the box up to date
+         * @return Index of the layer
+         */
+        int add(BasicBox& Box, int Z, std::function<void()> Update = {}) {
+            return add(Box.Area, Z, [&Box, Update = std::move(Update)](std::wstring& Out) {
+                if (Update) Update();
+                Box.render(Out);
+                });
+        }
+
+        /**
+         * @brief Change the area of a layer
+         */
+        void set_area(int Index, coord_box Area) noexcept {
+            if (Index < 0 || Index >= static_cast<int>(Layers.size())) return;
+            Layers[Index].Area = Area;
+            Planned = false;
+        }
+
+        /**
+         * @brief Recompute the groups before the next build
+         */
+        void invalidate() noexcept {
+            Planned = false;
+        }
+
+        /**
+         * @brief Remove all layers
+         */
+        void clear() noexcept {
+            Layers.clear();
+            Groups.clear();
+            Order.clear();
+            Planned = false;
+        }
+
+        /**
+         * @brief Number of layers
+         */
+        size_t num_layers() const noexcept {
+            return Layers.size();
+        }
+
+        /**
+         * @brief Number of groups that can be composed in parallel
+         */
+        size_t num_groups() {
+            if (!Planned) plan();
+            return Groups.size();
+        }
+
+        /**
+         * @brief Compose all layers and join them in z-order
+         *
+         * @return The frame, valid until the next build
+         */
+        std::wstring_view build() {
+            if (!Planned) plan();
+
+            auto ComposeGroup = [this](size_t g) {
+                for (size_t i : Groups[g]) {
+                    layer& l = Layers[i];
+                    l.Out.clear();
+                    l.Compose(l.Out);
+                }
+            };
+            if (Pool) {
+                Pool->run(Groups.size(), ComposeGroup);
+            }
+            else {
+                for (size_t g = 0; g < Groups.size(); g++) {
+                    ComposeGroup(g);
+                }
+            }
+
+            size_t Total{ 0 };
+            for (auto const& l : Layers) {
+                Total += l.Out.size();
+            }
+            Frame.clear();
+            Frame.reserve(Total);
+            for (size_t i : Order) {
+                Frame.append(Layers[i].Out);
+            }
+            return Frame;
+        }
+
+        /**
+         * @brief Build the frame and write it with a single call
+         */
+        void present() {
+            mz::Write(build());
+        }
+
+        /**
+         * @brief Measure frame building on 1 to N threads
+         *
+         * Tiles a screen with heat-map widgets that are recomposed every
+         * frame, builds NumFrames frames with pools of increasing size and
+         * prints the time per frame and the speedup. Nothing is written to
+         * the terminal except the results; every frame is checked against
+         * the single-threaded one by hash, outside the timed builds.
+         *
+         * @param NumRows Screen height
+         * @param NumCols Screen width
+         * @param NumWidgets Number of widgets (rounded to a grid)
+         * @param NumFrames Frames built per pool size
+         */
+        static void Benchmark(int NumRows = 120, int NumCols = 400, int NumWidgets = 48, int NumFrames = 30) {
+            int GridCols = std::max(1, static_cast<int>(std::sqrt(NumWidgets * 2.0)));
+            int GridRows = std::max(1, (NumWidgets + GridCols - 1) / GridCols);
+            int TileRows = std::max(1, NumRows / GridRows);
+            int TileCols = std::max(1, NumCols / GridCols);
+
+            int Frame{ 0 };
+            FrameComposer Composer;
+            for (int r = 0; r < GridRows; r++) {
+                for (int c = 0; c < GridCols; c++) {
+                    coord_box Tile{ coord(r * TileRows, c * TileCols), coord(r * TileRows + TileRows - 1, c * TileCols + TileCols - 1) };
+                    int Seed = r * GridCols + c;
+                    Composer.add(Tile, 0, [Tile, Seed, &Frame](std::wstring& Out) {
+                        for (int i = 0; i < Tile.num_rows(); i++) {
+                            Tile.Top.offset(i, 0).apply(Out);
+                            for (int j = 0; j < Tile.num_cols(); j++) {
+                                unsigned h = static_cast<unsigned>((i * 31 + j * 17 + Seed * 7 + Frame) * 2654435761u);
+                                rgb::gray(static_cast<int>(h >> 24) % 100).setBack(Out);
+                                Out.push_back(L' ');
+                            }
+                        }
+                        });
+                }
+            }
+
+            std::vector<uint64_t> Reference;   // Hash of each frame built on one thread
+            double Baseline{ 0 };
+            unsigned MaxThreads = std::max(1u, std::thread::hardware_concurrency());
+            std::wcout << std::format(L"{}x{} screen, {} widgets, {} frames\n",
+                NumRows, NumCols, Composer.num_layers(), NumFrames);
+
+            std::vector<unsigned> Sizes;
+            for (unsigned Threads = 1; Threads < MaxThreads; Threads *= 2) {
+                Sizes.push_back(Threads);
+            }
+            Sizes.push_back(MaxThreads);
+
+            for (unsigned Threads : Sizes) {
+                WorkerPool Pool(Threads);
+                Composer.set_pool(&Pool);
+
+                bool Same{ true };
+                std::chrono::steady_clock::duration Spent{};
+                for (Frame = 0; Frame < NumFrames; Frame++) {
+                    auto Start = std::chrono::steady_clock::now();
+                    std::wstring_view Out = Composer.build();
+                    Spent += std::chrono::steady_clock::now() - Start;
+
+                    uint64_t Hash = render_hash{}.add(Out).value();
+                    if (Threads == 1) Reference.push_back(Hash);
+                    else Same = Same && Hash == Reference[Frame];
+                }
+                double Ms = std::chrono::duration<double, std::milli>(Spent).count() / NumFrames;
+                if (Threads == 1) Baseline = Ms;
+
+                std::wcout << std::format(L"threads {:>3}: {:8.3f} ms/frame  x{:.2f}{}\n",
+                    Threads, Ms, Baseline / Ms, Same ? L"" : L"  OUTPUT DIFFERS");
+            }
+            Composer.set_pool(nullptr);
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_FRAME_COMPOSER_H
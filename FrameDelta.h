@@ -0,0 +1,602 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_FRAME_DELTA_H
+#define MZ_FRAME_DELTA_H
+#pragma once
+
+/**
+ * @file FrameDelta.h
+ * @brief Compact binary encoding of cell-level screen changes
+ *
+ * This file provides an encoder that compares successive VirtualTerminal
+ * screens and serializes only the cells that changed, and a decoder that
+ * rebuilds the screen on the receiving side. The format is built from
+ * LEB128 varints:
+ *
+ *  - Every message is prefixed with its payload length.
+ *  - A payload starts with KEYFRAME (followed by rows and columns) or DELTA,
+ *    then the frame number, then records until END.
+ *  - STYLE records bind a small handle to a foreground, background and
+ *    attribute set; a keyframe resets the handle table.
+ *  - SPAN records hold a row, a first column and run-length encoded
+ *    (style handle, glyph, repeat count) runs.
+ *  - CURSOR records carry the cursor position and visibility.
+ *
+ * A decoder that misses a frame answers with RESYNC and ignores deltas until
+ * the next keyframe.
+ *
+ * @author Meysam Zare
+ */
+
+#include "coord.h"
+#include "colors.h"
+#include "VirtualTerminal.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+
+namespace mz {
+
+    namespace frame {
+
+        /**
+         * @brief Record and message opcodes
+         */
+        enum opcode : uint8_t {
+            END = 0x00,        ///< End of frame
+            KEYFRAME = 0x01,   ///< Full frame, resets styles
+            DELTA = 0x02,      ///< Changes relative to the previous frame
+            STYLE = 0x10,      ///< Style handle definition
+            SPAN = 0x20,       ///< Run-length encoded cells on one row
+            CURSOR = 0x30,     ///< Cursor position and visibility
+            RESYNC = 0x7f      ///< Client to server: send a keyframe
+        };
+
+        /**
+         * @brief Largest style table before a keyframe is forced
+         */
+        static constexpr uint32_t MAX_STYLES{ 4096 };
+
+        /**
+         * @brief Largest screen a decoder accepts
+         *
+         * Keeps a corrupt or hostile keyframe from allocating gigabytes.
+         */
+        static constexpr uint64_t MAX_ROWS{ 1000 };
+        static constexpr uint64_t MAX_COLS{ 1000 };
+
+        /**
+         * @brief Unchanged cells tolerated inside one span
+         *
+         * Bridging a short gap is cheaper than starting a new span.
+         */
+        static constexpr int SPAN_GAP{ 3 };
+
+        /**
+         * @brief Append an unsigned LEB128 varint
+         */
+        inline void put_varint(std::string& Out, uint64_t Value) {
+            while (Value >= 0x80) {
+                Out += char(uint8_t(Value) | 0x80);
+                Value >>= 7;
+            }
+            Out += char(uint8_t(Value));
+        }
+
+        /**
+         * @brief Read an unsigned LEB128 varint
+         *
+         * @param In Input, advanced past the varint on success
+         * @param Value Decoded value
+         * @return true if error (truncated or overlong)
+         */
+        inline bool get_varint(std::string_view& In, uint64_t& Value) noexcept {
+            Value = 0;
+            for (int Shift = 0, i = 0; i < int(In.size()) && Shift < 64; ++i, Shift += 7) {
+                uint8_t b = uint8_t(In[i]);
+                Value |= uint64_t(b & 0x7f) << Shift;
+                if (!(b & 0x80)) {
+                    In.remove_prefix(i + 1);
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Pack the style part of a cell into one key
+         */
+        constexpr uint64_t style_key(vt_cell const& c) noexcept {
+            return (uint64_t(c.F.value()) << 32) | (uint64_t(c.B.value()) << 8) | c.Attr;
+        }
+
+        /**
+         * @brief Split one length-prefixed message off a byte stream
+         *
+         * @param Stream Received bytes; the message is removed on success
+         * @param Message Payload of the message
+         * @return true if a complete message was extracted
+         */
+        inline bool next_message(std::string& Stream, std::string& Message) {
+            std::string_view In(Stream);
+            uint64_t Length{ 0 };
+            if (get_varint(In, Length) || In.size() < Length) return false;
+            Message.assign(In.substr(0, size_t(Length)));
+            Stream.erase(0, Stream.size() - In.size() + size_t(Length));
+            return true;
+        }
+
+    } // namespace frame
+
+    /**
+     * @class frame_encoder
+     * @brief Serializes screen changes between successive frames
+     */
+    class frame_encoder {
+    private:
+        std::vector<vt_cell> Previous;                  ///< Last encoded screen
+        int Rows{ 0 };                                  ///< Rows of the last screen
+        int Cols{ 0 };                                  ///< Columns of the last screen
+        coord Cursor{ -1, -1 };                         ///< Last encoded cursor position
+        bool CursorVisible{ true };                     ///< Last encoded cursor visibility
+        std::unordered_map<uint64_t, uint32_t> Styles;  ///< Style key to handle
+        uint32_t FrameNumber{ 0 };                      ///< Number of the next frame
+        bool NeedKeyframe{ true };                      ///< Next frame must be a keyframe
+
+        /**
+         * @brief Get the handle of a style, defining it if new
+         */
+        uint32_t style_handle(vt_cell const& c, std::string& Out) {
+            uint64_t Key = frame::style_key(c);
+            auto it = Styles.find(Key);
+            if (it != Styles.end()) return it->second;
+
+            uint32_t Handle = uint32_t(Styles.size());
+            Styles.emplace(Key, Handle);
+            Out += char(frame::STYLE);
+            frame::put_varint(Out, Handle);
+            Out += char(c.F.r); Out += char(c.F.g); Out += char(c.F.b);
+            Out += char(c.B.r); Out += char(c.B.g); Out += char(c.B.b);
+            Out += char(c.Attr);
+            return Handle;
+        }
+
+        /**
+         * @brief Encode cells [First, Last] of a row as one span
+         */
+        void encode_span(VirtualTerminal const& Screen, int Row, int First, int Last, std::string& Out) {
+            // Style definitions go before the span that uses them
+            std::string Runs;
+            int NumRuns{ 0 };
+            int c = First;
+            while (c <= Last) {
+                vt_cell const& Cell = Screen.at(Row, c);
+                int Repeat{ 1 };
+                while (c + Repeat <= Last && Screen.at(Row, c + Repeat) == Cell) ++Repeat;
+                frame::put_varint(Runs, style_handle(Cell, Out));
+                frame::put_varint(Runs, Cell.Glyph);
+                frame::put_varint(Runs, uint64_t(Repeat));
+                ++NumRuns;
+                c += Repeat;
+            }
+            Out += char(frame::SPAN);
+            frame::put_varint(Out, uint64_t(Row));
+            frame::put_varint(Out, uint64_t(First));
+            frame::put_varint(Out, uint64_t(NumRuns));
+            Out += Runs;
+        }
+
+    public:
+        /**
+         * @brief Force the next frame to be a keyframe
+         *
+         * Call when a client connects or asks for a resync.
+         */
+        void request_keyframe() noexcept {
+            NeedKeyframe = true;
+        }
+
+        /**
+         * @brief Number of the next frame to be encoded
+         */
+        uint32_t frame_number() const noexcept {
+            return FrameNumber;
+        }
+
+        /**
+         * @brief Encode the changes since the previous frame
+         *
+         * Appends one length-prefixed message to Out. Emits nothing when the
+         * screen and cursor are unchanged and no keyframe is pending.
+         *
+         * @param Screen Current screen contents
+         * @param Out Destination for the message
+         * @return true if a message was appended
+         */
+        bool encode(VirtualTerminal const& Screen, std::string& Out) {
+            bool Key = NeedKeyframe || Screen.rows() != Rows || Screen.cols() != Cols ||
+                Styles.size() >= frame::MAX_STYLES;
+            if (Key) {
+                Styles.clear();
+                Rows = Screen.rows();
+                Cols = Screen.cols();
+                Previous.assign(size_t(Rows) * Cols, vt_cell{});
+                NeedKeyframe = false;
+            }
+
+            std::string Payload;
+            Payload += char(Key ? frame::KEYFRAME : frame::DELTA);
+            frame::put_varint(Payload, FrameNumber);
+            if (Key) {
+                frame::put_varint(Payload, uint64_t(Rows));
+                frame::put_varint(Payload, uint64_t(Cols));
+            }
+            size_t HeaderSize = Payload.size();
+
+            for (int r = 0; r < Rows; ++r) {
+                vt_cell* Old = &Previous[size_t(r) * Cols];
+                int c = 0;
+                while (c < Cols) {
+                    // Find the next changed cell (a keyframe sends every cell)
+                    if (!Key && Screen.at(r, c) == Old[c]) { ++c; continue; }
+                    int First = c;
+                    int Last = c;
+                    int Gap{ 0 };
+                    for (++c; c < Cols; ++c) {
+                        if (Key || !(Screen.at(r, c) == Old[c])) { Last = c; Gap = 0; }
+                        else if (++Gap > frame::SPAN_GAP) break;
+                    }
+                    encode_span(Screen, r, First, Last, Payload);
+                    for (int i = First; i <= Last; ++i) Old[i] = Screen.at(r, i);
+                    c = Last + 1;
+                }
+            }
+
+            coord NewCursor = Screen.cursor_position();
+            if (Key || NewCursor.Row != Cursor.Row || NewCursor.Col != Cursor.Col ||
+                Screen.cursor_visible() != CursorVisible) {
+                Cursor = NewCursor;
+                CursorVisible = Screen.cursor_visible();
+                Payload += char(frame::CURSOR);
+                frame::put_varint(Payload, uint64_t(Cursor.Row));
+                frame::put_varint(Payload, uint64_t(Cursor.Col));
+                Payload += char(CursorVisible ? 1 : 0);
+            }
+
+            if (!Key && Payload.size() == HeaderSize) return false;
+
+            Payload += char(frame::END);
+            frame::put_varint(Out, Payload.size());
+            Out += Payload;
+            ++FrameNumber;
+            return true;
+        }
+    };
+
+    /**
+     * @class frame_decoder
+     * @brief Rebuilds the screen from encoded frames
+     *
+     * Keeps the cell grid and style table of the sending side and records
+     * which spans each frame changed, so a client can repaint just those.
+     */
+    class frame_decoder {
+    public:
+        /**
+         * @brief Result of applying a frame
+         */
+        enum result : int {
+            applied = 0,        ///< Frame applied
+            need_keyframe = 1,  ///< Frame skipped; a keyframe is required
+            malformed = 2       ///< Frame could not be parsed
+        };
+
+        /**
+         * @struct span
+         * @brief A range of cells changed by the last frame
+         */
+        struct span {
+            int Row;    ///< Row index
+            int First;  ///< First column
+            int Last;   ///< Last column (inclusive)
+        };
+
+    private:
+        std::vector<vt_cell> Cells;     ///< Decoded cell grid
+        std::vector<vt_cell> Styles;    ///< Style handle table (glyph unused)
+        std::vector<span> Changed;      ///< Spans touched by the last frame
+        int Rows{ 0 };                  ///< Screen rows
+        int Cols{ 0 };                  ///< Screen columns
+        coord Cursor;                   ///< Cursor position
+        bool CursorVisible{ true };     ///< Cursor visibility
+        uint32_t NextFrame{ 0 };        ///< Expected frame number
+        bool Synced{ false };           ///< True once a keyframe was applied
+
+    public:
+        /**
+         * @brief Apply one message payload
+         *
+         * A malformed frame may have been applied in part, so like a lost
+         * frame it leaves the decoder waiting for a keyframe.
+         *
+         * @param Payload Message without its length prefix
+         * @return applied, need_keyframe or malformed
+         */
+        int apply(std::string_view Payload) {
+            int Result = decode(Payload);
+            if (Result == malformed) Synced = false;
+            return Result;
+        }
+
+        /**
+         * @brief Check whether a keyframe has been applied since the last gap
+         */
+        bool synced() const noexcept { return Synced; }
+
+    private:
+        /**
+         * @brief Parse and apply one message payload
+         */
+        int decode(std::string_view Payload) {
+            using namespace frame;
+            Changed.clear();
+            if (Payload.empty()) return malformed;
+            uint8_t Kind = uint8_t(Payload[0]);
+            Payload.remove_prefix(1);
+            uint64_t Number{ 0 };
+            if (get_varint(Payload, Number)) return malformed;
+
+            if (Kind == KEYFRAME) {
+                uint64_t r{ 0 }, c{ 0 };
+                if (get_varint(Payload, r) || get_varint(Payload, c) || !r || !c || r > MAX_ROWS || c > MAX_COLS) {
+                    return malformed;
+                }
+                Rows = int(r);
+                Cols = int(c);
+                Cells.assign(size_t(Rows) * Cols, vt_cell{});
+                Styles.clear();
+                Synced = true;
+            }
+            else if (Kind != DELTA) {
+                return malformed;
+            }
+            else if (!Synced || Number != NextFrame) {
+                // A frame was lost; deltas are useless until a keyframe
+                Synced = false;
+                return need_keyframe;
+            }
+            NextFrame = uint32_t(Number) + 1;
+
+            while (!Payload.empty()) {
+                uint8_t Op = uint8_t(Payload[0]);
+                Payload.remove_prefix(1);
+                if (Op == END) return applied;
+
+                if (Op == STYLE) {
+                    uint64_t Handle{ 0 };
+                    if (get_varint(Payload, Handle) || Payload.size() < 7 || Handle != Styles.size()) return malformed;
+                    vt_cell s;
+                    s.F = rgb(uint8_t(Payload[0]), uint8_t(Payload[1]), uint8_t(Payload[2]));
+                    s.B = rgb(uint8_t(Payload[3]), uint8_t(Payload[4]), uint8_t(Payload[5]));
+                    s.Attr = uint8_t(Payload[6]);
+                    Payload.remove_prefix(7);
+                    Styles.push_back(s);
+                }
+                else if (Op == SPAN) {
+                    uint64_t Row{ 0 }, Col{ 0 }, Runs{ 0 };
+                    if (get_varint(Payload, Row) || get_varint(Payload, Col) || get_varint(Payload, Runs) ||
+                        Row >= uint64_t(Rows) || Col >= uint64_t(Cols)) {
+                        return malformed;
+                    }
+                    int c = int(Col);
+                    for (uint64_t i = 0; i < Runs; ++i) {
+                        uint64_t Handle{ 0 }, Glyph{ 0 }, Repeat{ 0 };
+                        if (get_varint(Payload, Handle) || get_varint(Payload, Glyph) || get_varint(Payload, Repeat) ||
+                            Handle >= Styles.size() || c + Repeat > uint64_t(Cols)) {
+                            return malformed;
+                        }
+                        vt_cell Cell = Styles[size_t(Handle)];
+                        Cell.Glyph = char32_t(Glyph);
+                        for (uint64_t k = 0; k < Repeat; ++k) {
+                            Cells[size_t(Row) * Cols + c++] = Cell;
+                        }
+                    }
+                    if (c > int(Col)) Changed.push_back(span{ int(Row), int(Col), c - 1 });
+                }
+                else if (Op == CURSOR) {
+                    uint64_t Row{ 0 }, Col{ 0 };
+                    if (get_varint(Payload, Row) || get_varint(Payload, Col) || Payload.empty()) return malformed;
+                    Cursor = coord{ int(Row), int(Col) };
+                    CursorVisible = Payload[0] != 0;
+                    Payload.remove_prefix(1);
+                }
+                else {
+                    return malformed;
+                }
+            }
+            return malformed;  // Missing END
+        }
+
+    public:
+        /**
+         * @brief Get the number of rows
+         */
+        int rows() const noexcept { return Rows; }
+
+        /**
+         * @brief Get the number of columns
+         */
+        int cols() const noexcept { return Cols; }
+
+        /**
+         * @brief Get a decoded cell
+         */
+        vt_cell const& at(int Row, int Col) const noexcept {
+            return Cells[size_t(Row) * Cols + Col];
+        }
+
+        /**
+         * @brief Get the spans changed by the last applied frame
+         */
+        std::vector<span> const& changed() const noexcept {
+            return Changed;
+        }
+
+        /**
+         * @brief Check whether the decoded screen and cursor equal a reference screen
+         */
+        bool matches(VirtualTerminal const& Screen) const noexcept {
+            if (Screen.rows() != Rows || Screen.cols() != Cols) return false;
+            coord c = Screen.cursor_position();
+            if (c.Row != Cursor.Row || c.Col != Cursor.Col || Screen.cursor_visible() != CursorVisible) return false;
+            for (int r = 0; r < Rows; ++r) {
+                for (int c = 0; c < Cols; ++c) {
+                    if (!(Screen.at(r, c) == at(r, c))) return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Produce escape sequences that repaint the changed spans
+         *
+         * Output is plain UTF-8 suitable for the local terminal.
+         *
+         * @param Out Destination string
+         */
+        void render_changes(std::string& Out) const {
+            bool First{ true };
+            vt_cell Pen;
+            for (span const& s : Changed) {
+                Out += "\x1b[" + std::to_string(s.Row + 1) + ";" + std::to_string(s.First + 1) + "H";
+                for (int c = s.First; c <= s.Last; ++c) {
+                    vt_cell const& Cell = at(s.Row, c);
+                    if (First || !(frame::style_key(Cell) == frame::style_key(Pen))) {
+                        Out += "\x1b[0";
+                        if (Cell.Attr & vt_cell::BOLD) Out += ";1";
+                        if (Cell.Attr & vt_cell::UNDERLINE) Out += ";4";
+                        if (Cell.Attr & vt_cell::BLINK) Out += ";5";
+                        if (Cell.Attr & vt_cell::NEGATIVE) Out += ";7";
+                        Out += ";38;2;" + std::to_string(Cell.F.r) + ";" + std::to_string(Cell.F.g) + ";" + std::to_string(Cell.F.b);
+                        Out += ";48;2;" + std::to_string(Cell.B.r) + ";" + std::to_string(Cell.B.g) + ";" + std::to_string(Cell.B.b) + "m";
+                        Pen = Cell;
+                        First = false;
+                    }
+                    append_utf8(Out, Cell.Glyph);
+                }
+            }
+            Out += "\x1b[" + std::to_string(Cursor.Row + 1) + ";" + std::to_string(Cursor.Col + 1) + "H";
+            Out += CursorVisible ? "\x1b[?25h" : "\x1b[?25l";
+        }
+    };
+
+    namespace frame {
+
+        /**
+         * @brief Encode a scripted session and check that the decoder rebuilds it
+         *
+         * Covers colors, cursor moves and visibility, scrolling, a resize, a
+         * style table overflow, a lost frame followed by a resync, and an
+         * oversized keyframe.
+         *
+         * @return true if error (a decoded frame differs from its source)
+         */
+        inline bool round_trip_check() {
+            VirtualTerminal Screen(12, 40);
+            frame_encoder Encoder;
+            frame_decoder Decoder;
+            std::string Stream, Message;
+
+            // Encode the screen and apply every resulting message
+            auto step = [&](std::string_view Bytes) {
+                Screen.feed(Bytes);
+                Encoder.encode(Screen, Stream);
+                while (next_message(Stream, Message)) {
+                    if (Decoder.apply(Message) != frame_decoder::applied) return true;
+                }
+                return !Decoder.matches(Screen);
+            };
+
+            if (step("hello world") ||
+                step("\x1b[31;44mred on blue\x1b[0m\r\n") ||
+                step("\x1b[5;10H\x1b[1;4mbold\x1b[0m") ||
+                step("\x1b[?25l") ||
+                step("\x1b[2J\x1b[H\x1b[?25h")) {
+                return true;
+            }
+            for (int i = 0; i < 30; ++i) {
+                if (step("line " + std::to_string(i) + "\r\n")) return true;
+            }
+            Screen.resize(20, 60);
+            if (step("resized")) return true;
+
+            // More distinct styles than MAX_STYLES forces a keyframe midway
+            for (int f = 0; f < 8; ++f) {
+                std::string Bytes{ "\x1b[H" };
+                for (int i = 0; i < 600; ++i) {
+                    int n = f * 600 + i;
+                    Bytes += "\x1b[38;2;" + std::to_string(n & 255) + ";" + std::to_string(n >> 8) + ";7mx";
+                }
+                if (step(Bytes)) return true;
+            }
+
+            // A lost delta stops the decoder until a keyframe arrives
+            Screen.feed("lost");
+            Encoder.encode(Screen, Stream);
+            Stream.clear();
+            Screen.feed("next");
+            Encoder.encode(Screen, Stream);
+            if (!next_message(Stream, Message) || Decoder.apply(Message) != frame_decoder::need_keyframe) {
+                return true;
+            }
+            Encoder.request_keyframe();
+            if (step("")) return true;
+
+            // So does a truncated delta, even one whose spans were applied
+            Screen.feed("cut short");
+            Encoder.encode(Screen, Stream);
+            if (!next_message(Stream, Message)) return true;
+            Message.pop_back();
+            if (Decoder.apply(Message) != frame_decoder::malformed || Decoder.synced()) return true;
+            Encoder.request_keyframe();
+            if (step("")) return true;
+
+            // An oversized keyframe is rejected
+            std::string Huge;
+            Huge += char(KEYFRAME);
+            put_varint(Huge, 0);
+            put_varint(Huge, MAX_ROWS + 1);
+            put_varint(Huge, MAX_COLS);
+            Huge += char(END);
+            return Decoder.apply(Huge) != frame_decoder::malformed || Decoder.synced();
+        }
+
+    } // namespace frame
+
+} // namespace mz
+
+#endif // MZ_FRAME_DELTA_H
@@ -0,0 +1,351 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "FrameStream.h"
+#include "ConsoleCMD.h"
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz {
+
+    FrameStreamServer::FrameStreamServer(int NumRows, int NumCols) noexcept : Screen(NumRows, NumCols) {}
+
+    void FrameStreamServer::tap(std::string_view Bytes) noexcept {
+        if (Attached) {
+            Attached->feed(Bytes);
+        }
+    }
+
+    void FrameStreamServer::attach() noexcept {
+        Attached = this;
+        OutputTap = &FrameStreamServer::tap;
+    }
+
+    void FrameStreamServer::detach() noexcept {
+        if (Attached == this) {
+            Attached = nullptr;
+            OutputTap = nullptr;
+        }
+    }
+
+    void FrameStreamServer::feed(std::string_view Bytes) noexcept {
+        BytesMirrored += Bytes.size();
+        Screen.feed(Bytes);
+    }
+
+#if defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+
+    namespace {
+        /**
+         * @brief Fill a socket address for a filesystem path
+         *
+         * @return true if error (path too long)
+         */
+        bool make_address(std::string const& Path, sockaddr_un& Address) noexcept {
+            std::memset(&Address, 0, sizeof(Address));
+            Address.sun_family = AF_UNIX;
+            if (Path.size() >= sizeof(Address.sun_path)) {
+                return true;
+            }
+            std::memcpy(Address.sun_path, Path.c_str(), Path.size() + 1);
+            return false;
+        }
+
+        /**
+         * @brief Switch a descriptor to non-blocking mode
+         */
+        void set_nonblocking(int Fd) noexcept {
+            fcntl(Fd, F_SETFL, fcntl(Fd, F_GETFL, 0) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+            int On = 1;
+            setsockopt(Fd, SOL_SOCKET, SO_NOSIGPIPE, &On, sizeof(On));
+#endif
+        }
+
+#ifdef MSG_NOSIGNAL
+        constexpr int SEND_FLAGS{ MSG_NOSIGNAL };
+#else
+        constexpr int SEND_FLAGS{ 0 };
+#endif
+    }
+
+    FrameStreamServer::~FrameStreamServer() noexcept {
+        detach();
+        for (auto& c : Clients) {
+            close(c.Fd);
+        }
+        if (ListenFd >= 0) {
+            close(ListenFd);
+            unlink(SocketPath.c_str());
+        }
+    }
+
+    int FrameStreamServer::listen(std::string const& Path) noexcept {
+        sockaddr_un Address;
+        if (make_address(Path, Address)) {
+            std::cerr << "ERROR: Socket path is too long." << std::endl;
+            return 2;
+        }
+
+        ListenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (ListenFd < 0) {
+            std::cerr << "ERROR: Failed to create frame stream socket." << std::endl;
+            return 1;
+        }
+
+        // Replace a stale socket, but never a file that is something else
+        struct stat St;
+        if (lstat(Path.c_str(), &St) == 0 && S_ISSOCK(St.st_mode)) {
+            unlink(Path.c_str());
+        }
+        if (bind(ListenFd, reinterpret_cast<sockaddr*>(&Address), sizeof(Address)) != 0) {
+            std::cerr << "ERROR: Failed to bind frame stream socket." << std::endl;
+            close(ListenFd);
+            ListenFd = -1;
+            return 2;
+        }
+        if (::listen(ListenFd, 8) != 0) {
+            std::cerr << "ERROR: Failed to listen on frame stream socket." << std::endl;
+            close(ListenFd);
+            ListenFd = -1;
+            unlink(Path.c_str());
+            return 4;
+        }
+
+        set_nonblocking(ListenFd);
+        SocketPath = Path;
+        return 0;
+    }
+
+    void FrameStreamServer::accept_clients() noexcept {
+        if (ListenFd < 0) {
+            return;
+        }
+        while (true) {
+            int Fd = accept(ListenFd, nullptr, nullptr);
+            if (Fd < 0) {
+                break;
+            }
+            set_nonblocking(Fd);
+            // A fresh encoder starts with a keyframe
+            Clients.emplace_back().Fd = Fd;
+        }
+    }
+
+    bool FrameStreamServer::flush_client(client& c) noexcept {
+        while (!c.Queue.empty()) {
+            std::string const& Front = c.Queue.front();
+            ssize_t n = send(c.Fd, Front.data() + c.Offset, Front.size() - c.Offset, SEND_FLAGS);
+            if (n < 0) {
+                return errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR;
+            }
+            BytesSent += uint64_t(n);
+            c.Queued -= size_t(n);
+            c.Offset += size_t(n);
+            if (c.Offset == Front.size()) {
+                c.Queue.pop_front();
+                c.Offset = 0;
+            }
+        }
+        return false;
+    }
+
+    int FrameStreamServer::publish() noexcept {
+        accept_clients();
+
+        for (size_t i = 0; i < Clients.size();) {
+            client& c = Clients[i];
+            bool Gone{ false };
+
+            // Resync requests from the client
+            char Buffer[64];
+            while (true) {
+                ssize_t n = recv(c.Fd, Buffer, sizeof(Buffer), 0);
+                if (n == 0) { Gone = true; break; }
+                if (n < 0) { Gone = errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR; break; }
+                if (std::memchr(Buffer, frame::RESYNC, size_t(n))) {
+                    c.Encoder.request_keyframe();
+                }
+            }
+
+            if (!Gone) {
+                if (c.Queued > MAX_PENDING) {
+                    // Too far behind: drop whole queued messages (keeping one
+                    // already in flight) and start over from a keyframe
+                    size_t Keep = c.Offset ? 1 : 0;
+                    while (c.Queue.size() > Keep) {
+                        c.Queued -= c.Queue.back().size();
+                        c.Queue.pop_back();
+                    }
+                    if (Keep) {
+                        c.Queued = c.Queue.front().size() - c.Offset;
+                    }
+                    c.Encoder.request_keyframe();
+                }
+                std::string Message;
+                if (c.Encoder.encode(Screen, Message)) {
+                    c.Queued += Message.size();
+                    c.Queue.push_back(std::move(Message));
+                }
+                Gone = flush_client(c);
+            }
+
+            if (Gone) {
+                close(c.Fd);
+                Clients.erase(Clients.begin() + std::ptrdiff_t(i));
+            }
+            else {
+                ++i;
+            }
+        }
+        return int(Clients.size());
+    }
+
+    FrameStreamClient::~FrameStreamClient() noexcept {
+        if (Fd >= 0) {
+            close(Fd);
+        }
+    }
+
+    int FrameStreamClient::connect(std::string const& Path) noexcept {
+        sockaddr_un Address;
+        if (make_address(Path, Address)) {
+            return 2;
+        }
+        Fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (Fd < 0) {
+            std::cerr << "ERROR: Failed to create frame stream socket." << std::endl;
+            return 1;
+        }
+        if (::connect(Fd, reinterpret_cast<sockaddr*>(&Address), sizeof(Address)) != 0) {
+            std::cerr << "ERROR: Failed to connect to frame stream." << std::endl;
+            close(Fd);
+            Fd = -1;
+            return 2;
+        }
+        return 0;
+    }
+
+    int FrameStreamClient::receive(int TimeoutMs) noexcept {
+        if (Fd < 0) {
+            return -1;
+        }
+
+        pollfd pfd{ Fd, POLLIN, 0 };
+        if (poll(&pfd, 1, TimeoutMs) > 0) {
+            char Buffer[65536];
+            ssize_t n = recv(Fd, Buffer, sizeof(Buffer), 0);
+            if (n <= 0) {
+                close(Fd);
+                Fd = -1;
+                return -1;
+            }
+            BytesReceived += uint64_t(n);
+            Stream.append(Buffer, size_t(n));
+        }
+
+        int Applied{ 0 };
+        std::string Message;
+        std::string Output;
+        while (frame::next_message(Stream, Message)) {
+            int Result = Decoder.apply(Message);
+            if (Result == frame_decoder::applied) {
+                WaitingKeyframe = false;
+                ++Applied;
+                if (Render) {
+                    Decoder.render_changes(Output);
+                }
+            }
+            else if (!WaitingKeyframe) {
+                // Out of sync or corrupt: ask for a keyframe once
+                char Request = char(frame::RESYNC);
+                send(Fd, &Request, 1, SEND_FLAGS);
+                WaitingKeyframe = true;
+            }
+        }
+        if (!Output.empty()) {
+            fwrite(Output.data(), 1, Output.size(), stdout);
+            fflush(stdout);
+        }
+        return Applied;
+    }
+
+#else
+
+    FrameStreamServer::~FrameStreamServer() noexcept {
+        detach();
+    }
+
+    int FrameStreamServer::listen(std::string const&) noexcept {
+        std::wcerr << L"ERROR: Frame streaming is not supported on this platform." << std::endl;
+        return 1;
+    }
+
+    void FrameStreamServer::accept_clients() noexcept {}
+
+    bool FrameStreamServer::flush_client(client&) noexcept {
+        return true;
+    }
+
+    int FrameStreamServer::publish() noexcept {
+        return 0;
+    }
+
+    FrameStreamClient::~FrameStreamClient() noexcept {}
+
+    int FrameStreamClient::connect(std::string const&) noexcept {
+        return 1;
+    }
+
+    int FrameStreamClient::receive(int) noexcept {
+        return -1;
+    }
+
+#endif
+
+} // namespace mz
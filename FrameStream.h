@@ -0,0 +1,238 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_FRAME_STREAM_H
+#define MZ_FRAME_STREAM_H
+#pragma once
+
+/**
+ * @file FrameStream.h
+ * @brief Streaming screen frames to thin clients over a Unix domain socket
+ *
+ * FrameStreamServer mirrors everything the application writes into a
+ * VirtualTerminal and, at each frame boundary, sends every connected client
+ * the cells that changed, encoded with frame_encoder. FrameStreamClient is a
+ * local stand-in for the remote viewer: it decodes the stream, can repaint
+ * the local terminal, and asks for a keyframe whenever it falls out of sync.
+ *
+ * Unix domain sockets are used on Unix-like systems only; elsewhere the
+ * calls report an error.
+ *
+ * @author Meysam Zare
+ */
+
+#include "FrameDelta.h"
+#include "VirtualTerminal.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @class FrameStreamServer
+     * @brief Publishes screen deltas to connected viewers
+     *
+     * Typical use:
+     * @code
+     * FrameStreamServer server(30, 100);
+     * server.listen("/tmp/dashboard.sock");
+     * server.attach();
+     * while (running) {
+     *     draw_everything();
+     *     server.publish();
+     * }
+     * @endcode
+     */
+    class FrameStreamServer {
+    private:
+        /**
+         * @brief One connected viewer
+         */
+        struct client {
+            int Fd{ -1 };                   ///< Connected socket
+            frame_encoder Encoder;          ///< Per-client delta state
+            std::deque<std::string> Queue;  ///< Encoded messages not yet accepted by the socket
+            size_t Offset{ 0 };             ///< Bytes of the front message already sent
+            size_t Queued{ 0 };             ///< Total unsent bytes
+        };
+
+        /**
+         * @brief Bytes a slow client may lag behind before it is resynced
+         */
+        static constexpr size_t MAX_PENDING{ 1 << 20 };
+
+        VirtualTerminal Screen;         ///< Mirror of the application's screen
+        std::vector<client> Clients;    ///< Connected viewers
+        std::string SocketPath;         ///< Path the server is bound to
+        int ListenFd{ -1 };             ///< Listening socket
+        uint64_t BytesMirrored{ 0 };    ///< Raw output bytes seen
+        uint64_t BytesSent{ 0 };        ///< Encoded bytes sent
+
+        /**
+         * @brief Server currently installed as mz::OutputTap
+         */
+        static inline FrameStreamServer* Attached{ nullptr };
+
+        /**
+         * @brief Output tap forwarding to the attached server
+         */
+        static void tap(std::string_view Bytes) noexcept;
+
+        /**
+         * @brief Accept pending connections
+         */
+        void accept_clients() noexcept;
+
+        /**
+         * @brief Send as much pending data as the socket takes
+         *
+         * @return true if the client disconnected
+         */
+        bool flush_client(client& c) noexcept;
+
+    public:
+        /**
+         * @brief Construct a server mirroring a screen of the given size
+         */
+        FrameStreamServer(int NumRows, int NumCols) noexcept;
+
+        /**
+         * @brief Close all connections and remove the socket file
+         */
+        ~FrameStreamServer() noexcept;
+
+        /**
+         * @brief Start listening on a Unix domain socket
+         *
+         * @param Path Filesystem path of the socket (replaced if it exists)
+         * @return 0 on success, 1 if the socket could not be created,
+         *         2 if binding failed, 4 if listening failed
+         */
+        int listen(std::string const& Path) noexcept;
+
+        /**
+         * @brief Mirror all library output into this server
+         *
+         * Installs the server as mz::OutputTap. Only one server can be
+         * attached at a time.
+         */
+        void attach() noexcept;
+
+        /**
+         * @brief Stop mirroring library output
+         */
+        void detach() noexcept;
+
+        /**
+         * @brief Mirror output that bypasses mz::Write
+         *
+         * @param Bytes Raw terminal output
+         */
+        void feed(std::string_view Bytes) noexcept;
+
+        /**
+         * @brief End the current frame and send its changes
+         *
+         * Accepts new viewers (who receive a keyframe), honours resync
+         * requests, encodes each client's delta and writes it without
+         * blocking. A client that cannot keep up has its backlog dropped and
+         * is resynced with a keyframe.
+         *
+         * @return Number of connected clients
+         */
+        int publish() noexcept;
+
+        /**
+         * @brief Get the mirrored screen
+         */
+        VirtualTerminal const& screen() const noexcept { return Screen; }
+
+        /**
+         * @brief Raw escape-sequence bytes mirrored so far
+         */
+        uint64_t bytes_mirrored() const noexcept { return BytesMirrored; }
+
+        /**
+         * @brief Encoded bytes sent to all clients so far
+         */
+        uint64_t bytes_sent() const noexcept { return BytesSent; }
+    };
+
+    /**
+     * @class FrameStreamClient
+     * @brief Local stand-in for a remote thin client
+     */
+    class FrameStreamClient {
+    private:
+        frame_decoder Decoder;          ///< Decoded screen
+        std::string Stream;             ///< Received bytes not yet decoded
+        int Fd{ -1 };                   ///< Connected socket
+        uint64_t BytesReceived{ 0 };    ///< Encoded bytes received
+        bool WaitingKeyframe{ false };  ///< A resync request is outstanding
+
+    public:
+        /**
+         * @brief Repaint the local terminal after every frame
+         */
+        bool Render{ false };
+
+        /**
+         * @brief Disconnect on destruction
+         */
+        ~FrameStreamClient() noexcept;
+
+        /**
+         * @brief Connect to a server socket
+         *
+         * @param Path Filesystem path of the server socket
+         * @return 0 on success, 1 if the socket could not be created,
+         *         2 if the connection failed
+         */
+        int connect(std::string const& Path) noexcept;
+
+        /**
+         * @brief Receive and apply available frames
+         *
+         * @param TimeoutMs Time to wait for data (0 to not wait)
+         * @return Number of frames applied, or -1 if disconnected
+         */
+        int receive(int TimeoutMs) noexcept;
+
+        /**
+         * @brief Get the decoded screen
+         */
+        frame_decoder const& decoder() const noexcept { return Decoder; }
+
+        /**
+         * @brief Encoded bytes received so far
+         */
+        uint64_t bytes_received() const noexcept { return BytesReceived; }
+    };
+
+} // namespace mz
+
+#endif // MZ_FRAME_STREAM_H
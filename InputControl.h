@@ -39,6 +39,7 @@
 
 #include <vector>
 #include <string>
+#include <functional>
 #include <stdexcept>
 #include "ConsoleCMD.h"
 #include "coord.h"
@@ -362,6 +363,33 @@ namespace mz {
             return Processed >= 0;
         }
 
+        /**
+         * @brief Wait for the next key, calling OnIdle while none arrives
+         */
+        int next_key() {
+            if (OnIdle) {
+                while (!wait_key(IdleMs)) {
+                    OnIdle(*this);
+                }
+            }
+            return wgetch();
+        }
+
+        /**
+         * @brief Insert a key and call OnChange if the text changed
+         */
+        bool insert_and_notify(int x) {
+            if (!OnChange) {
+                return insert(x);
+            }
+            std::wstring Before = Text;
+            bool Inserted = insert(x);
+            if (Text != Before) {
+                OnChange(*this);
+            }
+            return Inserted;
+        }
+
         /**
          * @brief Current insert/overwrite mode
          *
@@ -450,6 +478,34 @@ namespace mz {
          */
         wchar_t wc{ 0 };
 
+        /**
+         * @brief Called after a keystroke changes Text
+         *
+         * Runs on the input loop, so it must return quickly; hand slow work
+         * to a worker such as AsyncValidator.
+         */
+        std::function<void(InputControl&)> OnChange;
+
+        /**
+         * @brief Called with every key before the field handles it
+         *
+         * Returns true if it consumed the key, e.g. Tab for completion.
+         */
+        std::function<bool(InputControl&, int)> OnKey;
+
+        /**
+         * @brief Called every IdleMs while get() waits for a key
+         *
+         * Lets the owner update the screen, e.g. with validation results,
+         * without waiting for the next keystroke.
+         */
+        std::function<void(InputControl&)> OnIdle;
+
+        /**
+         * @brief Interval between OnIdle calls in milliseconds
+         */
+        int IdleMs{ 50 };
+
         /**
          * @brief Reset the input control
          *
@@ -494,7 +550,10 @@ namespace mz {
             print_and_display_cursor();
 
             while (true) {
-                int x = wgetch();
+                int x = next_key();
+                if (OnKey && OnKey(*this, x)) {
+                    continue;
+                }
                 switch (x) {
                 case RETURNKEY:
                     print(Final, DisplayCharacter);
@@ -505,7 +564,7 @@ namespace mz {
                     print(Final, DisplayCharacter);
                     return false;
                 default:
-                    insert(x);
+                    insert_and_notify(x);
                     break;
                 }
             }
@@ -538,7 +597,10 @@ namespace mz {
             print_and_display_cursor();
 
             while (true) {
-                int x = wgetch();
+                int x = next_key();
+                if (OnKey && OnKey(*this, x)) {
+                    continue;
+                }
 
                 switch (x) {
                 case RETURNKEY:
@@ -563,7 +625,7 @@ namespace mz {
                     break;
                 default:
                     // Process regular input
-                    if (!insert(x)) {
+                    if (!insert_and_notify(x)) {
                         Footer.blink();
                         print_and_display_cursor();
                     }
@@ -577,7 +639,7 @@ namespace mz {
          *
          * Renders the input field without entering interactive mode.
          */
-        void print() const noexcept {
+        void print() const noexcept override {
             BasicBox::print();
         }
 
@@ -671,6 +733,26 @@ namespace mz {
             BeginOffset = 0;
         }
 
+        /**
+         * @brief Replace the text while editing
+         *
+         * Puts the cursor at the end, scrolling as needed, redraws the
+         * field and calls OnChange.
+         *
+         * @param NewText New text content (truncated to the maximum length)
+         */
+        void edit_text(std::wstring_view NewText) {
+            Text.assign(NewText.substr(0, static_cast<size_t>(MaxLength)));
+            int BoxLength = box_length();
+            int Size = static_cast<int>(Text.size());
+            BeginIndex = Size > BoxLength ? Size - BoxLength : 0;
+            BeginOffset = Size - BeginIndex;
+            print_and_display_cursor();
+            if (OnChange) {
+                OnChange(*this);
+            }
+        }
+
         /**
          * @brief Set the input mode
          *
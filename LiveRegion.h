@@ -0,0 +1,386 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_LIVE_REGION_H
+#define MZ_LIVE_REGION_H
+#pragma once
+
+/**
+ * @file LiveRegion.h
+ * @brief Live status lines rendered inline, below the cursor
+ *
+ * This file provides a small region of rows that a command-line tool
+ * updates in place without taking over the screen: no alternate screen
+ * buffer and no clearing, so the user's scrollback stays intact. Only
+ * relative cursor movement is used, because the absolute row of the
+ * region is not known. Lines logged above the region scroll into the
+ * scrollback as ordinary output.
+ *
+ * The region is sized once, in begin(); it is not redrawn when the
+ * terminal is resized, and a resize that reflows the rows leaves the
+ * relative movement off until the region is ended and begun again.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleCMD.h"
+#include "colors.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <csignal>
+#if defined(MZ_PLATFORM_WINDOWS)
+#include <io.h>
+#endif
+
+namespace mz {
+
+    /**
+     * @class LiveRegion
+     * @brief Rows below the cursor redrawn by difference with the last frame
+     *
+     * Lines are set with set_line() and written by render(), which
+     * rewrites only the rows that changed since the previous render. Between
+     * renders the cursor rests at the start of the region's first row.
+     * Lines are cut to the terminal width so that nothing wraps and the
+     * relative movement stays exact.
+     */
+    class LiveRegion {
+    public:
+        LiveRegion() noexcept {}
+
+        /**
+         * @brief Tear the region down, keeping the last frame on screen
+         */
+        ~LiveRegion() {
+            end();
+        }
+
+        LiveRegion(const LiveRegion&) = delete;
+        LiveRegion& operator=(const LiveRegion&) = delete;
+
+        /**
+         * @brief Reserve rows below the cursor
+         *
+         * The region starts at the beginning of the cursor's line; the
+         * screen scrolls up if the rows do not fit below it. Rows beyond the
+         * terminal height are dropped, since the cursor cannot move up past
+         * the top of the screen. The cursor is hidden while the region is
+         * active; SIGINT and SIGTERM show it again before the program's
+         * previous handlers run.
+         *
+         * @param NumRows Number of rows in the region
+         * @param NumCols Usable width (0: the terminal width)
+         * @return 0 on success, 1 if already active or the size is invalid
+         */
+        int begin(int NumRows, int NumCols = 0) noexcept {
+            if (Active || NumRows <= 0) {
+                return 1;
+            }
+            int Width{ 0 }, Height{ 0 };
+            if (GetConsoleSize(Width, Height)) {
+                if (Height > 0 && NumRows > Height) NumRows = Height;
+            }
+            else {
+                Width = 0;
+            }
+            if (NumCols <= 0) {
+                NumCols = Width > 0 ? Width : 80;
+            }
+
+            Rows = NumRows;
+            Cols = NumCols;
+            Next.assign(Rows, line{});
+            Shown.assign(Rows, line{});
+            Drawn = false;
+            Active = true;
+            catch_signals(true);
+
+            // Newlines scroll the screen if needed; then come back to the first row
+            Out.clear();
+            SetHide(Out);
+            Out.push_back(L'\r');
+            if (Rows > 1) {
+                Out.append(Rows - 1, L'\n');
+                MoveUp(Out, Rows - 1);
+            }
+            mz::Write(Out);
+            fflush(stdout);
+            return 0;
+        }
+
+        /**
+         * @brief Check whether the region is on screen
+         */
+        bool active() const noexcept {
+            return Active;
+        }
+
+        /**
+         * @brief Get the number of rows in the region
+         */
+        int rows() const noexcept {
+            return Rows;
+        }
+
+        /**
+         * @brief Set the text of a row for the next render
+         *
+         * @param Row Row within the region
+         * @param Text Plain text (no escape sequences)
+         * @return true if error (row out of range)
+         */
+        bool set_line(int Row, std::wstring_view Text) {
+            if (Row < 0 || Row >= Rows) {
+                return true;
+            }
+            line& l = Next[Row];
+            l.Text.assign(Text.substr(0, static_cast<size_t>(Cols)));
+            l.Styled = false;
+            return false;
+        }
+
+        /**
+         * @brief Set the text and colors of a row for the next render
+         *
+         * @param Row Row within the region
+         * @param Text Plain text (no escape sequences)
+         * @param Style Colors of the row
+         * @return true if error (row out of range)
+         */
+        bool set_line(int Row, std::wstring_view Text, color Style) {
+            if (set_line(Row, Text)) {
+                return true;
+            }
+            Next[Row].Style = Style;
+            Next[Row].Styled = true;
+            return false;
+        }
+
+        /**
+         * @brief Write the rows that changed since the last render
+         *
+         * @return Number of characters written
+         */
+        size_t render() noexcept {
+            if (!Active) {
+                return 0;
+            }
+            Out.clear();
+            int Cursor{ 0 };
+            for (int r = 0; r < Rows; r++) {
+                if (Drawn && Next[r] == Shown[r]) {
+                    continue;
+                }
+                move_to_row(Out, Cursor, r);
+                append_line(Out, Next[r]);
+                Shown[r] = Next[r];
+            }
+            move_to_row(Out, Cursor, 0);
+            Drawn = true;
+
+            if (!Out.empty()) {
+                mz::Write(Out);
+                fflush(stdout);
+            }
+            return Out.size();
+        }
+
+        /**
+         * @brief Print a line above the region
+         *
+         * The region moves down one row and is drawn again below the new
+         * line; at the bottom of the screen the line scrolls up into the
+         * scrollback like any other output.
+         *
+         * @param Text Line to print
+         */
+        void log(std::wstring_view Text) noexcept {
+            if (!Active) {
+                Out.assign(Text);
+                Out.append(L"\r\n");
+                mz::Write(Out);
+                return;
+            }
+            Out.clear();
+            Out.append(L"\x1b[0J");
+            Out.append(Text);
+            Out.append(L"\r\n");
+
+            // The rows below the log line start out blank
+            if (Rows > 1) {
+                Out.append(Rows - 1, L'\n');
+                MoveUp(Out, Rows - 1);
+            }
+            int Cursor{ 0 };
+            for (int r = 0; r < Rows; r++) {
+                if (Shown[r].Text.empty() && !Shown[r].Styled) {
+                    continue;
+                }
+                move_to_row(Out, Cursor, r);
+                append_line(Out, Shown[r]);
+            }
+            move_to_row(Out, Cursor, 0);
+            mz::Write(Out);
+            fflush(stdout);
+        }
+
+        /**
+         * @brief Release the region
+         *
+         * Safe to call more than once. The cursor is shown again and left
+         * on the line below the region (or where the region began if it
+         * is erased).
+         *
+         * @param Keep true to leave the last frame in place, false to erase it
+         */
+        void end(bool Keep = true) noexcept {
+            if (!Active) {
+                return;
+            }
+            Active = false;
+            catch_signals(false);
+            Out.clear();
+            if (Keep) {
+                if (Rows > 1) MoveDown(Out, Rows - 1);
+                Out.append(L"\r\n");
+            }
+            else {
+                Out.append(L"\r\x1b[0J");
+            }
+            SetShow(Out);
+            mz::Write(Out);
+            fflush(stdout);
+        }
+
+        /**
+         * @brief Run a demo: progress bars with log lines printed above them
+         */
+        static void Test() {
+            LiveRegion Region;
+            if (Region.begin(3)) return;
+            for (int i = 0; i <= 100; i++) {
+                int Filled = i * 30 / 100;
+                Region.set_line(0, std::format(L"download [{:<30}] {:>3}%", std::wstring(Filled, L'#'), i));
+                Region.set_line(1, std::format(L"verify   [{:<30}] {:>3}%", std::wstring(Filled / 2, L'#'), i / 2),
+                    color(color::AQUA, 80));
+                Region.set_line(2, std::format(L"{} of 100 files", i));
+                if (i % 25 == 0) {
+                    Region.log(std::format(L"checkpoint {}", i / 25));
+                }
+                Region.render();
+                std::this_thread::sleep_for(std::chrono::milliseconds(30));
+            }
+            Region.end();
+        }
+
+    private:
+        /**
+         * @brief Contents of one row
+         */
+        struct line {
+            std::wstring Text;
+            color Style;
+            bool Styled{ false };
+
+            bool operator==(line const& Other) const noexcept {
+                return Text == Other.Text && Styled == Other.Styled
+                    && (!Styled || (Style.F == Other.Style.F && Style.B == Other.Style.B));
+            }
+        };
+
+        std::vector<line> Next;     ///< Frame being built
+        std::vector<line> Shown;    ///< Frame on screen
+        std::wstring Out;           ///< Output buffer
+        int Rows{ 0 };
+        int Cols{ 0 };
+        bool Active{ false };
+        bool Drawn{ false };        ///< Shown holds what is on screen
+
+        using signal_handler = void (*)(int);
+        static inline signal_handler PrevInt{ SIG_DFL };   ///< SIGINT handler before begin()
+        static inline signal_handler PrevTerm{ SIG_DFL };  ///< SIGTERM handler before begin()
+        static inline int Catching{ 0 };                   ///< Active regions
+
+        /**
+         * @brief Show the cursor, then hand the signal to the previous handler
+         *
+         * Only write() is used here, as it is safe inside a signal handler.
+         */
+        static void restore_cursor(int Signal) {
+            static constexpr char Show[] = "\x1b[?25h\r\n";
+#if defined(MZ_PLATFORM_WINDOWS)
+            _write(1, Show, sizeof(Show) - 1);
+#else
+            [[maybe_unused]] auto n = ::write(1, Show, sizeof(Show) - 1);
+#endif
+            std::signal(SIGINT, PrevInt);
+            std::signal(SIGTERM, PrevTerm);
+            std::raise(Signal);
+        }
+
+        /**
+         * @brief Install restore_cursor() for the first region, remove it after the last
+         */
+        static void catch_signals(bool On) noexcept {
+            if (On) {
+                if (Catching++ == 0) {
+                    PrevInt = std::signal(SIGINT, restore_cursor);
+                    PrevTerm = std::signal(SIGTERM, restore_cursor);
+                    if (PrevInt == SIG_ERR) PrevInt = SIG_DFL;
+                    if (PrevTerm == SIG_ERR) PrevTerm = SIG_DFL;
+                }
+            }
+            else if (Catching > 0 && --Catching == 0) {
+                std::signal(SIGINT, PrevInt);
+                std::signal(SIGTERM, PrevTerm);
+            }
+        }
+
+        /**
+         * @brief Move from the start of one region row to the start of another
+         */
+        static void move_to_row(std::wstring& Buff, int& Cursor, int Row) {
+            if (Row > Cursor) MoveDown(Buff, Row - Cursor);
+            else if (Row < Cursor) MoveUp(Buff, Cursor - Row);
+            Cursor = Row;
+        }
+
+        /**
+         * @brief Write a row from its first column, erasing what it does not cover
+         */
+        static void append_line(std::wstring& Buff, line const& l) {
+            if (l.Styled) l.Style.apply(Buff);
+            Buff.append(l.Text);
+            Buff.append(L"\x1b[K");
+            if (l.Styled) ResetColor(Buff);
+            Buff.push_back(L'\r');
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_LIVE_REGION_H
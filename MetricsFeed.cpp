@@ -0,0 +1,149 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "MetricsFeed.h"
+#include <iostream>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz::metrics {
+
+#if defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+
+    int mapping::create(std::string const& SegmentName, size_t Bytes) noexcept {
+        close();
+
+        // Start from a fresh, zero-filled object
+        shm_unlink(SegmentName.c_str());
+        int Fd = shm_open(SegmentName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (Fd < 0) {
+            std::cerr << "ERROR: Failed to create metrics segment." << std::endl;
+            return 1;
+        }
+        if (ftruncate(Fd, static_cast<off_t>(Bytes)) != 0) {
+            std::cerr << "ERROR: Failed to size metrics segment." << std::endl;
+            ::close(Fd);
+            shm_unlink(SegmentName.c_str());
+            return 2;
+        }
+        void* Ptr = mmap(nullptr, Bytes, PROT_READ | PROT_WRITE, MAP_SHARED, Fd, 0);
+        ::close(Fd);
+        if (Ptr == MAP_FAILED) {
+            std::cerr << "ERROR: Failed to map metrics segment." << std::endl;
+            shm_unlink(SegmentName.c_str());
+            return 4;
+        }
+
+        Base = Ptr;
+        Size = Bytes;
+        Name = SegmentName;
+        Owner = true;
+        return 0;
+    }
+
+    int mapping::open(std::string const& SegmentName, bool Writable) noexcept {
+        close();
+
+        int Fd = shm_open(SegmentName.c_str(), Writable ? O_RDWR : O_RDONLY, 0);
+        if (Fd < 0) {
+            return 1;
+        }
+        struct stat Info;
+        if (fstat(Fd, &Info) != 0 || static_cast<size_t>(Info.st_size) < sizeof(header)) {
+            ::close(Fd);
+            return 2;
+        }
+        size_t Bytes = static_cast<size_t>(Info.st_size);
+        void* Ptr = mmap(nullptr, Bytes, Writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, Fd, 0);
+        ::close(Fd);
+        if (Ptr == MAP_FAILED) {
+            return 4;
+        }
+
+        // Validate the header before trusting any offsets
+        header* h = static_cast<header*>(Ptr);
+        if (std::atomic_ref<uint32_t>(h->Magic).load(std::memory_order_acquire) != MAGIC
+            || h->Version != VERSION
+            || Bytes < segment_size(h->NumSlots, h->RingSize)
+            || h->RingSize == 0) {
+            munmap(Ptr, Bytes);
+            return 2;
+        }
+
+        Base = Ptr;
+        Size = Bytes;
+        Name = SegmentName;
+        Owner = false;
+        return 0;
+    }
+
+    void mapping::close() noexcept {
+        if (Base) {
+            munmap(Base, Size);
+            if (Owner) {
+                shm_unlink(Name.c_str());
+            }
+        }
+        Base = nullptr;
+        Size = 0;
+        Owner = false;
+    }
+
+#else
+
+    int mapping::create(std::string const&, size_t) noexcept {
+        std::wcerr << L"ERROR: Shared-memory metrics are not supported on this platform." << std::endl;
+        return 1;
+    }
+
+    int mapping::open(std::string const&, bool) noexcept {
+        return 1;
+    }
+
+    void mapping::close() noexcept {
+        Base = nullptr;
+        Size = 0;
+        Owner = false;
+    }
+
+#endif
+
+} // namespace mz::metrics
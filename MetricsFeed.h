@@ -0,0 +1,699 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_METRICS_FEED_H
+#define MZ_METRICS_FEED_H
+#pragma once
+
+/**
+ * @file MetricsFeed.h
+ * @brief Shared-memory metrics feed and widget bindings
+ *
+ * Producers in other processes publish named numeric metrics and short
+ * text events into a shared-memory segment. The dashboard maps the same
+ * segment and reads it directly at frame time: reading a metric is a few
+ * atomic loads, with no system call.
+ *
+ * Segment layout (all offsets 64-byte aligned):
+ * - header: magic, version, table sizes, slots in use, event ring head
+ * - slot table: one seqlock-protected record per metric
+ * - event ring: fixed-size records, each with its own sequence number
+ *
+ * Each slot has a single writer. Events may be posted by any producer.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleCMD.h"
+#include "coord.h"
+#include "FooterBox.h"
+#include "WindowBox.h"
+#include <atomic>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <thread>
+#include <format>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+
+namespace mz {
+
+    namespace metrics {
+
+        constexpr uint32_t MAGIC{ 0x464D5A4D };     ///< "MZMF"
+        constexpr uint32_t VERSION{ 1 };            ///< Layout version
+        constexpr size_t NAME_WORDS{ 4 };           ///< Metric names up to 32 bytes
+        constexpr size_t TEXT_WORDS{ 8 };           ///< Event text up to 64 bytes
+
+        static_assert(std::atomic<uint32_t>::is_always_lock_free);
+        static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+        /**
+         * @brief Segment header
+         */
+        struct alignas(64) header {
+            uint32_t Magic;                     ///< MAGIC once initialised
+            uint32_t Version;                   ///< VERSION
+            uint32_t NumSlots;                  ///< Capacity of the slot table
+            uint32_t RingSize;                  ///< Number of event records
+            std::atomic<uint32_t> SlotsUsed;    ///< Registered slots
+            std::atomic<uint64_t> RingHead;     ///< Events ever posted
+        };
+
+        /**
+         * @brief One metric
+         *
+         * Seq is odd while the writer is updating the record.
+         */
+        struct alignas(64) slot {
+            std::atomic<uint32_t> Seq;              ///< Seqlock counter
+            std::atomic<uint64_t> Value;            ///< Bit pattern of a double
+            std::atomic<uint64_t> Stamp;            ///< Producer time in nanoseconds
+            std::atomic<uint64_t> Name[NAME_WORDS]; ///< NUL-padded UTF-8 name
+        };
+
+        /**
+         * @brief One event in the ring
+         *
+         * Seq is 2*index+1 while being written and 2*index+2 once complete,
+         * so a reader can tell a finished record from one being overwritten.
+         */
+        struct alignas(64) event_record {
+            std::atomic<uint64_t> Seq;              ///< Record sequence
+            std::atomic<uint64_t> Stamp;            ///< Producer time in nanoseconds
+            std::atomic<uint32_t> Slot;             ///< Related slot or UINT32_MAX
+            std::atomic<uint32_t> Level;            ///< Application-defined severity
+            std::atomic<uint64_t> Text[TEXT_WORDS]; ///< NUL-padded UTF-8 text
+        };
+
+        /**
+         * @brief Bytes needed for a segment
+         */
+        constexpr size_t segment_size(uint32_t NumSlots, uint32_t RingSize) noexcept {
+            return sizeof(header) + NumSlots * sizeof(slot) + RingSize * sizeof(event_record);
+        }
+
+        /**
+         * @brief Current time on the clock shared by producers and readers
+         */
+        inline uint64_t now() noexcept {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        /**
+         * @brief Store text into atomic words, truncating and NUL-padding
+         */
+        template <size_t N>
+        void store_text(std::atomic<uint64_t>(&Words)[N], std::string_view Text) noexcept {
+            char Bytes[N * 8]{};
+            std::memcpy(Bytes, Text.data(), Text.size() < sizeof(Bytes) ? Text.size() : sizeof(Bytes));
+            for (size_t i = 0; i < N; i++) {
+                uint64_t w;
+                std::memcpy(&w, Bytes + i * 8, 8);
+                Words[i].store(w, std::memory_order_relaxed);
+            }
+        }
+
+        /**
+         * @brief Load NUL-padded text from atomic words
+         */
+        template <size_t N>
+        std::string load_text(std::atomic<uint64_t> const(&Words)[N]) {
+            char Bytes[N * 8];
+            for (size_t i = 0; i < N; i++) {
+                uint64_t w = Words[i].load(std::memory_order_relaxed);
+                std::memcpy(Bytes + i * 8, &w, 8);
+            }
+            size_t Length{ 0 };
+            while (Length < sizeof(Bytes) && Bytes[Length]) ++Length;
+            return std::string(Bytes, Length);
+        }
+
+        /**
+         * @brief A mapped segment
+         *
+         * Platform code lives in MetricsFeed.cpp.
+         */
+        struct mapping {
+            void* Base{ nullptr };      ///< Start of the mapping
+            size_t Size{ 0 };           ///< Mapped bytes
+            std::string Name;           ///< Shared-memory object name
+            bool Owner{ false };        ///< Remove the object on unmap
+
+            /**
+             * @brief Create (or replace) and map a segment
+             *
+             * @return 0 on success, 1 if the object could not be created,
+             *         2 if it could not be sized, 4 if mapping failed
+             */
+            int create(std::string const& SegmentName, size_t Bytes) noexcept;
+
+            /**
+             * @brief Map an existing segment
+             *
+             * @param Writable Map for writing (producers) or read-only (readers)
+             * @return 0 on success, 1 if the object does not exist,
+             *         2 if it is not a valid segment, 4 if mapping failed
+             */
+            int open(std::string const& SegmentName, bool Writable) noexcept;
+
+            /**
+             * @brief Unmap, and remove the object if this mapping created it
+             */
+            void close() noexcept;
+
+            mapping() noexcept = default;
+            mapping(mapping const&) = delete;
+            mapping& operator=(mapping const&) = delete;
+            ~mapping() noexcept { close(); }
+        };
+    }
+
+    /**
+     * @struct metric_sample
+     * @brief Consistent snapshot of one metric
+     */
+    struct metric_sample {
+        double Value{ 0 };      ///< Metric value
+        uint64_t Stamp{ 0 };    ///< Producer time in nanoseconds
+        uint32_t Version{ 0 };  ///< Seqlock counter at the time of reading
+    };
+
+    /**
+     * @struct metric_event
+     * @brief One event read from the ring
+     */
+    struct metric_event {
+        uint64_t Index{ 0 };    ///< Position in the event stream
+        uint64_t Stamp{ 0 };    ///< Producer time in nanoseconds
+        int Slot{ -1 };         ///< Related metric, or -1
+        int Level{ 0 };         ///< Application-defined severity
+        std::string Text;       ///< Event text (UTF-8)
+    };
+
+    /**
+     * @class MetricsProducer
+     * @brief Writes metrics and events into a segment
+     */
+    class MetricsProducer {
+    private:
+        metrics::mapping Map;   ///< Mapped segment
+
+        metrics::header* head() const noexcept {
+            return static_cast<metrics::header*>(Map.Base);
+        }
+
+        metrics::slot* slots() const noexcept {
+            return reinterpret_cast<metrics::slot*>(static_cast<char*>(Map.Base) + sizeof(metrics::header));
+        }
+
+        metrics::event_record* ring() const noexcept {
+            return reinterpret_cast<metrics::event_record*>(
+                reinterpret_cast<char*>(slots() + head()->NumSlots));
+        }
+
+    public:
+        /**
+         * @brief Create a new segment and become its owner
+         *
+         * The segment is removed when the owner is destroyed; readers that
+         * already mapped it keep a valid view.
+         *
+         * @param Name Shared-memory object name, e.g. "/myapp-metrics"
+         * @param NumSlots Maximum number of metrics
+         * @param RingSize Number of events kept
+         * @return 0 on success, otherwise the error bits of mapping::create
+         */
+        int create(std::string const& Name, int NumSlots = 64, int RingSize = 256) noexcept {
+            NumSlots = NumSlots < 1 ? 1 : NumSlots;
+            RingSize = RingSize < 1 ? 1 : RingSize;
+            if (int Error = Map.create(Name, metrics::segment_size(uint32_t(NumSlots), uint32_t(RingSize)))) {
+                return Error;
+            }
+            // A fresh object is zero-filled; publish the magic last
+            metrics::header* h = head();
+            h->Version = metrics::VERSION;
+            h->NumSlots = uint32_t(NumSlots);
+            h->RingSize = uint32_t(RingSize);
+            std::atomic_thread_fence(std::memory_order_release);
+            std::atomic_ref<uint32_t>(h->Magic).store(metrics::MAGIC, std::memory_order_release);
+            return 0;
+        }
+
+        /**
+         * @brief Attach to a segment created by another producer
+         *
+         * @param Name Shared-memory object name
+         * @return 0 on success, otherwise the error bits of mapping::open
+         */
+        int open(std::string const& Name) noexcept {
+            return Map.open(Name, true);
+        }
+
+        /**
+         * @brief Check whether a segment is mapped
+         */
+        bool connected() const noexcept {
+            return Map.Base != nullptr;
+        }
+
+        /**
+         * @brief Find or register a metric
+         *
+         * @param Name Metric name (truncated to 32 bytes)
+         * @return Slot index, or -1 if the table is full
+         */
+        int slot(std::string_view Name) noexcept {
+            if (!connected()) return -1;
+            metrics::header* h = head();
+            Name = Name.substr(0, metrics::NAME_WORDS * 8);
+
+            uint32_t Used = h->SlotsUsed.load(std::memory_order_acquire);
+            for (uint32_t i = 0; i < Used && i < h->NumSlots; i++) {
+                if (metrics::load_text(slots()[i].Name) == Name) return int(i);
+            }
+
+            uint32_t Index = Used;
+            do {
+                if (Index >= h->NumSlots) return -1;
+            } while (!h->SlotsUsed.compare_exchange_weak(Index, Index + 1, std::memory_order_acq_rel));
+
+            metrics::slot& s = slots()[Index];
+            s.Seq.store(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            metrics::store_text(s.Name, Name);
+            s.Stamp.store(metrics::now(), std::memory_order_relaxed);
+            s.Seq.store(2, std::memory_order_release);
+            return int(Index);
+        }
+
+        /**
+         * @brief Publish a new value
+         *
+         * @param Slot Slot returned by slot()
+         * @param Value New value
+         */
+        void set(int Slot, double Value) noexcept {
+            if (!connected() || Slot < 0 || uint32_t(Slot) >= head()->NumSlots) return;
+            metrics::slot& s = slots()[Slot];
+            uint32_t Seq = s.Seq.load(std::memory_order_relaxed);
+            s.Seq.store(Seq + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            s.Value.store(std::bit_cast<uint64_t>(Value), std::memory_order_relaxed);
+            s.Stamp.store(metrics::now(), std::memory_order_relaxed);
+            s.Seq.store(Seq + 2, std::memory_order_release);
+        }
+
+        /**
+         * @brief Add to the current value (counters)
+         */
+        void add(int Slot, double Delta) noexcept {
+            if (!connected() || Slot < 0 || uint32_t(Slot) >= head()->NumSlots) return;
+            double Current = std::bit_cast<double>(slots()[Slot].Value.load(std::memory_order_relaxed));
+            set(Slot, Current + Delta);
+        }
+
+        /**
+         * @brief Append an event to the ring
+         *
+         * Old events are overwritten once the ring wraps.
+         *
+         * @param Text Event text (truncated to 64 bytes)
+         * @param Slot Related metric, or -1
+         * @param Level Application-defined severity
+         */
+        void post(std::string_view Text, int Slot = -1, int Level = 0) noexcept {
+            if (!connected()) return;
+            metrics::header* h = head();
+            uint64_t Index = h->RingHead.fetch_add(1, std::memory_order_acq_rel);
+            metrics::event_record& e = ring()[Index % h->RingSize];
+            e.Seq.store(2 * Index + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            e.Stamp.store(metrics::now(), std::memory_order_relaxed);
+            e.Slot.store(Slot < 0 ? UINT32_MAX : uint32_t(Slot), std::memory_order_relaxed);
+            e.Level.store(uint32_t(Level), std::memory_order_relaxed);
+            metrics::store_text(e.Text, Text);
+            e.Seq.store(2 * Index + 2, std::memory_order_release);
+        }
+    };
+
+    /**
+     * @class MetricsReader
+     * @brief Reads metrics and events from a segment without system calls
+     */
+    class MetricsReader {
+    private:
+        /**
+         * @brief Attempts at a consistent read before giving up for this frame
+         */
+        static constexpr int MAX_TRIES{ 64 };
+
+        metrics::mapping Map;       ///< Mapped segment
+        uint64_t NextEvent{ 0 };    ///< Next event index to read
+        uint64_t Lost{ 0 };         ///< Events overwritten before they were read
+
+        metrics::header const* head() const noexcept {
+            return static_cast<metrics::header const*>(Map.Base);
+        }
+
+        metrics::slot const* slots() const noexcept {
+            return reinterpret_cast<metrics::slot const*>(static_cast<char const*>(Map.Base) + sizeof(metrics::header));
+        }
+
+        metrics::event_record const* ring() const noexcept {
+            return reinterpret_cast<metrics::event_record const*>(
+                reinterpret_cast<char const*>(slots() + head()->NumSlots));
+        }
+
+        bool valid(int Slot) const noexcept {
+            return Map.Base && Slot >= 0 && uint32_t(Slot) < head()->SlotsUsed.load(std::memory_order_acquire)
+                && uint32_t(Slot) < head()->NumSlots;
+        }
+
+    public:
+        /**
+         * @brief Map a segment read-only
+         *
+         * Only events posted after opening are reported.
+         *
+         * @param Name Shared-memory object name
+         * @return 0 on success, otherwise the error bits of mapping::open
+         */
+        int open(std::string const& Name) noexcept {
+            if (int Error = Map.open(Name, false)) {
+                return Error;
+            }
+            NextEvent = head()->RingHead.load(std::memory_order_acquire);
+            Lost = 0;
+            return 0;
+        }
+
+        /**
+         * @brief Check whether a segment is mapped
+         */
+        bool connected() const noexcept {
+            return Map.Base != nullptr;
+        }
+
+        /**
+         * @brief Number of registered metrics
+         */
+        int num_slots() const noexcept {
+            if (!Map.Base) return 0;
+            uint32_t Used = head()->SlotsUsed.load(std::memory_order_acquire);
+            return int(Used < head()->NumSlots ? Used : head()->NumSlots);
+        }
+
+        /**
+         * @brief Find a metric by name
+         *
+         * @return Slot index, or -1 if not registered (yet)
+         */
+        int find(std::string_view Name) const {
+            for (int i = 0, n = num_slots(); i < n; i++) {
+                if (name(i) == Name) return i;
+            }
+            return -1;
+        }
+
+        /**
+         * @brief Get the name of a metric
+         */
+        std::string name(int Slot) const {
+            if (!valid(Slot)) return {};
+            for (int Tries = 0; Tries < MAX_TRIES; Tries++) {
+                uint32_t Before = slots()[Slot].Seq.load(std::memory_order_acquire);
+                std::string Name = metrics::load_text(slots()[Slot].Name);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (!(Before & 1) && slots()[Slot].Seq.load(std::memory_order_relaxed) == Before) {
+                    return Name;
+                }
+                std::this_thread::yield();
+            }
+            return {};
+        }
+
+        /**
+         * @brief Get the change counter of a metric
+         *
+         * A single atomic load; compare with the Version of an earlier
+         * sample to find out whether the value changed.
+         */
+        uint32_t version(int Slot) const noexcept {
+            return valid(Slot) ? slots()[Slot].Seq.load(std::memory_order_acquire) : 0;
+        }
+
+        /**
+         * @brief Take a consistent snapshot of a metric
+         *
+         * Retries while the producer is in the middle of an update, up to
+         * a limit so a producer that died mid-write cannot stall a frame.
+         *
+         * @param Slot Slot index
+         * @param Out Receives the sample
+         * @return true if error (slot not registered or no stable value)
+         */
+        bool read(int Slot, metric_sample& Out) const noexcept {
+            if (!valid(Slot)) return true;
+            metrics::slot const& s = slots()[Slot];
+            for (int Tries = 0; Tries < MAX_TRIES; Tries++) {
+                uint32_t Before = s.Seq.load(std::memory_order_acquire);
+                if (Before & 1) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                uint64_t Value = s.Value.load(std::memory_order_relaxed);
+                uint64_t Stamp = s.Stamp.load(std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.Seq.load(std::memory_order_relaxed) == Before) {
+                    Out.Value = std::bit_cast<double>(Value);
+                    Out.Stamp = Stamp;
+                    Out.Version = Before;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Read events posted since the previous call
+         *
+         * Events overwritten before they could be read are counted in
+         * events_lost(). A record still being written ends the batch; it
+         * is picked up on the next call.
+         *
+         * @param Out Receives the events (appended)
+         * @return Number of events appended
+         */
+        int events(std::vector<metric_event>& Out) {
+            if (!Map.Base) return 0;
+            metrics::header const* h = head();
+            uint64_t Head = h->RingHead.load(std::memory_order_acquire);
+            if (Head - NextEvent > h->RingSize) {
+                Lost += Head - NextEvent - h->RingSize;
+                NextEvent = Head - h->RingSize;
+            }
+
+            int Count{ 0 };
+            while (NextEvent < Head) {
+                metrics::event_record const& e = ring()[NextEvent % h->RingSize];
+                uint64_t Expected = 2 * NextEvent + 2;
+                uint64_t Before = e.Seq.load(std::memory_order_acquire);
+                if (Before < Expected) {
+                    break;  // still being written
+                }
+                metric_event Event;
+                Event.Index = NextEvent;
+                Event.Stamp = e.Stamp.load(std::memory_order_relaxed);
+                uint32_t Slot = e.Slot.load(std::memory_order_relaxed);
+                Event.Slot = Slot == UINT32_MAX ? -1 : int(Slot);
+                Event.Level = int(e.Level.load(std::memory_order_relaxed));
+                Event.Text = metrics::load_text(e.Text);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (Before != Expected || e.Seq.load(std::memory_order_relaxed) != Expected) {
+                    ++Lost;  // overwritten by a newer event
+                }
+                else {
+                    Out.push_back(std::move(Event));
+                    ++Count;
+                }
+                ++NextEvent;
+            }
+            return Count;
+        }
+
+        /**
+         * @brief Number of events overwritten before they were read
+         */
+        uint64_t events_lost() const noexcept {
+            return Lost;
+        }
+    };
+
+    /**
+     * @class MetricsBindings
+     * @brief Connects metric slots to widgets
+     *
+     * Call refresh() once per frame. Each binding checks its slot's change
+     * counter and redraws its widget only when the value changed since the
+     * previous frame. Bindings refer to metrics by name, so a producer may
+     * register its metrics after the bindings are made. Bound widgets must
+     * outlive the bindings.
+     */
+    class MetricsBindings {
+    private:
+        /**
+         * @brief One metric driving one draw function
+         */
+        struct binding {
+            std::string Name;                   ///< Metric name
+            int Slot{ -1 };                     ///< Resolved slot, or -1
+            uint32_t Seen{ 0 };                 ///< Version last drawn
+            std::function<void(double)> Draw;   ///< Redraw with the new value
+        };
+
+        MetricsReader& Reader;              ///< Source of values
+        std::vector<binding> Bindings;      ///< All bindings
+
+    public:
+        /**
+         * @brief Construct bindings reading from a reader
+         */
+        explicit MetricsBindings(MetricsReader& Reader) noexcept : Reader{ Reader } {}
+
+        /**
+         * @brief Bind a metric to any draw function
+         *
+         * @param Name Metric name
+         * @param Draw Called with the new value when it changes
+         */
+        void bind(std::string_view Name, std::function<void(double)> Draw) {
+            Bindings.push_back(binding{ std::string(Name), -1, 0, std::move(Draw) });
+        }
+
+        /**
+         * @brief Show a metric in a footer as "Label value"
+         */
+        void bind(std::string_view Name, FooterBox& Footer, std::wstring Label) {
+            bind(Name, [&Footer, Label = std::move(Label)](double Value) {
+                Footer.update_status(std::format(L"{}{:.6g}", Label, Value));
+                Footer.refresh();
+                });
+        }
+
+        /**
+         * @brief Drive a progress bar from a metric
+         *
+         * @param Full Metric value that corresponds to 100%
+         */
+        void bind(std::string_view Name, ProgressBarControl& Bar, double Full = 100.0) {
+            bind(Name, [&Bar, Full](double Value) {
+                Bar.update_permille(Full > 0 ? static_cast<int>(Value * 1000.0 / Full) : 0);
+                });
+        }
+
+        /**
+         * @brief Append each new value of a metric to a sparkline
+         */
+        void bind(std::string_view Name, SparklineBox& Chart) {
+            bind(Name, [&Chart](double Value) { Chart.push(Value); });
+        }
+
+        /**
+         * @brief Redraw widgets whose metric changed
+         *
+         * @return Number of widgets redrawn
+         */
+        int refresh() {
+            int Redrawn{ 0 };
+            for (auto& b : Bindings) {
+                if (b.Slot < 0) {
+                    b.Slot = Reader.find(b.Name);
+                    if (b.Slot < 0) continue;
+                }
+                if (Reader.version(b.Slot) == b.Seen) continue;
+
+                metric_sample Sample;
+                if (Reader.read(b.Slot, Sample)) continue;
+                b.Seen = Sample.Version;
+                b.Draw(Sample.Value);
+                ++Redrawn;
+            }
+            return Redrawn;
+        }
+
+        /**
+         * @brief Redraw every bound widget on the next refresh
+         */
+        void invalidate() noexcept {
+            for (auto& b : Bindings) {
+                b.Seen = 0;
+            }
+        }
+
+        /**
+         * @brief Run a demo with an in-process producer
+         *
+         * @param Window Screen area for the test
+         */
+        static void Test(coord_box Window) {
+            std::string Name = std::format("/mz-metrics-test-{}", metrics::now() % 100000);
+            MetricsProducer Producer;
+            if (Producer.create(Name, 8, 32)) return;
+            int Load = Producer.slot("load");
+            int Done = Producer.slot("done");
+
+            MetricsReader Reader;
+            if (Reader.open(Name)) return;
+
+            FooterBox Footer;
+            Footer.create(Window);
+            ProgressBarControl Bar;
+            Bar.create(coord{ short(Window.Top.Row + 1), short(Window.Top.Col + 1) }, 40);
+            SparklineBox Chart;
+            Chart.Color = color(color::AQUA, 80);
+            Chart.create(coord{ short(Window.Top.Row + 3), short(Window.Top.Col + 1) }, 40);
+
+            MetricsBindings View(Reader);
+            View.bind("load", Footer, L"load: ");
+            View.bind("load", Chart);
+            View.bind("done", Bar);
+
+            for (int i = 0; i <= 100; i++) {
+                Producer.set(Load, 50.0 + 40.0 * ((i * 37) % 17) / 17.0);
+                if (i % 2 == 0) Producer.set(Done, i);
+                View.refresh();
+                std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            }
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_METRICS_FEED_H
@@ -0,0 +1,529 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "ParallelFind.h"
+#include "TextEncoding.h"
+#include <filesystem>
+#include <system_error>
+#include <algorithm>
+#include <iostream>
+#include <format>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz {
+
+    namespace {
+
+        /**
+         * @brief Matches gathered by a walker before they are published
+         */
+        constexpr size_t PublishBatch = 64;
+
+#if defined(__linux__)
+        /**
+         * @brief Record returned by getdents64
+         */
+        struct linux_dirent64 {
+            uint64_t d_ino;
+            int64_t d_off;
+            unsigned short d_reclen;
+            unsigned char d_type;
+            char d_name[1];
+        };
+#endif
+
+    } // namespace
+
+    std::wstring widen_path(std::string_view Path) {
+        return from_utf8(Path);
+    }
+
+    ParallelFind::~ParallelFind() noexcept {
+        cancel();
+        wait();
+        close_root();
+    }
+
+    bool ParallelFind::start(std::wstring const& RootPath, find_options SearchOptions) noexcept {
+        cancel();
+        wait();
+        close_root();
+
+        Options = std::move(SearchOptions);
+        Root = RootPath.empty() ? std::wstring(L".") : RootPath;
+        Pattern = to_utf8(Options.Pattern);
+        Glob = Pattern.find_first_of("*?[") != std::string::npos;
+        if (Options.IgnoreCase) {
+            std::transform(Pattern.begin(), Pattern.end(), Pattern.begin(), detail::fold_ascii);
+        }
+
+#if defined(MZ_PLATFORM_WINDOWS) || defined(MZ_PLATFORM_UNKNOWN)
+        std::error_code Ec;
+        if (!std::filesystem::is_directory(std::filesystem::path(Root), Ec)) {
+            return true;
+        }
+#else
+        // A root that does not encode exactly would name some other directory
+        std::string Native;
+        if (encode_utf8(Native, Root)) {
+            return true;
+        }
+        RootFd = ::open(Native.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+        if (RootFd < 0) {
+            return true;
+        }
+        struct stat St;
+        if (fstat(RootFd, &St) != 0) {
+            close_root();
+            return true;
+        }
+        RootDevice = static_cast<uint64_t>(St.st_dev);
+#endif
+
+        Results.clear();
+        NumDirectories = 0;
+        NumEntries = 0;
+        NumMatches = 0;
+        Cancelled = false;
+        Clock.start();
+
+        unsigned n = Options.NumThreads ? Options.NumThreads : std::max(1u, std::thread::hardware_concurrency());
+        Queues.clear();
+        for (unsigned i = 0; i < n; i++) {
+            Queues.push_back(std::make_unique<task_queue>());
+        }
+        Outstanding = 0;
+        push(0, task{ std::string(), 0 });
+
+        Running = n;
+        try {
+            for (unsigned i = 0; i < n; i++) {
+                Threads.emplace_back(&ParallelFind::walk, this, i);
+            }
+        }
+        catch (...) {
+            // Walkers that never started cannot count themselves out
+            cancel();
+            wait();
+            Running = 0;
+            Clock.stop();
+            close_root();
+            return true;
+        }
+        return false;
+    }
+
+    void ParallelFind::cancel() noexcept {
+        Cancelled = true;
+        IdleWake.notify_all();
+    }
+
+    void ParallelFind::wait() noexcept {
+        for (auto& t : Threads) {
+            if (t.joinable()) t.join();
+        }
+        Threads.clear();
+    }
+
+    void ParallelFind::close_root() noexcept {
+#if !defined(MZ_PLATFORM_WINDOWS) && !defined(MZ_PLATFORM_UNKNOWN)
+        if (RootFd >= 0) ::close(RootFd);
+#endif
+        RootFd = -1;
+    }
+
+    void ParallelFind::push(unsigned Self, task&& Task) {
+        Outstanding.fetch_add(1);
+        {
+            std::lock_guard<std::mutex> Guard(Queues[Self]->Lock);
+            Queues[Self]->Tasks.push_back(std::move(Task));
+        }
+        IdleWake.notify_one();
+    }
+
+    bool ParallelFind::pop(unsigned Self, task& Task) {
+        // Own queue from the back: depth first, close to the directory just read
+        {
+            auto& q = *Queues[Self];
+            std::lock_guard<std::mutex> Guard(q.Lock);
+            if (!q.Tasks.empty()) {
+                Task = std::move(q.Tasks.back());
+                q.Tasks.pop_back();
+                return true;
+            }
+        }
+        // Other queues from the front: the oldest entries hold the largest subtrees
+        size_t n = Queues.size();
+        for (size_t i = 1; i < n; i++) {
+            auto& q = *Queues[(Self + i) % n];
+            std::lock_guard<std::mutex> Guard(q.Lock);
+            if (!q.Tasks.empty()) {
+                Task = std::move(q.Tasks.front());
+                q.Tasks.pop_front();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void ParallelFind::walk(unsigned Self) noexcept {
+        std::vector<find_match> Found;
+        task Task;
+        while (!Cancelled.load(std::memory_order_relaxed)) {
+            if (pop(Self, Task)) {
+                read_directory(Self, Task, Found);
+                if (Found.size() >= PublishBatch) {
+                    Results.publish(Found);
+                }
+                if (Outstanding.fetch_sub(1) == 1) {
+                    // Last directory of the tree
+                    IdleWake.notify_all();
+                    break;
+                }
+                continue;
+            }
+            if (Outstanding.load() == 0) break;
+
+            // Matches found so far should not wait for more work
+            Results.publish(Found);
+            std::unique_lock<std::mutex> Guard(IdleLock);
+            IdleWake.wait_for(Guard, std::chrono::milliseconds(2));
+        }
+        Results.publish(Found);
+
+        if (Running.fetch_sub(1) == 1) {
+            Clock.stop();
+        }
+    }
+
+    void ParallelFind::read_directory(unsigned Self, task const& Task, std::vector<find_match>& Found) noexcept {
+        uint64_t Entries{ 0 };
+        std::string Path;
+
+        // Examines one entry; Stat is filled on demand
+        auto visit = [&](auto&& stat_entry, char const* Name, bool Directory, bool Known) {
+            if (Name[0] == '.' && (Name[1] == 0 || (Name[1] == '.' && Name[2] == 0))) return;
+            if (!Options.Hidden && Name[0] == '.') return;
+            ++Entries;
+
+            int64_t Size{ 0 };
+            bool Stated{ false };
+            if (!Known) {
+                Stated = stat_entry(Directory, Size);
+            }
+
+            Path.assign(Task.Path);
+            if (!Path.empty()) Path.push_back('/');
+            Path.append(Name);
+
+            if (matches(Name)) {
+                if (!Directory && !Stated) {
+                    stat_entry(Directory, Size);
+                }
+                Found.push_back(find_match{ Path, Directory ? 0 : Size, Directory });
+                NumMatches.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (Directory && (Options.MaxDepth < 0 || Task.Depth < Options.MaxDepth)) {
+                push(Self, task{ Path, Task.Depth + 1 });
+            }
+        };
+
+#if defined(MZ_PLATFORM_WINDOWS) || defined(MZ_PLATFORM_UNKNOWN)
+        std::error_code Ec;
+        std::filesystem::path Dir;
+        try {
+            Dir = std::filesystem::path(Root) / std::filesystem::path(widen_path(Task.Path));
+        }
+        catch (...) {
+            return;
+        }
+        std::filesystem::directory_iterator It(Dir, std::filesystem::directory_options::skip_permission_denied, Ec);
+        if (Ec) return;
+        NumDirectories.fetch_add(1, std::memory_order_relaxed);
+
+        for (auto End = std::filesystem::directory_iterator(); It != End && !Cancelled.load(std::memory_order_relaxed); It.increment(Ec)) {
+            if (Ec) break;
+            auto const& Entry = *It;
+            std::error_code TypeEc;
+            bool Directory = Entry.is_directory(TypeEc) && !Entry.is_symlink(TypeEc);
+            std::string Name;
+            try {
+                Name = to_utf8(Entry.path().filename().wstring());
+            }
+            catch (...) {
+                continue;       // Name has no wide form
+            }
+            visit([&](bool&, int64_t& Size) {
+                std::error_code SizeEc;
+                Size = static_cast<int64_t>(Entry.file_size(SizeEc));
+                return true;
+                }, Name.c_str(), Directory, true);
+        }
+#else
+        // Relative to the root, never following a link into another tree
+        int Fd = ::openat(RootFd, Task.Path.empty() ? "." : Task.Path.c_str(),
+            O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+        if (Fd < 0) return;
+
+        if (Options.SameFilesystem && Task.Depth > 0) {
+            struct stat St;
+            if (fstat(Fd, &St) != 0 || static_cast<uint64_t>(St.st_dev) != RootDevice) {
+                ::close(Fd);
+                return;
+            }
+        }
+        NumDirectories.fetch_add(1, std::memory_order_relaxed);
+
+        char const* Current{ nullptr };
+        auto stat_entry = [&](bool& Directory, int64_t& Size) {
+            struct stat St;
+            if (fstatat(Fd, Current, &St, AT_SYMLINK_NOFOLLOW) != 0) return false;
+            Directory = S_ISDIR(St.st_mode);
+            Size = static_cast<int64_t>(St.st_size);
+            return true;
+        };
+
+#if defined(__linux__)
+        alignas(linux_dirent64) thread_local char Buf[64 * 1024];
+        while (!Cancelled.load(std::memory_order_relaxed)) {
+            long n = syscall(SYS_getdents64, Fd, Buf, sizeof(Buf));
+            if (n <= 0) break;
+            for (long i = 0; i < n;) {
+                auto Entry = reinterpret_cast<linux_dirent64 const*>(Buf + i);
+                i += Entry->d_reclen;
+                Current = Entry->d_name;
+                visit(stat_entry, Entry->d_name, Entry->d_type == DT_DIR, Entry->d_type != DT_UNKNOWN);
+            }
+        }
+        ::close(Fd);
+#else
+        DIR* Stream = fdopendir(Fd);
+        if (!Stream) {
+            ::close(Fd);
+            return;
+        }
+        while (!Cancelled.load(std::memory_order_relaxed)) {
+            dirent* Entry = readdir(Stream);
+            if (!Entry) break;
+            Current = Entry->d_name;
+            visit(stat_entry, Entry->d_name, Entry->d_type == DT_DIR, Entry->d_type != DT_UNKNOWN);
+        }
+        closedir(Stream);
+#endif
+#endif
+
+        NumEntries.fetch_add(Entries, std::memory_order_relaxed);
+    }
+
+    bool ParallelFind::matches(std::string_view Name) const noexcept {
+        if (Pattern.empty()) return true;
+        if (Glob) return glob_match(Pattern, Name, Options.IgnoreCase);
+        if (!Options.IgnoreCase) return Name.find(Pattern) != std::string_view::npos;
+        return std::search(Name.begin(), Name.end(), Pattern.begin(), Pattern.end(),
+            [](char a, char b) { return detail::fold_ascii(a) == b; }) != Name.end();
+    }
+
+    bool ParallelFind::glob_match(std::string_view Pattern, std::string_view Name, bool IgnoreCase) noexcept {
+        auto same = [IgnoreCase](char a, char b) {
+            return IgnoreCase ? detail::fold_ascii(a) == detail::fold_ascii(b) : a == b;
+        };
+
+        // Matches a [set] at Pattern[p]; sets Next past the closing bracket
+        auto match_set = [&](size_t p, char c, size_t& Next) {
+            size_t i = p + 1;
+            bool Negate = i < Pattern.size() && (Pattern[i] == '!' || Pattern[i] == '^');
+            if (Negate) ++i;
+            bool Found{ false };
+            bool First{ true };
+            for (; i < Pattern.size() && (First || Pattern[i] != ']'); First = false) {
+                char Low = Pattern[i];
+                char High = Low;
+                if (i + 2 < Pattern.size() && Pattern[i + 1] == '-' && Pattern[i + 2] != ']') {
+                    High = Pattern[i + 2];
+                    i += 3;
+                }
+                else {
+                    ++i;
+                }
+                char cl = IgnoreCase ? detail::fold_ascii(c) : c;
+                char lo = IgnoreCase ? detail::fold_ascii(Low) : Low;
+                char hi = IgnoreCase ? detail::fold_ascii(High) : High;
+                if ((c >= Low && c <= High) || (cl >= lo && cl <= hi)) Found = true;
+            }
+            if (i >= Pattern.size()) {
+                // No closing bracket: the '[' is literal
+                Next = p + 1;
+                return c == '[';
+            }
+            Next = i + 1;
+            return Found != Negate;
+        };
+
+        size_t p{ 0 }, n{ 0 };
+        size_t StarP{ std::string_view::npos }, StarN{ 0 };
+        while (n < Name.size()) {
+            if (p < Pattern.size()) {
+                char pc = Pattern[p];
+                if (pc == '*') {
+                    StarP = ++p;
+                    StarN = n;
+                    continue;
+                }
+                size_t Next = p + 1;
+                bool Ok = pc == '?' ? true
+                    : pc == '[' ? match_set(p, Name[n], Next)
+                    : same(pc, Name[n]);
+                if (Ok) {
+                    p = Next;
+                    ++n;
+                    continue;
+                }
+            }
+            // Let the last star take one more character
+            if (StarP == std::string_view::npos) return false;
+            p = StarP;
+            n = ++StarN;
+        }
+        while (p < Pattern.size() && Pattern[p] == '*') ++p;
+        return p == Pattern.size();
+    }
+
+    find_stats ParallelFind::stats() const noexcept {
+        find_stats St;
+        St.Directories = NumDirectories.load();
+        St.Entries = NumEntries.load();
+        St.Matches = NumMatches.load();
+        St.Done = done();
+        St.Seconds = Clock.seconds(St.Done);
+        return St;
+    }
+
+    size_t ParallelFind::stream_to(DirectoryDisplayBox& Box, size_t Max) {
+        std::vector<find_match> Batch;
+        size_t n = take(Batch, Max);
+        if (!n) return 0;
+
+        int From = Box.NumIndexes;
+        std::wstring Line;
+        for (auto const& Match : Batch) {
+            if (Box.NumIndexes >= MaxListed) break;
+            Line = Match.Directory ? std::wstring(L"<DIR>") : FileLengthString(Match.Size, true);
+            if (Line.size() < static_cast<size_t>(Box.LeftColumnSize)) {
+                Line.append(Box.LeftColumnSize - Line.size(), L' ');
+            }
+            Line.append(Match.wide_path());
+            Box.append_item(Line);
+        }
+        Box.draw_appended(From);
+        return n;
+    }
+
+    void ParallelFind::Benchmark(std::wstring const& RootPath, std::wstring const& SearchPattern) {
+        unsigned MaxThreads = std::max(1u, std::thread::hardware_concurrency());
+        std::vector<unsigned> Sizes{ 1 };
+        for (unsigned Threads = 2; Threads < MaxThreads; Threads *= 2) {
+            Sizes.push_back(Threads);
+        }
+        if (MaxThreads > 1) Sizes.push_back(MaxThreads);
+
+        double Baseline{ 0 };
+        bool Warm{ false };
+        for (size_t i = 0; i < Sizes.size(); i++) {
+            ParallelFind Find;
+            find_options Options;
+            Options.Pattern = SearchPattern;
+            Options.NumThreads = Sizes[i];
+            if (Find.start(RootPath, Options)) {
+                std::wcout << L"Cannot open " << RootPath << L"\n";
+                return;
+            }
+            Find.wait();
+            if (!Warm) {
+                // Measure again with the tree in the cache
+                Warm = true;
+                --i;
+                continue;
+            }
+            find_stats St = Find.stats();
+            if (Sizes[i] == 1) Baseline = St.Seconds;
+            std::wcout << std::format(L"{:>3} threads: {:>10} entries {:>8} matches {:>8.1f} ms {:>12.0f} entries/s  x{:.2f}\n",
+                Sizes[i], St.Entries, St.Matches, St.Seconds * 1e3,
+                St.Seconds > 0 ? St.Entries / St.Seconds : 0.0,
+                St.Seconds > 0 ? Baseline / St.Seconds : 0.0);
+        }
+    }
+
+    void ParallelFind::Test(coord_box Window, std::wstring const& RootPath, std::wstring const& SearchPattern) {
+        DirectoryDisplayBox sb;
+        sb.Area = Window.center_box(20, 70);
+        sb.initialize();
+        sb.create();
+        sb.draw_all2();
+
+        ParallelFind Find;
+        find_options Options;
+        Options.Pattern = SearchPattern;
+        if (Find.start(RootPath, Options)) return;
+
+        while (true) {
+            if (wait_key(30)) {
+                int wc = mz::wgetch();
+                switch (wc) {
+                case UPKEY: sb.move_up(); break;
+                case DOWNKEY: sb.move_down(); break;
+                case PAGEUPKEY: sb.page_up(); break;
+                case PAGEDOWNKEY: sb.page_down(); break;
+                case ESCAPEKEY:
+                    if (Find.done()) return;
+                    Find.cancel();
+                    break;
+                default: break;
+                }
+            }
+            Find.stream_to(sb);
+        }
+    }
+
+} // namespace mz
@@ -0,0 +1,419 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_PARALLEL_FIND_H
+#define MZ_PARALLEL_FIND_H
+#pragma once
+
+/**
+ * @file ParallelFind.h
+ * @brief Parallel recursive file search with streaming results
+ *
+ * ParallelFind walks a directory tree on several threads and collects the
+ * entries whose name matches a substring or glob pattern. Each thread keeps
+ * its own queue of directories and steals from the others when it runs dry.
+ * On Linux directories are read with getdents64 and opened with openat
+ * relative to the root directory; entries are typed from the directory
+ * records, with fstatat only where the record does not say. Paths are never
+ * canonicalized. Matches can be taken while the walk runs, e.g. to stream
+ * them into a DirectoryDisplayBox.
+ *
+ * @author Meysam Zare
+ */
+
+#include "DirectoryDisplayBox.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace mz {
+
+    namespace detail {
+
+        /**
+         * @brief Lowercase an ASCII letter, leaving every other byte alone
+         */
+        constexpr char fold_ascii(char c) noexcept {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+        }
+
+        /**
+         * @class result_queue
+         * @brief Results handed from worker threads to the consumer
+         *
+         * Workers publish batches; the consumer takes them in the order they
+         * were published.
+         */
+        template <typename T>
+        class result_queue {
+        private:
+            std::mutex Lock;
+            std::vector<T> Items;   ///< Results not yet taken
+
+        public:
+            /**
+             * @brief Hand a batch over, leaving Found empty
+             */
+            void publish(std::vector<T>& Found) {
+                if (Found.empty()) return;
+                std::lock_guard<std::mutex> Guard(Lock);
+                if (Items.empty()) {
+                    Items.swap(Found);
+                }
+                else {
+                    std::move(Found.begin(), Found.end(), std::back_inserter(Items));
+                    Found.clear();
+                }
+            }
+
+            /**
+             * @brief Move up to Max results to the end of Out
+             *
+             * @return Number of results taken
+             */
+            size_t take(std::vector<T>& Out, size_t Max) {
+                std::lock_guard<std::mutex> Guard(Lock);
+                size_t n = std::min(Max, Items.size());
+                std::move(Items.begin(), Items.begin() + n, std::back_inserter(Out));
+                Items.erase(Items.begin(), Items.begin() + n);
+                return n;
+            }
+
+            /**
+             * @brief Check whether results are waiting to be taken
+             */
+            bool pending() noexcept {
+                std::lock_guard<std::mutex> Guard(Lock);
+                return !Items.empty();
+            }
+
+            /**
+             * @brief Drop the results not yet taken
+             */
+            void clear() noexcept {
+                std::lock_guard<std::mutex> Guard(Lock);
+                Items.clear();
+            }
+        };
+
+        /**
+         * @class run_clock
+         * @brief Running time of a search, frozen by the last worker to finish
+         */
+        class run_clock {
+        private:
+            std::chrono::steady_clock::time_point Started;
+            std::atomic<int64_t> ElapsedNs{ 0 };    ///< Duration, set by stop()
+
+        public:
+            /**
+             * @brief Start timing a new run
+             */
+            void start() noexcept {
+                ElapsedNs = 0;
+                Started = std::chrono::steady_clock::now();
+            }
+
+            /**
+             * @brief Record the duration of the run
+             */
+            void stop() noexcept {
+                ElapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - Started).count();
+            }
+
+            /**
+             * @brief Time since start(), or the recorded duration once Done
+             */
+            double seconds(bool Done) const noexcept {
+                return Done
+                    ? ElapsedNs.load() / 1e9
+                    : std::chrono::duration<double>(std::chrono::steady_clock::now() - Started).count();
+            }
+        };
+
+    } // namespace detail
+
+    /**
+     * @struct find_options
+     * @brief What ParallelFind looks for and how far it goes
+     */
+    struct find_options {
+        std::wstring Pattern;           ///< Substring, or glob if it contains * ? or [
+        int MaxDepth{ -1 };             ///< Deepest directory level to read, root = 0 (-1 for no limit)
+        bool SameFilesystem{ true };    ///< Do not descend into other mounted file systems
+        bool IgnoreCase{ true };        ///< Compare ASCII letters without case
+        bool Hidden{ true };            ///< Include names starting with '.'
+        unsigned NumThreads{ 0 };       ///< Walker threads (0 for the number of hardware threads)
+    };
+
+    /**
+     * @brief Convert a path read from the file system to a wide string
+     *
+     * Paths are taken as UTF-8; bytes that are not valid UTF-8 become
+     * U+FFFD instead of throwing as std::filesystem would.
+     */
+    std::wstring widen_path(std::string_view Path);
+
+    /**
+     * @struct find_match
+     * @brief One entry found by ParallelFind
+     */
+    struct find_match {
+        std::string Path;               ///< Path relative to the root, as the file system names it (UTF-8 on Windows)
+        int64_t Size{ 0 };              ///< Size in bytes (0 for directories)
+        bool Directory{ false };        ///< Entry is a directory
+
+        /**
+         * @brief Get the path as a wide string
+         */
+        std::wstring wide_path() const {
+            return widen_path(Path);
+        }
+    };
+
+    /**
+     * @struct find_stats
+     * @brief Progress of a search
+     */
+    struct find_stats {
+        uint64_t Directories{ 0 };      ///< Directories read
+        uint64_t Entries{ 0 };          ///< Entries examined
+        uint64_t Matches{ 0 };          ///< Entries that matched
+        double Seconds{ 0 };            ///< Time since start, or duration once done
+        bool Done{ false };             ///< Walk finished or was cancelled
+    };
+
+    /**
+     * @class ParallelFind
+     * @brief Multi-threaded recursive search
+     *
+     * @code
+     * ParallelFind Find;
+     * Find.start(L"/data", { L"*.log" });
+     * while (!Find.done() || Find.pending()) {
+     *     if (wait_key(30)) handle_key(wgetch());
+     *     Find.stream_to(List);
+     * }
+     * @endcode
+     */
+    class ParallelFind {
+    private:
+        /**
+         * @brief Directory to read
+         */
+        struct task {
+            std::string Path;           ///< Relative to the root ("" for the root)
+            int Depth{ 0 };             ///< Root = 0
+        };
+
+        /**
+         * @brief Directory queue of one walker
+         */
+        struct task_queue {
+            std::mutex Lock;
+            std::deque<task> Tasks;
+        };
+
+        find_options Options;
+        std::string Pattern;            ///< Pattern as UTF-8, folded if IgnoreCase
+        bool Glob{ false };             ///< Pattern is a glob
+        std::wstring Root;              ///< Root as given
+        int RootFd{ -1 };               ///< Open root directory (POSIX)
+        uint64_t RootDevice{ 0 };       ///< File system of the root
+
+        std::vector<std::unique_ptr<task_queue>> Queues;
+        std::vector<std::thread> Threads;
+        std::atomic<size_t> Outstanding{ 0 };   ///< Directories queued or being read
+        std::atomic<bool> Cancelled{ false };
+        std::atomic<unsigned> Running{ 0 };     ///< Walkers still running
+        std::mutex IdleLock;
+        std::condition_variable IdleWake;       ///< Signals idle walkers that work arrived
+
+        detail::result_queue<find_match> Results;   ///< Matches not yet taken
+
+        std::atomic<uint64_t> NumDirectories{ 0 };
+        std::atomic<uint64_t> NumEntries{ 0 };
+        std::atomic<uint64_t> NumMatches{ 0 };
+        detail::run_clock Clock;                ///< Stopped by the last walker to finish
+
+        /**
+         * @brief Queue a directory on a walker's queue
+         */
+        void push(unsigned Self, task&& Task);
+
+        /**
+         * @brief Take a directory, from the own queue first, then from others
+         */
+        bool pop(unsigned Self, task& Task);
+
+        /**
+         * @brief Walker thread body
+         */
+        void walk(unsigned Self) noexcept;
+
+        /**
+         * @brief Read one directory, queueing its subdirectories
+         */
+        void read_directory(unsigned Self, task const& Task, std::vector<find_match>& Found) noexcept;
+
+        /**
+         * @brief Check a name against the pattern
+         */
+        bool matches(std::string_view Name) const noexcept;
+
+        /**
+         * @brief Release the root directory
+         */
+        void close_root() noexcept;
+
+    public:
+        /**
+         * @brief Most items stream_to() puts in a list
+         *
+         * The list keeps a formatted line per item; matches past this are
+         * still counted.
+         */
+        static constexpr int MaxListed{ 1 << 16 };
+
+        ParallelFind() noexcept = default;
+        ParallelFind(ParallelFind const&) = delete;
+        ParallelFind& operator=(ParallelFind const&) = delete;
+
+        /**
+         * @brief Cancel and wait for the walkers
+         */
+        ~ParallelFind() noexcept;
+
+        /**
+         * @brief Start a search, cancelling any search in progress
+         *
+         * @param RootPath Directory to search
+         * @param SearchOptions Pattern and limits
+         * @return true if the root cannot be opened as a directory
+         */
+        bool start(std::wstring const& RootPath, find_options SearchOptions) noexcept;
+
+        /**
+         * @brief Stop the search; walkers finish the directory they are reading
+         */
+        void cancel() noexcept;
+
+        /**
+         * @brief Wait for the walkers to finish
+         */
+        void wait() noexcept;
+
+        /**
+         * @brief Check whether the walk has finished
+         */
+        bool done() const noexcept {
+            return Running.load() == 0;
+        }
+
+        /**
+         * @brief Check whether matches are waiting to be taken
+         */
+        bool pending() noexcept {
+            return Results.pending();
+        }
+
+        /**
+         * @brief Take the matches found since the last call
+         *
+         * @param Out Receives up to Max matches, appended in the order found
+         * @param Max Largest number of matches to take
+         * @return Number of matches taken
+         */
+        size_t take(std::vector<find_match>& Out, size_t Max = SIZE_MAX) {
+            return Results.take(Out, Max);
+        }
+
+        /**
+         * @brief Get the progress of the search
+         */
+        find_stats stats() const noexcept;
+
+        /**
+         * @brief Append new matches to a list box and draw them
+         *
+         * Each item shows the size, or <DIR>, in the left column and the
+         * relative path after it. Does not wait for matches.
+         *
+         * @param Box List that is already on screen
+         * @param Max Largest number of matches to append in this call
+         * @return Number of matches taken
+         */
+        size_t stream_to(DirectoryDisplayBox& Box, size_t Max = 1024);
+
+        /**
+         * @brief Match a name against a glob pattern
+         *
+         * Supports *, ? and [set] with ranges and ! or ^ for negation.
+         * Characters are compared byte by byte.
+         *
+         * @param Pattern Glob pattern
+         * @param Name Name to check
+         * @param IgnoreCase Compare ASCII letters without case
+         * @return true if the whole name matches
+         */
+        static bool glob_match(std::string_view Pattern, std::string_view Name, bool IgnoreCase) noexcept;
+
+        /**
+         * @brief Measure walking speed on 1 to N threads
+         *
+         * Searches the same tree with growing numbers of walkers and prints
+         * entries per second for each. The first run also warms the cache.
+         *
+         * @param RootPath Directory to search
+         * @param SearchPattern Pattern to look for
+         */
+        static void Benchmark(std::wstring const& RootPath, std::wstring const& SearchPattern);
+
+        /**
+         * @brief Run a test search into a list
+         *
+         * Matches are added while the arrow and page keys move through the
+         * list. Escape cancels the search, or leaves once it has stopped.
+         *
+         * @param Window Screen area for the test
+         * @param RootPath Directory to search
+         * @param SearchPattern Pattern to look for
+         */
+        static void Test(coord_box Window, std::wstring const& RootPath, std::wstring const& SearchPattern);
+    };
+
+} // namespace mz
+
+#endif // MZ_PARALLEL_FIND_H
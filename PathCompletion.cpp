@@ -0,0 +1,140 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "PathCompletion.h"
+#include <filesystem>
+#include <system_error>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz {
+
+    bool list_directory(std::wstring const& Dir, std::vector<path_trie::entry>& Out) noexcept {
+        Out.clear();
+        std::error_code Ec;
+        std::filesystem::path Path;
+        try {
+            Path = Dir.empty() ? std::wstring(L".") : Dir;
+        }
+        catch (...) {
+            return true;        // Not representable as a native path
+        }
+        std::filesystem::directory_iterator It(Path, std::filesystem::directory_options::skip_permission_denied, Ec);
+        if (Ec) return true;
+
+        for (auto End = std::filesystem::directory_iterator(); It != End; It.increment(Ec)) {
+            if (Ec) return true;
+            std::error_code TypeEc;
+            // Uses the type from the directory entry where the system provides it
+            bool Directory = It->is_directory(TypeEc);
+            std::wstring Name;
+            try {
+                Name = It->path().filename().wstring();
+            }
+            catch (...) {
+                continue;       // Name has no wide form, so it cannot be completed
+            }
+            Out.push_back(path_trie::entry{ std::move(Name), Directory && !TypeEc });
+        }
+        return false;
+    }
+
+    namespace detail {
+
+#if defined(__linux__)
+
+        directory_watch::directory_watch() noexcept {
+            Fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        }
+
+        directory_watch::~directory_watch() noexcept {
+            if (Fd >= 0) ::close(Fd);
+        }
+
+        int directory_watch::add(std::wstring const& Dir) noexcept {
+            if (Fd < 0) return -1;
+            try {
+                std::filesystem::path Path(Dir.empty() ? std::wstring(L".") : Dir);
+                int Id = inotify_add_watch(Fd, Path.c_str(),
+                    IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_ONLYDIR);
+                // Aliases of one directory (links, "a" and "a/.") share an id
+                if (Id >= 0) Uses[Id]++;
+                return Id;
+            }
+            catch (...) {
+                return -1;
+            }
+        }
+
+        void directory_watch::remove(int Id) noexcept {
+            if (Fd < 0 || Id < 0) return;
+            auto it = Uses.find(Id);
+            if (it == Uses.end() || --it->second > 0) return;
+            Uses.erase(it);
+            inotify_rm_watch(Fd, Id);
+        }
+
+        void directory_watch::changed(std::vector<int>& Ids) noexcept {
+            if (Fd < 0) return;
+            alignas(inotify_event) char Buf[4096];
+            while (true) {
+                ssize_t n = read(Fd, Buf, sizeof(Buf));
+                if (n <= 0) return;     // EAGAIN: nothing more queued
+                for (ssize_t i = 0; i < n;) {
+                    auto Event = reinterpret_cast<inotify_event const*>(Buf + i);
+                    if (std::find(Ids.begin(), Ids.end(), Event->wd) == Ids.end()) {
+                        Ids.push_back(Event->wd);
+                    }
+                    i += static_cast<ssize_t>(sizeof(inotify_event) + Event->len);
+                }
+            }
+        }
+
+#else
+
+        // No change notification: listings expire instead
+        directory_watch::directory_watch() noexcept {}
+        directory_watch::~directory_watch() noexcept {}
+        int directory_watch::add(std::wstring const&) noexcept { return -1; }
+        void directory_watch::remove(int) noexcept {}
+        void directory_watch::changed(std::vector<int>&) noexcept {}
+
+#endif
+
+    } // namespace detail
+
+} // namespace mz
@@ -0,0 +1,770 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_PATH_COMPLETION_H
+#define MZ_PATH_COMPLETION_H
+#pragma once
+
+/**
+ * @file PathCompletion.h
+ * @brief Shell-like Tab completion of paths in input fields
+ *
+ * Directory listings are read in the background as soon as the user types a
+ * separator, and stored as a compact sorted trie in which every node knows
+ * the range of names below it. Completing a prefix and cycling through its
+ * candidates then cost O(prefix length). Listings are cached and dropped
+ * when inotify reports a change in the directory; on systems without
+ * inotify they expire after a few seconds.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleBoxes.h"
+#include "InputControl.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <algorithm>
+#include <numeric>
+#include <chrono>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @class path_trie
+     * @brief Sorted names of a directory, indexed by prefix
+     *
+     * A path-compressed trie over a sorted array: each node covers a range
+     * of names sharing its first Depth characters, and children are split on
+     * the next character. A prefix therefore maps to a contiguous range of
+     * the array, and the longest common extension of that range is known.
+     */
+    class path_trie {
+    public:
+        /**
+         * @brief One directory entry
+         */
+        struct entry {
+            std::wstring Name;          ///< File name without directory
+            bool Directory{ false };    ///< Entry is a directory (or a link to one)
+        };
+
+        /**
+         * @brief Names that start with a prefix
+         */
+        struct match {
+            uint32_t First{ 0 };    ///< First matching name
+            uint32_t Last{ 0 };     ///< One past the last matching name
+            uint32_t Common{ 0 };   ///< Length shared by all matching names
+
+            bool empty() const noexcept { return First == Last; }
+            uint32_t size() const noexcept { return Last - First; }
+        };
+
+    private:
+        /**
+         * @brief Trie node covering a range of names
+         */
+        struct node {
+            uint32_t First{ 0 };        ///< First name below the node
+            uint32_t Last{ 0 };         ///< One past the last name below the node
+            uint32_t Depth{ 0 };        ///< Characters shared by all names below
+            uint32_t Children{ 0 };     ///< First child in Edges
+            uint32_t NumChildren{ 0 };  ///< Number of children
+        };
+
+        /**
+         * @brief Edge to a child, labeled with the character after Depth
+         */
+        struct edge {
+            wchar_t Label{ 0 };
+            uint32_t Node{ 0 };
+        };
+
+        std::vector<entry> Entries;     ///< Entries sorted by name
+        std::vector<node> Nodes;        ///< Node 0 is the root
+        std::vector<edge> Edges;        ///< Children of each node, sorted by label
+
+        /**
+         * @brief Length of the common prefix of two names
+         */
+        static uint32_t common_length(std::wstring_view a, std::wstring_view b) noexcept {
+            size_t n = std::min(a.size(), b.size());
+            size_t i = 0;
+            while (i < n && a[i] == b[i]) ++i;
+            return static_cast<uint32_t>(i);
+        }
+
+        /**
+         * @brief Build the node for a range of names
+         *
+         * @return Index of the node
+         */
+        uint32_t build(uint32_t First, uint32_t Last) {
+            // Sorted, so the first and last names share the least
+            uint32_t Depth = common_length(Entries[First].Name, Entries[Last - 1].Name);
+            uint32_t Index = static_cast<uint32_t>(Nodes.size());
+            Nodes.push_back(node{ First, Last, Depth, 0, 0 });
+
+            // A name equal to the shared prefix sorts first and has no child
+            uint32_t i = First;
+            if (Entries[i].Name.size() == Depth) ++i;
+
+            std::vector<std::pair<uint32_t, uint32_t>> Groups;
+            while (i < Last) {
+                wchar_t Label = Entries[i].Name[Depth];
+                uint32_t j = i + 1;
+                while (j < Last && Entries[j].Name[Depth] == Label) ++j;
+                Groups.emplace_back(i, j);
+                i = j;
+            }
+
+            uint32_t Children = static_cast<uint32_t>(Edges.size());
+            Edges.resize(Edges.size() + Groups.size());
+            Nodes[Index].Children = Children;
+            Nodes[Index].NumChildren = static_cast<uint32_t>(Groups.size());
+            for (size_t g = 0; g < Groups.size(); g++) {
+                wchar_t Label = Entries[Groups[g].first].Name[Depth];
+                uint32_t Child = build(Groups[g].first, Groups[g].second);
+                Edges[Children + g] = edge{ Label, Child };
+            }
+            return Index;
+        }
+
+    public:
+        /**
+         * @brief Replace the contents with a directory listing
+         */
+        void assign(std::vector<entry> NewEntries) {
+            Entries = std::move(NewEntries);
+            std::sort(Entries.begin(), Entries.end(), [](entry const& a, entry const& b) {
+                return a.Name < b.Name;
+                });
+            Entries.erase(std::unique(Entries.begin(), Entries.end(), [](entry const& a, entry const& b) {
+                return a.Name == b.Name;
+                }), Entries.end());
+            Nodes.clear();
+            Edges.clear();
+            if (!Entries.empty()) {
+                build(0, static_cast<uint32_t>(Entries.size()));
+            }
+        }
+
+        /**
+         * @brief Find the names that start with a prefix
+         *
+         * Walks one node per branching point and compares each character
+         * of the prefix once.
+         */
+        match find(std::wstring_view Prefix) const noexcept {
+            if (Nodes.empty()) return {};
+            uint32_t Index{ 0 };
+            size_t Matched{ 0 };
+            while (true) {
+                node const& N = Nodes[Index];
+                std::wstring_view Name = Entries[N.First].Name;
+                size_t Upto = std::min<size_t>(Prefix.size(), N.Depth);
+                for (size_t i = Matched; i < Upto; i++) {
+                    if (Name[i] != Prefix[i]) return {};
+                }
+                if (Prefix.size() <= N.Depth) {
+                    return match{ N.First, N.Last, N.Depth };
+                }
+
+                // Pick the child for the next character
+                auto Begin = Edges.begin() + N.Children;
+                auto End = Begin + N.NumChildren;
+                auto It = std::lower_bound(Begin, End, Prefix[N.Depth], [](edge const& e, wchar_t c) {
+                    return e.Label < c;
+                    });
+                if (It == End || It->Label != Prefix[N.Depth]) return {};
+                Index = It->Node;
+                Matched = N.Depth + 1;
+            }
+        }
+
+        /**
+         * @brief Number of names
+         */
+        size_t size() const noexcept {
+            return Entries.size();
+        }
+
+        /**
+         * @brief Get a name by position in sorted order
+         */
+        std::wstring_view name(size_t i) const noexcept {
+            return Entries[i].Name;
+        }
+
+        /**
+         * @brief Check whether a name is a directory
+         */
+        bool is_directory(size_t i) const noexcept {
+            return Entries[i].Directory;
+        }
+    };
+
+    /**
+     * @brief Read the entries of a directory
+     *
+     * @param Dir Directory to list ("" for the current directory)
+     * @param Out Receives the entries, in directory order
+     * @return true if the directory could not be read
+     */
+    bool list_directory(std::wstring const& Dir, std::vector<path_trie::entry>& Out) noexcept;
+
+    namespace detail {
+
+        /**
+         * @class directory_watch
+         * @brief Change notification for a set of directories
+         *
+         * Uses inotify on Linux; elsewhere add() fails and callers fall back
+         * to expiring entries.
+         */
+        class directory_watch {
+        private:
+            int Fd{ -1 };
+            std::unordered_map<int, int> Uses;      ///< Listings sharing each watch id
+
+        public:
+            directory_watch() noexcept;
+            ~directory_watch() noexcept;
+            directory_watch(directory_watch const&) = delete;
+            directory_watch& operator=(directory_watch const&) = delete;
+
+            /**
+             * @brief Watch a directory for added, removed and renamed entries
+             *
+             * @return Watch id, or -1 if the directory cannot be watched
+             */
+            int add(std::wstring const& Dir) noexcept;
+
+            /**
+             * @brief Release a watch; it stops once every add() of it is released
+             */
+            void remove(int Id) noexcept;
+
+            /**
+             * @brief Collect the ids of watches that saw changes, without blocking
+             *
+             * An id of -1 means the event queue overflowed.
+             */
+            void changed(std::vector<int>& Ids) noexcept;
+        };
+
+    } // namespace detail
+
+    /**
+     * @class DirectoryCache
+     * @brief Background directory listing with a bounded cache
+     *
+     * A worker thread lists requested directories into path tries. The
+     * worker owns the shared state, so a listing stuck on a slow mount
+     * holds up neither the input loop nor the destruction of the cache.
+     */
+    class DirectoryCache {
+    private:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @brief Cached listing of one directory
+         */
+        struct listing {
+            std::shared_ptr<path_trie const> Trie;  ///< Entries (null while loading)
+            int Watch{ -1 };                        ///< Watch id, -1 if not watched
+            clock::time_point When;                 ///< When the listing was read
+            uint64_t Used{ 0 };                     ///< Last use, for eviction
+            bool Loading{ false };                  ///< Queued or being read
+            bool Redo{ false };                     ///< Changed while being read
+        };
+
+        /**
+         * @brief State shared with the worker
+         */
+        struct shared_state {
+            std::mutex Lock;
+            std::condition_variable Wake;       ///< Signals the worker
+            std::condition_variable Loaded;     ///< Signals that a listing finished
+            std::unordered_map<std::wstring, listing> Listings;
+            std::deque<std::wstring> Queue;     ///< Directories to read
+            detail::directory_watch Watch;
+            std::vector<int> Changed;           ///< Scratch for Watch.changed()
+            size_t Capacity{ 64 };
+            std::chrono::milliseconds Life{ 3000 };
+            uint64_t Uses{ 0 };
+            bool Stopping{ false };
+
+            /**
+             * @brief Drop listings of changed directories (Lock held)
+             */
+            void drain() noexcept {
+                Changed.clear();
+                Watch.changed(Changed);
+                for (int Id : Changed) {
+                    // Id -1 means events were lost, so every listing is suspect
+                    for (auto it = Listings.begin(); it != Listings.end();) {
+                        if (Id != -1 && it->second.Watch != Id) {
+                            ++it;
+                        }
+                        else if (it->second.Loading) {
+                            it->second.Redo = true;
+                            ++it;
+                        }
+                        else {
+                            if (it->second.Watch >= 0) Watch.remove(it->second.Watch);
+                            it = Listings.erase(it);
+                        }
+                    }
+                }
+            }
+
+            /**
+             * @brief Evict the least recently used listings (Lock held)
+             */
+            void evict() noexcept {
+                while (Listings.size() > Capacity) {
+                    auto Oldest = Listings.end();
+                    for (auto it = Listings.begin(); it != Listings.end(); ++it) {
+                        if (!it->second.Loading && (Oldest == Listings.end() || it->second.Used < Oldest->second.Used)) {
+                            Oldest = it;
+                        }
+                    }
+                    if (Oldest == Listings.end()) return;
+                    if (Oldest->second.Watch >= 0) Watch.remove(Oldest->second.Watch);
+                    Listings.erase(Oldest);
+                }
+            }
+
+            /**
+             * @brief Get a usable listing (Lock held)
+             */
+            std::shared_ptr<path_trie const> usable(std::wstring const& Dir) noexcept {
+                auto it = Listings.find(Dir);
+                if (it == Listings.end() || it->second.Loading) return nullptr;
+                if (it->second.Watch < 0 && clock::now() - it->second.When > Life) return nullptr;
+                it->second.Used = ++Uses;
+                return it->second.Trie;
+            }
+        };
+
+        std::shared_ptr<shared_state> State;
+
+        /**
+         * @brief Worker thread body
+         */
+        static void work(std::shared_ptr<shared_state> S) noexcept {
+            std::unique_lock<std::mutex> Guard(S->Lock);
+            while (true) {
+                S->Wake.wait(Guard, [&] { return S->Stopping || !S->Queue.empty(); });
+                if (S->Stopping) return;
+
+                std::wstring Dir = std::move(S->Queue.front());
+                S->Queue.pop_front();
+                auto it = S->Listings.find(Dir);
+                if (it == S->Listings.end() || !it->second.Loading) continue;
+
+                // Watch first, so changes made while reading are not missed
+                if (it->second.Watch < 0) {
+                    it->second.Watch = S->Watch.add(Dir);
+                }
+                it->second.Redo = false;
+
+                Guard.unlock();
+                std::vector<path_trie::entry> Entries;
+                list_directory(Dir, Entries);
+                auto Trie = std::make_shared<path_trie>();
+                Trie->assign(std::move(Entries));
+                Guard.lock();
+
+                S->drain();
+                it = S->Listings.find(Dir);
+                if (it == S->Listings.end()) continue;
+                if (it->second.Redo) {
+                    S->Queue.push_back(Dir);
+                    continue;
+                }
+                it->second.Trie = std::move(Trie);
+                it->second.When = clock::now();
+                it->second.Loading = false;
+                S->Loaded.notify_all();
+            }
+        }
+
+    public:
+        /**
+         * @brief Start the cache and its worker thread
+         *
+         * @param Capacity Number of directories to keep
+         */
+        explicit DirectoryCache(size_t Capacity = 64) : State{ std::make_shared<shared_state>() } {
+            State->Capacity = Capacity;
+            std::thread(work, State).detach();
+        }
+
+        DirectoryCache(DirectoryCache const&) = delete;
+        DirectoryCache& operator=(DirectoryCache const&) = delete;
+
+        /**
+         * @brief Stop the worker without waiting for a listing in progress
+         */
+        ~DirectoryCache() noexcept {
+            {
+                std::lock_guard<std::mutex> Guard(State->Lock);
+                State->Stopping = true;
+            }
+            State->Wake.notify_all();
+        }
+
+        /**
+         * @brief Start reading a directory unless a current listing exists
+         */
+        void prefetch(std::wstring const& Dir) {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            State->drain();
+            auto it = State->Listings.find(Dir);
+            if (it != State->Listings.end() && (it->second.Loading || State->usable(Dir))) {
+                return;
+            }
+            listing& L = State->Listings[Dir];
+            L.Loading = true;
+            L.Used = ++State->Uses;
+            State->Queue.push_back(Dir);
+            State->evict();
+            State->Wake.notify_one();
+        }
+
+        /**
+         * @brief Get a listing if one is ready, without waiting
+         */
+        std::shared_ptr<path_trie const> find(std::wstring const& Dir) {
+            std::lock_guard<std::mutex> Guard(State->Lock);
+            State->drain();
+            return State->usable(Dir);
+        }
+
+        /**
+         * @brief Get a listing, reading it if needed
+         *
+         * @param Dir Directory to list
+         * @param Timeout Longest wait for the worker
+         * @return The listing, or null if it was not ready in time
+         */
+        std::shared_ptr<path_trie const> get(std::wstring const& Dir, std::chrono::milliseconds Timeout) {
+            prefetch(Dir);
+            std::unique_lock<std::mutex> Guard(State->Lock);
+            std::shared_ptr<path_trie const> Trie;
+            State->Loaded.wait_for(Guard, Timeout, [&] {
+                return (Trie = State->usable(Dir)) != nullptr;
+                });
+            return Trie;
+        }
+
+        /**
+         * @brief Get a cache shared by the whole process
+         */
+        static DirectoryCache& shared() {
+            static DirectoryCache Cache;
+            return Cache;
+        }
+    };
+
+    /**
+     * @class CompletionPopup
+     * @brief Virtualized list of completion candidates
+     *
+     * Only the rows that fit in the area are composed, so the cost of a
+     * redraw does not depend on the number of candidates. print() writes
+     * the rows composed by the last set() or select().
+     */
+    class CompletionPopup : public BasicBox {
+    private:
+        std::shared_ptr<path_trie const> Trie;  ///< Names shown
+        path_trie::match Range;                 ///< Candidates within Trie
+        uint32_t Top{ 0 };                      ///< First visible candidate
+        uint32_t Selected{ 0 };                 ///< Highlighted candidate
+
+        /**
+         * @brief Compose the visible rows into the buffer
+         */
+        void compose() {
+            std::wstring& Out = bf;
+            Out.clear();
+            if (!Trie) return;
+            size_t Width = static_cast<size_t>(Area.num_cols());
+            for (int r = 0; r < Area.num_rows(); r++) {
+                Area.Top.offset(r, 0).apply(Out);
+                uint32_t i = Top + static_cast<uint32_t>(r);
+                if (i == Selected && i < Range.size()) {
+                    Color.apply_mirror(Out);
+                }
+                else {
+                    Color.apply(Out);
+                }
+
+                std::wstring_view Name;
+                bool Directory{ false };
+                if (i < Range.size()) {
+                    Name = Trie->name(Range.First + i);
+                    Directory = Trie->is_directory(Range.First + i);
+                }
+                size_t Used = std::min(Name.size(), Width);
+                Out.append(Name.substr(0, Used));
+                if (Directory && Used < Width) {
+                    Out.push_back(L'/');
+                    ++Used;
+                }
+                Out.append(Width - Used, L' ');
+            }
+        }
+
+    public:
+        /**
+         * @brief Show a range of candidates
+         */
+        void set(std::shared_ptr<path_trie const> Names, path_trie::match Candidates) {
+            Trie = std::move(Names);
+            Range = Candidates;
+            Top = 0;
+            Selected = 0;
+            compose();
+        }
+
+        /**
+         * @brief Highlight a candidate, scrolling it into view
+         *
+         * @param Index Candidate index within the range
+         */
+        void select(uint32_t Index) {
+            uint32_t Rows = static_cast<uint32_t>(std::max(1, Area.num_rows()));
+            Selected = Index;
+            if (Selected < Top) Top = Selected;
+            if (Selected >= Top + Rows) Top = Selected - Rows + 1;
+            compose();
+        }
+
+        /**
+         * @brief Blank the popup area
+         */
+        void clear() noexcept {
+            std::wstring Out;
+            Color.apply(Out);
+            for (int r = 0; r < Area.num_rows(); r++) {
+                Area.Top.offset(r, 0).apply(Out);
+                Out.append(static_cast<size_t>(Area.num_cols()), L' ');
+            }
+            mz::Write(Out);
+        }
+    };
+
+    /**
+     * @class PathCompleter
+     * @brief Tab completion for an InputControl holding a path
+     *
+     * Tab extends the path to the longest unambiguous name; when nothing
+     * can be added, repeated Tab cycles through the candidates in a popup.
+     * Any other key closes the popup and is handled as usual.
+     *
+     * @code
+     * PathCompleter Completer;
+     * Completer.Popup.Area = ...;
+     * Completer.OnClose = [&] { MsgBox.print(); };
+     * Name.OnKey = [&](InputControl& In, int Key) { return Completer.on_key(In, Key); };
+     * Name.OnChange = [&](InputControl& In) { Completer.on_change(In); };
+     * @endcode
+     */
+    class PathCompleter {
+    private:
+        DirectoryCache& Cache;                  ///< Source of listings
+        std::shared_ptr<path_trie const> Trie;  ///< Listing being cycled
+        path_trie::match Candidates;            ///< Names being cycled
+        std::wstring Dir;                       ///< Directory part being cycled
+        uint32_t Cycle{ 0 };                    ///< Current candidate
+        bool Cycling{ false };                  ///< Popup is open
+        bool Editing{ false };                  ///< The completer itself changes the text
+
+        /**
+         * @brief Check for a path separator
+         */
+        static bool is_separator(wchar_t c) noexcept {
+#if defined(_WIN32)
+            return c == L'/' || c == L'\\';
+#else
+            return c == L'/';
+#endif
+        }
+
+        /**
+         * @brief Length of the directory part of a path, separator included
+         */
+        static size_t directory_length(std::wstring_view Path) noexcept {
+            size_t n = Path.size();
+            while (n > 0 && !is_separator(Path[n - 1])) --n;
+            return n;
+        }
+
+        /**
+         * @brief Set the field text without closing the popup
+         */
+        void edit(InputControl& In, std::wstring_view Text) {
+            Editing = true;
+            In.edit_text(Text);
+            Editing = false;
+        }
+
+        /**
+         * @brief Text for a candidate: directory part, name and a separator for directories
+         */
+        std::wstring candidate_text(size_t Index) const {
+            std::wstring Out = Dir;
+            Out.append(Trie->name(Index));
+            if (Trie->is_directory(Index)) Out.push_back(L'/');
+            return Out;
+        }
+
+    public:
+        /**
+         * @brief Popup showing the candidates while cycling
+         */
+        CompletionPopup Popup;
+
+        /**
+         * @brief Longest wait for a listing that was not prefetched
+         */
+        std::chrono::milliseconds ListTimeout{ 150 };
+
+        /**
+         * @brief Called after the popup is closed, to redraw what it covered
+         */
+        std::function<void()> OnClose;
+
+        /**
+         * @brief Construct a completer
+         *
+         * @param Listings Cache to read listings from
+         */
+        explicit PathCompleter(DirectoryCache& Listings = DirectoryCache::shared()) noexcept : Cache{ Listings } {}
+
+        /**
+         * @brief Prefetch the directory of the text in the field
+         */
+        void prefetch(std::wstring_view Path) {
+            Cache.prefetch(std::wstring(Path.substr(0, directory_length(Path))));
+        }
+
+        /**
+         * @brief Handle a change of the field text
+         *
+         * A separator at the end starts reading that directory.
+         */
+        void on_change(InputControl& In) {
+            if (!Editing && Cycling) {
+                close();
+                In.display_cursor();
+            }
+            if (!In.Text.empty() && is_separator(In.Text.back())) {
+                prefetch(In.Text);
+            }
+        }
+
+        /**
+         * @brief Handle a key
+         *
+         * @return true if the key was Tab and has been consumed
+         */
+        bool on_key(InputControl& In, int Key) {
+            if (Key != TABKEY) {
+                if (Cycling) {
+                    close();
+                    In.display_cursor();
+                }
+                return false;
+            }
+
+            // Repeated Tab moves to the next candidate
+            if (Cycling) {
+                Cycle = (Cycle + 1) % Candidates.size();
+                Popup.select(Cycle);
+                Popup.print();
+                edit(In, candidate_text(Candidates.First + Cycle));
+                return true;
+            }
+
+            std::wstring_view Path = In.Text;
+            size_t DirLength = directory_length(Path);
+            Dir.assign(Path.substr(0, DirLength));
+            std::wstring_view Prefix = Path.substr(DirLength);
+
+            Trie = Cache.get(Dir, ListTimeout);
+            if (!Trie) return true;     // Still reading; the next Tab will find it
+
+            Candidates = Trie->find(Prefix);
+            if (Candidates.empty()) return true;
+
+            if (Candidates.size() == 1) {
+                edit(In, candidate_text(Candidates.First));
+                return true;
+            }
+            if (Candidates.Common > Prefix.size()) {
+                std::wstring Text = Dir;
+                Text.append(Trie->name(Candidates.First).substr(0, Candidates.Common));
+                edit(In, Text);
+                return true;
+            }
+
+            // Nothing to add: list the candidates and start cycling
+            Cycling = true;
+            Cycle = 0;
+            Popup.set(Trie, Candidates);
+            Popup.select(0);
+            Popup.print();
+            edit(In, candidate_text(Candidates.First));
+            return true;
+        }
+
+        /**
+         * @brief Close the popup if it is open
+         *
+         * Moves the terminal cursor; the field should redraw its cursor.
+         */
+        void close() {
+            if (!Cycling) return;
+            Cycling = false;
+            Popup.clear();
+            if (OnClose) OnClose();
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_PATH_COMPLETION_H
@@ -40,7 +40,12 @@
 #include "FrameBox.h"
 #include "FileInfo.h"
 #include "InputControl.h"
+#include "AsyncValidator.h"
+#include "TokenValidation.h"
+#include "PathCompletion.h"
 #include <string_view>
+#include <vector>
+#include <chrono>
 
 namespace mz {
 
@@ -51,8 +56,95 @@ namespace mz {
      * This class provides a complete UI component for entering and validating
      * file or directory paths. It includes an input field, validation logic,
      * and feedback messages in a styled frame.
+     *
+     * The path is checked while the user types, on a worker thread, and a
+     * square after the field shows the result: yellow while checking, green
+     * when the path is acceptable and red otherwise. A slow file system
+     * only delays the square, never the keystrokes. Tab completes the
+     * path from directory listings read in the background.
      */
     class PathEntryControl : public mz::FrameBox {
+    private:
+        /**
+         * @brief Indicator states
+         */
+        enum class indicator { none, checking, valid, invalid };
+
+        /**
+         * @brief Checks paths in the background
+         *
+         * The check does not depend on ChooseFile, so cached results stay
+         * valid when the mode changes: 0 for a directory, WRONG_KIND for
+         * anything else (with SPECIAL if it is not a regular file either)
+         * and MISSING if the path does not exist.
+         */
+        AsyncValidator Checker{ [](std::wstring_view Path) { return path_error(Path, true); } };
+
+        /**
+         * @brief Map a check result to a display_message() error code
+         */
+        int error_code(int CheckResult) const noexcept {
+            if (CheckResult & token_error::MISSING) return 1;
+            if (CheckResult & token_error::SPECIAL) return 3;
+            bool IsDirectory = CheckResult == 0;
+            return IsDirectory == ChooseFile ? 2 : 0;
+        }
+
+        /**
+         * @brief Draw the indicator after the input field
+         *
+         * Saves and restores the cursor, so editing continues undisturbed.
+         */
+        void draw_indicator(indicator State) {
+            std::wstring Out;
+            SavePos(Out);
+            Name.Area.Bottom.offset(0, 1).apply(Out);
+            Color.apply(Out);
+            switch (State) {
+            case indicator::checking: mz::color::YELLOW.setFront(Out); break;
+            case indicator::valid: mz::color::GREEN.setFront(Out); break;
+            case indicator::invalid: mz::color::RED.setFront(Out); break;
+            default: break;
+            }
+            if (State == indicator::none) {
+                Out.push_back(L' ');
+            }
+            else {
+                Out.append(FSQUARE, 2);
+            }
+            LoadPos(Out);
+            mz::Write(Out);
+        }
+
+        /**
+         * @brief Start checking the current text
+         */
+        void request_check() {
+            if (Name.Text.empty()) {
+                Checker.cancel();
+                draw_indicator(indicator::none);
+                return;
+            }
+            Checker.request(Name.Text);
+            int Result{ 0 };
+            if (Checker.get(Result) == AsyncValidator::status::ready) {
+                draw_indicator(error_code(Result) ? indicator::invalid : indicator::valid);
+            }
+            else {
+                draw_indicator(indicator::checking);
+            }
+        }
+
+        /**
+         * @brief Show a result that arrived while the user was idle
+         */
+        void show_result() {
+            int Result{ 0 };
+            if (Checker.poll(Result)) {
+                draw_indicator(error_code(Result) ? indicator::invalid : indicator::valid);
+            }
+        }
+
     public:
         /**
          * @brief File information about the entered path
@@ -76,6 +168,11 @@ namespace mz {
          */
         mz::MultilineMessageBox MsgBox;
 
+        /**
+         * @brief Tab completion for the path field
+         */
+        mz::PathCompleter Completer;
+
         /**
          * @brief Path type selector
          *
@@ -105,6 +202,15 @@ namespace mz {
 
             // Set overall dialog dimensions
             Area.set_size(mz::coord{ 8, 50 });
+
+            // Check and complete as the user types
+            Name.OnChange = [this](InputControl& In) {
+                Completer.on_change(In);
+                request_check();
+            };
+            Name.OnIdle = [this](InputControl&) { show_result(); };
+            Name.OnKey = [this](InputControl& In, int Key) { return Completer.on_key(In, Key); };
+            Completer.OnClose = [this] { MsgBox.print(); };
         }
 
         /**
@@ -134,6 +240,10 @@ namespace mz {
             MsgBox.Area = Area.top_left_child(mz::coord{ 2, 45 }).shift(mz::coord{ 4, 2 });
             MsgBox.clear();
 
+            // Candidates are listed in the rows below the path field
+            Completer.Popup.Area = Area.top_left_child(mz::coord{ 4, 45 }).shift(mz::coord{ 3, 2 });
+            Completer.Popup.Color = Color;
+
             // Set initial footer message
             Footer.update_status(L"Press ESC to cancel");
         }
@@ -141,54 +251,73 @@ namespace mz {
         /**
          * @brief Validate path and display appropriate messages
          *
-         * Checks if the entered path exists and is of the correct type
-         * (file or directory). Displays validation feedback messages.
+         * Checks the path again, ignoring cached results, and waits for
+         * the check; Escape abandons the wait. Other keys pressed while
+         * waiting are kept for the input that follows. Displays validation
+         * feedback messages.
          *
-         * @return Error code: 0=valid, 1=invalid path, 2=wrong type, 3=not file/dir
+         * @return Error code: 0=valid, 1=invalid path, 2=wrong type,
+         *         3=neither a file nor a directory, 4=check abandoned
          */
         int display_message() noexcept {
             int ErrorCode = 0;
-
-            // Create a FileInfo object from the entered path
-            PathInfo = mz::FileInfo{ Name.Text };
             MsgBox.clear();
 
-            // Check if path exists
-            if (PathInfo.m_size < 0 || !PathInfo.exists()) {
-                MsgBox.insert_line(L"Invalid path.", mz::color::RED);
-                ErrorCode = 1;
-            }
-            // Path is a file but we wanted a directory
-            else if (PathInfo.isFile()) {
-                if (!ChooseFile) {
-                    MsgBox.insert_line(L"The specified path is a file.", mz::color::RED);
-                    ErrorCode = 2;
+            // The path may have changed since it was last checked
+            Checker.check_now(Name.Text);
+            int Result{ 0 };
+            if (!Checker.wait_for(std::chrono::milliseconds(0), Result)) {
+                draw_indicator(indicator::checking);
+                Footer.update_status(L"Checking path... ESC to stop");
+                Footer.print();
+                std::vector<key_event> Typed;
+                bool Abandoned{ false };
+                while (!Checker.wait_for(std::chrono::milliseconds(50), Result)) {
+                    if (!key_pending()) {
+                        continue;
+                    }
+                    key_event Event = read_key();
+                    if (Event.Action != key_action::release && Event.legacy_key() == mz::ESCAPEKEY) {
+                        Abandoned = true;
+                        break;
+                    }
+                    Typed.push_back(Event);
                 }
-            }
-            // Path is a directory but we wanted a file
-            else if (PathInfo.isDirectory()) {
-                if (ChooseFile) {
-                    MsgBox.insert_line(L"The specified path is a directory.", mz::color::RED);
-                    ErrorCode = 2;
+                for (key_event const& Event : Typed) {
+                    unread_key(Event);
                 }
-            }
-            // Path is neither a file nor a directory
-            else {
-                if (ChooseFile) {
-                    MsgBox.insert_line(L"The specified path is not a file.", mz::color::RED);
-                    ErrorCode = 3;
+                if (Abandoned) {
+                    Checker.cancel();
+                    draw_indicator(indicator::none);
                 }
-                else {
-                    MsgBox.insert_line(L"The specified path is not a directory.", mz::color::RED);
-                    ErrorCode = 3;
+                Footer.update_status(L"Press ESC to cancel");
+                Footer.print();
+                if (Abandoned) {
+                    return 4;
                 }
             }
+            ErrorCode = error_code(Result);
+            draw_indicator(ErrorCode ? indicator::invalid : indicator::valid);
+
+            if (ErrorCode == 1) {
+                MsgBox.insert_line(L"Invalid path.", mz::color::RED);
+            }
+            else if (ErrorCode == 2) {
+                MsgBox.insert_line(ChooseFile ? L"The specified path is a directory." : L"The specified path is a file.",
+                    mz::color::RED);
+            }
+            else if (ErrorCode == 3) {
+                MsgBox.insert_line(ChooseFile ? L"The specified path is not a file." : L"The specified path is not a directory.",
+                    mz::color::RED);
+            }
 
             // Show additional message if there's an error
             if (ErrorCode) {
                 MsgBox.insert_line(L"Press ESC to cancel or any key to continue.", mz::color::RED);
             }
             else {
+                // Reads the metadata on this thread, so a slow file system stalls here too
+                PathInfo = mz::FileInfo{ Name.Text };
                 Name.print(Color, 0);
             }
 
@@ -212,13 +341,20 @@ namespace mz {
             mz::Write(bf);
             Footer.print();
             Name.print();
+            request_check();
+            Completer.prefetch(Name.Text);
 
             while (true) {
                 // Get path input
-                if (Name.get(Color, 0)) {
+                bool Entered = Name.get(Color, 0);
+                Completer.close();
+                if (Entered) {
                     // Validate input
                     int ErrorCode = display_message();
 
+                    if (ErrorCode == 4) {
+                        continue;  // Check abandoned, keep editing
+                    }
                     if (ErrorCode) {
                         // Show error and wait for user decision
                         Name.print(Color, 0);
@@ -294,6 +430,16 @@ namespace mz {
         void set_file_mode(bool fileMode) noexcept {
             ChooseFile = fileMode;
         }
+
+        /**
+         * @brief Forget cached check results
+         *
+         * Call after the file system changed in a way the user should see
+         * at once, e.g. after creating the entered directory.
+         */
+        void refresh_checks() noexcept {
+            Checker.clear_cache();
+        }
     };
 
 } // namespace mz
@@ -0,0 +1,252 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "PtyHarness.h"
+#include "LoginControl.h"
+#include "DirectoryDisplayBox.h"
+#include "TokenEntryControl.h"
+#include "FrameDelta.h"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+#include <cerrno>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#include <util.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#include <pty.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz {
+
+    using namespace std::chrono_literals;
+
+    PtyHarness::PtyHarness(int NumRows, int NumCols) noexcept : Screen(NumRows, NumCols) {}
+
+#if defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+
+    int PtyHarness::run(std::function<void()> const& Program,
+        std::vector<pty_step> const& Script,
+        std::chrono::milliseconds Settle,
+        std::chrono::milliseconds Timeout) noexcept {
+        using clock = std::chrono::steady_clock;
+
+        Report = pty_report{};
+        Screen.resize(Screen.rows(), Screen.cols());
+
+        struct winsize ws {};
+        ws.ws_row = static_cast<unsigned short>(Screen.rows());
+        ws.ws_col = static_cast<unsigned short>(Screen.cols());
+
+        int Master{ -1 };
+        pid_t Child = forkpty(&Master, nullptr, nullptr, &ws);
+        if (Child < 0) {
+            std::cerr << "ERROR: Failed to create pseudo-terminal." << std::endl;
+            return 1;
+        }
+        if (Child == 0) {
+            // Child: run the program with the pty as its terminal
+            Program();
+            fflush(stdout);
+            _exit(0);
+        }
+
+        const auto Start = clock::now();
+        const auto Deadline = Start + Timeout;
+        bool Closed{ false };
+        bool AwaitingOutput{ false };
+        clock::time_point SentAt;
+        clock::duration Idle{};
+        char Buffer[16384];
+
+        // Drain child output until Until, or until nothing arrives for
+        // QuietFor when that is non-zero
+        auto pump = [&](clock::time_point Until, std::chrono::milliseconds QuietFor) {
+            auto LastOutput = clock::now();
+            while (!Closed) {
+                auto Now = clock::now();
+                if (Now >= Deadline) {
+                    Report.TimedOut = true;
+                    return;
+                }
+                auto Limit = std::min(Until, Deadline);
+                if (QuietFor.count() > 0) {
+                    Limit = std::min(Limit, LastOutput + QuietFor);
+                }
+                if (Now >= Limit) return;
+
+                pollfd pfd{ Master, POLLIN, 0 };
+                int Wait = int(std::chrono::ceil<std::chrono::milliseconds>(Limit - Now).count());
+                int Ready = poll(&pfd, 1, Wait);
+                if (Ready == 0) {
+                    // A scripted wait that ended with nothing to read
+                    Idle += clock::now() - Now;
+                    continue;
+                }
+                if (Ready < 0) continue;
+
+                ssize_t n = read(Master, Buffer, sizeof(Buffer));
+                if (n < 0 && (errno == EINTR || errno == EAGAIN)) continue;
+                if (n <= 0) {
+                    // EIO once the child has closed its side
+                    Closed = true;
+                    return;
+                }
+                LastOutput = clock::now();
+                if (AwaitingOutput) {
+                    Report.Latencies.push_back(
+                        std::chrono::duration<double, std::milli>(LastOutput - SentAt).count());
+                    AwaitingOutput = false;
+                }
+                Report.BytesRead += uint64_t(n);
+                Screen.feed(std::string_view(Buffer, size_t(n)));
+
+                // Answer queries the way a real terminal would
+                if (std::string Reply = Screen.take_replies(); !Reply.empty()) {
+                    (void)!write(Master, Reply.data(), Reply.size());
+                }
+            }
+        };
+
+        auto check = [&](std::string const& Expect) {
+            if (!Expect.empty() && !Screen.contains(Expect)) {
+                Report.Failures.push_back(Expect);
+            }
+        };
+
+        std::string const* Pending{ nullptr };
+        for (auto const& Step : Script) {
+            pump(clock::now() + Step.Delay, 0ms);
+            if (Pending) check(*Pending);
+            Pending = &Step.Expect;
+            if (Closed || Report.TimedOut) break;
+
+            if (!Step.Keys.empty()) {
+                SentAt = clock::now();
+                AwaitingOutput = true;
+                (void)!write(Master, Step.Keys.data(), Step.Keys.size());
+            }
+        }
+        pump(Deadline, Settle);
+        if (Pending) check(*Pending);
+
+        // Reap the child, terminating demos that loop forever
+        int Status{ 0 };
+        if (waitpid(Child, &Status, WNOHANG) == 0) {
+            kill(Child, SIGTERM);
+            std::this_thread::sleep_for(20ms);
+            if (waitpid(Child, &Status, WNOHANG) == 0) {
+                kill(Child, SIGKILL);
+                waitpid(Child, &Status, 0);
+            }
+        }
+        Report.ExitStatus = WIFEXITED(Status) ? WEXITSTATUS(Status) : -1;
+        close(Master);
+
+        Report.Seconds = std::chrono::duration<double>(clock::now() - Start).count();
+        Report.ActiveSeconds = std::max(0.0, Report.Seconds - std::chrono::duration<double>(Idle).count());
+        if (Report.ActiveSeconds > 0) {
+            Report.Throughput = double(Report.BytesRead) / Report.ActiveSeconds;
+        }
+        if (!Report.Latencies.empty()) {
+            std::vector<double> Sorted = Report.Latencies;
+            std::sort(Sorted.begin(), Sorted.end());
+            Report.LatencyP50 = Sorted[Sorted.size() / 2];
+            Report.LatencyP95 = Sorted[std::min(Sorted.size() - 1, Sorted.size() * 95 / 100)];
+            Report.LatencyMax = Sorted.back();
+        }
+
+        int error = 0;
+        if (Report.TimedOut) error += 2;
+        if (!Report.Failures.empty()) error += 4;
+        return error;
+    }
+
+#else
+
+    int PtyHarness::run(std::function<void()> const&,
+        std::vector<pty_step> const&,
+        std::chrono::milliseconds,
+        std::chrono::milliseconds) noexcept {
+        // Pseudo-terminals are not available on this platform
+        Report = pty_report{};
+        std::wcerr << L"ERROR: Pseudo-terminals are not supported on this platform." << std::endl;
+        return 1;
+    }
+
+#endif
+
+    void PtyHarness::Test(coord_box Window) noexcept {
+        coord Size = Window.get_size();
+        PtyHarness Harness(Size.Row, Size.Col);
+
+        struct scenario {
+            const wchar_t* Name;
+            std::function<void()> Program;
+            std::vector<pty_step> Script;
+        };
+
+        std::vector<scenario> Scenarios{
+            { L"LoginControl", [Window] { LoginControl::Test(Window); }, {
+                { 150ms, "", "username:" },
+                { 20ms, "alice1A\r", "password:" },
+                { 20ms, "wrong\r", "Incorrect username and/or password." },
+                { 20ms, "\x1b\x1b", "" } } },
+            { L"DirectoryDisplayBox", [Window] { DirectoryDisplayBox::Test(Window); }, {
+                { 150ms, "", "HELLO" } } },
+            { L"TokenEntryControl", [Window] { TokenEntryControl::Test(Window); }, {
+                { 150ms, "", "username:" },
+                { 20ms, "abcdef\r", "must contain at least 1 number." },
+                { 20ms, "abcD1234\r", "" } } },
+        };
+
+        for (auto& s : Scenarios) {
+            int err = Harness.run(s.Program, s.Script);
+            pty_report const& r = Harness.report();
+            mz::Write(std::format(L"{:<20} {:<4} {:>8} bytes {:>8.2f} KiB/s  p50 {:>6.2f} ms  p95 {:>6.2f} ms  max {:>6.2f} ms\n",
+                s.Name, err ? L"FAIL" : L"PASS", r.BytesRead, r.Throughput / 1024.0,
+                r.LatencyP50, r.LatencyP95, r.LatencyMax));
+            for (auto const& f : r.Failures) {
+                mz::Write(std::format(L"    missing on screen: {}\n", std::wstring(f.begin(), f.end())));
+            }
+        }
+        mz::Write(std::format(L"{:<20} {:<4}\n", L"FrameDelta", frame::round_trip_check() ? L"FAIL" : L"PASS"));
+    }
+
+} // namespace mz
@@ -0,0 +1,164 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_PTY_HARNESS_H
+#define MZ_PTY_HARNESS_H
+#pragma once
+
+/**
+ * @file PtyHarness.h
+ * @brief Scripted end-to-end driver for interactive controls
+ *
+ * This file provides a harness that runs a control's demo routine in a child
+ * process attached to a pseudo-terminal, types scripted keystrokes into it
+ * with controlled timing, and feeds everything the child draws into a
+ * VirtualTerminal. Screen contents can then be checked after each step and
+ * the run reports output throughput and keystroke-to-output latency.
+ *
+ * Pseudo-terminals are only available on Unix-like systems; on other
+ * platforms run() reports an error without starting anything.
+ *
+ * @author Meysam Zare
+ */
+
+#include "coord.h"
+#include "VirtualTerminal.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @struct pty_step
+     * @brief One scripted interaction with the program under test
+     */
+    struct pty_step {
+        std::chrono::milliseconds Delay{ 50 };  ///< Time to let output settle before typing
+        std::string Keys;                       ///< Raw bytes to type
+        std::string Expect;                     ///< Text that must be on screen once output settles
+    };
+
+    /**
+     * @struct pty_report
+     * @brief Measurements collected from a harness run
+     */
+    struct pty_report {
+        uint64_t BytesRead{ 0 };            ///< Output bytes produced by the child
+        double Seconds{ 0 };                ///< Wall-clock duration of the run
+        double ActiveSeconds{ 0 };          ///< Seconds minus the scripted waits that saw no output
+        double Throughput{ 0 };             ///< Output bytes per active second
+        std::vector<double> Latencies;      ///< Keystroke to first output byte, in ms
+        double LatencyP50{ 0 };             ///< Median keystroke latency in ms
+        double LatencyP95{ 0 };             ///< 95th percentile keystroke latency in ms
+        double LatencyMax{ 0 };             ///< Worst keystroke latency in ms
+        int ExitStatus{ -1 };               ///< Child exit status, -1 if it was killed
+        bool TimedOut{ false };             ///< True if the run hit its timeout
+        std::vector<std::string> Failures;  ///< Expectations that did not hold
+    };
+
+    /**
+     * @class PtyHarness
+     * @brief Runs a program on a pseudo-terminal under scripted input
+     *
+     * Typical use:
+     * @code
+     * PtyHarness h(30, 100);
+     * h.run([] { LoginControl::Test(coord_box{ {0,0}, {29,99} }); },
+     *       { { 100ms, "alice1A\r", "password:" }, { 50ms, "Secret9\r" } });
+     * bool ok = h.report().Failures.empty();
+     * @endcode
+     */
+    class PtyHarness {
+    private:
+        /**
+         * @brief Emulated screen the child draws into
+         */
+        VirtualTerminal Screen;
+
+        /**
+         * @brief Results of the most recent run
+         */
+        pty_report Report;
+
+    public:
+        /**
+         * @brief Construct a harness with the given pseudo-terminal size
+         *
+         * @param NumRows Number of terminal rows
+         * @param NumCols Number of terminal columns
+         */
+        explicit PtyHarness(int NumRows = 24, int NumCols = 80) noexcept;
+
+        /**
+         * @brief Run a program under a scripted keystroke sequence
+         *
+         * The program runs in a forked child whose standard streams are the
+         * slave side of a new pseudo-terminal. Before each step the harness
+         * keeps draining output for the step's Delay, then checks the previous
+         * step's expectation and types the step's keys. After the last step it
+         * waits for output to stay quiet for Settle, then terminates the child
+         * if it has not exited on its own.
+         *
+         * @param Program Routine to run in the child (e.g. a control's Test)
+         * @param Script Keystrokes to type, in order
+         * @param Settle Quiet period that ends the run
+         * @param Timeout Upper bound on the whole run
+         * @return 0 on success, 1 if the pseudo-terminal could not be created,
+         *         2 if the run timed out, 4 if an expectation failed
+         */
+        int run(std::function<void()> const& Program,
+            std::vector<pty_step> const& Script,
+            std::chrono::milliseconds Settle = std::chrono::milliseconds(200),
+            std::chrono::milliseconds Timeout = std::chrono::milliseconds(10000)) noexcept;
+
+        /**
+         * @brief Get the emulated screen after the last run
+         */
+        VirtualTerminal const& screen() const noexcept { return Screen; }
+
+        /**
+         * @brief Get the measurements of the last run
+         */
+        pty_report const& report() const noexcept { return Report; }
+
+        /**
+         * @brief Drive the login, directory and token entry demos
+         *
+         * Runs LoginControl::Test, DirectoryDisplayBox::Test and
+         * TokenEntryControl::Test under scripted input and prints a pass/fail
+         * line with throughput and latency figures for each, followed by
+         * the frame encoder/decoder round-trip check.
+         *
+         * @param Window Screen area handed to each demo
+         */
+        static void Test(coord_box Window) noexcept;
+    };
+
+} // namespace mz
+
+#endif // MZ_PTY_HARNESS_H
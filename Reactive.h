@@ -0,0 +1,472 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_REACTIVE_H
+#define MZ_REACTIVE_H
+#pragma once
+
+/**
+ * @file Reactive.h
+ * @brief Signals, computed values and effects for binding widgets to a model
+ *
+ * This file provides reactive primitives for screens whose displayed values
+ * derive from shared model state. An observable (a signal) holds a model
+ * value; a computed derives a value from observables and other computeds;
+ * an effect pushes values into widgets. Dependencies are recorded
+ * automatically while a computed or effect runs.
+ *
+ * Setting a signal only marks what depends on it. Effects run together in
+ * reactive_graph::flush(), normally once per frame from EventLoop. Before
+ * an effect runs, its sources are brought up to date depth first, so every
+ * node sees a consistent snapshot, recomputes at most once per change and
+ * is skipped entirely when none of its sources changed value.
+ *
+ * @code
+ * observable<int> Selected{ 0 };
+ * observable<int> Total{ 0 };
+ * computed<std::wstring> Label{ [&] { return std::format(L"{} of {}", Selected.get(), Total.get()); } };
+ * effect ShowLabel{ [&] { Footer.set_field("selection", Label.get()); Footer.flush_fields(); } };
+ *
+ * Selected.set(3);    // nothing is drawn yet
+ * Total.set(40);
+ * reactive().flush(); // Label recomputes once, the footer is written once
+ * @endcode
+ *
+ * Nodes are not thread-safe; change signals on the thread that flushes.
+ *
+ * @author Meysam Zare
+ */
+
+#include <concepts>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <algorithm>
+
+namespace mz {
+
+    class reactive_graph;
+    inline reactive_graph& reactive();
+
+    /**
+     * @class reactive_node
+     * @brief Common part of signals, computeds and effects
+     *
+     * Keeps the dependency edges in both directions and the epochs used to
+     * decide whether a node must be recomputed. Nodes link to each other by
+     * address, so they can be neither copied nor moved.
+     */
+    class reactive_node {
+        friend class reactive_graph;
+
+    public:
+        reactive_node(const reactive_node&) = delete;
+        reactive_node& operator=(const reactive_node&) = delete;
+
+    protected:
+        /**
+         * @brief Kind of node, which decides how it takes part in a flush
+         */
+        enum class node_kind : uint8_t {
+            source,     ///< signal: changes only through set()
+            derived,    ///< computed: recomputed on demand
+            sink        ///< effect: queued for the next flush
+        };
+
+        explicit reactive_node(reactive_graph& Graph, node_kind Kind) noexcept : Graph{ Graph }, Kind{ Kind } {}
+        inline ~reactive_node();
+
+        /**
+         * @brief Recompute the value
+         *
+         * @return true if the value changed
+         */
+        virtual bool recompute() = 0;
+
+        /**
+         * @brief Record this node as a source of the node being computed
+         */
+        inline void track() const;
+
+        /**
+         * @brief Bring the value up to date, recomputing only if a source changed
+         */
+        inline void refresh() const;
+
+        /**
+         * @brief Queue the node for the next flush
+         */
+        inline void enqueue() const;
+
+        /**
+         * @brief Announce a new value of a source node
+         */
+        inline void changed() const;
+
+        reactive_graph& Graph;
+        node_kind Kind;
+
+    private:
+        mutable std::vector<reactive_node const*> Sources;      ///< Nodes read by the last computation
+        mutable std::vector<reactive_node const*> Dependents;   ///< Nodes that read this one
+        mutable uint64_t Changed{ 0 };      ///< Epoch of the last change of value
+        mutable uint64_t ComputedAt{ 0 };   ///< Epoch of the last computation
+        mutable uint64_t Verified{ 0 };     ///< Epoch at which the value was last known to be current
+        mutable bool Computed{ false };     ///< At least one computation happened
+        mutable bool Pending{ false };      ///< Marked by a change and not yet refreshed
+        mutable bool Computing{ false };    ///< Guards against dependency cycles
+    };
+
+    /**
+     * @class reactive_graph
+     * @brief Change epochs, the current observer and the queue of effects
+     *
+     * One graph usually serves the whole program (see reactive()).
+     */
+    class reactive_graph {
+        friend class reactive_node;
+
+    public:
+        /**
+         * @brief Called when the first change after a flush arrives
+         *
+         * Typically requests a frame, e.g. EventLoop::bind() sets it to
+         * EventLoop::invalidate().
+         */
+        std::function<void()> OnSchedule;
+
+        /**
+         * @brief Check whether effects are waiting for flush()
+         */
+        bool pending() const noexcept {
+            return !Queue.empty();
+        }
+
+        /**
+         * @brief Run every effect whose sources changed since it last ran
+         *
+         * Effects run in the order they were first marked. An effect that
+         * sets a signal queues the dependents of that signal in the same
+         * flush.
+         *
+         * @return Number of effects that ran
+         */
+        int flush() {
+            Scheduled = false;
+            int Ran{ 0 };
+            while (!Queue.empty()) {
+                reactive_node const* Node = Queue.front();
+                Queue.pop_front();
+                if (!Node) continue;
+                uint64_t Before = Node->ComputedAt;
+                Node->refresh();
+                if (Node->ComputedAt != Before) ++Ran;
+            }
+            return Ran;
+        }
+
+        /**
+         * @brief Current change epoch; advances with every signal change
+         */
+        uint64_t epoch() const noexcept {
+            return Epoch;
+        }
+
+    private:
+        std::deque<reactive_node const*> Queue;     ///< Effects to refresh on flush
+        reactive_node const* Observer{ nullptr };   ///< Node whose computation is running
+        uint64_t Epoch{ 1 };
+        bool Scheduled{ false };
+
+        /**
+         * @brief Record a new value of a signal and mark everything downstream
+         */
+        void changed(reactive_node const& Source) {
+            ++Epoch;
+            Source.Changed = Source.ComputedAt = Source.Verified = Epoch;
+            mark(Source);
+            schedule();
+        }
+
+        /**
+         * @brief Mark the dependents of a node, queueing effects
+         *
+         * Stops at nodes already marked, so each node is visited once per
+         * flush however many of its sources change.
+         */
+        void mark(reactive_node const& Node) {
+            for (reactive_node const* d : Node.Dependents) {
+                if (d->Pending) continue;
+                d->Pending = true;
+                if (d->Kind == reactive_node::node_kind::sink) {
+                    Queue.push_back(d);
+                }
+                else {
+                    mark(*d);
+                }
+            }
+        }
+
+        /**
+         * @brief Queue a new effect for its first run
+         */
+        void enqueue(reactive_node const& Node) {
+            Node.Pending = true;
+            Queue.push_back(&Node);
+            schedule();
+        }
+
+        void schedule() {
+            if (!Scheduled) {
+                Scheduled = true;
+                if (OnSchedule) OnSchedule();
+            }
+        }
+
+        /**
+         * @brief Drop a node that is being destroyed from the queue
+         */
+        void forget(reactive_node const& Node) noexcept {
+            std::replace(Queue.begin(), Queue.end(), &Node, static_cast<reactive_node const*>(nullptr));
+            if (Observer == &Node) Observer = nullptr;
+        }
+    };
+
+    /**
+     * @brief Get the process-wide reactive graph
+     */
+    inline reactive_graph& reactive() {
+        static reactive_graph Graph;
+        return Graph;
+    }
+
+    inline reactive_node::~reactive_node() {
+        for (reactive_node const* s : Sources) {
+            std::erase(s->Dependents, this);
+        }
+        for (reactive_node const* d : Dependents) {
+            std::erase(d->Sources, this);
+        }
+        Graph.forget(*this);
+    }
+
+    inline void reactive_node::track() const {
+        reactive_node const* Observer = Graph.Observer;
+        if (!Observer || Observer == this) return;
+        if (std::find(Observer->Sources.begin(), Observer->Sources.end(), this) != Observer->Sources.end()) return;
+        Observer->Sources.push_back(this);
+        Dependents.push_back(Observer);
+    }
+
+    inline void reactive_node::enqueue() const {
+        Graph.enqueue(*this);
+    }
+
+    inline void reactive_node::changed() const {
+        Graph.changed(*this);
+    }
+
+    inline void reactive_node::refresh() const {
+        if (Verified == Graph.Epoch || Kind == node_kind::source || Computing) return;
+
+        // Sources first: a node only ever sees values that are already current
+        bool Stale = !Computed;
+        for (reactive_node const* s : Sources) {
+            s->refresh();
+            if (s->Changed > ComputedAt) Stale = true;
+        }
+
+        if (Stale) {
+            // Dependencies are recorded afresh by the computation
+            for (reactive_node const* s : Sources) {
+                std::erase(s->Dependents, this);
+            }
+            Sources.clear();
+
+            reactive_node const* Outer = Graph.Observer;
+            Graph.Observer = this;
+            Computing = true;
+            struct restore {
+                reactive_graph& Graph;
+                reactive_node const* Outer;
+                bool& Computing;
+                ~restore() { Graph.Observer = Outer; Computing = false; }
+            } Restore{ Graph, Outer, Computing };
+
+            if (const_cast<reactive_node*>(this)->recompute()) {
+                Changed = Graph.Epoch;
+            }
+            Computed = true;
+            ComputedAt = Graph.Epoch;
+        }
+        Verified = Graph.Epoch;
+        Pending = false;
+    }
+
+    /**
+     * @class observable
+     * @brief A model value (signal) that computeds and effects can depend on
+     *
+     * Setting an equal value is not a change and wakes nothing. Named so
+     * that it does not collide with ::signal() from <csignal>.
+     *
+     * @tparam T Value type
+     */
+    template <class T>
+    class observable : public reactive_node {
+    public:
+        explicit observable(T Initial = T{}, reactive_graph& Graph = reactive())
+            : reactive_node{ Graph, node_kind::source }, Value{ std::move(Initial) } {
+        }
+
+        /**
+         * @brief Read the value, recording a dependency of the running computation
+         */
+        const T& get() const {
+            track();
+            return Value;
+        }
+
+        /**
+         * @brief Read the value without recording a dependency
+         */
+        const T& peek() const noexcept {
+            return Value;
+        }
+
+        /**
+         * @brief Replace the value
+         */
+        void set(T NewValue) {
+            if constexpr (std::equality_comparable<T>) {
+                if (Value == NewValue) return;
+            }
+            Value = std::move(NewValue);
+            changed();
+        }
+
+        /**
+         * @brief Modify the value in place
+         *
+         * @param Fn Called with a copy of the value to modify
+         */
+        template <class Fn>
+        void update(Fn&& Modify) {
+            T NewValue = Value;
+            std::forward<Fn>(Modify)(NewValue);
+            set(std::move(NewValue));
+        }
+
+    private:
+        bool recompute() override { return false; }
+
+        T Value;
+    };
+
+    /**
+     * @class computed
+     * @brief A value derived from signals and other computeds
+     *
+     * Computed lazily on first read and afterwards only when a source has
+     * changed value. A result equal to the previous one does not count as a
+     * change, so dependents further down are left alone.
+     *
+     * @tparam T Value type
+     */
+    template <class T>
+    class computed : public reactive_node {
+    public:
+        explicit computed(std::function<T()> Compute, reactive_graph& Graph = reactive())
+            : reactive_node{ Graph, node_kind::derived }, Compute{ std::move(Compute) } {
+        }
+
+        /**
+         * @brief Read the current value, recording a dependency of the running computation
+         */
+        const T& get() const {
+            refresh();
+            track();
+            return Value;
+        }
+
+        /**
+         * @brief Number of times the value was computed
+         */
+        uint64_t computations() const noexcept {
+            return Count;
+        }
+
+    private:
+        bool recompute() override {
+            ++Count;
+            T NewValue = Compute();
+            if constexpr (std::equality_comparable<T>) {
+                if (Count > 1 && NewValue == Value) return false;
+            }
+            Value = std::move(NewValue);
+            return true;
+        }
+
+        std::function<T()> Compute;
+        T Value{};
+        uint64_t Count{ 0 };
+    };
+
+    /**
+     * @class effect
+     * @brief Side effect, such as a widget update, that follows its sources
+     *
+     * Runs in the first flush after construction and then in every flush
+     * that follows a change of one of the values it read.
+     */
+    class effect : public reactive_node {
+    public:
+        explicit effect(std::function<void()> Run, reactive_graph& Graph = reactive())
+            : reactive_node{ Graph, node_kind::sink }, Run{ std::move(Run) } {
+            enqueue();
+        }
+
+        /**
+         * @brief Number of times the effect ran
+         */
+        uint64_t runs() const noexcept {
+            return Count;
+        }
+
+    private:
+        bool recompute() override {
+            ++Count;
+            Run();
+            return false;
+        }
+
+        std::function<void()> Run;
+        uint64_t Count{ 0 };
+    };
+
+} // namespace mz
+
+#endif // MZ_REACTIVE_H
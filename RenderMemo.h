@@ -0,0 +1,215 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_RENDER_MEMO_H
+#define MZ_RENDER_MEMO_H
+#pragma once
+
+/**
+ * @file RenderMemo.h
+ * @brief Content hashing to skip redundant widget renders
+ *
+ * Widgets hash the inputs of a render (text, colors, area, focus) and
+ * compare the result with the hash of the previous render. When they match,
+ * composing the buffer, and for widgets that write as they update, writing
+ * it out are skipped. Decisions about output are counted in a process-wide
+ * pair of counters; checks that only spare composing a buffer are not,
+ * since that buffer is still written by a later print() or refresh().
+ *
+ * @author Meysam Zare
+ */
+
+#include "colors.h"
+#include "coord.h"
+#include <atomic>
+#include <string_view>
+#include <type_traits>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @struct render_stats
+     * @brief Process-wide render counters
+     */
+    struct render_stats {
+        std::atomic<uint64_t> Performed{ 0 };  ///< Renders that wrote output
+        std::atomic<uint64_t> Skipped{ 0 };    ///< Renders whose output was skipped because nothing changed
+
+        /**
+         * @brief Reset both counters
+         */
+        void reset() noexcept {
+            Performed = 0;
+            Skipped = 0;
+        }
+    };
+
+    /**
+     * @brief Get the process-wide render counters
+     */
+    inline render_stats& render_counters() noexcept {
+        static render_stats Stats;
+        return Stats;
+    }
+
+    /**
+     * @class render_hash
+     * @brief Incremental 64-bit FNV-1a hash of render inputs
+     */
+    class render_hash {
+    private:
+        uint64_t Value{ 14695981039346656037ull };
+
+        void mix(void const* Data, size_t Size) noexcept {
+            auto Bytes = static_cast<unsigned char const*>(Data);
+            for (size_t i = 0; i < Size; i++) {
+                Value = (Value ^ Bytes[i]) * 1099511628211ull;
+            }
+        }
+
+    public:
+        /**
+         * @brief Add text
+         *
+         * The length is mixed in as well, so "ab"+"c" and "a"+"bc" differ.
+         */
+        render_hash& add(std::wstring_view Text) noexcept {
+            add(Text.size());
+            mix(Text.data(), Text.size() * sizeof(wchar_t));
+            return *this;
+        }
+
+        /**
+         * @brief Add an integer or enumeration
+         */
+        template <typename T>
+            requires (std::is_integral_v<T> || std::is_enum_v<T>)
+        render_hash& add(T Number) noexcept {
+            mix(&Number, sizeof(Number));
+            return *this;
+        }
+
+        /**
+         * @brief Add a color
+         */
+        render_hash& add(rgb Color) noexcept {
+            return add(Color.value());
+        }
+
+        /**
+         * @brief Add a foreground/background pair
+         */
+        render_hash& add(color Colors) noexcept {
+            return add(Colors.F).add(Colors.B);
+        }
+
+        /**
+         * @brief Add a screen position
+         */
+        render_hash& add(coord Position) noexcept {
+            return add(Position.Row).add(Position.Col);
+        }
+
+        /**
+         * @brief Add a screen area
+         */
+        render_hash& add(coord_box Box) noexcept {
+            return add(Box.Top).add(Box.Bottom);
+        }
+
+        /**
+         * @brief Get the hash value
+         */
+        uint64_t value() const noexcept {
+            return Value;
+        }
+    };
+
+    /**
+     * @class render_memo
+     * @brief Remembers the hash of the last render
+     *
+     * @code
+     * uint64_t Hash = render_hash{}.add(Text).add(Color).add(Area).value();
+     * if (Memo.skip(Hash)) return;
+     * compose_and_print();
+     * Memo.store(Hash);
+     * @endcode
+     */
+    class render_memo {
+    private:
+        uint64_t Hash{ 0 };     ///< Hash of the last render
+        bool Valid{ false };    ///< Hash is meaningful
+
+    public:
+        /**
+         * @brief Check whether the inputs match the last render, without counting
+         *
+         * For memos that only spare composing a buffer; whether the buffer is
+         * written is decided (and counted) elsewhere.
+         *
+         * @param NewHash Hash of the inputs of the requested render
+         * @return true if the inputs match the last render
+         */
+        bool matches(uint64_t NewHash) const noexcept {
+            return Valid && NewHash == Hash;
+        }
+
+        /**
+         * @brief Decide whether a render that writes output can be skipped
+         *
+         * Counts the decision in render_counters().
+         *
+         * @param NewHash Hash of the inputs of the requested render
+         * @return true if the inputs match the last render
+         */
+        bool skip(uint64_t NewHash) const noexcept {
+            if (Valid && NewHash == Hash) {
+                render_counters().Skipped.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+            render_counters().Performed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        /**
+         * @brief Record the inputs of a completed render
+         */
+        void store(uint64_t NewHash) noexcept {
+            Hash = NewHash;
+            Valid = true;
+        }
+
+        /**
+         * @brief Forget the last render, so the next one always happens
+         */
+        void invalidate() noexcept {
+            Valid = false;
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_RENDER_MEMO_H
@@ -0,0 +1,515 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_RICH_TEXT_H
+#define MZ_RICH_TEXT_H
+#pragma once
+
+/**
+ * @file RichText.h
+ * @brief Inline style markup compiled to cached span lists
+ *
+ * A rich_format is parsed once from markup such as
+ * `[b fg=red]Error[/] in [u]{path}[/]` into a list of literal text,
+ * style and placeholder pieces. Colors are turned into escape sequences at
+ * parse time, so rendering only copies pieces and substitutes arguments.
+ * rich_format::get() caches recently parsed formats by the content of the
+ * markup, which makes it cheap to use a literal in code that runs every
+ * frame.
+ *
+ * Markup:
+ * - `[b]` bold, `[u]` underline, `[r]` reverse video
+ * - `fg=NAME`, `bg=NAME` with a color name (red, silver, ...) or `#rrggbb`
+ * - several attributes in one tag: `[b u fg=#ff8000]`
+ * - `[/]` ends the innermost tag; tags nest
+ * - `{name}` or `{}` placeholders, numbered in order of first use
+ * - `[[`, `]]`, `{{` and `}}` stand for literal brackets and braces
+ *
+ * @author Meysam Zare
+ */
+
+#include "colors.h"
+#include "RenderMemo.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <array>
+#include <unordered_map>
+#include <list>
+#include <format>
+#include <algorithm>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @class rich_format
+     * @brief Parsed rich-text markup
+     *
+     * @code
+     * auto const& Fmt = rich_format::get(L"[b fg=red]Error[/] in [u]{path}[/]");
+     * std::wstring Line;
+     * Fmt.format(Line, Color, 60, Path);
+     * @endcode
+     */
+    class rich_format {
+    public:
+        static constexpr uint8_t BOLD{ 1 };         ///< Bold attribute bit
+        static constexpr uint8_t UNDERLINE{ 2 };    ///< Underline attribute bit
+        static constexpr uint8_t REVERSE{ 4 };      ///< Reverse video attribute bit
+
+        /**
+         * @brief Resolved style of a run of text
+         */
+        struct style {
+            uint8_t Attrs{ 0 };     ///< BOLD, UNDERLINE and REVERSE bits
+            std::wstring Front;     ///< Foreground escape (empty to use the base color)
+            std::wstring Back;      ///< Background escape (empty to use the base color)
+        };
+
+        /**
+         * @brief Kind of a compiled piece
+         */
+        enum class piece_kind : uint8_t {
+            text,       ///< Literal text
+            style,      ///< Switch to a style
+            arg         ///< Placeholder argument
+        };
+
+        /**
+         * @brief One compiled piece
+         */
+        struct piece {
+            piece_kind Kind{ piece_kind::text };
+            uint32_t Index{ 0 };    ///< Offset in the literal pool, style index or argument index
+            uint32_t Length{ 0 };   ///< Length of literal text
+        };
+
+    private:
+        std::wstring Source;                    ///< Markup the format was parsed from
+        std::wstring Literals;                  ///< Literal text of all text pieces
+        std::vector<piece> Pieces;              ///< Compiled pieces in order
+        std::vector<style> Styles;              ///< Styles; index 0 is the base style
+        std::vector<std::wstring> ArgNames;     ///< Placeholder names by argument index
+        size_t ErrorPos{ std::wstring_view::npos };    ///< First markup error
+
+        mutable uint32_t CachedBase{ 0xffffffff };  ///< Base foreground the escapes below belong to
+        mutable uint32_t CachedBack{ 0xffffffff };  ///< Base background the escapes below belong to
+        mutable std::wstring BaseFront;         ///< Escape for the base foreground
+        mutable std::wstring BaseBack;          ///< Escape for the base background
+
+        /**
+         * @brief Look up a color by name or #rrggbb
+         *
+         * @return true if the name is not a color
+         */
+        static bool parse_color(std::wstring_view Name, rgb& Out) noexcept {
+            if (Name.size() == 7 && Name[0] == L'#') {
+                uint32_t v{ 0 };
+                for (size_t i = 1; i < 7; i++) {
+                    wchar_t c = Name[i];
+                    int d = c >= L'0' && c <= L'9' ? c - L'0'
+                        : c >= L'a' && c <= L'f' ? c - L'a' + 10
+                        : c >= L'A' && c <= L'F' ? c - L'A' + 10 : -1;
+                    if (d < 0) return true;
+                    v = v * 16 + static_cast<uint32_t>(d);
+                }
+                Out = rgb(v >> 16, (v >> 8) & 0xFF, v & 0xFF);
+                return false;
+            }
+
+            static constexpr std::pair<wchar_t const*, rgb> Names[]{
+                { L"black", color::BLACK }, { L"gray", color::GRAY }, { L"grey", color::GRAY },
+                { L"silver", color::SILVER }, { L"white", color::WHITE }, { L"maroon", color::MAROON },
+                { L"darkred", color::DARKRED }, { L"brown", color::BROWN }, { L"orange", color::ORANGE },
+                { L"gold", color::GOLD }, { L"red", color::RED }, { L"lime", color::LIME },
+                { L"green", color::GREEN }, { L"olive", color::OLIVE }, { L"seagreen", color::SEAGREEN },
+                { L"darkgreen", color::DARKGREEN }, { L"blue", color::BLUE }, { L"navy", color::NAVY },
+                { L"darkblue", color::DARKBLUE }, { L"yellow", color::YELLOW }, { L"magenta", color::MAGENTA },
+                { L"cyan", color::CYAN }, { L"aqua", color::AQUA }, { L"khaki", color::KHAKI },
+                { L"lavender", color::LAVENDER }, { L"lightcyan", color::LIGHTCYAN },
+                { L"brightgreen", color::BRIGHTGREEN }, { L"brightyellow", color::BRIGHTYELLOW },
+                { L"sienna", color::SIENNA }
+            };
+            for (auto const& [Key, Value] : Names) {
+                if (Name == Key) {
+                    Out = Value;
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /**
+         * @brief Apply the attributes of a tag body to a style
+         *
+         * @return true if the tag is not valid markup
+         */
+        static bool parse_tag(std::wstring_view Tag, style& s) {
+            bool Any{ false };
+            while (!Tag.empty()) {
+                size_t Sp = Tag.find(L' ');
+                std::wstring_view Word = Tag.substr(0, Sp);
+                Tag = Sp == std::wstring_view::npos ? std::wstring_view{} : Tag.substr(Sp + 1);
+                if (Word.empty()) continue;
+
+                rgb c;
+                if (Word == L"b") s.Attrs |= BOLD;
+                else if (Word == L"u") s.Attrs |= UNDERLINE;
+                else if (Word == L"r") s.Attrs |= REVERSE;
+                else if (Word.starts_with(L"fg=") && !parse_color(Word.substr(3), c)) {
+                    s.Front.clear();
+                    c.setFront(s.Front);
+                }
+                else if (Word.starts_with(L"bg=") && !parse_color(Word.substr(3), c)) {
+                    s.Back.clear();
+                    c.setBack(s.Back);
+                }
+                else return true;
+                Any = true;
+            }
+            return !Any;
+        }
+
+        /**
+         * @brief Append literal text as a piece
+         */
+        void add_text(std::wstring_view Text) {
+            if (Text.empty()) return;
+            if (!Pieces.empty() && Pieces.back().Kind == piece_kind::text
+                && Pieces.back().Index + Pieces.back().Length == Literals.size()) {
+                Pieces.back().Length += static_cast<uint32_t>(Text.size());
+            }
+            else {
+                Pieces.push_back(piece{ piece_kind::text, static_cast<uint32_t>(Literals.size()), static_cast<uint32_t>(Text.size()) });
+            }
+            Literals.append(Text);
+        }
+
+        /**
+         * @brief Parse the markup
+         */
+        void compile() {
+            Styles.push_back(style{});
+            std::vector<uint32_t> Stack{ 0 };
+            std::wstring_view m{ Source };
+
+            size_t i{ 0 };
+            while (i < m.size()) {
+                wchar_t c = m[i];
+                if ((c == L'[' || c == L']' || c == L'{' || c == L'}') && i + 1 < m.size() && m[i + 1] == c) {
+                    add_text(m.substr(i, 1));
+                    i += 2;
+                    continue;
+                }
+                if (c == L'[') {
+                    size_t End = m.find(L']', i);
+                    if (End == std::wstring_view::npos) break;
+                    std::wstring_view Tag = m.substr(i + 1, End - i - 1);
+                    if (Tag == L"/") {
+                        if (Stack.size() > 1) Stack.pop_back();
+                        else if (ErrorPos == std::wstring_view::npos) ErrorPos = i;
+                        Pieces.push_back(piece{ piece_kind::style, Stack.back(), 0 });
+                    }
+                    else {
+                        style s = Styles[Stack.back()];
+                        if (parse_tag(Tag, s)) {
+                            // Not markup: keep it as text
+                            if (ErrorPos == std::wstring_view::npos) ErrorPos = i;
+                            add_text(m.substr(i, End - i + 1));
+                        }
+                        else {
+                            Stack.push_back(static_cast<uint32_t>(Styles.size()));
+                            Styles.push_back(std::move(s));
+                            Pieces.push_back(piece{ piece_kind::style, Stack.back(), 0 });
+                        }
+                    }
+                    i = End + 1;
+                    continue;
+                }
+                if (c == L'{') {
+                    size_t End = m.find(L'}', i);
+                    if (End == std::wstring_view::npos) break;
+                    std::wstring_view Name = m.substr(i + 1, End - i - 1);
+                    auto It = Name.empty() ? ArgNames.end() : std::find(ArgNames.begin(), ArgNames.end(), Name);
+                    uint32_t Arg = static_cast<uint32_t>(It - ArgNames.begin());
+                    if (It == ArgNames.end()) {
+                        ArgNames.emplace_back(Name);
+                    }
+                    Pieces.push_back(piece{ piece_kind::arg, Arg, 0 });
+                    i = End + 1;
+                    continue;
+                }
+                size_t Next = m.find_first_of(L"[]{}", i + 1);
+                if (Next == std::wstring_view::npos) Next = m.size();
+                add_text(m.substr(i, Next - i));
+                i = Next;
+            }
+
+            // Unterminated tag or placeholder
+            if (i < m.size()) {
+                if (ErrorPos == std::wstring_view::npos) ErrorPos = i;
+                add_text(m.substr(i));
+            }
+
+            // Close open tags so that render() always ends in the base style
+            if (Stack.size() > 1) {
+                Pieces.push_back(piece{ piece_kind::style, 0, 0 });
+            }
+        }
+
+        /**
+         * @brief Append the escapes for a style over a base
+         */
+        void apply(std::wstring& Out, style const& s, uint8_t BaseAttrs) const {
+            uint8_t a = s.Attrs | BaseAttrs;
+            Out.append(a & BOLD ? L"\x1b[1m" : L"\x1b[22m");
+            Out.append(a & UNDERLINE ? L"\x1b[4m" : L"\x1b[24m");
+            Out.append(a & REVERSE ? L"\x1b[7m" : L"\x1b[27m");
+            Out.append(s.Front.empty() ? BaseFront : s.Front);
+            Out.append(s.Back.empty() ? BaseBack : s.Back);
+        }
+
+    public:
+        /**
+         * @brief Parse markup
+         *
+         * @param Markup Markup text
+         */
+        explicit rich_format(std::wstring_view Markup) : Source(Markup) {
+            compile();
+        }
+
+        /**
+         * @brief Number of parsed formats get() keeps per thread
+         */
+        static constexpr size_t CacheSize{ 64 };
+
+        /**
+         * @brief Get the parsed format of a markup string
+         *
+         * The most recently used formats are cached per thread by a hash of
+         * the markup, checked against its content, so passing the same
+         * markup again costs a hash and one comparison and no parsing.
+         *
+         * @param Markup Markup text
+         * @return Parsed format, valid until this thread has asked get()
+         *         for CacheSize other markup strings
+         */
+        static rich_format const& get(std::wstring_view Markup) {
+            struct entry {
+                uint64_t Key;
+                rich_format Format;
+            };
+            struct cache {
+                std::list<entry> Entries;   ///< Most recently used first
+                std::unordered_map<uint64_t, std::list<entry>::iterator> Index;
+            };
+            static thread_local cache Cache;
+
+            uint64_t Key = render_hash{}.add(Markup).value();
+            auto Found = Cache.Index.find(Key);
+            if (Found != Cache.Index.end()) {
+                if (Found->second->Format.Source == Markup) {
+                    Cache.Entries.splice(Cache.Entries.begin(), Cache.Entries, Found->second);
+                    return Cache.Entries.front().Format;
+                }
+                // A hash collision: the newer markup takes the slot
+                Cache.Entries.erase(Found->second);
+                Cache.Index.erase(Found);
+            }
+            else if (Cache.Entries.size() >= CacheSize) {
+                Cache.Index.erase(Cache.Entries.back().Key);
+                Cache.Entries.pop_back();
+            }
+            Cache.Entries.push_front(entry{ Key, rich_format(Markup) });
+            Cache.Index[Key] = Cache.Entries.begin();
+            return Cache.Entries.front().Format;
+        }
+
+        /**
+         * @brief Markup the format was parsed from
+         */
+        std::wstring_view source() const noexcept {
+            return Source;
+        }
+
+        /**
+         * @brief Number of placeholder arguments
+         */
+        size_t num_args() const noexcept {
+            return ArgNames.size();
+        }
+
+        /**
+         * @brief Get the argument index of a named placeholder
+         *
+         * @return Index, or -1 if there is no such placeholder
+         */
+        int arg_index(std::wstring_view Name) const noexcept {
+            auto It = std::find(ArgNames.begin(), ArgNames.end(), Name);
+            return It == ArgNames.end() ? -1 : static_cast<int>(It - ArgNames.begin());
+        }
+
+        /**
+         * @brief Check whether the markup had errors
+         *
+         * Invalid tags are shown as text and unmatched [/] are ignored.
+         */
+        bool error() const noexcept {
+            return ErrorPos != std::wstring_view::npos;
+        }
+
+        /**
+         * @brief Position of the first markup error (npos if none)
+         */
+        size_t error_pos() const noexcept {
+            return ErrorPos;
+        }
+
+        /**
+         * @brief Compiled pieces
+         */
+        std::span<piece const> pieces() const noexcept {
+            return Pieces;
+        }
+
+        /**
+         * @brief Render with arguments
+         *
+         * Text beyond MaxWidth characters is cut off; styles after the cut
+         * are still applied so the output always ends in the base style.
+         *
+         * @param Out Buffer to append to
+         * @param Base Colors of unstyled text
+         * @param Args Placeholder values by argument index (missing ones are empty)
+         * @param MaxWidth Maximum number of characters to write
+         * @param BaseAttrs Attributes of unstyled text (BOLD, UNDERLINE, REVERSE)
+         * @return Number of characters written
+         */
+        size_t render(std::wstring& Out, color Base, std::span<std::wstring_view const> Args,
+            size_t MaxWidth = SIZE_MAX, uint8_t BaseAttrs = 0) const {
+            if (CachedBase != Base.F.value()) {
+                BaseFront.clear();
+                Base.F.setFront(BaseFront);
+                CachedBase = Base.F.value();
+            }
+            if (CachedBack != Base.B.value()) {
+                BaseBack.clear();
+                Base.B.setBack(BaseBack);
+                CachedBack = Base.B.value();
+            }
+
+            size_t Width{ 0 };
+            for (piece const& p : Pieces) {
+                std::wstring_view Text;
+                switch (p.Kind) {
+                case piece_kind::style:
+                    apply(Out, Styles[p.Index], BaseAttrs);
+                    continue;
+                case piece_kind::text:
+                    Text = std::wstring_view{ Literals }.substr(p.Index, p.Length);
+                    break;
+                case piece_kind::arg:
+                    if (p.Index < Args.size()) Text = Args[p.Index];
+                    break;
+                }
+                size_t n = std::min(Text.size(), MaxWidth - Width);
+                Out.append(Text.substr(0, n));
+                Width += n;
+            }
+            return Width;
+        }
+
+        /**
+         * @brief Render with arguments of any formattable type
+         *
+         * Strings are used as they are; other values go through std::format.
+         */
+        template <typename... A>
+        size_t format(std::wstring& Out, color Base, size_t MaxWidth, A const&... Args) const;
+
+        /**
+         * @brief Hash the format and its arguments for render memoization
+         */
+        uint64_t hash(std::span<std::wstring_view const> Args) const noexcept {
+            render_hash h;
+            h.add(reinterpret_cast<uintptr_t>(this)).add(std::wstring_view{ Source });
+            for (auto a : Args) {
+                h.add(a);
+            }
+            return h.value();
+        }
+    };
+
+    /**
+     * @class rich_args
+     * @brief Placeholder arguments of any formattable type, viewed as text
+     *
+     * Strings are used as they are; other values go through std::format.
+     */
+    template <typename... A>
+    class rich_args {
+    private:
+        std::array<std::wstring, sizeof...(A)> Storage;     ///< Formatted non-string values
+        std::array<std::wstring_view, sizeof...(A)> Views;  ///< Argument text by index
+
+        template <typename T>
+        static std::wstring_view as_view(T const& Value, std::wstring& Text) {
+            if constexpr (std::is_convertible_v<T const&, std::wstring_view>) {
+                return std::wstring_view{ Value };
+            }
+            else {
+                Text = std::format(L"{}", Value);
+                return Text;
+            }
+        }
+
+    public:
+        explicit rich_args(A const&... Args) {
+            [[maybe_unused]] size_t i{ 0 };
+            ((Views[i] = as_view(Args, Storage[i]), ++i), ...);
+        }
+
+        rich_args(rich_args const&) = delete;
+        rich_args& operator=(rich_args const&) = delete;
+
+        /**
+         * @brief Get the argument views
+         */
+        std::span<std::wstring_view const> views() const noexcept {
+            return Views;
+        }
+    };
+
+    template <typename... A>
+    size_t rich_format::format(std::wstring& Out, color Base, size_t MaxWidth, A const&... Args) const {
+        rich_args<A...> Views(Args...);
+        return render(Out, Base, Views.views(), MaxWidth);
+    }
+
+} // namespace mz
+
+#endif // MZ_RICH_TEXT_H
@@ -0,0 +1,311 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_STARTUP_PROFILER_H
+#define MZ_STARTUP_PROFILER_H
+#pragma once
+
+/**
+ * @file StartupProfiler.h
+ * @brief Startup timeline and idle-time task queue
+ *
+ * This file provides a lightweight timeline for measuring how long an
+ * application takes to put its first frame on screen, and a queue of
+ * deferred tasks that run only while no keystroke is waiting. Together they
+ * support a lazy startup mode: paint a minimal frame first, then finish
+ * non-critical setup and build large widget templates during idle time.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleCMD.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <chrono>
+
+namespace mz {
+
+    /**
+     * @class startup_timeline
+     * @brief Named timestamps relative to program startup
+     *
+     * The origin is the moment the timeline is constructed; for the global
+     * timeline that is its first use, so call startup_profile() at the top of
+     * main() for the most accurate figures.
+     */
+    class startup_timeline {
+    public:
+        using clock = std::chrono::steady_clock;
+
+        /**
+         * @struct event
+         * @brief One recorded point on the timeline
+         */
+        struct event {
+            std::wstring Name;          ///< Label of the event
+            clock::time_point Time;     ///< When the event happened
+        };
+
+    private:
+        /**
+         * @brief Timeline origin
+         */
+        clock::time_point Origin{ clock::now() };
+
+        /**
+         * @brief Recorded events in order
+         */
+        std::vector<event> Events;
+
+        /**
+         * @brief Moment the first frame was presented (Origin if not yet)
+         */
+        clock::time_point FirstFrame{ Origin };
+
+    public:
+        /**
+         * @brief Record a named event at the current time
+         *
+         * @param Name Event label
+         */
+        void mark(std::wstring_view Name) {
+            Events.push_back(event{ std::wstring(Name), clock::now() });
+        }
+
+        /**
+         * @brief Record that the first frame has been written
+         *
+         * Only the first call has any effect. EventLoop::run() calls it
+         * after its first frame; applications that draw without the loop
+         * call it after their first flush.
+         */
+        void first_frame() {
+            if (FirstFrame == Origin) {
+                FirstFrame = clock::now();
+                Events.push_back(event{ L"first frame", FirstFrame });
+            }
+        }
+
+        /**
+         * @brief Check whether the first frame has been recorded
+         */
+        bool has_first_frame() const noexcept {
+            return FirstFrame != Origin;
+        }
+
+        /**
+         * @brief Time from origin to the first frame
+         *
+         * @return Milliseconds, or a negative value if no frame was recorded
+         */
+        double time_to_first_frame() const noexcept {
+            if (!has_first_frame()) return -1.0;
+            return std::chrono::duration<double, std::milli>(FirstFrame - Origin).count();
+        }
+
+        /**
+         * @brief Get all recorded events
+         */
+        std::vector<event> const& events() const noexcept {
+            return Events;
+        }
+
+        /**
+         * @brief Format the timeline as text
+         *
+         * One line per event with its offset from the origin and the time
+         * since the previous event, followed by the time to first frame.
+         *
+         * @return Multi-line report
+         */
+        std::wstring report() const {
+            std::wstring Out;
+            clock::time_point Previous = Origin;
+            for (auto const& e : Events) {
+                Out += std::format(L"{:>9.3f} ms  (+{:>8.3f})  {}\n",
+                    std::chrono::duration<double, std::milli>(e.Time - Origin).count(),
+                    std::chrono::duration<double, std::milli>(e.Time - Previous).count(),
+                    e.Name);
+                Previous = e.Time;
+            }
+            if (has_first_frame()) {
+                Out += std::format(L"time to first frame: {:.3f} ms\n", time_to_first_frame());
+            }
+            return Out;
+        }
+    };
+
+    /**
+     * @class idle_queue
+     * @brief Tasks deferred until the application is idle
+     *
+     * Tasks run in the order they were deferred, on the thread that drains
+     * the queue. Each run is recorded on the startup timeline. A task that
+     * captures a widget should check the widget's idle_guard first.
+     */
+    class idle_queue {
+    private:
+        /**
+         * @brief A deferred task with its label
+         */
+        struct task {
+            std::wstring Name;
+            std::function<void()> Run;
+        };
+
+        /**
+         * @brief Pending tasks in order
+         */
+        std::deque<task> Tasks;
+
+        /**
+         * @brief Timeline that receives a mark per completed task
+         */
+        startup_timeline* Timeline{ nullptr };
+
+    public:
+        /**
+         * @brief Construct a queue reporting to a timeline
+         *
+         * @param Timeline Timeline to mark, or nullptr for none
+         */
+        explicit idle_queue(startup_timeline* Timeline = nullptr) noexcept : Timeline{ Timeline } {}
+
+        /**
+         * @brief Defer a task
+         *
+         * @param Name Label used on the timeline
+         * @param Run Task to run later
+         */
+        void defer(std::wstring_view Name, std::function<void()> Run) {
+            Tasks.push_back(task{ std::wstring(Name), std::move(Run) });
+        }
+
+        /**
+         * @brief Check whether any task is pending
+         */
+        bool empty() const noexcept {
+            return Tasks.empty();
+        }
+
+        /**
+         * @brief Run the oldest pending task
+         *
+         * @return true if a task was run
+         */
+        bool run_one() {
+            if (Tasks.empty()) return false;
+            task t = std::move(Tasks.front());
+            Tasks.pop_front();
+            t.Run();
+            if (Timeline) Timeline->mark(t.Name);
+            return true;
+        }
+
+        /**
+         * @brief Run tasks until the queue is empty or a key is waiting
+         *
+         * Checking for input between tasks keeps the application responsive:
+         * a keystroke typed during startup is handled before further
+         * deferred work.
+         *
+         * @return Number of tasks run
+         */
+        int run_until_input() {
+            int Count{ 0 };
+            while (!Tasks.empty() && !mz::key_pending()) {
+                run_one();
+                ++Count;
+            }
+            return Count;
+        }
+
+        /**
+         * @brief Run every pending task
+         *
+         * @return Number of tasks run
+         */
+        int run_all() {
+            int Count{ 0 };
+            while (run_one()) {
+                ++Count;
+            }
+            return Count;
+        }
+    };
+
+    /**
+     * @class idle_guard
+     * @brief Lets deferred tasks detect that the object that queued them is gone
+     *
+     * @code
+     * idle_tasks().defer(L"load", [this, Alive = Guard.watch()] {
+     *     if (Alive.expired()) return;
+     *     load();
+     * });
+     * @endcode
+     *
+     * A copy gets a guard of its own, so tasks queued by one object never
+     * run on behalf of its copies.
+     */
+    class idle_guard {
+    public:
+        idle_guard() = default;
+        idle_guard(idle_guard const&) {}
+        idle_guard& operator=(idle_guard const&) noexcept { return *this; }
+
+        /**
+         * @brief Get a handle that expires when the guard is destroyed
+         */
+        std::weak_ptr<void> watch() const noexcept {
+            return Alive;
+        }
+
+    private:
+        std::shared_ptr<int> Alive{ std::make_shared<int>(0) };
+    };
+
+    /**
+     * @brief Get the process-wide startup timeline
+     */
+    inline startup_timeline& startup_profile() {
+        static startup_timeline Timeline;
+        return Timeline;
+    }
+
+    /**
+     * @brief Get the process-wide idle task queue
+     */
+    inline idle_queue& idle_tasks() {
+        static idle_queue Queue{ &startup_profile() };
+        return Queue;
+    }
+
+} // namespace mz
+
+#endif // MZ_STARTUP_PROFILER_H
@@ -0,0 +1,398 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_TEMPLATE_BUFFER_H
+#define MZ_TEMPLATE_BUFFER_H
+#pragma once
+
+/**
+ * @file TemplateBuffer.h
+ * @brief Patchable fixed-stride line templates with partial flush
+ *
+ * Several widgets keep their whole screen image in one buffer made of
+ * fixed-length lines, built from fixed-width escape sequences so that a
+ * color or a piece of text can be replaced in place. template_buffer
+ * describes such a line as a set of named slots, records which slots were
+ * patched, and writes out only those slots, each preceded by the shortest
+ * cursor movement that reaches it.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleCMD.h"
+#include "coord.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <algorithm>
+#include <utility>
+#include <cstdlib>
+
+namespace mz {
+
+    /**
+     * @class template_buffer
+     * @brief Slot layout of a fixed-stride line buffer
+     *
+     * The buffer itself stays with the widget (usually BasicBox::bf) and is
+     * passed to patch() and flush(); the template only knows where each slot
+     * lives. Row r of the buffer starts at r * stride().
+     *
+     * Slot kinds:
+     * - style: an escape sequence (padded with NUL) that colors the slots
+     *   after it on the same line, up to the next style slot
+     * - text: a fixed number of cells
+     * - indicator: a small marker glyph, such as a scroll quote
+     *
+     * Patching a style slot marks every slot it colors, since the terminal
+     * only shows the new colors once those cells are written again.
+     *
+     * Typical use:
+     * @code
+     * Line.patch(bf, Index, StyleSlot, CommFocus);
+     * Line.flush(bf, Out, TopIndex, NumRows, Area.Top);
+     * mz::Write(Out);
+     * @endcode
+     */
+    class template_buffer {
+    public:
+        /**
+         * @brief Kind of content a slot holds
+         */
+        enum class slot_kind : uint8_t {
+            style,      ///< Escape sequence applying to the following slots
+            text,       ///< Visible cells
+            indicator   ///< Single marker glyph
+        };
+
+        /**
+         * @struct slot
+         * @brief One patchable region of a line
+         */
+        struct slot {
+            std::wstring Name;      ///< Lookup name
+            slot_kind Kind;         ///< Content kind
+            int Offset{ 0 };        ///< Offset in buffer units from the start of the line
+            int Capacity{ 0 };      ///< Size in buffer units
+            int Col{ 0 };           ///< Screen column relative to the line origin
+            int Cols{ 0 };          ///< Screen columns covered
+            int Style{ -1 };        ///< Style slot coloring this slot, or -1
+        };
+
+    private:
+        /**
+         * @brief Slots in offset order
+         */
+        std::vector<slot> Slots;
+
+        /**
+         * @brief Patched (row, slot) pairs awaiting flush
+         */
+        std::vector<std::pair<int, int>> Dirty;
+
+        /**
+         * @brief Length of one line in buffer units
+         */
+        int Stride{ 0 };
+
+        /**
+         * @brief Append a decimal number
+         */
+        static void append_number(std::wstring& Out, int n) {
+            wchar_t Digits[12];
+            int Count{ 0 };
+            do {
+                Digits[Count++] = wchar_t(L'0' + n % 10);
+                n /= 10;
+            } while (n);
+            while (Count) Out.push_back(Digits[--Count]);
+        }
+
+        /**
+         * @brief Append a CSI sequence with an optional count
+         *
+         * A count of 1 is left out, as every terminal defaults to it.
+         */
+        static void append_csi(std::wstring& Out, int n, wchar_t Final) {
+            Out.append(L"\x1b[");
+            if (n != 1) append_number(Out, n);
+            Out.push_back(Final);
+        }
+
+    public:
+        /**
+         * @brief Forget all slots and set the line length
+         *
+         * @param LineLength Length of one line in buffer units
+         */
+        void reset(int LineLength) {
+            Slots.clear();
+            Dirty.clear();
+            Stride = LineLength;
+        }
+
+        /**
+         * @brief Get the line length in buffer units
+         */
+        int stride() const noexcept {
+            return Stride;
+        }
+
+        /**
+         * @brief Define a slot
+         *
+         * Slots must be added in offset order. A text or indicator slot is
+         * colored by the most recently added style slot.
+         *
+         * @param Name Lookup name
+         * @param Kind Content kind
+         * @param Offset Offset in buffer units from the start of the line
+         * @param Capacity Size in buffer units
+         * @param Col Screen column relative to the line origin (ignored for style)
+         * @param Cols Screen columns covered (defaults to Capacity)
+         * @return Slot index
+         */
+        int add(std::wstring_view Name, slot_kind Kind, int Offset, int Capacity, int Col = 0, int Cols = -1) {
+            int Style{ -1 };
+            for (int i = static_cast<int>(Slots.size()) - 1; i >= 0; --i) {
+                if (Slots[i].Kind == slot_kind::style) {
+                    Style = i;
+                    break;
+                }
+            }
+            Slots.push_back(slot{ std::wstring(Name), Kind, Offset, Capacity, Col,
+                Kind == slot_kind::style ? 0 : (Cols < 0 ? Capacity : Cols), Kind == slot_kind::style ? -1 : Style });
+            return static_cast<int>(Slots.size()) - 1;
+        }
+
+        /**
+         * @brief Find a slot by name
+         *
+         * @return Slot index, or -1 if there is no such slot
+         */
+        int find(std::wstring_view Name) const noexcept {
+            for (size_t i = 0; i < Slots.size(); i++) {
+                if (Slots[i].Name == Name) return static_cast<int>(i);
+            }
+            return -1;
+        }
+
+        /**
+         * @brief Get a slot definition
+         */
+        slot const& at(int Slot) const noexcept {
+            return Slots[Slot];
+        }
+
+        /**
+         * @brief Number of defined slots
+         */
+        int num_slots() const noexcept {
+            return static_cast<int>(Slots.size());
+        }
+
+        /**
+         * @brief Mark a slot for the next flush
+         *
+         * Marking a style slot marks every slot it colors.
+         */
+        void touch(int Row, int Slot) {
+            if (Slots[Slot].Kind != slot_kind::style) {
+                Dirty.emplace_back(Row, Slot);
+                return;
+            }
+            for (int i = 0; i < num_slots(); i++) {
+                if (Slots[i].Style == Slot) Dirty.emplace_back(Row, i);
+            }
+        }
+
+        /**
+         * @brief Mark every slot of a row for the next flush
+         */
+        void touch_row(int Row) {
+            for (int i = 0; i < num_slots(); i++) {
+                if (Slots[i].Kind != slot_kind::style) Dirty.emplace_back(Row, i);
+            }
+        }
+
+        /**
+         * @brief Replace the contents of a slot
+         *
+         * Style slots are padded with NUL, other slots with spaces. The slot
+         * is marked only if its contents actually changed.
+         *
+         * @param Buffer Widget buffer holding the lines
+         * @param Row Line index
+         * @param Slot Slot index
+         * @param Content New contents
+         * @return true if error (row outside the buffer or content too long)
+         */
+        bool patch(std::wstring& Buffer, int Row, int Slot, std::wstring_view Content) {
+            slot const& s = Slots[Slot];
+            size_t Begin = static_cast<size_t>(Row) * Stride + s.Offset;
+            if (Row < 0 || Begin + s.Capacity > Buffer.size() || Content.size() > static_cast<size_t>(s.Capacity)) {
+                return true;
+            }
+
+            wchar_t Pad = s.Kind == slot_kind::style ? wchar_t(0) : wchar_t(' ');
+            std::wstring_view Current{ Buffer.data() + Begin, static_cast<size_t>(s.Capacity) };
+            if (Current.substr(0, Content.size()) == Content
+                && Current.find_first_not_of(Pad, Content.size()) == std::wstring_view::npos) {
+                return false;
+            }
+
+            Buffer.replace(Begin, Content.size(), Content);
+            std::fill_n(Buffer.begin() + static_cast<std::ptrdiff_t>(Begin + Content.size()),
+                s.Capacity - static_cast<int>(Content.size()), Pad);
+            touch(Row, Slot);
+            return false;
+        }
+
+        /**
+         * @brief Check whether any slot is waiting to be flushed
+         */
+        bool pending() const noexcept {
+            return !Dirty.empty();
+        }
+
+        /**
+         * @brief Drop all marks, e.g. after the whole buffer was printed
+         */
+        void discard() noexcept {
+            Dirty.clear();
+        }
+
+        /**
+         * @brief Append the shortest sequence moving the cursor
+         *
+         * Compares an absolute position with relative moves from the
+         * current position.
+         *
+         * @param Out Destination
+         * @param From Current cursor position (0-based)
+         * @param Known false if the current position is unknown
+         * @param To Target position (0-based)
+         */
+        static void move_cursor(std::wstring& Out, coord From, bool Known, coord To) {
+            std::wstring Best;
+            Best.append(L"\x1b[");
+            append_number(Best, To.Row + 1);
+            if (To.Col) {
+                Best.push_back(';');
+                append_number(Best, To.Col + 1);
+            }
+            Best.push_back('H');
+
+            if (Known) {
+                if (From == To) return;
+
+                std::wstring Relative;
+                if (To.Row != From.Row) {
+                    append_csi(Relative, std::abs(To.Row - From.Row), To.Row > From.Row ? 'B' : 'A');
+                }
+                if (To.Col != From.Col) {
+                    if (To.Col == 0) {
+                        Relative.push_back('\r');
+                    }
+                    else {
+                        append_csi(Relative, std::abs(To.Col - From.Col), To.Col > From.Col ? 'C' : 'D');
+                    }
+                }
+                if (Relative.size() < Best.size()) {
+                    Best.swap(Relative);
+                }
+            }
+            Out.append(Best);
+        }
+
+        /**
+         * @brief Write out the marked slots of the visible rows
+         *
+         * Slots are written in row and offset order. Each slot's style is
+         * emitted when it differs from the last one written, and adjacent
+         * slots need no cursor movement at all. Marks on rows outside the
+         * visible range are dropped, as those rows are drawn in full when
+         * they scroll into view. The cursor must not end up in the last
+         * screen column, where terminals defer the wrap.
+         *
+         * @param Buffer Widget buffer holding the lines
+         * @param Out Destination for the escape sequences (appended)
+         * @param FirstRow Line shown on the first screen row
+         * @param NumRows Number of visible lines
+         * @param Origin Screen position of the first visible line
+         * @return Number of slots written
+         */
+        int flush(std::wstring const& Buffer, std::wstring& Out, int FirstRow, int NumRows, coord Origin) {
+            std::sort(Dirty.begin(), Dirty.end());
+            Dirty.erase(std::unique(Dirty.begin(), Dirty.end()), Dirty.end());
+
+            coord Cursor{};
+            bool Known{ false };
+            std::wstring_view ActiveStyle;
+            int Written{ 0 };
+
+            for (auto [Row, Index] : Dirty) {
+                if (Row < FirstRow || Row >= FirstRow + NumRows) continue;
+                size_t Line = static_cast<size_t>(Row) * Stride;
+                if (Line + Stride > Buffer.size()) continue;
+                slot const& s = Slots[Index];
+
+                if (s.Style >= 0) {
+                    slot const& Style = Slots[s.Style];
+                    std::wstring_view Sequence{ Buffer.data() + Line + Style.Offset, static_cast<size_t>(Style.Capacity) };
+                    Sequence = Sequence.substr(0, Sequence.find_last_not_of(wchar_t(0)) + 1);
+                    if (Sequence != ActiveStyle) {
+                        Out.append(Sequence);
+                        ActiveStyle = Sequence;
+                    }
+                }
+
+                coord Target(Origin.Row + Row - FirstRow, Origin.Col + s.Col);
+                move_cursor(Out, Cursor, Known, Target);
+                Out.append(Buffer, Line + s.Offset, static_cast<size_t>(s.Capacity));
+                Cursor = coord(Target.Row, Target.Col + s.Cols);
+                Known = true;
+                ++Written;
+            }
+
+            Dirty.clear();
+            return Written;
+        }
+
+        /**
+         * @brief Write out the marked slots directly to the terminal
+         *
+         * @return Number of slots written
+         */
+        int flush(std::wstring const& Buffer, int FirstRow, int NumRows, coord Origin) {
+            std::wstring Out;
+            int Written = flush(Buffer, Out, FirstRow, NumRows, Origin);
+            if (!Out.empty()) mz::Write(Out);
+            return Written;
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_TEMPLATE_BUFFER_H
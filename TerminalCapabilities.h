@@ -0,0 +1,504 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_TERMINAL_CAPABILITIES_H
+#define MZ_TERMINAL_CAPABILITIES_H
+#pragma once
+
+/**
+ * @file TerminalCapabilities.h
+ * @brief Terminal capability queries, reply parsing and on-disk cache
+ *
+ * This file defines the set of capabilities learned by querying the terminal
+ * (DA1, DA2, XTVERSION, DECRQM mode reports and OSC palette queries), the
+ * batched query string, a parser for the terminal's replies and a small
+ * text cache stored under $XDG_CACHE_HOME so that later startups can skip
+ * the round-trip entirely. The actual terminal I/O lives in TerminalManager.
+ *
+ * @author Meysam Zare
+ */
+
+#include "colors.h"
+#include <string>
+#include <string_view>
+#include <filesystem>
+#include <fstream>
+#include <cstdlib>
+#include <cstdio>
+#include <cstdint>
+#include <format>
+#include <chrono>
+#include <random>
+
+namespace mz {
+
+    /**
+     * @struct terminal_capabilities
+     * @brief Capabilities reported by the terminal
+     */
+    struct terminal_capabilities {
+        /**
+         * @brief DECRQM mode states (as reported in DECRPM replies)
+         */
+        enum mode_state : int {
+            mode_unknown = 0,        ///< Mode not recognized or no reply
+            mode_set = 1,            ///< Mode supported and enabled
+            mode_reset = 2,          ///< Mode supported and disabled
+            mode_permanent_set = 3,  ///< Mode permanently enabled
+            mode_permanent_reset = 4 ///< Mode permanently disabled
+        };
+
+        bool Responded{ false };        ///< True once the DA1 reply was seen
+        bool FromCache{ false };        ///< True if loaded from the on-disk cache
+        int DeviceClass{ 0 };           ///< First DA1 parameter (62, 64, 65 ...)
+        uint64_t Attributes{ 0 };       ///< DA1 attribute bits (bit N set for attribute N < 64)
+        int TerminalType{ -1 };         ///< First DA2 parameter
+        int FirmwareVersion{ 0 };       ///< Second DA2 parameter
+        std::string Version;            ///< XTVERSION name and version
+        int SynchronizedOutput{ 0 };    ///< DECRQM 2026 state
+        int BracketedPaste{ 0 };        ///< DECRQM 2004 state
+        int SgrMouse{ 0 };              ///< DECRQM 1006 state
+        int KeyboardFlags{ -1 };        ///< Kitty keyboard protocol flags in effect (-1 if not answered)
+        bool HasPalette{ false };       ///< OSC 4 answered
+        bool HasForeground{ false };    ///< OSC 10 answered
+        bool HasBackground{ false };    ///< OSC 11 answered
+        rgb Palette0;                   ///< Palette entry 0
+        rgb Foreground;                 ///< Default foreground color
+        rgb Background;                 ///< Default background color
+
+        /**
+         * @brief Check whether a DECRQM state means the mode is usable
+         */
+        static constexpr bool mode_supported(int State) noexcept {
+            return State != mode_unknown && State != mode_permanent_reset;
+        }
+
+        /**
+         * @brief Check whether the terminal speaks ANSI escape sequences
+         */
+        bool supports_ansi() const noexcept {
+            return Responded;
+        }
+
+        /**
+         * @brief Check whether the terminal supports color output
+         *
+         * DA1 attribute 22 announces ANSI color; answering an OSC color query
+         * implies a color-capable terminal as well.
+         */
+        bool supports_color() const noexcept {
+            return Responded && ((Attributes & (uint64_t(1) << 22)) || HasPalette || HasForeground || HasBackground);
+        }
+
+        /**
+         * @brief Check whether synchronized output (mode 2026) is available
+         */
+        bool supports_synchronized_output() const noexcept {
+            return mode_supported(SynchronizedOutput);
+        }
+
+        /**
+         * @brief Check whether the kitty keyboard protocol is available
+         *
+         * Terminals that implement it answer CSI ? u with their current flags.
+         */
+        bool supports_kitty_keyboard() const noexcept {
+            return KeyboardFlags >= 0;
+        }
+    };
+
+    namespace caps {
+
+        /**
+         * @brief All capability queries, sent as one batch
+         *
+         * DA1 goes last: every terminal answers it and replies arrive in
+         * order, so its reply marks the end of the batch.
+         */
+        static constexpr std::string_view QUERIES{
+            "\x1b]4;0;?\x1b\\"      // OSC 4: palette entry 0
+            "\x1b]10;?\x1b\\"       // OSC 10: default foreground
+            "\x1b]11;?\x1b\\"       // OSC 11: default background
+            "\x1b[>0q"              // XTVERSION
+            "\x1b[?2026$p"          // DECRQM synchronized output
+            "\x1b[?2004$p"          // DECRQM bracketed paste
+            "\x1b[?1006$p"          // DECRQM SGR mouse
+            "\x1b[?u"               // Kitty keyboard protocol flags
+            "\x1b[>c"               // DA2
+            "\x1b[c"                // DA1
+        };
+
+        /**
+         * @brief Cache file format version
+         */
+        static constexpr int CACHE_VERSION{ 2 };
+
+        /**
+         * @brief How long a terminal that never answered is not probed again
+         *
+         * A slow connection can make a capable terminal miss the timeout, so
+         * negative results expire.
+         */
+        static constexpr std::chrono::hours SILENT_CACHE_LIFE{ 24 };
+
+        /**
+         * @brief Parse semicolon separated decimal parameters
+         *
+         * @param Params Parameter text (e.g. "64;1;22")
+         * @param Out Output array
+         * @param Max Capacity of Out
+         * @return Number of parameters stored
+         */
+        inline int parse_params(std::string_view Params, int* Out, int Max) noexcept {
+            int Count{ 0 };
+            int Value{ 0 };
+            bool Any{ false };
+            for (char ch : Params) {
+                if (ch >= '0' && ch <= '9') {
+                    Value = Value * 10 + (ch - '0');
+                    Any = true;
+                }
+                else if (ch == ';') {
+                    if (Count < Max) Out[Count++] = Value;
+                    Value = 0;
+                    Any = false;
+                }
+            }
+            if (Any && Count < Max) Out[Count++] = Value;
+            return Count;
+        }
+
+        /**
+         * @brief Parse an X11 color specification ("rgb:RRRR/GGGG/BBBB")
+         *
+         * @param Spec Specification text
+         * @param Out Parsed color
+         * @return true if the specification was understood
+         */
+        inline bool parse_color_spec(std::string_view Spec, rgb& Out) noexcept {
+            if (Spec.substr(0, 4) != "rgb:") return false;
+            Spec.remove_prefix(4);
+            unsigned Parts[3]{ 0, 0, 0 };
+            for (int i = 0; i < 3; ++i) {
+                size_t End = Spec.find('/');
+                std::string_view Hex = Spec.substr(0, End);
+                if (Hex.empty() || Hex.size() > 4) return false;
+                unsigned Value{ 0 };
+                for (char ch : Hex) {
+                    int d = (ch >= '0' && ch <= '9') ? ch - '0' :
+                        (ch >= 'a' && ch <= 'f') ? ch - 'a' + 10 :
+                        (ch >= 'A' && ch <= 'F') ? ch - 'A' + 10 : -1;
+                    if (d < 0) return false;
+                    Value = (Value << 4) | unsigned(d);
+                }
+                // Scale 1-4 hex digits to 8 bits
+                unsigned Bits = unsigned(Hex.size()) * 4;
+                Parts[i] = Bits >= 8 ? (Value >> (Bits - 8)) : (Value * 255 / ((1u << Bits) - 1));
+                if (End == std::string_view::npos) {
+                    if (i != 2) return false;
+                    break;
+                }
+                Spec.remove_prefix(End + 1);
+            }
+            Out = rgb(Parts[0], Parts[1], Parts[2]);
+            return true;
+        }
+
+        /**
+         * @brief Parse every complete reply found in a buffer
+         *
+         * Unrelated input (e.g. keystrokes typed during the probe) is skipped,
+         * or collected in Other so that it can be given back to the reader.
+         * Replies are the CSI sequences that start with ? or > and the OSC
+         * and DCS strings; other escape sequences are keys.
+         *
+         * @param Replies Bytes read from the terminal so far
+         * @param Caps Capabilities to update
+         * @param Other Receives the bytes that are not replies (nullptr to skip them)
+         * @return true once the DA1 reply (end of batch) has been parsed
+         */
+        inline bool parse_replies(std::string_view Replies, terminal_capabilities& Caps,
+            std::string* Other = nullptr) noexcept {
+            auto keep = [&](size_t From, size_t To) {
+                if (Other) Other->append(Replies.substr(From, To - From));
+            };
+            size_t i = 0;
+            while (i < Replies.size()) {
+                size_t Esc = Replies.find('\x1b', i);
+                if (Esc == std::string_view::npos || Esc + 1 >= Replies.size()) {
+                    keep(i, Replies.size());
+                    break;
+                }
+                keep(i, Esc);
+                i = Esc;
+                char Kind = Replies[i + 1];
+                if (Kind == '[') {
+                    // CSI: parameters up to the final byte
+                    size_t j = i + 2;
+                    while (j < Replies.size() && (Replies[j] < 0x40 || Replies[j] > 0x7e)) ++j;
+                    if (j >= Replies.size()) {
+                        keep(i, Replies.size());
+                        break;
+                    }
+                    std::string_view Body = Replies.substr(i + 2, j - i - 2);
+                    char Final = Replies[j];
+                    if (Body.empty() || (Body[0] != '?' && Body[0] != '>')) {
+                        keep(i, j + 1);
+                    }
+                    int p[64];
+                    if (Final == 'c' && !Body.empty() && Body[0] == '?') {
+                        int n = parse_params(Body.substr(1), p, 64);
+                        Caps.Responded = true;
+                        Caps.DeviceClass = n > 0 ? p[0] : 0;
+                        for (int k = 1; k < n; ++k) {
+                            if (p[k] < 64) Caps.Attributes |= uint64_t(1) << p[k];
+                        }
+                    }
+                    else if (Final == 'c' && !Body.empty() && Body[0] == '>') {
+                        int n = parse_params(Body.substr(1), p, 64);
+                        if (n > 0) Caps.TerminalType = p[0];
+                        if (n > 1) Caps.FirmwareVersion = p[1];
+                    }
+                    else if (Final == 'y' && Body.size() > 2 && Body[0] == '?' && Body.back() == '$') {
+                        // DECRPM: CSI ? mode ; state $ y
+                        int n = parse_params(Body.substr(1, Body.size() - 2), p, 64);
+                        if (n == 2) {
+                            if (p[0] == 2026) Caps.SynchronizedOutput = p[1];
+                            else if (p[0] == 2004) Caps.BracketedPaste = p[1];
+                            else if (p[0] == 1006) Caps.SgrMouse = p[1];
+                        }
+                    }
+                    else if (Final == 'u' && !Body.empty() && Body[0] == '?') {
+                        // Kitty keyboard: CSI ? flags u
+                        int n = parse_params(Body.substr(1), p, 64);
+                        Caps.KeyboardFlags = n > 0 ? p[0] : 0;
+                    }
+                    i = j + 1;
+                }
+                else if (Kind == ']' || Kind == 'P') {
+                    // OSC or DCS string terminated by BEL or ST
+                    size_t j = i + 2;
+                    size_t End = std::string_view::npos;
+                    size_t Next = 0;
+                    for (; j < Replies.size(); ++j) {
+                        if (Replies[j] == '\x07') { End = j; Next = j + 1; break; }
+                        if (Replies[j] == '\x1b' && j + 1 < Replies.size() && Replies[j + 1] == '\\') {
+                            End = j; Next = j + 2; break;
+                        }
+                    }
+                    if (End == std::string_view::npos) {
+                        keep(i, Replies.size());
+                        break;
+                    }
+                    std::string_view Body = Replies.substr(i + 2, End - i - 2);
+                    if (Kind == 'P' && Body.substr(0, 2) == ">|") {
+                        Caps.Version = std::string(Body.substr(2));
+                    }
+                    else if (Kind == ']') {
+                        if (Body.substr(0, 4) == "4;0;") {
+                            Caps.HasPalette = parse_color_spec(Body.substr(4), Caps.Palette0);
+                        }
+                        else if (Body.substr(0, 3) == "10;") {
+                            Caps.HasForeground = parse_color_spec(Body.substr(3), Caps.Foreground);
+                        }
+                        else if (Body.substr(0, 3) == "11;") {
+                            Caps.HasBackground = parse_color_spec(Body.substr(3), Caps.Background);
+                        }
+                    }
+                    i = Next;
+                }
+                else {
+                    keep(i, i + 1);
+                    ++i;
+                }
+            }
+            return Caps.Responded;
+        }
+
+        /**
+         * @brief Build the cache key from the environment
+         *
+         * @return "TERM|TERM_PROGRAM|TERM_PROGRAM_VERSION"
+         */
+        inline std::string cache_key() {
+            auto env = [](const char* Name) {
+                const char* Value = std::getenv(Name);
+                return std::string(Value ? Value : "");
+            };
+            return env("TERM") + "|" + env("TERM_PROGRAM") + "|" + env("TERM_PROGRAM_VERSION");
+        }
+
+        /**
+         * @brief Get the cache file location for a key
+         *
+         * Uses $XDG_CACHE_HOME, falling back to $HOME/.cache. The file name is
+         * a hash of the key; the key itself is stored inside and verified.
+         *
+         * @param Key Cache key from cache_key()
+         * @return Path of the cache file, empty if no cache directory exists
+         */
+        inline std::filesystem::path cache_path(std::string_view Key) {
+            std::filesystem::path Dir;
+            if (const char* Xdg = std::getenv("XDG_CACHE_HOME"); Xdg && *Xdg) {
+                Dir = Xdg;
+            }
+            else if (const char* Home = std::getenv("HOME"); Home && *Home) {
+                Dir = std::filesystem::path(Home) / ".cache";
+            }
+            else {
+                return {};
+            }
+
+            // FNV-1a over the key keeps file names short and filesystem-safe
+            uint64_t Hash{ 14695981039346656037ull };
+            for (char ch : Key) {
+                Hash = (Hash ^ static_cast<unsigned char>(ch)) * 1099511628211ull;
+            }
+            char Name[32];
+            std::snprintf(Name, sizeof(Name), "caps-%016llx", static_cast<unsigned long long>(Hash));
+            return Dir / "terminal_utils" / Name;
+        }
+
+        /**
+         * @brief Save capabilities to the cache
+         *
+         * @param Key Cache key
+         * @param Caps Capabilities to save
+         * @return true if error
+         */
+        inline bool save(std::string_view Key, terminal_capabilities const& Caps) noexcept {
+            try {
+                std::filesystem::path Path = cache_path(Key);
+                if (Path.empty()) return true;
+                std::error_code ec;
+                std::filesystem::create_directories(Path.parent_path(), ec);
+                if (ec) return true;
+
+                // Write to a temporary file and rename so readers never see a
+                // partial file; the name is unique so concurrent probes do not collide
+                std::filesystem::path Temp = Path;
+                Temp += std::format(".{:08x}{:x}.tmp", std::random_device{}(),
+                    static_cast<unsigned long long>(std::chrono::steady_clock::now().time_since_epoch().count()));
+                {
+                    std::ofstream f(Temp, std::ios::trunc);
+                    if (!f) return true;
+                    f << "version=" << CACHE_VERSION << '\n'
+                        << "key=" << Key << '\n'
+                        << "responded=" << Caps.Responded << '\n'
+                        << "device_class=" << Caps.DeviceClass << '\n'
+                        << "attributes=" << Caps.Attributes << '\n'
+                        << "terminal_type=" << Caps.TerminalType << '\n'
+                        << "firmware=" << Caps.FirmwareVersion << '\n'
+                        << "xtversion=" << Caps.Version << '\n'
+                        << "mode2026=" << Caps.SynchronizedOutput << '\n'
+                        << "mode2004=" << Caps.BracketedPaste << '\n'
+                        << "mode1006=" << Caps.SgrMouse << '\n'
+                        << "kitty_keyboard=" << Caps.KeyboardFlags << '\n'
+                        << "palette0=" << (Caps.HasPalette ? int64_t(Caps.Palette0.value()) : -1) << '\n'
+                        << "foreground=" << (Caps.HasForeground ? int64_t(Caps.Foreground.value()) : -1) << '\n'
+                        << "background=" << (Caps.HasBackground ? int64_t(Caps.Background.value()) : -1) << '\n';
+                    if (!f) return true;
+                }
+                std::filesystem::rename(Temp, Path, ec);
+                if (ec) {
+                    std::filesystem::remove(Temp, ec);
+                    return true;
+                }
+                return false;
+            }
+            catch (...) {
+                return true;
+            }
+        }
+
+        /**
+         * @brief Load capabilities from the cache
+         *
+         * @param Key Cache key
+         * @param Caps Loaded capabilities
+         * @return true if error (no entry, stale version, key mismatch or an
+         *         expired entry for a terminal that never answered)
+         */
+        inline bool load(std::string_view Key, terminal_capabilities& Caps) noexcept {
+            try {
+                std::filesystem::path Path = cache_path(Key);
+                if (Path.empty()) return true;
+                std::ifstream f(Path);
+                if (!f) return true;
+
+                terminal_capabilities Loaded;
+                bool VersionOk{ false };
+                bool KeyOk{ false };
+                std::string Line;
+                while (std::getline(f, Line)) {
+                    size_t Eq = Line.find('=');
+                    if (Eq == std::string::npos) continue;
+                    std::string_view Name = std::string_view(Line).substr(0, Eq);
+                    std::string Value = Line.substr(Eq + 1);
+                    auto number = [&Value]() { return std::strtoll(Value.c_str(), nullptr, 10); };
+                    auto color = [&](bool& Has, rgb& Out) {
+                        long long v = number();
+                        Has = v >= 0;
+                        if (Has) Out = rgb(uint32_t(v));
+                    };
+
+                    if (Name == "version") VersionOk = number() == CACHE_VERSION;
+                    else if (Name == "key") KeyOk = Value == Key;
+                    else if (Name == "responded") Loaded.Responded = number() != 0;
+                    else if (Name == "device_class") Loaded.DeviceClass = int(number());
+                    else if (Name == "attributes") Loaded.Attributes = std::strtoull(Value.c_str(), nullptr, 10);
+                    else if (Name == "terminal_type") Loaded.TerminalType = int(number());
+                    else if (Name == "firmware") Loaded.FirmwareVersion = int(number());
+                    else if (Name == "xtversion") Loaded.Version = Value;
+                    else if (Name == "mode2026") Loaded.SynchronizedOutput = int(number());
+                    else if (Name == "mode2004") Loaded.BracketedPaste = int(number());
+                    else if (Name == "mode1006") Loaded.SgrMouse = int(number());
+                    else if (Name == "kitty_keyboard") Loaded.KeyboardFlags = int(number());
+                    else if (Name == "palette0") color(Loaded.HasPalette, Loaded.Palette0);
+                    else if (Name == "foreground") color(Loaded.HasForeground, Loaded.Foreground);
+                    else if (Name == "background") color(Loaded.HasBackground, Loaded.Background);
+                }
+                if (!VersionOk || !KeyOk) return true;
+                if (!Loaded.Responded) {
+                    std::error_code ec;
+                    auto Written = std::filesystem::last_write_time(Path, ec);
+                    if (ec || std::filesystem::file_time_type::clock::now() - Written > SILENT_CACHE_LIFE) {
+                        return true;
+                    }
+                }
+
+                Loaded.FromCache = true;
+                Caps = Loaded;
+                return false;
+            }
+            catch (...) {
+                return true;
+            }
+        }
+
+    } // namespace caps
+
+} // namespace mz
+
+#endif // MZ_TERMINAL_CAPABILITIES_H
@@ -23,6 +23,7 @@
 */
 
 #include "TerminalManager.h"
+#include "StartupProfiler.h"
 #include <iostream>
 #include <string>
 
@@ -36,12 +37,16 @@
 #include <unistd.h>
 #include <termios.h>
 #include <signal.h>
+#include <poll.h>
+#include <chrono>
 #elif defined(__linux__) || defined(__unix__) || defined(__unix)
 #define MZ_PLATFORM_UNIX
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <termios.h>
 #include <signal.h>
+#include <poll.h>
+#include <chrono>
 #else
 #define MZ_PLATFORM_UNKNOWN
 // Minimal implementation for unknown platforms
@@ -397,8 +402,9 @@ namespace mz {
                 default: clearCommand = L"\x1b[2J\x1b[H"; break; // Clear screen and home
                 }
 
-                DWORD written;
-                WriteConsoleW(stdOutHandle, clearCommand, wcslen(clearCommand), &written, NULL);
+                // Through mz::Write so that an installed OutputTap sees the clear
+                mz::Write(std::wstring_view(clearCommand));
+                fflush(stdout);
             }
             else {
                 // Fallback for terminals without ANSI support
@@ -452,6 +458,11 @@ namespace mz {
             return size;
         }
 
+        int ProbeCapabilities(TerminalManager*, int) noexcept {
+            // Console capabilities are known from the console mode
+            return 0;
+        }
+
         bool SupportsAnsi() const noexcept {
             return (newConsoleMode & ENABLE_VIRTUAL_TERMINAL_PROCESSING) != 0;
         }
@@ -601,13 +612,15 @@ namespace mz {
             default: clearCommand = "\x1b[2J\x1b[H"; break; // Clear screen and home
             }
 
-            write(STDOUT_FILENO, clearCommand, strlen(clearCommand));
+            // Through mz::Write so that an installed OutputTap sees the clear
+            mz::Write(std::string_view(clearCommand));
+            fflush(stdout);
         }
 
         void ClearAll() noexcept {
             // Clear screen and scrollback buffer
-            const char* clearCommand = "\x1b[2J\x1b[3J\x1b[H";
-            write(STDOUT_FILENO, clearCommand, strlen(clearCommand));
+            mz::Write(std::string_view("\x1b[2J\x1b[3J\x1b[H"));
+            fflush(stdout);
         }
 
         coord GetTerminalSize() const noexcept {
@@ -622,6 +635,76 @@ namespace mz {
             return size;
         }
 
+        int ProbeCapabilities(TerminalManager* mgr, int timeoutMs) noexcept {
+            if (!isatty(STDIN_FILENO) || !isatty(STDOUT_FILENO)) {
+                return 1;
+            }
+
+            int error = 0;
+            std::string key = caps::cache_key();
+            terminal_capabilities found;
+
+            if (caps::load(key, found)) {
+                // Cache miss: read replies without echo or line buffering
+                struct termios saved;
+                tcgetattr(STDIN_FILENO, &saved);
+                struct termios quiet = saved;
+                quiet.c_lflag &= ~(ICANON | ECHO);
+                quiet.c_cc[VMIN] = 0;
+                quiet.c_cc[VTIME] = 0;
+                tcsetattr(STDIN_FILENO, TCSANOW, &quiet);
+
+                // Flush pending library output so the queries follow it
+                fflush(stdout);
+                write(STDOUT_FILENO, caps::QUERIES.data(), caps::QUERIES.size());
+
+                std::string replies;
+                char buffer[512];
+                auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+                while (!caps::parse_replies(replies, found)) {
+                    auto remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                        deadline - std::chrono::steady_clock::now()).count();
+                    if (remaining <= 0) {
+                        break;
+                    }
+                    struct pollfd pfd { STDIN_FILENO, POLLIN, 0 };
+                    if (poll(&pfd, 1, int(remaining)) <= 0) {
+                        continue;
+                    }
+                    ssize_t n = read(STDIN_FILENO, buffer, sizeof(buffer));
+                    if (n > 0) {
+                        replies.append(buffer, size_t(n));
+                    }
+                }
+
+                tcsetattr(STDIN_FILENO, TCSANOW, &saved);
+
+                // Keystrokes typed during the probe go back to the key reader;
+                // replies that arrive after the timeout are skipped by read_key()
+                std::string keys;
+                caps::parse_replies(replies, found, &keys);
+                if (!keys.empty()) {
+                    unread_input(keys);
+                }
+
+                // A silent terminal is cached too, so later runs do not wait again
+                if (caps::save(key, found)) {
+                    std::cerr << "ERROR: Failed to write terminal capability cache." << std::endl;
+                    error += 4;
+                }
+            }
+
+            if (!found.Responded) {
+                // No answer: keep the defaults
+                return error + 2;
+            }
+
+            mgr->capabilities = found;
+            supportsAnsi = found.supports_ansi();
+            supportsColor = found.supports_color();
+            return error;
+        }
+
         bool SupportsAnsi() const noexcept {
             return supportsAnsi;
         }
@@ -665,17 +748,21 @@ namespace mz {
 
         void ClearScreen(int) noexcept {
             // Try ANSI clear screen, may or may not work
-            std::cout << "\x1b[2J\x1b[H" << std::flush;
+            mz::Write(std::string_view("\x1b[2J\x1b[H"));
+            fflush(stdout);
         }
 
         void ClearAll() noexcept {
-            std::cout << "\x1b[2J\x1b[H" << std::flush;
+            mz::Write(std::string_view("\x1b[2J\x1b[H"));
+            fflush(stdout);
         }
 
         coord GetTerminalSize() const noexcept {
             return coord{ 24, 80 }; // Default size
         }
 
+        int ProbeCapabilities(TerminalManager*, int) noexcept { return 1; }
+
         bool SupportsAnsi() const noexcept { return false; }
         bool SupportsColor() const noexcept { return false; }
         bool SupportsCursorPositioning() const noexcept { return false; }
@@ -688,7 +775,10 @@ namespace mz {
 
     TerminalManager::TerminalManager() noexcept : pImpl(std::make_unique<PlatformImpl>()) {}
 
-    TerminalManager::~TerminalManager() noexcept = default;
+    TerminalManager::~TerminalManager() noexcept {
+        disable_focus_reporting();
+        disable_kitty_keyboard();
+    }
 
     int TerminalManager::set_font(std::wstring_view fontFamily, int fontSize) noexcept {
         return pImpl->SetFont(fontFamily, fontSize);
@@ -757,12 +847,189 @@ namespace mz {
             error += err;
         }
 
+        // Learn terminal capabilities; a silent terminal keeps the defaults
+        probe_capabilities();
+
         // Clear the screen
         clear_all();
 
         return error;
     }
 
+    int TerminalManager::probe_capabilities(int timeoutMs) noexcept {
+        return pImpl->ProbeCapabilities(this, timeoutMs);
+    }
+
+    const terminal_capabilities& TerminalManager::get_capabilities() const noexcept {
+        return capabilities;
+    }
+
+    int TerminalManager::enable_kitty_keyboard(int flags) noexcept {
+#ifdef MZ_PLATFORM_WINDOWS
+        (void)flags;
+        return 1;
+#else
+        if (!capabilities.Responded) {
+            probe_capabilities();
+        }
+        if (!capabilities.supports_kitty_keyboard()) {
+            return 1;
+        }
+
+        // Push once so the terminal's stack is balanced; later calls replace the top entry
+        std::string sequence = std::string("\x1b[") + (kittyKeyboardPushed ? '=' : '>') + std::to_string(flags) + 'u';
+        fflush(stdout);
+        if (write(STDOUT_FILENO, sequence.data(), sequence.size()) < 0) {
+            return 1;
+        }
+        kittyKeyboardPushed = true;
+        KittyKeyboardFlags = flags;
+        return 0;
+#endif
+    }
+
+    int TerminalManager::enable_focus_reporting() noexcept {
+#ifdef MZ_PLATFORM_WINDOWS
+        return 1;
+#else
+        if (focusReporting) {
+            return 0;
+        }
+        // A running EventLoop may have switched the mode on already
+        if (FocusReportUsers == 0) {
+            fflush(stdout);
+            if (write(STDOUT_FILENO, "\x1b[?1004h", 8) < 0) {
+                return 1;
+            }
+        }
+        ++FocusReportUsers;
+        focusReporting = true;
+        return 0;
+#endif
+    }
+
+    void TerminalManager::disable_focus_reporting() noexcept {
+#ifndef MZ_PLATFORM_WINDOWS
+        if (!focusReporting) {
+            return;
+        }
+        focusReporting = false;
+        if (--FocusReportUsers > 0) {
+            return;
+        }
+        fflush(stdout);
+        write(STDOUT_FILENO, "\x1b[?1004l", 8);
+        TerminalFocused = true;
+#endif
+    }
+
+    void TerminalManager::disable_kitty_keyboard() noexcept {
+#ifndef MZ_PLATFORM_WINDOWS
+        if (!kittyKeyboardPushed) {
+            return;
+        }
+        fflush(stdout);
+        write(STDOUT_FILENO, "\x1b[<u", 4);
+        kittyKeyboardPushed = false;
+        KittyKeyboardFlags = 0;
+#endif
+    }
+
+    int TerminalManager::setup_lazy(int numRows, int numCols) noexcept {
+        startup_timeline& timeline = startup_profile();
+        timeline.mark(L"setup begin");
+        int error = 0;
+
+        if (int err = get_standard_handles(); err != 0) {
+            return err;
+        }
+        timeline.mark(L"standard handles");
+
+        // UTF-8 and escape sequence processing are needed by the first frame
+        if (int err = set_code_page(); err != 0) {
+            error += err;
+        }
+        if (int err = set_console_mode(); err != 0) {
+            error += err;
+        }
+        timeline.mark(L"console mode");
+
+        // Lay out against the current size; resizing happens when idle
+        if (int err = get_console_size(); err != 0) {
+            error += err;
+        }
+        window.Top = coord{ 0, 0 };
+        window.set_size(oldWindow.get_size());
+
+        // A plain clear is enough; clearing scrollback would cost a repaint later
+        cls();
+        timeline.mark(L"screen cleared");
+
+        pendingRows = numRows;
+        pendingCols = numCols;
+        setupPending = true;
+        idle_tasks().defer(L"finish terminal setup", [this, alive = idleGuard.watch()] {
+            if (alive.expired()) return;
+            finish_setup();
+        });
+
+        return error;
+    }
+
+    int TerminalManager::setup_inline() noexcept {
+        int error = 0;
+
+        if (int err = get_standard_handles(); err != 0) {
+            return err;
+        }
+
+        if (int err = set_code_page(); err != 0) {
+            error += err;
+        }
+
+#ifdef MZ_PLATFORM_WINDOWS
+        // Windows needs virtual terminal processing; Unix terminals keep cooked mode
+        if (int err = set_console_mode(); err != 0) {
+            error += err;
+        }
+#endif
+
+        // The current size bounds the rows a live region can use
+        if (int err = get_console_size(); err != 0) {
+            error += err;
+        }
+        window.Top = coord{ 0, 0 };
+        window.set_size(oldWindow.get_size());
+
+        probe_capabilities();
+        return error;
+    }
+
+    int TerminalManager::finish_setup() noexcept {
+        if (!setupPending) {
+            return 0;
+        }
+        setupPending = false;
+        int error = 0;
+
+#ifdef MZ_PLATFORM_WINDOWS
+        if (int err = set_font(L"Cascadia Code", 18); err != 0) {
+            error += err;
+        }
+#endif
+
+        if (int err = set_console_size(pendingRows, pendingCols); err != 0) {
+            error += err;
+        }
+
+        if (int err = set_console_style(); err != 0) {
+            error += err;
+        }
+
+        probe_capabilities();
+        return error;
+    }
+
     void TerminalManager::cls(int mode) noexcept {
         pImpl->ClearScreen(mode);
     }
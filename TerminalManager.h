@@ -5,6 +5,8 @@
 #include "ConsoleCMD.h"
 #include "coord.h"
 #include "cursor.h"
+#include "TerminalCapabilities.h"
+#include "StartupProfiler.h"
 
 namespace mz {
 
@@ -91,6 +93,69 @@ namespace mz {
          */
         int set_code_page() noexcept;
 
+        /**
+         * @brief Query terminal capabilities
+         *
+         * Sends DA1, DA2, XTVERSION, DECRQM, kitty keyboard and OSC color queries in a single
+         * batch and parses the replies until the DA1 answer arrives or the
+         * timeout expires. Results are cached on disk keyed by TERM,
+         * TERM_PROGRAM and TERM_PROGRAM_VERSION, so later runs skip the
+         * round-trip; a terminal that did not answer is not probed again
+         * for a day. Keys typed during the probe are kept for read_key().
+         *
+         * @param timeoutMs Maximum time to wait for replies in milliseconds
+         * @return 0 on success, 2 if the terminal did not answer, other error code on failure
+         */
+        int probe_capabilities(int timeoutMs = 250) noexcept;
+
+        /**
+         * @brief Get the capabilities learned by probe_capabilities()
+         *
+         * @return Capability set (all unknown before probing)
+         */
+        const terminal_capabilities& get_capabilities() const noexcept;
+
+        /**
+         * @brief Switch the keyboard to the kitty keyboard protocol
+         *
+         * Pushes the flags with CSI > flags u when the terminal answered the
+         * capability probe for it (probing first if needed). Keys then arrive
+         * unambiguously: Escape no longer waits for a timeout, modified keys
+         * such as Ctrl+I and Tab differ, and with KITTY_EVENT_TYPES read_key()
+         * reports repeats and releases. The previous mode is restored by
+         * disable_kitty_keyboard() or on destruction. Keys typed while the
+         * probe waits for its replies are queued again for read_key().
+         *
+         * @param flags KITTY_* flags to request
+         * @return 0 on success, 1 if the terminal does not support the protocol
+         */
+        int enable_kitty_keyboard(int flags = KITTY_DISAMBIGUATE | KITTY_EVENT_TYPES) noexcept;
+
+        /**
+         * @brief Restore the keyboard mode in effect before enable_kitty_keyboard()
+         */
+        void disable_kitty_keyboard() noexcept;
+
+        /**
+         * @brief Ask the terminal to report focus changes
+         *
+         * Enables mode 1004; focus-in and focus-out then arrive as CSI I and
+         * CSI O, which read_key() turns into FOCUSINKEY and FOCUSOUTKEY and
+         * records in TerminalFocused. Terminals without the mode ignore it.
+         * Only for applications that read input with read_key(): wgetch()
+         * skips the reports, so loops that poll key_pending() or wait_key()
+         * before calling wgetch() would block on them. EventLoop::run()
+         * enables the mode by itself. Undone on destruction.
+         *
+         * @return 0 on success, 1 if not available on this platform
+         */
+        int enable_focus_reporting() noexcept;
+
+        /**
+         * @brief Stop focus reports and assume the terminal is focused
+         */
+        void disable_focus_reporting() noexcept;
+
         /**
          * @brief Setup the terminal with default settings
          *
@@ -100,6 +165,45 @@ namespace mz {
          */
         int setup(int numRows, int numCols) noexcept;
 
+        /**
+         * @brief Setup the terminal for the fastest possible first frame
+         *
+         * Performs only what the first paint needs: standard handles, UTF-8
+         * code page, console mode and the current window size, followed by a
+         * plain screen clear. Font, window size, window style and capability
+         * probing are deferred to idle_tasks() and run by finish_setup().
+         * Each step is marked on startup_profile().
+         *
+         * @param numRows Number of rows requested
+         * @param numCols Number of columns requested
+         * @return 0 on success, error code on failure
+         */
+        int setup_lazy(int numRows, int numCols) noexcept;
+
+        /**
+         * @brief Setup the terminal for inline output below the shell prompt
+         *
+         * For command-line tools that show a few live lines (see
+         * LiveRegion) instead of a full-screen interface. Selects UTF-8 and
+         * escape sequence processing and probes capabilities, but leaves the
+         * screen, its size, the scrollback and the line discipline alone,
+         * so Ctrl+C still interrupts the tool.
+         *
+         * @return 0 on success, error code on failure
+         */
+        int setup_inline() noexcept;
+
+        /**
+         * @brief Complete the setup steps skipped by setup_lazy()
+         *
+         * Queued on idle_tasks() by setup_lazy(); calling it directly is only
+         * needed when the idle queue is never drained. Does nothing when no
+         * lazy setup is pending.
+         *
+         * @return 0 on success, error code on failure
+         */
+        int finish_setup() noexcept;
+
         /**
          * @brief Clear the screen
          *
@@ -159,6 +263,23 @@ namespace mz {
         // Default cursor settings
         cursor defaults;
 
+        // Capabilities reported by the terminal
+        terminal_capabilities capabilities;
+
+        // Keyboard protocol flags pushed by enable_kitty_keyboard()
+        bool kittyKeyboardPushed{ false };
+
+        // Focus reporting (mode 1004) switched on by enable_focus_reporting()
+        bool focusReporting{ false };
+
+        // Setup deferred by setup_lazy()
+        int pendingRows{ 0 };
+        int pendingCols{ 0 };
+        bool setupPending{ false };
+
+        // Lets deferred tasks detect that the manager is gone
+        idle_guard idleGuard;
+
         // Screen size in pixels (when available)
         int screenPixelWidth{ 0 };
         int screenPixelHeight{ 0 };
@@ -0,0 +1,157 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_TEXT_ENCODING_H
+#define MZ_TEXT_ENCODING_H
+#pragma once
+
+/**
+ * @file TextEncoding.h
+ * @brief Non-throwing conversion between wide strings and UTF-8
+ *
+ * Unlike the conversions of std::filesystem::path, these never throw for
+ * text that has no representation on the other side: anything that cannot
+ * be converted becomes U+FFFD. Used where a path crosses between the wide
+ * strings of the widgets and the bytes of the file system inside code that
+ * must not throw.
+ *
+ * @author Meysam Zare
+ */
+
+#include <string>
+#include <string_view>
+
+namespace mz {
+
+    /**
+     * @brief Append wide text as UTF-8
+     *
+     * Surrogate pairs are combined where wchar_t is 16 bits; lone surrogates
+     * and values beyond U+10FFFF become U+FFFD.
+     *
+     * @return true if some of the text had to be replaced
+     */
+    inline bool encode_utf8(std::string& Out, std::wstring_view Text) {
+        bool Replaced{ false };
+        for (size_t i = 0; i < Text.size(); i++) {
+            auto Code = static_cast<char32_t>(Text[i]);
+            if (Code >= 0xD800 && Code < 0xDC00 && i + 1 < Text.size()) {
+                auto Low = static_cast<char32_t>(Text[i + 1]);
+                if (Low >= 0xDC00 && Low < 0xE000) {
+                    Code = 0x10000 + ((Code - 0xD800) << 10) + (Low - 0xDC00);
+                    ++i;
+                }
+            }
+            if ((Code >= 0xD800 && Code < 0xE000) || Code > 0x10FFFF) {
+                Code = 0xFFFD;
+                Replaced = true;
+            }
+            if (Code < 0x80) {
+                Out.push_back(static_cast<char>(Code));
+            }
+            else if (Code < 0x800) {
+                Out.push_back(static_cast<char>(0xC0 | (Code >> 6)));
+                Out.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+            }
+            else if (Code < 0x10000) {
+                Out.push_back(static_cast<char>(0xE0 | (Code >> 12)));
+                Out.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+                Out.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+            }
+            else {
+                Out.push_back(static_cast<char>(0xF0 | (Code >> 18)));
+                Out.push_back(static_cast<char>(0x80 | ((Code >> 12) & 0x3F)));
+                Out.push_back(static_cast<char>(0x80 | ((Code >> 6) & 0x3F)));
+                Out.push_back(static_cast<char>(0x80 | (Code & 0x3F)));
+            }
+        }
+        return Replaced;
+    }
+
+    /**
+     * @brief Append UTF-8 text as wide text
+     *
+     * Each byte that does not start a well-formed sequence (truncated,
+     * overlong, surrogate or beyond U+10FFFF) becomes U+FFFD. Where wchar_t
+     * is 16 bits, characters beyond U+FFFF become surrogate pairs.
+     */
+    inline void decode_utf8(std::wstring& Out, std::string_view Text) {
+        for (size_t i = 0; i < Text.size();) {
+            auto c = static_cast<unsigned char>(Text[i]);
+            if (c < 0x80) {
+                Out.push_back(static_cast<wchar_t>(c));
+                ++i;
+                continue;
+            }
+            size_t Len = c >= 0xF8 ? 0 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC2 ? 2 : 0;
+            char32_t Code = c & (0x7F >> Len);
+            bool Valid = Len != 0 && i + Len <= Text.size();
+            for (size_t k = 1; Valid && k < Len; k++) {
+                auto d = static_cast<unsigned char>(Text[i + k]);
+                Valid = (d & 0xC0) == 0x80;
+                Code = (Code << 6) | (d & 0x3F);
+            }
+            constexpr char32_t Least[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+            if (!Valid || Code < Least[Len] || (Code >= 0xD800 && Code < 0xE000) || Code > 0x10FFFF) {
+                Out.push_back(static_cast<wchar_t>(0xFFFD));
+                ++i;
+                continue;
+            }
+            if constexpr (sizeof(wchar_t) == 2) {
+                if (Code >= 0x10000) {
+                    Code -= 0x10000;
+                    Out.push_back(static_cast<wchar_t>(0xD800 + (Code >> 10)));
+                    Out.push_back(static_cast<wchar_t>(0xDC00 + (Code & 0x3FF)));
+                    i += Len;
+                    continue;
+                }
+            }
+            Out.push_back(static_cast<wchar_t>(Code));
+            i += Len;
+        }
+    }
+
+    /**
+     * @brief Get wide text as UTF-8
+     */
+    inline std::string to_utf8(std::wstring_view Text) {
+        std::string Out;
+        Out.reserve(Text.size());
+        encode_utf8(Out, Text);
+        return Out;
+    }
+
+    /**
+     * @brief Get UTF-8 text as wide text
+     */
+    inline std::wstring from_utf8(std::string_view Text) {
+        std::wstring Out;
+        Out.reserve(Text.size());
+        decode_utf8(Out, Text);
+        return Out;
+    }
+
+} // namespace mz
+
+#endif // MZ_TEXT_ENCODING_H
@@ -44,6 +44,8 @@
 #include <climits>
 #include "FrameBox.h"
 #include "InputControl.h"
+#include "TokenValidation.h"
+#include "PathCompletion.h"
 
 namespace mz {
 
@@ -80,7 +82,7 @@ namespace mz {
             case TokenType::user:
             {
                 // Add username validation flags
-                Error |= username_error(Token.Text, Min, Max);
+                Error |= validate_token(Token.Text, rule());
 
                 // Display validation rules with red highlighting for failed rules
                 MsgBox.insert_line(std::format(L"must be {}-{} characters.", Min, Max),
@@ -96,18 +98,9 @@ namespace mz {
             } break;
 
             case TokenType::signed_integer:
-            case TokenType::unsigned_integer:
             {
-                // Parse and validate the number
-                long long Res = string_to_signed(Token.Text);
-
-                if (Res == LLONG_MIN) {
-                    Error |= 1;  // Parse error
-                }
-                else {
-                    Error |= (!!(Res < Min)) << 1;  // Too small
-                    Error |= (!!(Res > Max)) << 2;  // Too large
-                }
+                // Parse over the full 64-bit range and check the bounds
+                Error |= validate_token(Token.Text, rule());
 
                 // Display validation rules with red highlighting for failed rules
                 MsgBox.insert_line(L"must be an integer.",
@@ -118,11 +111,41 @@ namespace mz {
                     Error & 4 ? mz::color::RED : FrontColor);
             } break;
 
+            case TokenType::unsigned_integer:
+            {
+                // Bounds are unsigned, so Max may exceed LLONG_MAX
+                Error |= validate_token(Token.Text, rule());
+
+                // Display validation rules with red highlighting for failed rules
+                MsgBox.insert_line(L"must be a non-negative integer.",
+                    Error & 1 ? mz::color::RED : FrontColor);
+                MsgBox.insert_line(std::format(L"must be >= {}", static_cast<unsigned long long>(Min)),
+                    Error & 2 ? mz::color::RED : FrontColor);
+                MsgBox.insert_line(std::format(L"must be <= {}", static_cast<unsigned long long>(Max)),
+                    Error & 4 ? mz::color::RED : FrontColor);
+            } break;
+
+            case TokenType::floating_point:
+            {
+                Error |= validate_token(Token.Text, rule());
+                MsgBox.insert_line(L"must be a number.",
+                    Error & 1 ? mz::color::RED : FrontColor);
+            } break;
+
+            case TokenType::file:
+            case TokenType::directory:
+            {
+                Error |= validate_token(Token.Text, rule());
+                MsgBox.insert_line(L"must exist.",
+                    Error & 1 ? mz::color::RED : FrontColor);
+                MsgBox.insert_line(Type == TokenType::file ? L"must be a file." : L"must be a directory.",
+                    Error & 2 ? mz::color::RED : FrontColor);
+            } break;
+
             case TokenType::bounded_length:
             {
                 // Add length and character validation flags
-                Error |= username_error(Token.Text, Min, Max);
-                Error &= ~14;  // Clear unused flags
+                Error |= validate_token(Token.Text, rule());
 
                 // Display validation rules with red highlighting for failed rules
                 MsgBox.insert_line(std::format(L"must be {}-{} characters.", Min, Max),
@@ -142,19 +165,9 @@ namespace mz {
 
     public:
         /**
-         * @enum TokenType
          * @brief Types of tokens with different validation rules
          */
-        enum class TokenType {
-            none = 0,             ///< No validation
-            user = 1,             ///< Username validation (letters, numbers, length)
-            file = 2,             ///< File path validation
-            signed_integer = 3,   ///< Signed integer in range Min-Max
-            unsigned_integer = 4, ///< Unsigned integer in range Min-Max
-            floating_point = 5,   ///< Floating point number
-            bounded_length = 6,   ///< Text with length bounds
-            directory = 7,        ///< Directory path validation
-        };
+        using TokenType = token_type;
 
         /**
          * @brief Token type for validation
@@ -177,6 +190,20 @@ namespace mz {
          */
         long long Max{ 12 };
 
+        /**
+         * @brief Check whether the token is a file or directory path
+         */
+        bool is_path() const noexcept {
+            return Type == TokenType::file || Type == TokenType::directory;
+        }
+
+        /**
+         * @brief Get the type and bounds as a rule for validate_token()
+         */
+        token_rule rule() const noexcept {
+            return token_rule{ Type, Min, Max };
+        }
+
         /**
          * @brief Input control for token entry
          */
@@ -187,6 +214,11 @@ namespace mz {
          */
         MultilineMessageBox MsgBox;
 
+        /**
+         * @brief Tab completion, active for file and directory tokens
+         */
+        PathCompleter Completer;
+
         /**
          * @brief Initialize the token entry dialog
          *
@@ -215,6 +247,10 @@ namespace mz {
             MsgBox.Area = Area.pad_rows(4, 2).pad_cols(3, 1);
             MsgBox.clear();
 
+            // Completion candidates cover the messages while shown
+            Completer.Popup.Area = MsgBox.Area;
+            Completer.Popup.Color = Color;
+
             // Initialize the footer
             Footer.create(Area.bottom_rows(1));
             Footer.update_status(L"");
@@ -242,6 +278,15 @@ namespace mz {
 
             // Configure token input field size
             Token.set_size(16, 16);
+
+            // Complete paths for file and directory tokens
+            Token.OnKey = [this](InputControl& In, int Key) {
+                return is_path() && Completer.on_key(In, Key);
+            };
+            Token.OnChange = [this](InputControl& In) {
+                if (is_path()) Completer.on_change(In);
+            };
+            Completer.OnClose = [this] { MsgBox.print(); };
         }
 
         /**
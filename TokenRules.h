@@ -0,0 +1,124 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_TOKEN_RULES_H
+#define MZ_TOKEN_RULES_H
+#pragma once
+
+/**
+ * @file TokenRules.h
+ * @brief Error bits and character rules shared by the token validators
+ *
+ * Depends on nothing else in the library, so the core console functions
+ * (username_error()) and the batch validators (TokenValidation.h) apply
+ * the same rules without either layer including the other.
+ *
+ * @author Meysam Zare
+ */
+
+#include <string_view>
+#include <type_traits>
+#include <cstddef>
+
+namespace mz {
+
+    /**
+     * @struct token_error
+     * @brief Error bits returned by the validators (0 = valid)
+     *
+     * The meaning of a bit depends on the token type.
+     */
+    struct token_error {
+        // user and bounded_length
+        static constexpr int LENGTH = 1;        ///< Length outside Min-Max
+        static constexpr int NO_DIGIT = 2;      ///< Missing digit (user only)
+        static constexpr int NO_LOWER = 4;      ///< Missing lowercase letter (user only)
+        static constexpr int NO_UPPER = 8;      ///< Missing uppercase letter (user only)
+        static constexpr int BAD_CHAR = 16;     ///< Space or special character
+
+        // signed_integer, unsigned_integer and floating_point
+        static constexpr int PARSE = 1;         ///< Not a number, or out of the type's range
+        static constexpr int TOO_SMALL = 2;     ///< Less than Min
+        static constexpr int TOO_LARGE = 4;     ///< Greater than Max
+
+        // file and directory
+        static constexpr int MISSING = 1;       ///< Path does not exist
+        static constexpr int WRONG_KIND = 2;    ///< Directory where a file is expected, or the reverse
+        static constexpr int SPECIAL = 4;       ///< Neither a regular file nor a directory (device, FIFO, socket)
+    };
+
+    namespace detail {
+
+        /**
+         * @brief Character classes of ASCII, as the error bit each one clears
+         */
+        struct token_classes {
+            unsigned char Bits[128]{};
+
+            constexpr token_classes() noexcept {
+                for (int c = 0; c < 128; c++) Bits[c] = token_error::BAD_CHAR;
+                for (int c = '0'; c <= '9'; c++) Bits[c] = token_error::NO_DIGIT;
+                for (int c = 'a'; c <= 'z'; c++) Bits[c] = token_error::NO_LOWER;
+                for (int c = 'A'; c <= 'Z'; c++) Bits[c] = token_error::NO_UPPER;
+            }
+        };
+
+        inline constexpr token_classes TokenClasses{};
+
+        /**
+         * @brief Union of the classes of all characters of a token
+         *
+         * A branch-free loop over a table, which compilers vectorize.
+         */
+        inline int token_class_union(std::wstring_view Text) noexcept {
+            unsigned Seen{ 0 };
+            for (wchar_t w : Text) {
+                auto u = static_cast<std::make_unsigned_t<wchar_t>>(w);
+                Seen |= TokenClasses.Bits[u < 128 ? u : 0];
+            }
+            return static_cast<int>(Seen);
+        }
+
+        /**
+         * @brief Length and character errors of a user or bounded_length token
+         *
+         * The rules of username_error() and validate_token(), without the
+         * file system checks of the latter.
+         */
+        inline int text_token_error(std::wstring_view Text, long long Min, long long Max, bool User) noexcept {
+            int Error = (Text.size() < size_t(Min) || Text.size() > size_t(Max))
+                ? token_error::LENGTH : 0;
+            int Seen = token_class_union(Text);
+            Error |= Seen & token_error::BAD_CHAR;
+            if (User) {
+                Error |= ~Seen & (token_error::NO_DIGIT | token_error::NO_LOWER | token_error::NO_UPPER);
+            }
+            return Error;
+        }
+
+    } // namespace detail
+
+} // namespace mz
+
+#endif // MZ_TOKEN_RULES_H
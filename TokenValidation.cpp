@@ -0,0 +1,130 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#include "TokenValidation.h"
+#include <filesystem>
+#include <string>
+
+// Platform detection
+#if defined(_WIN32) || defined(_WIN64) || defined(_MSC_VER)
+#define MZ_PLATFORM_WINDOWS
+#elif defined(__APPLE__) || defined(__MACH__)
+#define MZ_PLATFORM_MACOS
+#include <sys/stat.h>
+#include <fcntl.h>
+#elif defined(__linux__) || defined(__unix__) || defined(__unix)
+#define MZ_PLATFORM_UNIX
+#include <sys/stat.h>
+#include <fcntl.h>
+#else
+#define MZ_PLATFORM_UNKNOWN
+#endif
+
+namespace mz {
+
+    namespace {
+
+        /**
+         * @brief Convert a path to the narrow encoding of the file system
+         *
+         * ASCII paths, the usual case, are copied without going through
+         * std::filesystem.
+         *
+         * @return true if error (the path cannot be converted)
+         */
+        bool narrow_path(std::wstring_view Path, std::string& Out) noexcept {
+            try {
+                Out.assign(Path.size(), '\0');
+                for (size_t i = 0; i < Path.size(); i++) {
+                    if (Path[i] <= 0 || Path[i] >= 0x80) {
+                        Out = std::filesystem::path(Path).string();
+                        return false;
+                    }
+                    Out[i] = static_cast<char>(Path[i]);
+                }
+                return false;
+            }
+            catch (...) {
+                return true;
+            }
+        }
+
+        /**
+         * @brief Error bits for an existing path of the given type
+         */
+        int kind_error(bool IsDirectory, bool IsRegular, bool Directory) noexcept {
+            if (Directory ? IsDirectory : IsRegular) return 0;
+            return token_error::WRONG_KIND | (IsDirectory || IsRegular ? 0 : token_error::SPECIAL);
+        }
+
+    } // namespace
+
+#if defined(MZ_PLATFORM_UNIX) && defined(STATX_TYPE)
+
+    int path_error(std::wstring_view Path, bool Directory) noexcept {
+        if (Path.empty()) return token_error::MISSING;
+        // Only the file type is needed, and cached attributes will do
+        std::string Narrow;
+        struct statx St;
+        if (narrow_path(Path, Narrow) ||
+            statx(AT_FDCWD, Narrow.c_str(), AT_STATX_DONT_SYNC, STATX_TYPE, &St) != 0) {
+            return token_error::MISSING;
+        }
+        return kind_error(S_ISDIR(St.stx_mode), S_ISREG(St.stx_mode), Directory);
+    }
+
+#elif defined(MZ_PLATFORM_MACOS) || defined(MZ_PLATFORM_UNIX)
+
+    int path_error(std::wstring_view Path, bool Directory) noexcept {
+        if (Path.empty()) return token_error::MISSING;
+        std::string Narrow;
+        struct stat St;
+        if (narrow_path(Path, Narrow) || fstatat(AT_FDCWD, Narrow.c_str(), &St, 0) != 0) {
+            return token_error::MISSING;
+        }
+        return kind_error(S_ISDIR(St.st_mode), S_ISREG(St.st_mode), Directory);
+    }
+
+#else
+
+    int path_error(std::wstring_view Path, bool Directory) noexcept {
+        if (Path.empty()) return token_error::MISSING;
+        std::filesystem::path Native;
+        try {
+            Native = std::filesystem::path(Path);
+        }
+        catch (...) {
+            return token_error::MISSING;
+        }
+        std::error_code Ec;
+        auto Status = std::filesystem::status(Native, Ec);
+        if (Ec || !std::filesystem::exists(Status)) {
+            return token_error::MISSING;
+        }
+        return kind_error(std::filesystem::is_directory(Status), std::filesystem::is_regular_file(Status), Directory);
+    }
+
+#endif
+
+} // namespace mz
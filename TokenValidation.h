@@ -0,0 +1,215 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_TOKEN_VALIDATION_H
+#define MZ_TOKEN_VALIDATION_H
+#pragma once
+
+/**
+ * @file TokenValidation.h
+ * @brief Headless validation of tokens, one at a time or in batches
+ *
+ * The rules behind TokenEntryControl, without a dialog: usernames, bounded
+ * text, integers over the full 64-bit range, floating-point numbers, files
+ * and directories. validate_tokens() checks a whole span of tokens, such as
+ * an imported list of usernames, and writes one error code per token. Large
+ * batches are split into chunks that run on a WorkerPool.
+ *
+ * @author Meysam Zare
+ */
+
+#include "ConsoleCMD.h"
+#include "TokenRules.h"
+#include "WorkerPool.h"
+#include <string>
+#include <string_view>
+#include <span>
+#include <vector>
+#include <type_traits>
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @enum token_type
+     * @brief Types of tokens with different validation rules
+     */
+    enum class token_type {
+        none = 0,             ///< No validation
+        user = 1,             ///< Username validation (letters, numbers, length)
+        file = 2,             ///< File path validation
+        signed_integer = 3,   ///< Signed integer in range Min-Max
+        unsigned_integer = 4, ///< Unsigned integer in range Min-Max
+        floating_point = 5,   ///< Floating point number
+        bounded_length = 6,   ///< Text with length bounds
+        directory = 7,        ///< Directory path validation
+    };
+
+    /**
+     * @struct token_rule
+     * @brief Token type and bounds
+     *
+     * For text types the bounds are lengths; for signed_integer they are
+     * values. For unsigned_integer they are read as unsigned long long, so a
+     * Max of -1 allows every 64-bit value. floating_point, file and directory
+     * ignore them.
+     */
+    struct token_rule {
+        token_type Type{ token_type::user };    ///< Validation to apply
+        long long Min{ 4 };                     ///< Minimum value/length
+        long long Max{ 12 };                    ///< Maximum value/length
+    };
+
+    /**
+     * @brief Check that a path names an existing file or directory
+     *
+     * A file must be a regular file. Paths of the wrong kind also carry
+     * token_error::SPECIAL when they are neither a file nor a directory.
+     *
+     * @param Path Path to check
+     * @param Directory true for a directory, false for a file
+     * @return token_error::MISSING or token_error::WRONG_KIND bits, 0 if valid
+     */
+    int path_error(std::wstring_view Path, bool Directory) noexcept;
+
+    namespace detail {
+
+        /**
+         * @brief Tokens per chunk of a parallel batch
+         */
+        inline constexpr size_t TokenChunk = 1024;
+
+        /**
+         * @brief Batches smaller than this run on the calling thread
+         */
+        inline constexpr size_t ParallelTokens = 4096;
+
+    } // namespace detail
+
+    /**
+     * @brief Validate one token
+     *
+     * Gives the same result as the interactive TokenEntryControl.
+     *
+     * @param Text Token to validate
+     * @param Rule Type and bounds
+     * @return Bitmask of token_error bits (0 if valid)
+     */
+    inline int validate_token(std::wstring_view Text, token_rule const& Rule) noexcept {
+        switch (Rule.Type) {
+        case token_type::user:
+        case token_type::bounded_length:
+            return detail::text_token_error(Text, Rule.Min, Rule.Max, Rule.Type == token_type::user);
+
+        case token_type::signed_integer:
+        {
+            long long Value{ 0 };
+            if (parse_signed(Text, Value)) return token_error::PARSE;
+            return (Value < Rule.Min ? token_error::TOO_SMALL : 0)
+                | (Value > Rule.Max ? token_error::TOO_LARGE : 0);
+        }
+
+        case token_type::unsigned_integer:
+        {
+            unsigned long long Value{ 0 };
+            if (parse_unsigned(Text, Value)) return token_error::PARSE;
+            return (Value < static_cast<unsigned long long>(Rule.Min) ? token_error::TOO_SMALL : 0)
+                | (Value > static_cast<unsigned long long>(Rule.Max) ? token_error::TOO_LARGE : 0);
+        }
+
+        case token_type::floating_point:
+        {
+            double Value{ 0 };
+            return parse_floating(Text, Value) ? token_error::PARSE : 0;
+        }
+
+        case token_type::file:
+            return path_error(Text, false);
+
+        case token_type::directory:
+            return path_error(Text, true);
+
+        default:
+            return 0;
+        }
+    }
+
+    /**
+     * @brief Validate a batch of tokens
+     *
+     * Writes the error code of Tokens[i] to Errors[i]. Batches of a few
+     * thousand tokens or more are validated in chunks on the pool.
+     *
+     * @code
+     * std::vector<int> Errors(Names.size());
+     * size_t Bad = validate_tokens(std::span(Names), { token_type::user, 4, 12 }, Errors);
+     * @endcode
+     *
+     * @param Tokens Tokens to validate
+     * @param Rule Type and bounds, shared by all tokens
+     * @param Errors Receives one code per token; must be as long as Tokens
+     * @param Pool Pool for large batches (nullptr for the shared pool)
+     * @return Number of invalid tokens
+     */
+    template <typename S>
+        requires std::is_convertible_v<S&, std::wstring_view>
+    size_t validate_tokens(std::span<S> Tokens, token_rule const& Rule,
+        std::span<int> Errors, WorkerPool* Pool = nullptr) noexcept {
+        size_t n = std::min(Tokens.size(), Errors.size());
+        auto validate_range = [&](size_t Begin, size_t End) {
+            size_t Bad{ 0 };
+            for (size_t i = Begin; i < End; i++) {
+                Errors[i] = validate_token(Tokens[i], Rule);
+                Bad += Errors[i] != 0;
+            }
+            return Bad;
+        };
+
+        if (n < detail::ParallelTokens) {
+            return validate_range(0, n);
+        }
+
+        std::atomic<size_t> Bad{ 0 };
+        size_t NumChunks = (n + detail::TokenChunk - 1) / detail::TokenChunk;
+        (Pool ? *Pool : WorkerPool::shared()).run(NumChunks, [&](size_t c) {
+            size_t Begin = c * detail::TokenChunk;
+            size_t End = std::min(n, Begin + detail::TokenChunk);
+            Bad.fetch_add(validate_range(Begin, End), std::memory_order_relaxed);
+            });
+        return Bad.load();
+    }
+
+    /**
+     * @brief Validate a batch of tokens held in a vector
+     */
+    inline size_t validate_tokens(std::vector<std::wstring> const& Tokens, token_rule const& Rule,
+        std::span<int> Errors, WorkerPool* Pool = nullptr) noexcept {
+        return validate_tokens(std::span<std::wstring const>(Tokens), Rule, Errors, Pool);
+    }
+
+} // namespace mz
+
+#endif // MZ_TOKEN_VALIDATION_H
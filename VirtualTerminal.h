@@ -0,0 +1,593 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_VIRTUAL_TERMINAL_H
+#define MZ_VIRTUAL_TERMINAL_H
+#pragma once
+
+/**
+ * @file VirtualTerminal.h
+ * @brief Headless terminal emulator for inspecting rendered output
+ *
+ * This file provides an in-memory terminal screen that interprets the same
+ * escape sequences the library emits (cursor positioning, relative moves,
+ * erase commands and 24-bit SGR colors). Output captured from a widget or
+ * from a program running on a pseudo-terminal can be fed into it and the
+ * resulting cell grid inspected without a real terminal attached.
+ *
+ * @author Meysam Zare
+ */
+
+#include "coord.h"
+#include "colors.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+
+namespace mz {
+
+    /**
+     * @struct vt_cell
+     * @brief A single character cell of the virtual screen
+     */
+    struct vt_cell {
+        static constexpr uint8_t BOLD{ 1 };       ///< Bold attribute bit
+        static constexpr uint8_t UNDERLINE{ 2 };  ///< Underline attribute bit
+        static constexpr uint8_t NEGATIVE{ 4 };   ///< Reverse video attribute bit
+        static constexpr uint8_t BLINK{ 8 };      ///< Blink attribute bit
+
+        char32_t Glyph{ U' ' };         ///< Unicode code point shown in the cell
+        rgb F{ color::SILVER };         ///< Foreground color
+        rgb B{ color::BLACK };          ///< Background color
+        uint8_t Attr{ 0 };              ///< Attribute bits
+
+        /**
+         * @brief Equality comparison operator
+         */
+        friend constexpr bool operator == (vt_cell const& L, vt_cell const& R) noexcept {
+            return L.Glyph == R.Glyph && L.F == R.F && L.B == R.B && L.Attr == R.Attr;
+        }
+    };
+
+    /**
+     * @brief Append a code point to a string as UTF-8
+     *
+     * @param Out Destination string
+     * @param Glyph Unicode code point
+     */
+    inline void append_utf8(std::string& Out, char32_t Glyph) {
+        if (Glyph < 0x80) {
+            Out += char(Glyph);
+        }
+        else if (Glyph < 0x800) {
+            Out += char(0xC0 | (Glyph >> 6));
+            Out += char(0x80 | (Glyph & 0x3F));
+        }
+        else if (Glyph < 0x10000) {
+            Out += char(0xE0 | (Glyph >> 12));
+            Out += char(0x80 | ((Glyph >> 6) & 0x3F));
+            Out += char(0x80 | (Glyph & 0x3F));
+        }
+        else {
+            Out += char(0xF0 | (Glyph >> 18));
+            Out += char(0x80 | ((Glyph >> 12) & 0x3F));
+            Out += char(0x80 | ((Glyph >> 6) & 0x3F));
+            Out += char(0x80 | (Glyph & 0x3F));
+        }
+    }
+
+    /**
+     * @class VirtualTerminal
+     * @brief Headless VT-style screen fed from a raw output byte stream
+     *
+     * The library renders into wide buffers whose units carry UTF-8 bytes
+     * packed two per unit (low byte first), padded with NUL bytes. The
+     * byte-level feed() accepts that stream exactly as it reaches a terminal,
+     * so NUL padding is ignored and multi-unit glyphs are reassembled.
+     *
+     * Queries that a real terminal would answer (cursor position report,
+     * primary device attributes) are recorded as replies which the caller can
+     * collect with take_replies() and forward to the program under test.
+     */
+    class VirtualTerminal {
+    private:
+        /**
+         * @brief Parser states
+         */
+        enum class state : uint8_t { ground, escape, escape_skip, csi, string, string_escape };
+
+        int Rows{ 24 };                 ///< Number of screen rows
+        int Cols{ 80 };                 ///< Number of screen columns
+        std::vector<vt_cell> Cells;     ///< Row-major cell grid
+
+        coord Cursor;                   ///< 0-based cursor position
+        coord SavedCursor;              ///< Position stored by ESC 7
+        bool CursorVisible{ true };     ///< Cursor visibility (DECTCEM)
+        bool WrapPending{ false };      ///< Deferred autowrap flag
+        vt_cell Pen;                    ///< Attributes applied to printed glyphs
+
+        state State{ state::ground };   ///< Current parser state
+        std::string Params;             ///< Accumulated CSI parameter bytes
+        char Private{ 0 };              ///< CSI private marker ('?', '>', '<', '=')
+        char Intermediate{ 0 };         ///< CSI intermediate byte (' ', '$', ...)
+
+        char32_t CodePoint{ 0 };        ///< UTF-8 decoder accumulator
+        int Pending{ 0 };               ///< Continuation bytes still expected
+
+        std::string Replies;            ///< Responses to terminal queries
+        uint64_t BytesFed{ 0 };         ///< Total bytes consumed
+
+        /**
+         * @brief Access a cell by position
+         */
+        vt_cell& cell(int Row, int Col) noexcept {
+            return Cells[size_t(Row) * Cols + Col];
+        }
+
+        /**
+         * @brief Clamp the cursor into the screen
+         */
+        void clamp_cursor() noexcept {
+            Cursor.Row = short(std::clamp<int>(Cursor.Row, 0, Rows - 1));
+            Cursor.Col = short(std::clamp<int>(Cursor.Col, 0, Cols - 1));
+            WrapPending = false;
+        }
+
+        /**
+         * @brief Blank a range of cells in a row using the current background
+         */
+        void erase(int Row, int First, int Last) noexcept {
+            vt_cell Blank;
+            Blank.B = Pen.B;
+            for (int c = std::max(First, 0); c <= std::min(Last, Cols - 1); ++c) {
+                cell(Row, c) = Blank;
+            }
+        }
+
+        /**
+         * @brief Scroll the whole screen up by one row
+         */
+        void scroll_up() noexcept {
+            std::move(Cells.begin() + Cols, Cells.end(), Cells.begin());
+            erase(Rows - 1, 0, Cols - 1);
+        }
+
+        /**
+         * @brief Move the cursor down one row, scrolling at the bottom
+         */
+        void line_feed() noexcept {
+            WrapPending = false;
+            if (Cursor.Row + 1 >= Rows) {
+                scroll_up();
+            }
+            else {
+                ++Cursor.Row;
+            }
+        }
+
+        /**
+         * @brief Place a glyph at the cursor and advance
+         */
+        void print(char32_t Glyph) noexcept {
+            if (WrapPending) {
+                Cursor.Col = 0;
+                line_feed();
+            }
+            vt_cell& c = cell(Cursor.Row, Cursor.Col);
+            c = Pen;
+            c.Glyph = Glyph;
+            if (Cursor.Col + 1 >= Cols) {
+                WrapPending = true;
+            }
+            else {
+                ++Cursor.Col;
+            }
+        }
+
+        /**
+         * @brief Read the Index-th numeric CSI parameter
+         *
+         * @param Index Zero-based parameter index
+         * @param Default Value returned for missing or zero parameters
+         */
+        int param(int Index, int Default) const noexcept {
+            int Value{ 0 };
+            bool Found{ false };
+            int Current{ 0 };
+            for (char ch : Params) {
+                if (ch == ';' || ch == ':') {
+                    if (Current == Index) break;
+                    ++Current;
+                    continue;
+                }
+                if (Current == Index && ch >= '0' && ch <= '9') {
+                    Value = Value * 10 + (ch - '0');
+                    Found = true;
+                }
+            }
+            return (Found && Value) ? Value : Default;
+        }
+
+        /**
+         * @brief Number of CSI parameters present
+         */
+        int param_count() const noexcept {
+            if (Params.empty()) return 0;
+            return 1 + int(std::count_if(Params.begin(), Params.end(),
+                [](char ch) { return ch == ';' || ch == ':'; }));
+        }
+
+        /**
+         * @brief Apply an SGR (select graphic rendition) sequence
+         */
+        void select_graphic_rendition() noexcept {
+            int Count = std::max(param_count(), 1);
+            for (int i = 0; i < Count; ++i) {
+                int p = param(i, 0);
+                switch (p) {
+                case 0: Pen = vt_cell{}; break;
+                case 1: Pen.Attr |= vt_cell::BOLD; break;
+                case 4: Pen.Attr |= vt_cell::UNDERLINE; break;
+                case 5: Pen.Attr |= vt_cell::BLINK; break;
+                case 7: Pen.Attr |= vt_cell::NEGATIVE; break;
+                case 22: Pen.Attr &= ~vt_cell::BOLD; break;
+                case 24: Pen.Attr &= ~vt_cell::UNDERLINE; break;
+                case 25: Pen.Attr &= ~vt_cell::BLINK; break;
+                case 27: Pen.Attr &= ~vt_cell::NEGATIVE; break;
+                case 39: Pen.F = vt_cell{}.F; break;
+                case 49: Pen.B = vt_cell{}.B; break;
+                case 38:
+                case 48:
+                    // Only the 24-bit form (38;2;r;g;b) is produced by the library
+                    if (param(i + 1, 0) == 2) {
+                        rgb X(param(i + 2, 0), param(i + 3, 0), param(i + 4, 0));
+                        (p == 38 ? Pen.F : Pen.B) = X;
+                        i += 4;
+                    }
+                    else if (param(i + 1, 0) == 5) {
+                        i += 2;
+                    }
+                    break;
+                default: break;
+                }
+            }
+        }
+
+        /**
+         * @brief Execute a complete CSI sequence
+         */
+        void dispatch_csi(char Final) noexcept {
+            if (Private == '?') {
+                // DEC private modes: only cursor visibility and the alternate
+                // screen change what the screen shows
+                if (Final == 'h' || Final == 'l') {
+                    int Mode = param(0, 0);
+                    if (Mode == 25) CursorVisible = (Final == 'h');
+                    if (Mode == 1049) erase_display(2);
+                }
+                return;
+            }
+            if (Private || Intermediate) {
+                // Cursor shape, kitty keyboard and similar requests
+                if (Private == '>' && Final == 'c') Replies += "\x1b[>0;0;0c";
+                return;
+            }
+
+            switch (Final) {
+            case 'H':
+            case 'f':
+                Cursor = coord{ param(0, 1) - 1, param(1, 1) - 1 };
+                clamp_cursor();
+                break;
+            case 'A': Cursor.Row -= short(param(0, 1)); clamp_cursor(); break;
+            case 'B': Cursor.Row += short(param(0, 1)); clamp_cursor(); break;
+            case 'C': Cursor.Col += short(param(0, 1)); clamp_cursor(); break;
+            case 'D': Cursor.Col -= short(param(0, 1)); clamp_cursor(); break;
+            case 'E': Cursor = coord{ Cursor.Row + param(0, 1), 0 }; clamp_cursor(); break;
+            case 'F': Cursor = coord{ Cursor.Row - param(0, 1), 0 }; clamp_cursor(); break;
+            case 'G': Cursor.Col = short(param(0, 1) - 1); clamp_cursor(); break;
+            case 'd': Cursor.Row = short(param(0, 1) - 1); clamp_cursor(); break;
+            case 'J': erase_display(param(0, 0)); break;
+            case 'K': {
+                int Mode = param(0, 0);
+                if (Mode == 0) erase(Cursor.Row, Cursor.Col, Cols - 1);
+                else if (Mode == 1) erase(Cursor.Row, 0, Cursor.Col);
+                else erase(Cursor.Row, 0, Cols - 1);
+                break;
+            }
+            case 'X': erase(Cursor.Row, Cursor.Col, Cursor.Col + param(0, 1) - 1); break;
+            case 'm': select_graphic_rendition(); break;
+            case 'n':
+                // Device status report: answer cursor position requests
+                if (param(0, 0) == 6) {
+                    Replies += "\x1b[" + std::to_string(Cursor.Row + 1) + ";" +
+                        std::to_string(Cursor.Col + 1) + "R";
+                }
+                break;
+            case 'c':
+                Replies += "\x1b[?62;22c";
+                break;
+            case 's': SavedCursor = Cursor; break;
+            case 'u': Cursor = SavedCursor; clamp_cursor(); break;
+            default: break;
+            }
+        }
+
+        /**
+         * @brief Erase part of the display (ED)
+         */
+        void erase_display(int Mode) noexcept {
+            if (Mode == 0) {
+                erase(Cursor.Row, Cursor.Col, Cols - 1);
+                for (int r = Cursor.Row + 1; r < Rows; ++r) erase(r, 0, Cols - 1);
+            }
+            else if (Mode == 1) {
+                for (int r = 0; r < Cursor.Row; ++r) erase(r, 0, Cols - 1);
+                erase(Cursor.Row, 0, Cursor.Col);
+            }
+            else {
+                for (int r = 0; r < Rows; ++r) erase(r, 0, Cols - 1);
+            }
+        }
+
+        /**
+         * @brief Handle a C0 control character
+         */
+        void control(unsigned char ch) noexcept {
+            switch (ch) {
+            case '\r': Cursor.Col = 0; WrapPending = false; break;
+            case '\n': line_feed(); break;
+            case '\b': if (Cursor.Col > 0) --Cursor.Col; WrapPending = false; break;
+            case '\t': Cursor.Col = short(std::min(Cols - 1, (Cursor.Col / 8 + 1) * 8)); break;
+            default: break;
+            }
+        }
+
+        /**
+         * @brief Feed one byte of the ground state through the UTF-8 decoder
+         */
+        void decode(unsigned char ch) noexcept {
+            if (Pending > 0 && (ch & 0xC0) == 0x80) {
+                CodePoint = (CodePoint << 6) | (ch & 0x3F);
+                if (--Pending == 0) print(CodePoint);
+                return;
+            }
+            Pending = 0;
+            if (ch < 0x80) print(ch);
+            else if ((ch & 0xE0) == 0xC0) { CodePoint = ch & 0x1F; Pending = 1; }
+            else if ((ch & 0xF0) == 0xE0) { CodePoint = ch & 0x0F; Pending = 2; }
+            else if ((ch & 0xF8) == 0xF0) { CodePoint = ch & 0x07; Pending = 3; }
+            else print(U'\xFFFD');
+        }
+
+    public:
+        /**
+         * @brief Construct a blank screen
+         *
+         * @param NumRows Number of rows
+         * @param NumCols Number of columns
+         */
+        explicit VirtualTerminal(int NumRows = 24, int NumCols = 80) noexcept {
+            resize(NumRows, NumCols);
+        }
+
+        /**
+         * @brief Resize and clear the screen
+         */
+        void resize(int NumRows, int NumCols) noexcept {
+            Rows = std::max(NumRows, 1);
+            Cols = std::max(NumCols, 1);
+            BytesFed = 0;
+            reset();
+        }
+
+        /**
+         * @brief Clear the screen and reset all parser and cursor state
+         */
+        void reset() noexcept {
+            Cells.assign(size_t(Rows) * Cols, vt_cell{});
+            Cursor = SavedCursor = coord{};
+            CursorVisible = true;
+            WrapPending = false;
+            Pen = vt_cell{};
+            State = state::ground;
+            Params.clear();
+            Private = Intermediate = 0;
+            Pending = 0;
+            Replies.clear();
+        }
+
+        /**
+         * @brief Interpret a raw terminal output byte stream
+         *
+         * @param Bytes Bytes exactly as they would reach a terminal
+         */
+        void feed(std::string_view Bytes) noexcept {
+            BytesFed += Bytes.size();
+            for (unsigned char ch : Bytes) {
+                if (ch == 0) continue;  // Padding emitted by 16-bit writes
+                switch (State) {
+                case state::ground:
+                    if (ch == 0x1b) { State = state::escape; Pending = 0; }
+                    else if (ch < 0x20 || ch == 0x7f) control(ch);
+                    else decode(ch);
+                    break;
+                case state::escape:
+                    State = state::ground;
+                    switch (ch) {
+                    case '[':
+                        State = state::csi;
+                        Params.clear();
+                        Private = Intermediate = 0;
+                        break;
+                    case ']': case 'P': case '_': case '^': State = state::string; break;
+                    case '(': case ')': case '#': State = state::escape_skip; break;
+                    case '7': SavedCursor = Cursor; break;
+                    case '8': Cursor = SavedCursor; clamp_cursor(); break;
+                    case 'c': reset(); break;
+                    default: break;
+                    }
+                    break;
+                case state::escape_skip:
+                    State = state::ground;
+                    break;
+                case state::csi:
+                    if ((ch >= '0' && ch <= '9') || ch == ';' || ch == ':') Params += char(ch);
+                    else if (ch >= '<' && ch <= '?') Private = char(ch);
+                    else if (ch >= 0x20 && ch <= 0x2f) Intermediate = char(ch);
+                    else if (ch >= 0x40 && ch <= 0x7e) {
+                        dispatch_csi(char(ch));
+                        State = state::ground;
+                    }
+                    else if (ch == 0x1b) State = state::escape;
+                    break;
+                case state::string:
+                    // OSC/DCS/APC payloads end with BEL or ST (ESC \)
+                    if (ch == 0x07) State = state::ground;
+                    else if (ch == 0x1b) State = state::string_escape;
+                    break;
+                case state::string_escape:
+                    State = (ch == '\\') ? state::ground : state::string;
+                    break;
+                }
+            }
+        }
+
+        /**
+         * @brief Interpret a wide buffer the way mz::Write sends it
+         *
+         * Each unit contributes its low byte then its high byte, matching the
+         * two-bytes-per-unit output of mz::Write(std::wstring_view).
+         *
+         * @param Units Buffer produced by a widget
+         */
+        void feed(std::wstring_view Units) noexcept {
+            std::string Bytes;
+            Bytes.reserve(Units.size() * 2);
+            for (wchar_t w : Units) {
+                Bytes += char(w & 0xff);
+                Bytes += char((w >> 8) & 0xff);
+            }
+            feed(std::string_view(Bytes));
+        }
+
+        /**
+         * @brief Get the number of rows
+         */
+        int rows() const noexcept { return Rows; }
+
+        /**
+         * @brief Get the number of columns
+         */
+        int cols() const noexcept { return Cols; }
+
+        /**
+         * @brief Get a cell by position
+         */
+        vt_cell const& at(int Row, int Col) const noexcept {
+            return Cells[size_t(Row) * Cols + Col];
+        }
+
+        /**
+         * @brief Get the 0-based cursor position
+         */
+        coord cursor_position() const noexcept { return Cursor; }
+
+        /**
+         * @brief Check whether the cursor is visible
+         */
+        bool cursor_visible() const noexcept { return CursorVisible; }
+
+        /**
+         * @brief Total number of bytes consumed
+         */
+        uint64_t bytes_fed() const noexcept { return BytesFed; }
+
+        /**
+         * @brief Collect and clear pending query responses
+         */
+        std::string take_replies() noexcept {
+            std::string Out;
+            Out.swap(Replies);
+            return Out;
+        }
+
+        /**
+         * @brief Get the text of a row as UTF-8 with trailing blanks removed
+         *
+         * @param Row 0-based row index
+         */
+        std::string row_text(int Row) const {
+            std::string Out;
+            for (int c = 0; c < Cols; ++c) {
+                append_utf8(Out, at(Row, c).Glyph);
+            }
+            Out.erase(Out.find_last_not_of(' ') + 1);
+            return Out;
+        }
+
+        /**
+         * @brief Find a UTF-8 string on the screen
+         *
+         * @param Text Text to search for (must not span rows)
+         * @return Position of the first match, or {-1, -1} if not found
+         */
+        coord find(std::string_view Text) const {
+            for (int r = 0; r < Rows; ++r) {
+                std::string Line = row_text(r);
+                if (size_t Pos = Line.find(Text); Pos != std::string::npos) {
+                    // Convert byte offset into a column count
+                    int Col = int(std::count_if(Line.begin(), Line.begin() + Pos,
+                        [](char ch) { return (static_cast<unsigned char>(ch) & 0xC0) != 0x80; }));
+                    return coord{ r, Col };
+                }
+            }
+            return coord{ -1, -1 };
+        }
+
+        /**
+         * @brief Check whether a UTF-8 string appears anywhere on the screen
+         */
+        bool contains(std::string_view Text) const {
+            return find(Text).Row >= 0;
+        }
+
+        /**
+         * @brief Render the whole screen as newline separated UTF-8 text
+         */
+        std::string dump() const {
+            std::string Out;
+            for (int r = 0; r < Rows; ++r) {
+                Out += row_text(r);
+                Out += '\n';
+            }
+            return Out;
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_VIRTUAL_TERMINAL_H
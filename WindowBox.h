@@ -28,11 +28,11 @@
 
 /**
  * @file WindowBox.h
- * @brief UI components for progress bars and scrollbars
+ * @brief UI components for progress bars, sparklines and scrollbars
  *
- * This file provides terminal UI components for displaying progress bars
- * and scrollbars in console applications. These components help create
- * more interactive and visual interfaces in text-based environments.
+ * This file provides terminal UI components for displaying progress bars,
+ * sparklines and scrollbars in console applications. These components help
+ * create more interactive and visual interfaces in text-based environments.
  *
  * @author Meysam Zare
  */
@@ -42,9 +42,160 @@
 #include "cursor.h"
 #include "ConsoleBoxes.h"
 #include <format>
+#include <vector>
+#include <algorithm>
+#include <thread>
+#include <chrono>
+#include <iostream>
 
 namespace mz {
 
+    /**
+     * @class cell_line
+     * @brief A row or column of cells that rewrites only what changed
+     *
+     * A widget composes the cells it wants in Next and calls flush(),
+     * which compares them with the cells written last time and emits
+     * only those that differ. The cursor is positioned only where a run
+     * of changed cells breaks.
+     */
+    class cell_line {
+    public:
+        /**
+         * @brief One cell: glyph and colors
+         */
+        struct cell {
+            wchar_t Glyph[2]{ L' ', 0 };  ///< Glyph units; the second is 0 for single-unit glyphs
+            rgb Front;                    ///< Foreground color
+            rgb Back;                     ///< Background color
+
+            friend constexpr bool operator == (cell const& L, cell const& R) noexcept {
+                return L.Glyph[0] == R.Glyph[0] && L.Glyph[1] == R.Glyph[1] && L.Front == R.Front && L.Back == R.Back;
+            }
+        };
+
+        /**
+         * @brief Cells to show on the next flush
+         */
+        std::vector<cell> Next;
+
+        /**
+         * @brief Make a cell from a two-unit glyph
+         */
+        static constexpr cell make(const wchar_t(&Glyph)[2], rgb Front, rgb Back) noexcept {
+            cell Cell;
+            Cell.Glyph[0] = Glyph[0];
+            Cell.Glyph[1] = Glyph[1];
+            Cell.Front = Front;
+            Cell.Back = Back;
+            return Cell;
+        }
+
+        /**
+         * @brief Make a cell from a single-unit glyph
+         */
+        static constexpr cell make(wchar_t Glyph, rgb Front, rgb Back) noexcept {
+            cell Cell;
+            Cell.Glyph[0] = Glyph;
+            Cell.Glyph[1] = 0;
+            Cell.Front = Front;
+            Cell.Back = Back;
+            return Cell;
+        }
+
+        /**
+         * @brief Make a left-aligned block covering Eighths/8 of the cell (1-8)
+         */
+        static constexpr cell left_block(int Eighths, rgb Front, rgb Back) noexcept {
+            wchar_t const Glyph[2]{ FULLBLOCK[0], static_cast<wchar_t>(0x90 - Eighths) };
+            return make(Glyph, Front, Back);
+        }
+
+        /**
+         * @brief Make a bottom-aligned block covering Eighths/8 of the cell (1-8)
+         */
+        static constexpr cell bottom_block(int Eighths, rgb Front, rgb Back) noexcept {
+            wchar_t const Glyph[2]{ FULLBLOCK[0], static_cast<wchar_t>(0x80 + Eighths) };
+            return make(Glyph, Front, Back);
+        }
+
+        /**
+         * @brief True if the cells on screen are known
+         */
+        bool valid() const noexcept {
+            return !Shown.empty();
+        }
+
+        /**
+         * @brief Forget what is on screen so the next flush writes every cell
+         */
+        void invalidate() noexcept {
+            Shown.clear();
+        }
+
+        /**
+         * @brief Write the cells of Next that differ from those on screen
+         *
+         * Everything is written when the line moved, changed length or
+         * was invalidated. Next is left empty for the following frame.
+         *
+         * @param bf Buffer to append drawing commands to
+         * @param Origin Screen position of the first cell
+         * @param Vertical True to stack the cells downwards from Origin
+         * @return true if anything was written
+         */
+        bool flush(std::wstring& bf, coord Origin, bool Vertical = false) noexcept {
+            bool Full = Shown.size() != Next.size() || !(ShownOrigin == Origin);
+            int NumCells = static_cast<int>(Next.size());
+
+            cursor Seq;
+            bool Started = false;
+            bool FrontSet = false;  // A space does not show the foreground, so it is set lazily
+            int At = -1;            // Cell the terminal cursor sits on, -1 if unknown
+
+            for (int i = 0; i < NumCells; ++i) {
+                cell const& Cell = Next[i];
+                if (!Full && Cell == Shown[i]) {
+                    continue;
+                }
+                if (!Started) {
+                    SetHide(bf);
+                    ClrUnderline(bf);
+                    ClrNegative(bf);
+                    Seq.set_back_rgb(bf, Cell.Back);
+                    Started = true;
+                }
+                if (At != i || Vertical) {
+                    (Vertical ? Origin.offset(i, 0) : Origin.offset(0, i)).apply(bf);
+                }
+                if (Cell.Glyph[0] != L' ' || Cell.Glyph[1]) {
+                    if (FrontSet) {
+                        Seq.update_front_rgb(bf, Cell.Front);
+                    }
+                    else {
+                        Seq.set_front_rgb(bf, Cell.Front);
+                        FrontSet = true;
+                    }
+                }
+                Seq.update_back_rgb(bf, Cell.Back);
+                bf.push_back(Cell.Glyph[0]);
+                if (Cell.Glyph[1]) {
+                    bf.push_back(Cell.Glyph[1]);
+                }
+                At = i + 1;
+            }
+
+            Shown.swap(Next);
+            Next.clear();
+            ShownOrigin = Origin;
+            return Started;
+        }
+
+    private:
+        std::vector<cell> Shown;  ///< Cells as last written, empty when unknown
+        coord ShownOrigin;        ///< Origin of the cells in Shown
+    };
+
     /**
      * @class ProgressBarControl
      * @brief Visual progress indicator for console applications
@@ -62,6 +213,28 @@ namespace mz {
          */
         int PreMessageSize{ 0 };
 
+        /**
+         * @brief Inputs of the bar last printed
+         */
+        render_memo Memo;
+
+        /**
+         * @brief Cells of the per-mille rendering, diffed on each update
+         */
+        cell_line Cells;
+
+        /**
+         * @brief Commands of the last per-mille update
+         */
+        std::wstring Delta;
+
+        /**
+         * @brief Hash the inputs of a render
+         */
+        uint64_t render_key(int ProgressPercentage) const noexcept {
+            return render_hash{}.add(ProgressPercentage).add(Color).add(Area).value();
+        }
+
         /**
          * @brief Update internal buffer with current progress
          *
@@ -141,6 +314,11 @@ namespace mz {
          */
         int Percentage{ 0 };
 
+        /**
+         * @brief Current progress in tenths of a percent (0-1000)
+         */
+        int PerMille{ 0 };
+
         /**
          * @brief Default constructor
          *
@@ -182,19 +360,23 @@ namespace mz {
 
             // Start with 0% progress
             Percentage = 0;
+            PerMille = 0;
             draw();
+            Memo.invalidate();
+            Cells.invalidate();
         }
 
         /**
          * @brief Update progress bar with new percentage
          *
-         * Sets the progress to the specified percentage and redraws if changed.
+         * Sets the progress to the specified percentage and redraws unless
+         * the bar on screen already shows it with the same colors and area.
          *
          * @param ProgressPercentage New progress value (0-100)
          */
         void update(int ProgressPercentage) noexcept {
-            // Only redraw if percentage changed or at 0%
-            if (ProgressPercentage != Percentage || !Percentage) {
+            ProgressPercentage = std::clamp(ProgressPercentage, 0, 100);
+            if (!Memo.skip(render_key(ProgressPercentage))) {
                 draw(ProgressPercentage);
             }
         }
@@ -210,10 +392,84 @@ namespace mz {
             // Constrain percentage to valid range
             ProgressPercentage = std::clamp(ProgressPercentage, 0, 100);
             Percentage = ProgressPercentage;
+            PerMille = Percentage * 10;
 
             // Update display
             draw();
             print();
+            Memo.store(render_key(Percentage));
+            Cells.invalidate();
+        }
+
+        /**
+         * @brief Update progress in tenths of a percent, writing only changed cells
+         *
+         * Fills the bar in eighths of a cell and labels it with one decimal
+         * place ("42.7%"). Only the cells that differ from the last update
+         * are written: usually the boundary cell and a label digit, so many
+         * bars can be updated for a few bytes each. Calling draw() repaints
+         * the whole bar and makes the next update write every cell again.
+         *
+         * @param Out Buffer to append drawing commands to
+         * @param Value New progress value (0-1000)
+         * @return true if anything was appended
+         */
+        bool update_permille(std::wstring& Out, int Value) noexcept {
+            Value = std::clamp(Value, 0, 1000);
+            PerMille = Value;
+            Percentage = Value / 10;
+            Memo.invalidate();
+
+            const int Width = Area.num_cols();
+            const long long Filled = 8LL * Width * Value / 1000;
+
+            // Label centered on the bar, dropped if it does not fit
+            wchar_t Label[8]{};
+            int LabelLength = 0;
+            if (Value >= 1000) { Label[LabelLength++] = L'1'; }
+            if (Value >= 100) { Label[LabelLength++] = static_cast<wchar_t>(L'0' + Value / 100 % 10); }
+            Label[LabelLength++] = static_cast<wchar_t>(L'0' + Value / 10 % 10);
+            Label[LabelLength++] = L'.';
+            Label[LabelLength++] = static_cast<wchar_t>(L'0' + Value % 10);
+            Label[LabelLength++] = L'%';
+            const int LabelStart = LabelLength <= Width ? (Width - LabelLength) / 2 : Width;
+
+            // Filled cells have the back color B, unfilled cells F
+            Cells.Next.clear();
+            for (int i = 0; i < Width; i++) {
+                const int Cover = static_cast<int>(std::clamp<long long>(Filled - 8LL * i, 0, 8));
+                if (i >= LabelStart && i < LabelStart + LabelLength) {
+                    const wchar_t c = Label[i - LabelStart];
+                    Cells.Next.push_back(Cover >= 4
+                        ? cell_line::make(c, Color.F, Color.B)
+                        : cell_line::make(c, Color.B, Color.F));
+                }
+                else if (Cover == 8) {
+                    Cells.Next.push_back(cell_line::make(L' ', Color.F, Color.B));
+                }
+                else if (Cover == 0) {
+                    Cells.Next.push_back(cell_line::make(L' ', Color.B, Color.F));
+                }
+                else {
+                    Cells.Next.push_back(cell_line::left_block(Cover, Color.B, Color.F));
+                }
+            }
+            return Cells.flush(Out, Area.Top);
+        }
+
+        /**
+         * @brief Update progress in tenths of a percent and write the changes
+         *
+         * @param Value New progress value (0-1000)
+         * @return true if anything was written
+         */
+        bool update_permille(int Value) noexcept {
+            Delta.clear();
+            if (!update_permille(Delta, Value)) {
+                return false;
+            }
+            mz::Write(Delta);
+            return true;
         }
 
         /**
@@ -230,8 +486,21 @@ namespace mz {
 
             for (int i = 0; i <= 100; i++) {
                 pbc.draw(i);
-                Sleep(100);
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+
+            // Same animation in per-mille steps, writing only changed cells
+            size_t Bytes{ 0 };
+            std::wstring Out;
+            for (int i = 0; i <= 1000; i++) {
+                Out.clear();
+                pbc.update_permille(Out, i);
+                Bytes += Out.size();
+                mz::Write(Out);
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
             }
+            std::wcout << std::format(L"\n {} per-mille updates, {:.1f} characters each\n",
+                1001, static_cast<double>(Bytes) / 1001);
         }
 
         /**
@@ -259,12 +528,147 @@ namespace mz {
         }
     };
 
+    /**
+     * @class SparklineBox
+     * @brief Single-row chart of recent values
+     *
+     * Keeps the most recent samples (one per column) and draws them with
+     * eighth-height block characters, newest on the right. The vertical
+     * range follows the samples unless a fixed range is set.
+     */
+    class SparklineBox : public BasicBox {
+    private:
+        /**
+         * @brief Sample history used as a ring buffer
+         */
+        std::vector<double> Samples;
+
+        /**
+         * @brief Index of the oldest sample
+         */
+        size_t Head{ 0 };
+
+        /**
+         * @brief Number of valid samples
+         */
+        size_t Count{ 0 };
+
+        /**
+         * @brief Fixed range (used when Low < High)
+         */
+        double Low{ 0 }, High{ 0 };
+
+        /**
+         * @brief Rebuild the buffer from the sample history
+         */
+        void draw() noexcept {
+            static constexpr wchar_t const* Levels[8]{
+                BBLOCK1, BBLOCK2, BBLOCK3, BBLOCK4, BBLOCK5, BBLOCK6, BBLOCK7, FULLBLOCK };
+
+            double Min{ Low }, Max{ High };
+            if (Min >= Max && Count) {
+                Min = Max = Samples[Head];
+                for (size_t i = 0; i < Count; i++) {
+                    double v = Samples[(Head + i) % Samples.size()];
+                    Min = v < Min ? v : Min;
+                    Max = v > Max ? v : Max;
+                }
+            }
+            const double Span = Max > Min ? Max - Min : 1.0;
+
+            bf.clear();
+            Color.apply(bf);
+            Area.Top.apply(bf);
+            SetHide(bf);
+            ClrUnderline(bf);
+            bf.append(Samples.size() - Count, ' ');
+            for (size_t i = 0; i < Count; i++) {
+                double v = Samples[(Head + i) % Samples.size()];
+                int Level = static_cast<int>((v - Min) / Span * 7.0 + 0.5);
+                Level = std::clamp(Level, 0, 7);
+                bf.append(Levels[Level], 2);
+            }
+        }
+
+    public:
+        /**
+         * @brief Initialize the sparkline
+         *
+         * @param Top Left end of the chart
+         * @param Width Number of samples shown (one per column)
+         */
+        void create(coord Top, int Width) noexcept {
+            Width = Width < 1 ? 1 : Width;
+            Area.Top = Top;
+            Area.set_size(1, Width);
+            Samples.assign(static_cast<size_t>(Width), 0.0);
+            Head = 0;
+            Count = 0;
+            bf.reserve(static_cast<size_t>(Width) * 2 + 100);
+            draw();
+        }
+
+        /**
+         * @brief Fix the vertical range
+         *
+         * Pass Min >= Max to return to automatic scaling.
+         */
+        void set_range(double Min, double Max) noexcept {
+            Low = Min;
+            High = Max;
+        }
+
+        /**
+         * @brief Append a sample and rebuild the buffer without printing
+         *
+         * The oldest sample scrolls off once the chart is full. Safe as a
+         * FrameComposer update, which writes the buffer out itself.
+         *
+         * @param Value New sample
+         */
+        void append(double Value) noexcept {
+            if (Samples.empty()) return;
+            if (Count < Samples.size()) {
+                Samples[(Head + Count++) % Samples.size()] = Value;
+            }
+            else {
+                Samples[Head] = Value;
+                Head = (Head + 1) % Samples.size();
+            }
+            draw();
+        }
+
+        /**
+         * @brief Append a sample and redraw
+         *
+         * @param Value New sample
+         */
+        void push(double Value) noexcept {
+            if (Samples.empty()) return;
+            append(Value);
+            print();
+        }
+
+        /**
+         * @brief Forget all samples and redraw empty
+         */
+        void clear() noexcept {
+            Head = 0;
+            Count = 0;
+            draw();
+            print();
+        }
+    };
+
     /**
      * @class BasicScrollBar
      * @brief Base class for scrollbar components
      *
      * Provides common properties and functionality for horizontal
-     * and vertical scrollbars.
+     * and vertical scrollbars. A bar remembers the glyph and colors of
+     * every cell it last wrote, so a redraw emits only the cells that
+     * changed: moving the thumb by one step touches its one or two end
+     * cells. Thumb ends use eighth-block glyphs for sub-cell precision.
      */
     class BasicScrollBar {
     public:
@@ -331,6 +735,113 @@ namespace mz {
             ScrollColors.F = thumbColor;
             ScrollColors.B = trackColor;
         }
+
+        /**
+         * @brief Forget what is on screen so the next draw writes every cell
+         *
+         * Call after the bar's area was painted over by something else.
+         * Moving or resizing the bar invalidates it automatically.
+         */
+        void invalidate() const noexcept {
+            Cells.invalidate();
+        }
+
+    protected:
+        mutable cell_line Cells;    ///< Arrow, track and thumb cells
+        mutable coord ShownTopLeft; ///< TopLeft when Cells were written
+        mutable int ShownPre{ 0 };  ///< PreLength when Cells were written
+        mutable int ShownPost{ 0 }; ///< PostLength when Cells were written
+        mutable rgb ShownBack;      ///< BackRGB when Cells were written
+
+        /**
+         * @brief Make an arrow cell, bright when there is more to scroll to
+         */
+        template<typename G>
+        cell_line::cell arrow_cell(G const& Glyph, bool Active) const noexcept {
+            return cell_line::make(Glyph, Active ? ScrollColors.F : ScrollColors.B, BackRGB);
+        }
+
+        /**
+         * @brief Compute the thumb extent in eighths of a cell
+         *
+         * The thumb is at least one cell long and slides over the
+         * remaining track in proportion to First.
+         *
+         * @param NumCells Number of track cells
+         * @param First Index of the first visible item
+         * @param Visible Number of items in view
+         * @param NumItems Total number of items (the whole track if they all fit)
+         * @param Start Receives the first eighth covered by the thumb
+         * @param Length Receives the number of eighths covered
+         */
+        static void thumb_eighths(int NumCells, int First, int Visible, int NumItems, int& Start, int& Length) noexcept {
+            long long Track = 8LL * NumCells;
+            long long Len = Track * Visible / NumItems;
+            Len = std::clamp<long long>(Len, std::min<long long>(8, Track), Track);
+            long long Range = static_cast<long long>(NumItems) - Visible;
+            if (Range <= 0) {
+                Start = 0;
+                Length = static_cast<int>(Track);
+                return;
+            }
+            long long Pos = std::clamp<long long>(First, 0, Range);
+            Start = static_cast<int>(((Track - Len) * Pos + Range / 2) / Range);
+            Length = static_cast<int>(Len);
+        }
+
+        /**
+         * @brief Share of track cell i covered by the thumb
+         *
+         * @param i Track cell index
+         * @param Start First eighth covered by the thumb
+         * @param Length Number of eighths covered
+         * @param From Receives the first covered eighth within the cell
+         * @return Number of covered eighths within the cell (0-8)
+         */
+        static int covered(int i, int Start, int Length, int& From) noexcept {
+            int Lo = i * 8;
+            int A = std::max(Start, Lo);
+            int B = std::min(Start + Length, Lo + 8);
+            From = A - Lo;
+            return B > A ? B - A : 0;
+        }
+
+        /**
+         * @brief Write the composed cells that changed since the last draw
+         *
+         * Writes everything, including the Pre/Post spaces of a
+         * horizontal bar, when the bar was moved, resized or invalidated.
+         *
+         * @param bf Buffer to append drawing commands to
+         * @param Vertical True to stack the cells downwards from TopLeft
+         */
+        void render(std::wstring& bf, bool Vertical) const noexcept {
+            if (!(ShownTopLeft == TopLeft) || ShownPre != PreLength
+                || ShownPost != PostLength || !(ShownBack == BackRGB)) {
+                Cells.invalidate();
+            }
+            int Lead = Vertical ? 0 : std::max(PreLength, 0);
+
+            if (!Cells.valid() && !Vertical && (Lead > 0 || PostLength > 0)) {
+                cursor Seq;
+                SetHide(bf);
+                Seq.set_back_rgb(bf, BackRGB);
+                if (Lead > 0) {
+                    TopLeft.apply(bf);
+                    bf.append(Lead, L' ');
+                }
+                if (PostLength > 0) {
+                    TopLeft.offset(0, Lead + static_cast<int>(Cells.Next.size())).apply(bf);
+                    bf.append(PostLength, L' ');
+                }
+            }
+            Cells.flush(bf, TopLeft.offset(0, Lead), Vertical);
+
+            ShownTopLeft = TopLeft;
+            ShownPre = PreLength;
+            ShownPost = PostLength;
+            ShownBack = BackRGB;
+        }
     };
 
     /**
@@ -361,127 +872,51 @@ namespace mz {
          * @brief Draw the scrollbar
          *
          * Renders the horizontal scrollbar to represent the current
-         * scroll position within a collection of items.
+         * scroll position within a collection of items. Only cells that
+         * changed since the last draw are written.
          *
          * @param bf Buffer to append drawing commands to
          * @param FirstItem Index of first visible item
          * @param NumItems Total number of items
          */
         void draw(std::wstring& bf, int FirstItem, int NumItems) const noexcept {
-            // Set cursor position to start of scrollbar
-            coord Loc{ TopLeft };
-
             // Ensure bar length is valid
-            int NumBars = BarLength;
-            NumBars = NumBars > 0 ? NumBars : 0;
-
-            // Setup display
-            SetHide(bf);
-            ClrUnderline(bf);
-            BackRGB.setBack(bf);
-
-            // Position cursor
-            Loc.apply(bf);
-
-            // Add pre-scrollbar space if needed
-            if (PreLength > 0) {
-                Loc.append(bf, PreLength, ' ');
-            }
-
-            // If all items fit in view, show inactive scrollbar
-            if (NumItems <= BarLength) {
-                ScrollColors.B.setFront(bf);
-                Loc.push_back(bf, LHEAD);  // Left arrow
-
-                // Draw inactive scrollbar of full width
-                for (int i = 0; i < BarLength; i++) {
-                    Loc.push_back(bf, FSQUARE);
-                }
-
-                Loc.push_back(bf, RHEAD);  // Right arrow
+            int NumBars = BarLength > 0 ? BarLength : 0;
+
+            // Thumb extent in eighths; the whole track when all items fit
+            bool Active = NumItems > BarLength;
+            int Start = 0;
+            int Length = 8 * NumBars;
+            if (Active) {
+                thumb_eighths(NumBars, FirstItem, BarLength, NumItems, Start, Length);
             }
-            else {
-                // Calculate thumb position and size
-                int thumbStart = 0;
-                int thumbEnd = (FirstItem + BarLength) * BarLength / NumItems;
-
-                // Ensure thumb is visible and sized appropriately
-                if (thumbEnd >= BarLength) {
-                    thumbEnd = BarLength - (FirstItem + BarLength < NumItems ? 1 : 0);
-                }
-
-                if (thumbEnd > 0) {
-                    // Calculate thumb start based on its size and position
-                    thumbStart = thumbEnd - BarLength * BarLength / NumItems;
-                    thumbStart -= (thumbStart == thumbEnd ? 1 : 0);
-                    thumbStart = thumbStart > 0 ? thumbStart : 0;
-                }
-                else {
-                    // Minimum thumb size
-                    thumbStart = 0;
-                    thumbEnd = 1;
-                }
-
-                // Adjust for special case at beginning
-                if (thumbStart == 0 && FirstItem > 0) {
-                    ++thumbStart;
-                    ++thumbEnd;
-                }
-
-                // Set up cursor control sequence
-                cursor Seq;
-
-                // Left arrow color based on scroll position
-                if (thumbStart > 0) {
-                    Seq.set_front_rgb(bf, ScrollColors.F);  // Active
-                }
-                else {
-                    Seq.set_front_rgb(bf, ScrollColors.B);  // Inactive
-                }
-
-                // Draw left arrow
-                Loc.push_back(bf, LHEAD);
 
-                // Draw track before thumb
-                if (thumbStart > 0) {
-                    Seq.update_front_rgb(bf, ScrollColors.B);
-                    for (int i = 0; i < thumbStart; i++) {
-                        Loc.push_back(bf, FSQUARE);
-                    }
-                }
+            rgb Thumb = ScrollColors.F;
+            rgb Track = ScrollColors.B;
 
-                // Draw thumb
-                if (thumbStart < thumbEnd) {
-                    Seq.update_front_rgb(bf, ScrollColors.F);
-                    for (int i = thumbStart; i < thumbEnd; i++) {
-                        Loc.push_back(bf, FSQUARE);
-                    }
+            Cells.Next.clear();
+            Cells.Next.push_back(arrow_cell(LHEAD, Active && Start > 0));
+            for (int i = 0; i < NumBars; i++) {
+                int From = 0;
+                int Cover = Active ? covered(i, Start, Length, From) : 0;
+                if (Cover == 0) {
+                    Cells.Next.push_back(cell_line::make(L' ', Thumb, Track));
                 }
-
-                // Draw track after thumb
-                if (thumbEnd < NumBars) {
-                    Seq.update_front_rgb(bf, ScrollColors.B);
-                    for (int i = thumbEnd; i < NumBars; i++) {
-                        Loc.push_back(bf, FSQUARE);
-                    }
+                else if (Cover == 8) {
+                    Cells.Next.push_back(cell_line::make(FULLBLOCK, Thumb, Track));
                 }
-
-                // Right arrow color based on scroll position
-                if (thumbEnd < NumBars) {
-                    Seq.update_front_rgb(bf, ScrollColors.F);  // Active
+                else if (From > 0) {
+                    // Thumb starts inside the cell: the left part is track
+                    Cells.Next.push_back(cell_line::left_block(From, Track, Thumb));
                 }
                 else {
-                    Seq.update_front_rgb(bf, ScrollColors.B);  // Inactive
+                    // Thumb ends inside the cell: the left part is thumb
+                    Cells.Next.push_back(cell_line::left_block(Cover, Thumb, Track));
                 }
-
-                // Draw right arrow
-                Loc.push_back(bf, RHEAD);
             }
+            Cells.Next.push_back(arrow_cell(RHEAD, Active && Start + Length < 8 * NumBars));
 
-            // Add post-scrollbar space if needed
-            if (PostLength > 0) {
-                Loc.append(bf, PostLength, ' ');
-            }
+            render(bf, false);
         }
     };
 
@@ -513,131 +948,53 @@ namespace mz {
          * @brief Draw the scrollbar
          *
          * Renders the vertical scrollbar to represent the current
-         * scroll position within a collection of items.
+         * scroll position within a collection of items. Only cells that
+         * changed since the last draw are written.
          *
          * @param bf Buffer to append drawing commands to
          * @param FirstRow Index of first visible row
          * @param NumItems Total number of items
          */
         void draw(std::wstring& bf, int FirstRow, int NumItems) const noexcept {
-            // Set up cursor control sequence
-            cursor Seq;
-
-            // Setup display
-            SetHide(bf);
-            ClrUnderline(bf);
-            BackRGB.setBack(bf);
-
-            // Position cursor
-            coord Loc{ TopLeft };
-            Loc.apply(bf);
-
             // Calculate usable bar length (excluding arrows)
-            int NumBars = BarLength - 2;
-
-            // Track start and end positions
-            int thumbStart = 0;
-            int thumbEnd = 0;
-
-            // If all items fit in view, show inactive scrollbar
-            if (NumItems < BarLength) {
-                thumbStart = 0;
-                thumbEnd = NumBars;
-
-                // Draw inactive up arrow
-                Seq.set_front_rgb(bf, ScrollColors.B);
-                Loc.push_back(bf, TRIUP);
-
-                // Draw inactive scrollbar body
-                Seq.set_back_rgb(bf, ScrollColors.B);
-                for (int i = 0; i < NumBars; i++) {
-                    Loc.move_left(bf);
-                    Loc.move_down(bf);
-                    Loc.push_back(bf, ' ');
-                }
-
-                // Restore background color
-                Seq.update_back_rgb(bf, BackRGB);
+            int NumBars = BarLength > 2 ? BarLength - 2 : 0;
+
+            // Thumb extent in eighths; the whole track when all items fit
+            bool Active = NumItems > BarLength;
+            int Start = 0;
+            int Length = 8 * NumBars;
+            if (Active) {
+                thumb_eighths(NumBars, FirstRow, BarLength, NumItems, Start, Length);
             }
-            else {
-                // Calculate thumb position and size
-                thumbEnd = (FirstRow + BarLength) * NumBars / NumItems;
 
-                // Ensure thumb is visible and sized appropriately
-                if (thumbEnd >= NumBars) {
-                    thumbEnd = NumBars - (FirstRow + BarLength < NumBars ? 1 : 0);
-                }
+            rgb Thumb = ScrollColors.F;
+            rgb Track = ScrollColors.B;
 
-                if (thumbEnd > 0) {
-                    // Calculate thumb start based on its size and position
-                    thumbStart = thumbEnd - BarLength * NumBars / NumItems;
-                    thumbStart -= (thumbStart == thumbEnd ? 1 : 0);
-                    thumbStart = thumbStart > 0 ? thumbStart : 0;
+            Cells.Next.clear();
+            Cells.Next.push_back(arrow_cell(TRIUP, Active && Start > 0));
+            for (int i = 0; i < NumBars; i++) {
+                int From = 0;
+                int Cover = Active ? covered(i, Start, Length, From) : 0;
+                if (Cover == 0) {
+                    Cells.Next.push_back(cell_line::make(L' ', Thumb, Track));
                 }
-                else {
-                    // Minimum thumb size
-                    thumbStart = 0;
-                    thumbEnd = 1;
-                }
-
-                // Adjust for special case at beginning
-                if (thumbStart == 0 && FirstRow > 0) {
-                    ++thumbStart;
-                    ++thumbEnd;
+                else if (Cover == 8) {
+                    Cells.Next.push_back(cell_line::make(FULLBLOCK, Thumb, Track));
                 }
-
-                // Up arrow color based on scroll position
-                if (thumbStart > 0) {
-                    Seq.set_front_rgb(ScrollColors.F);  // Active
+                else if (From > 0) {
+                    // Thumb starts inside the cell: the bottom part is thumb
+                    Cells.Next.push_back(cell_line::bottom_block(Cover, Thumb, Track));
                 }
                 else {
-                    Seq.set_front_rgb(ScrollColors.B);  // Inactive
-                }
-
-                // Draw up arrow
-                Seq.apply(bf);
-                Loc.push_back(bf, TRIUP);
-
-                // Set color for track
-                Seq.update_front_rgb(bf, ScrollColors.F);
-                Seq.update_back_rgb(bf, ScrollColors.B);
-
-                // Draw track before thumb
-                for (int i = 0; i < thumbStart; i++) {
-                    Loc.move_left(bf);
-                    Loc.move_down(bf);
-                    Loc.push_back(bf, ' ');
-                }
-
-                // Draw thumb (inverted colors)
-                SetNegative(bf);
-                for (int i = thumbStart; i < thumbEnd; i++) {
-                    Loc.move_left(bf);
-                    Loc.move_down(bf);
-                    Loc.push_back(bf, ' ');
-                }
-                ClrNegative(bf);
-
-                // Draw track after thumb
-                for (int i = thumbEnd; i < NumBars; i++) {
-                    Loc.move_left(bf);
-                    Loc.move_down(bf);
-                    Loc.push_back(bf, ' ');
-                }
-
-                // Restore background color
-                Seq.update_back_rgb(bf, BackRGB);
-
-                // Down arrow color based on scroll position
-                if (thumbEnd == NumBars) {
-                    Seq.update_front_rgb(bf, ScrollColors.B);  // Inactive
+                    // Thumb ends inside the cell: the bottom part is track
+                    Cells.Next.push_back(cell_line::bottom_block(8 - Cover, Track, Thumb));
                 }
             }
+            if (BarLength > 1) {
+                Cells.Next.push_back(arrow_cell(TRIDOWN, Active && Start + Length < 8 * NumBars));
+            }
 
-            // Draw down arrow
-            Loc.move_left(bf);
-            Loc.move_down(bf);
-            Loc.push_back(bf, TRIDOWN);
+            render(bf, true);
         }
     };
 
@@ -0,0 +1,216 @@
+/*
+* MIT License
+*
+* Copyright (c) 2021-2024 Meysam Zare
+*
+* Permission is hereby granted, free of charge, to any person obtaining a copy
+* of this software and associated documentation files (the "Software"), to deal
+* in the Software without restriction, including without limitation the rights
+* to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+* copies of the Software, and to permit persons to whom the Software is
+* furnished to do so, subject to the following conditions:
+*
+* The above copyright notice and this permission notice shall be included in all
+* copies or substantial portions of the Software.
+*
+* THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+* IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+* FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+* AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+* LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+* OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+* SOFTWARE.
+*/
+
+#ifndef MZ_WORKER_POOL_H
+#define MZ_WORKER_POOL_H
+#pragma once
+
+/**
+ * @file WorkerPool.h
+ * @brief Fixed-size thread pool for data-parallel batches
+ *
+ * WorkerPool runs a batch of indexed tasks on a set of long-lived threads.
+ * The calling thread takes part in the batch and run() returns once every
+ * task has finished, so a batch behaves like an ordinary loop that happens
+ * to use several cores. Calls made from inside a task run sequentially on
+ * the calling thread instead of deadlocking.
+ *
+ * @author Meysam Zare
+ */
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include <cstddef>
+#include <cstdint>
+
+namespace mz {
+
+    /**
+     * @class WorkerPool
+     * @brief Runs batches of indexed tasks on several threads
+     *
+     * @code
+     * WorkerPool Pool;
+     * Pool.run(Items.size(), [&](size_t i) { process(Items[i]); });
+     * @endcode
+     */
+    class WorkerPool {
+    private:
+        std::vector<std::thread> Threads;       ///< Worker threads (the caller is not included)
+        std::mutex Lock;                        ///< Guards the batch state below
+        std::condition_variable Wake;           ///< Signals workers that a batch started or the pool stops
+        std::condition_variable Done;           ///< Signals the caller that workers left the batch
+        std::mutex RunLock;                     ///< Serializes batches from different threads
+
+        std::function<void(size_t)> const* Task{ nullptr };    ///< Task of the current batch
+        size_t NumTasks{ 0 };                   ///< Number of tasks in the current batch
+        std::atomic<size_t> Next{ 0 };          ///< Next task index to hand out
+        uint64_t Generation{ 0 };               ///< Incremented for every batch
+        int Busy{ 0 };                          ///< Workers still inside the current batch
+        bool Stopping{ false };                 ///< Pool is being destroyed
+
+        /**
+         * @brief Set while a thread executes a task of any pool
+         */
+        static inline thread_local bool InsideTask{ false };
+
+        /**
+         * @brief Take tasks of the current batch until none are left
+         */
+        void drain(std::function<void(size_t)> const& Fn, size_t Count) noexcept {
+            bool WasInside = InsideTask;
+            InsideTask = true;
+            for (size_t i = Next.fetch_add(1); i < Count; i = Next.fetch_add(1)) {
+                Fn(i);
+            }
+            InsideTask = WasInside;
+        }
+
+        /**
+         * @brief Worker thread body
+         */
+        void work() noexcept {
+            uint64_t Seen{ 0 };
+            while (true) {
+                std::function<void(size_t)> const* Fn;
+                size_t Count;
+                {
+                    std::unique_lock<std::mutex> Guard(Lock);
+                    Wake.wait(Guard, [&] { return Stopping || Generation != Seen; });
+                    if (Stopping) return;
+                    Seen = Generation;
+                    if (!Task) continue;    // The batch finished without this worker
+                    Fn = Task;
+                    Count = NumTasks;
+                    ++Busy;
+                }
+                drain(*Fn, Count);
+                {
+                    std::lock_guard<std::mutex> Guard(Lock);
+                    --Busy;
+                }
+                Done.notify_one();
+            }
+        }
+
+    public:
+        /**
+         * @brief Start the pool
+         *
+         * @param NumThreads Total threads taking part in a batch, the caller
+         *        included (0 for the number of hardware threads)
+         */
+        explicit WorkerPool(unsigned NumThreads = 0) {
+            if (NumThreads == 0) {
+                NumThreads = std::thread::hardware_concurrency();
+            }
+            if (NumThreads == 0) {
+                NumThreads = 1;
+            }
+            Threads.reserve(NumThreads - 1);
+            for (unsigned i = 1; i < NumThreads; i++) {
+                Threads.emplace_back([this] { work(); });
+            }
+        }
+
+        WorkerPool(WorkerPool const&) = delete;
+        WorkerPool& operator=(WorkerPool const&) = delete;
+
+        /**
+         * @brief Stop and join all worker threads
+         */
+        ~WorkerPool() noexcept {
+            {
+                std::lock_guard<std::mutex> Guard(Lock);
+                Stopping = true;
+            }
+            Wake.notify_all();
+            for (auto& t : Threads) {
+                t.join();
+            }
+        }
+
+        /**
+         * @brief Number of threads taking part in a batch, the caller included
+         */
+        size_t size() const noexcept {
+            return Threads.size() + 1;
+        }
+
+        /**
+         * @brief Run Fn(0) .. Fn(Count - 1) and wait for all of them
+         *
+         * Tasks may run in any order and on any thread. Called from inside a
+         * task, or on a pool without workers, the tasks run in order on the
+         * calling thread.
+         *
+         * @param Count Number of tasks
+         * @param Fn Task body, called with the task index
+         */
+        void run(size_t Count, std::function<void(size_t)> const& Fn) noexcept {
+            if (Count == 0) return;
+            if (InsideTask || Threads.empty() || Count == 1) {
+                for (size_t i = 0; i < Count; i++) {
+                    Fn(i);
+                }
+                return;
+            }
+
+            std::lock_guard<std::mutex> Serial(RunLock);
+            {
+                std::lock_guard<std::mutex> Guard(Lock);
+                Task = &Fn;
+                NumTasks = Count;
+                Next = 0;
+                ++Generation;
+            }
+            Wake.notify_all();
+
+            drain(Fn, Count);
+
+            // Workers may still be finishing their last task
+            std::unique_lock<std::mutex> Guard(Lock);
+            Done.wait(Guard, [&] { return Busy == 0; });
+            Task = nullptr;
+            NumTasks = 0;
+        }
+
+        /**
+         * @brief Get a pool shared by the whole process
+         *
+         * Created on first use with one thread per hardware thread.
+         */
+        static WorkerPool& shared() {
+            static WorkerPool Pool;
+            return Pool;
+        }
+    };
+
+} // namespace mz
+
+#endif // MZ_WORKER_POOL_H